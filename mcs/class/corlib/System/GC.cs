@@ -110,6 +110,16 @@ namespace System
 			RecordPressure (-bytesAllocated);
 		}
 
+		// Rents a pinned byte[] of at least minimumLength bytes for I/O. The contents
+		// are not cleared.
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		internal extern static byte[] RentPinnedBuffer (int minimumLength);
+
+		// Gives a buffer obtained from RentPinnedBuffer back to the runtime. The
+		// caller must not use it afterwards.
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		internal extern static void ReturnPinnedBuffer (byte[] buffer);
+
 		[PermissionSetAttribute (SecurityAction.LinkDemand, Name = "FullTrust")]
 		[MonoTODO]
 		public static GCNotificationStatus WaitForFullGCApproach () {
@@ -1408,6 +1408,157 @@ typedef union {
 
 #define amd64_sse_prefetch_reg_membase(inst, arg, basereg, disp) emit_sse_reg_membase_op2((inst), (arg), (basereg), (disp), 0x0f, 0x18)
 
+/* AVX defines */
+
+/* The implied legacy prefix (VEX.pp) */
+#define AMD64_VEX_PP_NONE 0
+#define AMD64_VEX_PP_66 1
+#define AMD64_VEX_PP_F3 2
+#define AMD64_VEX_PP_F2 3
+
+/* The implied leading opcode bytes (VEX.mmmmm) */
+#define AMD64_VEX_MAP_0F 1
+#define AMD64_VEX_MAP_0F38 2
+#define AMD64_VEX_MAP_0F3A 3
+
+/* The vector length (VEX.L) */
+#define AMD64_VEX_L128 0
+#define AMD64_VEX_L256 1
+
+/*
+ * Emit a VEX prefix. REG, INDEX and RM_BASE are the registers encoded in the modrm/sib
+ * bytes, which select the R, X and B bits, while VREG is the additional source operand.
+ * The two byte form is used when possible.
+ */
+#define amd64_vex_emit(inst,map,w,vreg,l,pp,reg,index,rm_base) do { \
+	if ((map) == AMD64_VEX_MAP_0F && !(w) && (index) < 8 && (rm_base) < 8) { \
+		*(inst)++ = (unsigned char)0xc5; \
+		*(inst)++ = (unsigned char)((((reg) > 7) ? 0 : 0x80) | ((~(vreg) & 0xf) << 3) | ((l) << 2) | (pp)); \
+	} else { \
+		*(inst)++ = (unsigned char)0xc4; \
+		*(inst)++ = (unsigned char)((((reg) > 7) ? 0 : 0x80) | (((index) > 7) ? 0 : 0x40) | (((rm_base) > 7) ? 0 : 0x20) | (map)); \
+		*(inst)++ = (unsigned char)(((w) ? 0x80 : 0) | ((~(vreg) & 0xf) << 3) | ((l) << 2) | (pp)); \
+	} \
+} while (0)
+
+#define emit_vex_reg_reg_reg(inst,dreg,sreg1,sreg2,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_emit ((inst), (map), 0, (sreg1), (l), (pp), (dreg), 0, (sreg2)); \
+    *(inst)++ = (unsigned char)(op); \
+    x86_reg_emit ((inst), (dreg), (sreg2)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define emit_vex_reg_reg_reg_imm(inst,dreg,sreg1,sreg2,l,pp,map,op,imm) do { \
+    amd64_codegen_pre(inst); \
+    emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), (pp), (map), (op)); \
+    x86_imm_emit8 ((inst), (imm)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+/* Shifts by an immediate, where the modrm reg field holds an opcode extension */
+#define emit_vex_shift_reg_imm(inst,dreg,reg,l,op,ext,imm) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_emit ((inst), AMD64_VEX_MAP_0F, 0, (dreg), (l), AMD64_VEX_PP_66, 0, 0, (reg)); \
+    *(inst)++ = (unsigned char)(op); \
+    x86_reg_emit ((inst), (ext), (reg)); \
+    x86_imm_emit8 ((inst), (imm)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define emit_vex_reg_membase(inst,dreg,basereg,disp,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_emit ((inst), (map), 0, 0, (l), (pp), (dreg), 0, (basereg) == AMD64_RIP ? 0 : (basereg)); \
+    *(inst)++ = (unsigned char)(op); \
+    amd64_membase_emit ((inst), (dreg), (basereg), (disp)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define emit_vex_membase_reg(inst,basereg,disp,reg,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_emit ((inst), (map), 0, 0, (l), (pp), (reg), 0, (basereg) == AMD64_RIP ? 0 : (basereg)); \
+    *(inst)++ = (unsigned char)(op); \
+    amd64_membase_emit ((inst), (reg), (basereg), (disp)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+/* specific AVX opcode defines, L selects between the xmm and the ymm forms */
+
+#define amd64_vex_addps_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x58)
+
+#define amd64_vex_subps_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5c)
+
+#define amd64_vex_mulps_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x59)
+
+#define amd64_vex_divps_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5e)
+
+#define amd64_vex_pand_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xdb)
+
+#define amd64_vex_por_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xeb)
+
+#define amd64_vex_pxor_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xef)
+
+#define amd64_vex_paddb_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfc)
+
+#define amd64_vex_paddw_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfd)
+
+#define amd64_vex_paddd_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfe)
+
+#define amd64_vex_paddq_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xd4)
+
+#define amd64_vex_psubb_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf8)
+
+#define amd64_vex_psubw_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf9)
+
+#define amd64_vex_psubd_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfa)
+
+#define amd64_vex_psubq_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfb)
+
+#define amd64_vex_pmullw_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xd5)
+
+#define amd64_vex_pmulld_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x40)
+
+#define amd64_vex_psadbw_reg_reg_reg(inst,dreg,sreg1,sreg2,l) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf6)
+
+#define amd64_vex_pshufd_reg_reg_imm(inst,dreg,reg,imm,l) emit_vex_reg_reg_reg_imm ((inst), (dreg), 0, (reg), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x70, (imm))
+
+#define amd64_vex_pslld_reg_imm(inst,dreg,reg,imm,l) emit_vex_shift_reg_imm ((inst), (dreg), (reg), (l), 0x72, 6, (imm))
+
+#define amd64_vex_psrld_reg_imm(inst,dreg,reg,imm,l) emit_vex_shift_reg_imm ((inst), (dreg), (reg), (l), 0x72, 2, (imm))
+
+#define amd64_vex_psrad_reg_imm(inst,dreg,reg,imm,l) emit_vex_shift_reg_imm ((inst), (dreg), (reg), (l), 0x72, 4, (imm))
+
+#define amd64_vex_movaps_reg_reg(inst,dreg,reg,l) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x28)
+
+#define amd64_vex_movups_reg_membase(inst,dreg,basereg,disp,l) emit_vex_reg_membase ((inst), (dreg), (basereg), (disp), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x10)
+
+#define amd64_vex_movups_membase_reg(inst,basereg,disp,reg,l) emit_vex_membase_reg ((inst), (basereg), (disp), (reg), (l), AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x11)
+
+#define amd64_vex_movd_xreg_reg(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), AMD64_VEX_L128, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x6e)
+
+#define amd64_vex_movd_reg_xreg(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (reg), 0, (dreg), AMD64_VEX_L128, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0x7e)
+
+#define amd64_vex_cvtsd2ss_reg_reg(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), (reg), (reg), AMD64_VEX_L128, AMD64_VEX_PP_F2, AMD64_VEX_MAP_0F, 0x5a)
+
+/* AVX2: broadcast the low element of the xmm reg REG */
+#define amd64_vex_pbroadcastb_reg_reg(inst,dreg,reg,l) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x78)
+
+#define amd64_vex_pbroadcastd_reg_reg(inst,dreg,reg,l) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x58)
+
+#define amd64_vex_broadcastss_reg_reg(inst,dreg,reg,l) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), (l), AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x18)
+
+/* AVX2: extract the 128 bit lane IMM of the ymm reg REG into the xmm reg DREG */
+#define amd64_vex_extracti128_reg_reg_imm(inst,dreg,reg,imm) emit_vex_reg_reg_reg_imm ((inst), (reg), 0, (dreg), AMD64_VEX_L256, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F3A, 0x39, (imm))
+
+/* Zero the upper halves of all ymm regs, to avoid the SSE/AVX transition penalties */
+#define amd64_vex_zeroupper(inst) do { \
+    amd64_codegen_pre(inst); \
+    *(inst)++ = (unsigned char)0xc5; \
+    *(inst)++ = (unsigned char)0xf8; \
+    *(inst)++ = (unsigned char)0x77; \
+    amd64_codegen_post(inst); \
+} while (0)
+
 /* Generated from x86-codegen.h */
 
 #define amd64_breakpoint_size(inst,size) do { x86_breakpoint(inst); } while (0)
@@ -0,0 +1,56 @@
+using System;
+using System.Diagnostics;
+using System.Threading;
+
+/*
+ * Measures the throughput of a lock held for very short critical sections
+ * by an increasing number of threads, which is the case adaptive spinning
+ * in the monitor code is meant to help with.
+ */
+public class LockContention {
+
+	static readonly object lock_obj = new object ();
+	static long counter;
+
+	static void Work (int iterations) {
+		for (int i = 0; i < iterations; i++) {
+			lock (lock_obj) {
+				counter ++;
+			}
+		}
+	}
+
+	static int Run (int nthreads, int iterations) {
+		Thread[] threads = new Thread [nthreads];
+
+		counter = 0;
+		for (int i = 0; i < nthreads; i++)
+			threads [i] = new Thread (() => Work (iterations));
+
+		Stopwatch sw = Stopwatch.StartNew ();
+
+		for (int i = 0; i < nthreads; i++)
+			threads [i].Start ();
+		for (int i = 0; i < nthreads; i++)
+			threads [i].Join ();
+
+		sw.Stop ();
+		Console.WriteLine ("{0,2} threads {1,10:F1} locks/ms", nthreads, (double) nthreads * iterations / sw.Elapsed.TotalMilliseconds);
+		return counter == (long) nthreads * iterations ? 0 : 1;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		int iterations = repeat * 1000000;
+		int res = 0;
+
+		for (int nthreads = 1; nthreads <= 2 * Environment.ProcessorCount; nthreads *= 2)
+			res |= Run (nthreads, iterations);
+
+		return res;
+	}
+}
@@ -0,0 +1,69 @@
+using System;
+using System.Diagnostics;
+using System.Runtime.CompilerServices;
+
+/*
+ * Measures the latency of throwing and catching an exception, both in the
+ * same method and through a number of frames with and without finally clauses.
+ */
+public class ThrowCatch {
+
+	static int finally_count;
+
+	[MethodImpl (MethodImplOptions.NoInlining)]
+	static void Throw (int depth) {
+		if (depth == 0)
+			throw new Exception ();
+		Throw (depth - 1);
+	}
+
+	[MethodImpl (MethodImplOptions.NoInlining)]
+	static void ThrowFinally (int depth) {
+		if (depth == 0)
+			throw new Exception ();
+		try {
+			ThrowFinally (depth - 1);
+		} finally {
+			finally_count ++;
+		}
+	}
+
+	static int Run (string name, int depth, bool with_finally, int iterations) {
+		int caught = 0;
+		Stopwatch sw = Stopwatch.StartNew ();
+
+		for (int i = 0; i < iterations; i++) {
+			try {
+				if (with_finally)
+					ThrowFinally (depth);
+				else
+					Throw (depth);
+			} catch (Exception) {
+				caught ++;
+			}
+		}
+
+		sw.Stop ();
+		Console.WriteLine ("{0,-20} {1,8:F3} us/throw", name, sw.Elapsed.TotalMilliseconds * 1000 / iterations);
+		return caught == iterations ? 0 : 1;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		int iterations = repeat * 100000;
+		int res = 0;
+
+		res |= Run ("depth 0", 0, false, iterations);
+		res |= Run ("depth 4", 4, false, iterations);
+		res |= Run ("depth 16", 16, false, iterations);
+		res |= Run ("depth 16 + finally", 16, true, iterations);
+
+		if (finally_count != iterations * 16)
+			return 1;
+		return res;
+	}
+}
@@ -837,6 +837,11 @@ typedef struct {
 	guint64 threadpool_ioworkitems;
 	guint threadpool_threads;
 	guint threadpool_iothreads;
+	/* Threads and Locks category, continued */
+	guint32 thread_contended_acquires;
+	guint32 thread_spins;
+	guint32 thread_spin_acquires;
+	guint32 thread_parks;
 } MonoPerfCounters;
 
 extern MonoPerfCounters *mono_perfcounters;
@@ -79,6 +79,8 @@ void        ves_icall_System_GCHandle_FreeHandle (guint32 handle);
 gpointer    ves_icall_System_GCHandle_GetAddrOfPinnedObject (guint32 handle);
 void        ves_icall_System_GC_register_ephemeron_array (MonoObject *array);
 MonoObject  *ves_icall_System_GC_get_ephemeron_tombstone (void);
+MonoArray   *ves_icall_System_GC_RentPinnedBuffer (int minimum_length);
+void        ves_icall_System_GC_ReturnPinnedBuffer (MonoArray *buffer);
 
 MonoBoolean ves_icall_Mono_Runtime_SetGCAllowSynchronousMajor (MonoBoolean flag);
 
@@ -111,6 +113,9 @@ void mono_gchandle_set_target (guint32 gchandle, MonoObject *obj);
 /*Ephemeron functionality. Sgen only*/
 gboolean    mono_gc_ephemeron_array_add (MonoObject *obj);
 
+MonoArray*  mono_gc_rent_pinned_buffer (int min_length);
+void        mono_gc_return_pinned_buffer (MonoArray *buffer);
+
 /* To disable synchronous, evacuating collections - concurrent SGen only */
 gboolean    mono_gc_set_allow_synchronous_major (gboolean flag);
 
@@ -525,6 +525,37 @@ ves_icall_System_GC_get_ephemeron_tombstone (void)
 	return mono_domain_get ()->ephemeron_tombstone;
 }
 
+MonoArray*
+ves_icall_System_GC_RentPinnedBuffer (int minimum_length)
+{
+	MonoArray *buffer;
+
+	if (minimum_length < 0) {
+		mono_set_pending_exception (mono_get_exception_argument_out_of_range ("minimumLength"));
+		return NULL;
+	}
+
+#ifdef HAVE_SGEN_GC
+	buffer = mono_gc_rent_pinned_buffer (minimum_length);
+#else
+	/* Objects don't move with Boehm, so any array will do. */
+	buffer = mono_array_new (mono_domain_get (), mono_defaults.byte_class, minimum_length);
+#endif
+	if (!buffer)
+		mono_set_pending_exception (mono_domain_get ()->out_of_memory_ex);
+	return buffer;
+}
+
+void
+ves_icall_System_GC_ReturnPinnedBuffer (MonoArray *buffer)
+{
+	MONO_CHECK_ARG_NULL (buffer,);
+
+#ifdef HAVE_SGEN_GC
+	mono_gc_return_pinned_buffer (buffer);
+#endif
+}
+
 #define mono_allocator_lock() mono_mutex_lock (&allocator_section)
 #define mono_allocator_unlock() mono_mutex_unlock (&allocator_section)
 static mono_mutex_t allocator_section;
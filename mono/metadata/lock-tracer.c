@@ -21,6 +21,8 @@
 #endif
 
 #include <mono/io-layer/io-layer.h>
+#include <mono/utils/atomic.h>
+#include <mono/utils/mono-time.h>
 
 #include "lock-tracer.h"
 
@@ -141,3 +143,49 @@ mono_locks_lock_released (RuntimeLocks kind, gpointer lock)
 }
 
 #endif
+
+/*
+ * Number of threads blocked on the runtime locks, hashed by lock address, so
+ * that the owner knows whether to report a contended release. Collisions only
+ * cause spurious reports.
+ */
+#define CONTENTION_SLOTS 64
+static gint32 contention_waiters [CONTENTION_SLOTS];
+
+#define contention_slot(lock) (&contention_waiters [((gsize)(lock) >> 4) % CONTENTION_SLOTS])
+
+/*
+ * mono_locks_contention_acquire:
+ *
+ *   Acquire LOCK, and report the time spent waiting for it to the profiler if
+ * it was held by another thread.
+ */
+void
+mono_locks_contention_acquire (mono_mutex_t *lock, RuntimeLocks kind)
+{
+	gint64 start;
+
+	if (mono_mutex_trylock (lock) == 0)
+		return;
+
+	start = mono_100ns_ticks ();
+
+	InterlockedIncrement (contention_slot (lock));
+	mono_mutex_lock (lock);
+	InterlockedDecrement (contention_slot (lock));
+
+	mono_profiler_lock_contention (lock, kind, MONO_PROFILER_LOCK_WAIT, (mono_100ns_ticks () - start) * 100);
+}
+
+/*
+ * mono_locks_contention_release:
+ *
+ *   Called by the owner of LOCK right before releasing it, so the profiler can
+ * record where the lock was held while other threads were waiting for it.
+ */
+void
+mono_locks_contention_release (mono_mutex_t *lock, RuntimeLocks kind)
+{
+	if (InterlockedRead (contention_slot (lock)) > 0)
+		mono_profiler_lock_contention (lock, kind, MONO_PROFILER_LOCK_CONTENDED_RELEASE, 0);
+}
@@ -5,6 +5,8 @@
 #include <glib.h>
 
 #include "mono/utils/mono-compiler.h"
+#include "mono/utils/mono-mutex.h"
+#include "mono/metadata/profiler-private.h"
 
 G_BEGIN_DECLS
 
@@ -39,23 +41,42 @@ void mono_locks_lock_released (RuntimeLocks kind, gpointer lock);
 
 #endif
 
+/*
+ * When the profiler wants monitor events, contention on the runtime locks is
+ * measured and reported as well, see mono_locks_contention_acquire ().
+ */
+void mono_locks_contention_acquire (mono_mutex_t *lock, RuntimeLocks kind);
+void mono_locks_contention_release (mono_mutex_t *lock, RuntimeLocks kind);
+
+#define mono_locks_contention_enabled() G_UNLIKELY (mono_profiler_events & MONO_PROFILE_MONITOR_EVENTS)
+
 #define mono_locks_acquire(LOCK, NAME) do { \
-	mono_mutex_lock (LOCK); \
+	if (mono_locks_contention_enabled ()) \
+		mono_locks_contention_acquire (LOCK, NAME); \
+	else \
+		mono_mutex_lock (LOCK); \
 	mono_locks_lock_acquired (NAME, LOCK); \
 } while (0)
 
 #define mono_locks_release(LOCK, NAME) do { \
 	mono_locks_lock_released (NAME, LOCK); \
+	if (mono_locks_contention_enabled ()) \
+		mono_locks_contention_release (LOCK, NAME); \
 	mono_mutex_unlock (LOCK); \
 } while (0)
 
 #define mono_locks_mutex_acquire(LOCK, NAME) do { \
-	mono_mutex_lock (LOCK); \
+	if (mono_locks_contention_enabled ()) \
+		mono_locks_contention_acquire (LOCK, NAME); \
+	else \
+		mono_mutex_lock (LOCK); \
 	mono_locks_lock_acquired (NAME, LOCK); \
 } while (0)
 
 #define mono_locks_mutex_release(LOCK, NAME) do { \
 	mono_locks_lock_released (NAME, LOCK); \
+	if (mono_locks_contention_enabled ()) \
+		mono_locks_contention_release (LOCK, NAME); \
 	mono_mutex_unlock (LOCK); \
 } while (0)
 G_END_DECLS
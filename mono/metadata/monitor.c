@@ -28,6 +28,7 @@
 #include <mono/utils/mono-threads.h>
 #include <mono/metadata/profiler-private.h>
 #include <mono/utils/mono-time.h>
+#include <mono/utils/mono-proclib.h>
 #include <mono/utils/atomic.h>
 
 /*
@@ -83,6 +84,19 @@ static MonoThreadsSync *monitor_freelist;
 static MonitorArray *monitor_allocated;
 static int array_size = 16;
 
+/*
+ * Contended threads spin for up to spin_limit iterations before blocking on the
+ * entry semaphore. The limit of each monitor is doubled when spinning acquired
+ * the lock and halved when it didn't, so monitors held for long periods quickly
+ * stop wasting cycles, while short critical sections avoid the context switches.
+ */
+#define MONITOR_SPIN_MIN	16
+#define MONITOR_SPIN_INIT	128
+#define MONITOR_SPIN_MAX	2048
+
+/* spinning is pointless if the owner can't run at the same time */
+static gboolean monitor_spin_enabled;
+
 /* MonoThreadsSync status helpers */
 
 static inline guint32
@@ -249,6 +263,8 @@ void
 mono_monitor_init (void)
 {
 	mono_mutex_init_recursive (&monitor_mutex);
+
+	monitor_spin_enabled = mono_cpu_count () > 1;
 }
  
 void
@@ -440,6 +456,7 @@ mon_new (gsize id)
 	new->status = mon_status_init_entry_count (new->status);
 	new->nest = 1;
 	new->data = NULL;
+	new->spin_limit = MONITOR_SPIN_INIT;
 	
 #ifndef DISABLE_PERFCOUNTERS
 	mono_perfcounters->gc_sync_blocks++;
@@ -677,8 +694,11 @@ mono_monitor_exit_inflated (MonoObject *obj)
 				new_status = mon_status_decrement_entry_count (new_status);
 			tmp_status = InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status);
 			if (tmp_status == old_status) {
-				if (have_waiters)
+				if (have_waiters) {
 					ReleaseSemaphore (mon->entry_sem, 1, NULL);
+					if (G_UNLIKELY (mono_profiler_events & MONO_PROFILE_MONITOR_EVENTS))
+						mono_profiler_lock_contention (obj, MONO_PROFILER_LOCK_MONITOR, MONO_PROFILER_LOCK_CONTENDED_RELEASE, 0);
+				}
 				break;
 			}
 			old_status = tmp_status;
@@ -733,6 +753,69 @@ mon_decrement_entry_count (MonoThreadsSync *mon)
 	}
 }
 
+static inline void
+mon_spin_pause (void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__asm__ __volatile__ ("pause" : : : "memory");
+#else
+	mono_memory_barrier ();
+#endif
+}
+
+/*
+ * mon_spin:
+ *
+ *   Spin waiting for the owner of MON to release it, and try to acquire it for ID.
+ * We give up early when threads are already blocked on the monitor and the owner
+ * didn't change since we started, as the owner is then most likely not running
+ * or holding the lock for a long time. Returns TRUE if the lock was acquired.
+ */
+static gboolean
+mon_spin (MonoThreadsSync *mon, guint32 id)
+{
+	guint32 old_status, new_status, owner, limit, i;
+
+	if (!monitor_spin_enabled)
+		return FALSE;
+
+	limit = mon->spin_limit;
+	owner = mon_status_get_owner (mon->status);
+
+#ifndef DISABLE_PERFCOUNTERS
+	mono_perfcounters->thread_spins++;
+#endif
+
+	for (i = 0; i < limit; ++i) {
+		mon_spin_pause ();
+
+		old_status = mon->status;
+		if (mon_status_get_owner (old_status) == 0) {
+			new_status = mon_status_set_owner (old_status, id);
+			if (InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status) == old_status) {
+				mon->spin_limit = MIN (limit * 2, MONITOR_SPIN_MAX);
+#ifndef DISABLE_PERFCOUNTERS
+				mono_perfcounters->thread_spin_acquires++;
+#endif
+				return TRUE;
+			}
+		} else if (i >= MONITOR_SPIN_MIN && mon_status_get_owner (old_status) == owner && mon_status_have_waiters (old_status)) {
+			break;
+		}
+	}
+
+	mon->spin_limit = MAX (limit / 2, MONITOR_SPIN_MIN);
+	return FALSE;
+}
+
+/* Report the time spent waiting for OBJ to the profiler, if it was measured */
+static inline void
+mon_report_wait (MonoObject *obj, gint64 contention_start)
+{
+	if (contention_start)
+		mono_profiler_lock_contention (obj, MONO_PROFILER_LOCK_MONITOR, MONO_PROFILER_LOCK_WAIT, (mono_100ns_ticks () - contention_start) * 100);
+}
+
 /* If allow_interruption==TRUE, the method will be interrumped if abort or suspend
  * is requested. In this case it returns -1.
  */ 
@@ -748,6 +831,7 @@ mono_monitor_try_enter_inflated (MonoObject *obj, guint32 ms, gboolean allow_int
 	guint32 new_status, old_status, tmp_status;
 	MonoInternalThread *thread;
 	gboolean interrupted = FALSE;
+	gint64 contention_start = 0;
 
 	LOCK_DEBUG (g_message("%s: (%d) Trying to lock object %p (%d ms)", __func__, id, obj, ms));
 
@@ -799,6 +883,9 @@ retry:
 
 	mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_CONTENTION);
 
+	if (G_UNLIKELY (mono_profiler_events & MONO_PROFILE_MONITOR_EVENTS))
+		contention_start = mono_100ns_ticks ();
+
 	/* The slow path begins here. */
 retry_contended:
 	/* a small amount of duplicated code, but it allows us to insert the profiler
@@ -820,6 +907,10 @@ retry_contended:
 		if (G_LIKELY (tmp_status == old_status)) {
 			/* Success */
 			g_assert (mon->nest == 1);
+#ifndef DISABLE_PERFCOUNTERS
+			mono_perfcounters->thread_contended_acquires++;
+#endif
+			mon_report_wait (obj, contention_start);
 			mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
 			return 1;
 		}
@@ -828,6 +919,18 @@ retry_contended:
 	/* If the object is currently locked by this thread... */
 	if (mon_status_get_owner (old_status) == id) {
 		mon->nest++;
+		mon_report_wait (obj, contention_start);
+		mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
+		return 1;
+	}
+
+	/* The owner may release the lock soon, so spin for a while before blocking */
+	if (mon_spin (mon, id)) {
+		g_assert (mon->nest == 1);
+#ifndef DISABLE_PERFCOUNTERS
+		mono_perfcounters->thread_contended_acquires++;
+#endif
+		mon_report_wait (obj, contention_start);
 		mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
 		return 1;
 	}
@@ -871,6 +974,7 @@ retry_contended:
 #ifndef DISABLE_PERFCOUNTERS
 	mono_perfcounters->thread_queue_len++;
 	mono_perfcounters->thread_queue_max++;
+	mono_perfcounters->thread_parks++;
 #endif
 	thread = mono_thread_internal_current ();
 
@@ -929,6 +1033,7 @@ retry_contended:
 	/* Timed out or interrupted */
 	mon_decrement_entry_count (mon);
 
+	mon_report_wait (obj, contention_start);
 	mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_FAIL);
 
 	if (ret == WAIT_IO_COMPLETION) {
@@ -42,6 +42,8 @@ struct _MonoThreadsSync
 	HANDLE entry_sem;
 	GSList *wait_list;
 	void *data;
+	/* number of iterations to spin before blocking, adapted to past successes */
+	guint32 spin_limit;
 };
 
 /*
@@ -109,6 +109,10 @@ PERFCTR_COUNTER(THREAD_NUMPHYS, "# of current physical Threads", "", NumberOfIte
 PERFCTR_COUNTER(THREAD_NUMREC, "# of current recognized threads", "", NumberOfItems32, thread_cur_recognized)
 PERFCTR_COUNTER(THREAD_TOTREC, "# of total recognized threads", "", NumberOfItems32, thread_num_recognized)
 PERFCTR_COUNTER(THREAD_TOTRECSEC, "rate of recognized threads / sec", "", RateOfCountsPerSecond32, thread_num_recognized)
+PERFCTR_COUNTER(THREAD_CONTENDED_ACQUIRES, "# of Contended Acquisitions", "", NumberOfItems32, thread_contended_acquires)
+PERFCTR_COUNTER(THREAD_SPINS, "# of Lock Spins", "", NumberOfItems32, thread_spins)
+PERFCTR_COUNTER(THREAD_SPIN_ACQUIRES, "# of Lock Spin Acquisitions", "", NumberOfItems32, thread_spin_acquires)
+PERFCTR_COUNTER(THREAD_PARKS, "# of Lock Parks", "", NumberOfItems32, thread_parks)
 
 PERFCTR_CAT(INTEROP, ".NET CLR Interop", "", MultiInstance, Mono, INTEROP_NUMCCW)
 PERFCTR_COUNTER(INTEROP_NUMCCW, "# of CCWs", "", NumberOfItems32, interop_num_ccw)
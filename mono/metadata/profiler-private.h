@@ -36,6 +36,7 @@ void mono_profiler_method_end_invoke   (MonoMethod *method);
 void mono_profiler_code_transition (MonoMethod *method, int result);
 void mono_profiler_allocation      (MonoObject *obj);
 void mono_profiler_monitor_event   (MonoObject *obj, MonoProfilerMonitorEvent event);
+void mono_profiler_lock_contention (gpointer lock, int kind, MonoProfilerLockEvent event, guint64 wait_ns);
 void mono_profiler_stat_hit        (guchar *ip, void *context);
 void mono_profiler_stat_call_chain (int call_chain_depth, guchar **ips, void *context);
 int  mono_profiler_stat_get_call_chain_depth (void);
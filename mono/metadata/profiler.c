@@ -73,6 +73,7 @@ struct _ProfilerDesc {
 	MonoProfileMethodResult man_unman_transition;
 	MonoProfileAllocFunc    allocation_cb;
 	MonoProfileMonitorFunc  monitor_event_cb;
+	MonoProfileLockContentionFunc lock_contention_cb;
 	MonoProfileStatFunc     statistical_cb;
 	MonoProfileStatCallChainFunc statistical_call_chain_cb;
 	int                     statistical_call_chain_depth;
@@ -280,6 +281,14 @@ mono_profiler_install_monitor  (MonoProfileMonitorFunc callback)
 	prof_list->monitor_event_cb = callback;
 }
 
+void
+mono_profiler_install_lock_contention (MonoProfileLockContentionFunc callback)
+{
+	if (!prof_list)
+		return;
+	prof_list->lock_contention_cb = callback;
+}
+
 static MonoProfileSamplingMode sampling_mode = MONO_PROFILER_STAT_MODE_PROCESS;
 static int64_t sampling_frequency = 1000; //1ms
 
@@ -543,6 +552,16 @@ mono_profiler_monitor_event      (MonoObject *obj, MonoProfilerMonitorEvent even
 	}
 }
 
+void
+mono_profiler_lock_contention (gpointer lock, int kind, MonoProfilerLockEvent event, guint64 wait_ns)
+{
+	ProfilerDesc *prof;
+	for (prof = prof_list; prof; prof = prof->next) {
+		if ((prof->events & MONO_PROFILE_MONITOR_EVENTS) && prof->lock_contention_cb)
+			prof->lock_contention_cb (prof->profiler, lock, kind, event, wait_ns);
+	}
+}
+
 void
 mono_profiler_stat_hit (guchar *ip, void *context)
 {
@@ -86,6 +86,23 @@ typedef enum {
 	MONO_PROFILER_MONITOR_FAIL = 3
 } MonoProfilerMonitorEvent;
 
+/*
+ * Lock contention events, reported when MONO_PROFILE_MONITOR_EVENTS is enabled.
+ * The lock kind is MONO_PROFILER_LOCK_MONITOR for monitors, in which case the
+ * lock is the locked object, otherwise it identifies a runtime internal lock,
+ * and the lock is the address of the mutex. Runtime lock events are reported
+ * while the lock is held, so the callback must not walk the stack or call back
+ * into the runtime for them.
+ */
+typedef enum {
+	/* the thread acquired or gave up on a lock it had to wait for */
+	MONO_PROFILER_LOCK_WAIT = 1,
+	/* the thread released a lock other threads are waiting for */
+	MONO_PROFILER_LOCK_CONTENDED_RELEASE = 2
+} MonoProfilerLockEvent;
+
+#define MONO_PROFILER_LOCK_MONITOR 0
+
 typedef enum {
 	MONO_PROFILER_CALL_CHAIN_NONE = 0,
 	MONO_PROFILER_CALL_CHAIN_NATIVE = 1,
@@ -125,6 +142,7 @@ typedef void (*MonoProfileClassFunc)    (MonoProfiler *prof, MonoClass    *klass
 typedef void (*MonoProfileModuleFunc)   (MonoProfiler *prof, MonoImage    *module);
 typedef void (*MonoProfileAssemblyFunc) (MonoProfiler *prof, MonoAssembly *assembly);
 typedef void (*MonoProfileMonitorFunc)  (MonoProfiler *prof, MonoObject *obj, MonoProfilerMonitorEvent event);
+typedef void (*MonoProfileLockContentionFunc) (MonoProfiler *prof, void *lock, int kind, MonoProfilerLockEvent event, uint64_t wait_ns);
 
 typedef void (*MonoProfileExceptionFunc) (MonoProfiler *prof, MonoObject *object);
 typedef void (*MonoProfileExceptionClauseFunc) (MonoProfiler *prof, MonoMethod *method, int clause_type, int clause_num);
@@ -189,6 +207,7 @@ MONO_API void mono_profiler_install_thread_name (MonoProfileThreadNameFunc threa
 MONO_API void mono_profiler_install_transition  (MonoProfileMethodResult callback);
 MONO_API void mono_profiler_install_allocation  (MonoProfileAllocFunc callback);
 MONO_API void mono_profiler_install_monitor     (MonoProfileMonitorFunc callback);
+MONO_API void mono_profiler_install_lock_contention (MonoProfileLockContentionFunc callback);
 MONO_API void mono_profiler_install_statistical (MonoProfileStatFunc callback);
 MONO_API void mono_profiler_install_statistical_call_chain (MonoProfileStatCallChainFunc callback, int call_chain_depth, MonoProfilerCallChainStrategy call_chain_strategy);
 MONO_API void mono_profiler_install_exception   (MonoProfileExceptionFunc throw_callback, MonoProfileMethodFunc exc_method_leave, MonoProfileExceptionClauseFunc clause_callback);
@@ -39,6 +39,11 @@ sgen_vtable_get_descriptor (GCVTable vtable)
 	return (SgenDescriptor)vtable->gc_descr;
 }
 
+/* Pinned buffer size classes are powers of two from 4KB to 1MB. */
+#define SGEN_PINNED_BUFFER_MIN_SIZE_BITS	12
+#define SGEN_PINNED_BUFFER_NUM_SIZE_CLASSES	9
+#define SGEN_PINNED_BUFFER_CACHE_SLOTS		2
+
 typedef struct _SgenClientThreadInfo SgenClientThreadInfo;
 struct _SgenClientThreadInfo {
 	MonoThreadInfo info;
@@ -71,6 +76,12 @@ struct _SgenClientThreadInfo {
 
 	gpointer runtime_data;
 
+	/*
+	 * Pinned byte[] buffers given back to the pool, by size class.  They are scanned
+	 * conservatively, which keeps them alive and pinned.
+	 */
+	MonoArray *pinned_buffers [SGEN_PINNED_BUFFER_NUM_SIZE_CLASSES][SGEN_PINNED_BUFFER_CACHE_SLOTS];
+
 	void *stack_end;
 	void *stack_start;
 	void *stack_start_limit;
@@ -691,6 +702,7 @@ extern MonoNativeTlsKey thread_info_key;
 #define SGEN_TV_DECLARE(name) gint64 name
 #define SGEN_TV_GETTIME(tv) tv = mono_100ns_ticks ()
 #define SGEN_TV_ELAPSED(start,end) ((long)(end-start))
+#define SGEN_TV_FROM_MSEC(ms) ((gint64)(ms) * 10000)
 
 typedef MonoSemType SgenSemaphore;
 
@@ -821,6 +821,23 @@ clear_domain_free_major_pinned_object_callback (GCObject *obj, size_t size, Mono
 		major_collector.free_pinned_object (obj, size);
 }
 
+static void
+clear_pinned_buffers_for_domain (MonoDomain *domain)
+{
+	SgenThreadInfo *info;
+	int i, j;
+
+	FOREACH_THREAD (info) {
+		for (i = 0; i < SGEN_PINNED_BUFFER_NUM_SIZE_CLASSES; ++i) {
+			for (j = 0; j < SGEN_PINNED_BUFFER_CACHE_SLOTS; ++j) {
+				MonoArray *buffer = info->client_info.pinned_buffers [i][j];
+				if (buffer && mono_object_domain (buffer) == domain)
+					info->client_info.pinned_buffers [i][j] = NULL;
+			}
+		}
+	} END_FOREACH_THREAD
+}
+
 /*
  * When appdomains are unloaded we can easily remove objects that have finalizers,
  * but all the others could still be present in random places on the heap.
@@ -852,6 +869,8 @@ mono_gc_clear_domain (MonoDomain * domain)
 
 	sgen_clear_nursery_fragments ();
 
+	clear_pinned_buffers_for_domain (domain);
+
 	if (sgen_mono_xdomain_checks && domain != mono_get_root_domain ()) {
 		sgen_scan_for_registered_roots_in_domain (domain, ROOT_TYPE_NORMAL);
 		sgen_scan_for_registered_roots_in_domain (domain, ROOT_TYPE_WBARRIER);
@@ -946,6 +965,103 @@ mono_gc_alloc_pinned_obj (MonoVTable *vtable, size_t size)
 	return obj;
 }
 
+/*
+ * Pinned buffers
+ *
+ * The class libraries rent byte[] buffers for I/O from a pool instead of allocating
+ * them per request.  Buffers come in power of two size classes and are allocated
+ * pinned, so small ones come from the pinned major blocks and the others from the LOS.
+ * Returned buffers are kept in a small per-thread cache, which isn't shared, so no
+ * locking is needed.  Their contents are not cleared.
+ */
+
+static guint64 stat_pinned_buffers_allocated;
+static guint64 stat_pinned_buffers_reused;
+static guint64 stat_pinned_buffers_returned;
+
+/* Returns -1 if the length is larger than the largest size class. */
+static int
+pinned_buffer_size_class (uintptr_t length)
+{
+	int size_class = 0;
+
+	while (((uintptr_t)1 << (size_class + SGEN_PINNED_BUFFER_MIN_SIZE_BITS)) < length) {
+		if (++size_class == SGEN_PINNED_BUFFER_NUM_SIZE_CLASSES)
+			return -1;
+	}
+	return size_class;
+}
+
+MonoArray*
+mono_gc_rent_pinned_buffer (int min_length)
+{
+	SgenThreadInfo *info = mono_thread_info_current ();
+	MonoDomain *domain = mono_domain_get ();
+	MonoVTable *vtable;
+	MonoArray *buffer;
+	uintptr_t length = min_length;
+	int size_class, i;
+
+	size_class = pinned_buffer_size_class (length);
+	if (size_class >= 0) {
+		length = (uintptr_t)1 << (size_class + SGEN_PINNED_BUFFER_MIN_SIZE_BITS);
+
+		for (i = 0; i < SGEN_PINNED_BUFFER_CACHE_SLOTS; ++i) {
+			buffer = info->client_info.pinned_buffers [size_class][i];
+			if (buffer && mono_object_domain (buffer) == domain) {
+				info->client_info.pinned_buffers [size_class][i] = NULL;
+				++stat_pinned_buffers_reused;
+				return buffer;
+			}
+		}
+	}
+
+	vtable = mono_class_vtable (domain, mono_array_class_get (mono_defaults.byte_class, 1));
+
+	/* Set the length before the concurrent collector can see the object. */
+	LOCK_GC;
+	buffer = (MonoArray*)sgen_alloc_obj_pinned_nolock (vtable, sizeof (MonoArray) + length);
+	if (buffer)
+		buffer->max_length = (mono_array_size_t)length;
+	UNLOCK_GC;
+
+	if (!buffer)
+		return NULL;
+
+	if (G_UNLIKELY (alloc_events))
+		mono_profiler_allocation (&buffer->obj);
+
+	++stat_pinned_buffers_allocated;
+	return buffer;
+}
+
+void
+mono_gc_return_pinned_buffer (MonoArray *buffer)
+{
+	SgenThreadInfo *info = mono_thread_info_current ();
+	uintptr_t length = mono_array_length (buffer);
+	int size_class, i;
+
+	/* Only take buffers that could have come from the pool. */
+	size_class = pinned_buffer_size_class (length);
+	if (size_class < 0 || length != (uintptr_t)1 << (size_class + SGEN_PINNED_BUFFER_MIN_SIZE_BITS))
+		return;
+	if (buffer->obj.vtable->klass->element_class != mono_defaults.byte_class || buffer->obj.vtable->klass->rank != 1)
+		return;
+	if (!sgen_object_never_moves ((GCObject*)buffer))
+		return;
+
+	for (i = 0; i < SGEN_PINNED_BUFFER_CACHE_SLOTS; ++i) {
+		if (!info->client_info.pinned_buffers [size_class][i]) {
+			info->client_info.pinned_buffers [size_class][i] = buffer;
+			++stat_pinned_buffers_returned;
+			return;
+		}
+	}
+
+	/* The cache is full, so the buffer becomes garbage. */
+}
+
 void*
 mono_gc_alloc_mature (MonoVTable *vtable)
 {
@@ -1413,7 +1529,11 @@ mono_gc_get_managed_allocator (MonoClass *klass, gboolean for_box, gboolean know
 		return NULL;
 	if (!mono_runtime_has_tls_get ())
 		return NULL;
-	if (klass->instance_size > tlab_size)
+	/*
+	 * The fast path only checks the current TLAB's end, which is bounded by the
+	 * thread's own TLAB size, so this can only rule out objects no TLAB can hold.
+	 */
+	if (klass->instance_size > SGEN_MAX_TLAB_SIZE)
 		return NULL;
 	if (known_instance_size && ALIGN_TO (klass->instance_size, SGEN_ALLOC_ALIGN) >= SGEN_MAX_SMALL_OBJ_SIZE)
 		return NULL;
@@ -2044,17 +2164,22 @@ sgen_client_collecting_major_3 (SgenPointerQueue *fin_ready_queue, SgenPointerQu
 static void *moved_objects [MOVED_OBJECTS_NUM];
 static int moved_objects_idx = 0;
 
+/* Objects are moved by several threads at once in parallel nursery collections. */
+static mono_mutex_t moved_objects_mutex;
+
 void
 mono_sgen_register_moved_object (void *obj, void *destination)
 {
 	g_assert (mono_profiler_events & MONO_PROFILE_GC_MOVES);
 
+	mono_mutex_lock (&moved_objects_mutex);
 	if (moved_objects_idx == MOVED_OBJECTS_NUM) {
 		mono_profiler_gc_moves (moved_objects, moved_objects_idx);
 		moved_objects_idx = 0;
 	}
 	moved_objects [moved_objects_idx++] = obj;
 	moved_objects [moved_objects_idx++] = destination;
+	mono_mutex_unlock (&moved_objects_mutex);
 }
 
 void
@@ -2186,6 +2311,8 @@ sgen_client_thread_register (SgenThreadInfo* info, void *stack_bottom_fallback)
 
 	info->client_info.stack_start = NULL;
 
+	memset (info->client_info.pinned_buffers, 0, sizeof (info->client_info.pinned_buffers));
+
 #ifdef SGEN_POSIX_STW
 	info->client_info.stop_count = -1;
 	info->client_info.signal = 0;
@@ -2353,6 +2480,13 @@ sgen_client_scan_thread_data (void *start_nursery, void *end_nursery, gboolean p
 
 		binary_protocol_scan_stack ((gpointer)mono_thread_info_get_tid (info), info->client_info.stack_start, info->client_info.stack_end, skip_reason);
 
+		/* The pinned buffer cache must be scanned even if the stack is skipped. */
+		if (!precise) {
+			sgen_conservatively_pin_objects_from ((void**)info->client_info.pinned_buffers,
+					(void**)info->client_info.pinned_buffers + SGEN_PINNED_BUFFER_NUM_SIZE_CLASSES * SGEN_PINNED_BUFFER_CACHE_SLOTS,
+					start_nursery, end_nursery, PIN_TYPE_OTHER);
+		}
+
 		if (skip_reason)
 			continue;
 
@@ -2836,6 +2970,8 @@ sgen_client_init (void)
 
 	sgen_register_fixed_internal_mem_type (INTERNAL_MEM_EPHEMERON_LINK, sizeof (EphemeronLinkNode));
 
+	mono_mutex_init (&moved_objects_mutex);
+
 	mono_sgen_init_stw ();
 
 #ifndef HAVE_KW_THREAD
@@ -2962,6 +3098,10 @@ mono_gc_base_init (void)
 	mono_counters_register ("WBarrier object copy", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_wbarrier_object_copy);
 #endif
 
+	mono_counters_register ("# pinned buffers allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pinned_buffers_allocated);
+	mono_counters_register ("# pinned buffers reused", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pinned_buffers_reused);
+	mono_counters_register ("# pinned buffers returned", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pinned_buffers_returned);
+
 	sgen_gc_init ();
 
 	if (nursery_canaries_enabled ())
@@ -10,13 +10,17 @@
 
 #define EPOLL_NEVENTS 128
 
-static gint epoll_fd;
-static struct epoll_event *epoll_events;
+typedef struct {
+	gint fd;
+	struct epoll_event *events;
+} ThreadPoolIOEpoll;
 
-static gboolean
+static gpointer
 epoll_init (gint wakeup_pipe_fd)
 {
 	struct epoll_event event;
+	gint epoll_fd;
+	ThreadPoolIOEpoll *data;
 
 #ifdef EPOOL_CLOEXEC
 	epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
@@ -31,7 +35,7 @@ epoll_init (gint wakeup_pipe_fd)
 #else
 		g_error ("epoll_init: epoll (256) failed, error (%d) %s\n", errno, g_strerror (errno));
 #endif
-		return FALSE;
+		return NULL;
 	}
 
 	event.events = EPOLLIN;
@@ -39,24 +43,30 @@ epoll_init (gint wakeup_pipe_fd)
 	if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event) == -1) {
 		g_error ("epoll_init: epoll_ctl () failed, error (%d) %s", errno, g_strerror (errno));
 		close (epoll_fd);
-		return FALSE;
+		return NULL;
 	}
 
-	epoll_events = g_new0 (struct epoll_event, EPOLL_NEVENTS);
+	data = g_new0 (ThreadPoolIOEpoll, 1);
+	data->fd = epoll_fd;
+	data->events = g_new0 (struct epoll_event, EPOLL_NEVENTS);
 
-	return TRUE;
+	return data;
 }
 
 static void
-epoll_cleanup (void)
+epoll_cleanup (gpointer backend_data)
 {
-	g_free (epoll_events);
-	close (epoll_fd);
+	ThreadPoolIOEpoll *data = backend_data;
+
+	g_free (data->events);
+	close (data->fd);
+	g_free (data);
 }
 
 static void
-epoll_register_fd (gint fd, gint events, gboolean is_new)
+epoll_register_fd (gpointer backend_data, gint fd, gint events, gboolean is_new)
 {
+	ThreadPoolIOEpoll *data = backend_data;
 	struct epoll_event event;
 
 #ifndef EPOLLONESHOT
@@ -71,27 +81,55 @@ epoll_register_fd (gint fd, gint events, gboolean is_new)
 	if ((events & EVENT_OUT) != 0)
 		event.events |= EPOLLOUT;
 
-	if (epoll_ctl (epoll_fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, event.data.fd, &event) == -1)
+	if (epoll_ctl (data->fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, event.data.fd, &event) == -1)
 		g_error ("epoll_register_fd: epoll_ctl(%s) failed, error (%d) %s", is_new ? "EPOLL_CTL_ADD" : "EPOLL_CTL_MOD", errno, g_strerror (errno));
 }
 
+/*
+ * epoll_edge_register_fd:
+ *
+ *   In edge triggered mode, fds are registered once for both directions, and stay
+ * registered until they are removed. The selector only re-registers an fd when
+ * operations are still waiting after an event: EPOLL_CTL_MOD reports the fd again
+ * if it is still ready, even though no new edge happened.
+ */
+static void
+epoll_edge_register_fd (gpointer backend_data, gint fd, gint events, gboolean is_new)
+{
+	ThreadPoolIOEpoll *data = backend_data;
+	struct epoll_event event;
+
+	event.data.fd = fd;
+	event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+#ifdef EPOLLRDHUP
+	event.events |= EPOLLRDHUP;
+#endif
+
+	if (epoll_ctl (data->fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, event.data.fd, &event) == -1)
+		g_error ("epoll_edge_register_fd: epoll_ctl(%s) failed, error (%d) %s", is_new ? "EPOLL_CTL_ADD" : "EPOLL_CTL_MOD", errno, g_strerror (errno));
+}
+
 static void
-epoll_remove_fd (gint fd)
+epoll_remove_fd (gpointer backend_data, gint fd)
 {
-	if (epoll_ctl (epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1)
+	ThreadPoolIOEpoll *data = backend_data;
+
+	if (epoll_ctl (data->fd, EPOLL_CTL_DEL, fd, NULL) == -1)
 			g_error ("epoll_remove_fd: epoll_ctl (EPOLL_CTL_DEL) failed, error (%d) %s", errno, g_strerror (errno));
 }
 
 static gint
-epoll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+epoll_event_wait (gpointer backend_data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	ThreadPoolIOEpoll *data = backend_data;
+	struct epoll_event *epoll_events = data->events;
 	gint i, ready;
 
 	memset (epoll_events, 0, sizeof (struct epoll_event) * EPOLL_NEVENTS);
 
 	mono_gc_set_skip_thread (TRUE);
 
-	ready = epoll_wait (epoll_fd, epoll_events, EPOLL_NEVENTS, -1);
+	ready = epoll_wait (data->fd, epoll_events, EPOLL_NEVENTS, -1);
 
 	mono_gc_set_skip_thread (FALSE);
 
@@ -116,6 +154,10 @@ epoll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), g
 		fd = epoll_events [i].data.fd;
 		if (epoll_events [i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
 			events |= EVENT_IN;
+#ifdef EPOLLRDHUP
+		if (epoll_events [i].events & EPOLLRDHUP)
+			events |= EVENT_IN;
+#endif
 		if (epoll_events [i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
 			events |= EVENT_OUT;
 
@@ -133,4 +175,13 @@ static ThreadPoolIOBackend backend_epoll = {
 	.event_wait = epoll_event_wait,
 };
 
+static ThreadPoolIOBackend backend_epoll_edge = {
+	.init = epoll_init,
+	.cleanup = epoll_cleanup,
+	.register_fd = epoll_edge_register_fd,
+	.remove_fd = epoll_remove_fd,
+	.event_wait = epoll_event_wait,
+	.edge_triggered = TRUE,
+};
+
 #endif
@@ -12,83 +12,99 @@
 
 #define KQUEUE_NEVENTS 128
 
-static gint kqueue_fd;
-static struct kevent *kqueue_events;
+typedef struct {
+	gint fd;
+	struct kevent *events;
+} ThreadPoolIOKqueue;
 
 static gint
-KQUEUE_INIT_FD (gint fd, gint events, gint flags)
+KQUEUE_INIT_FD (gint kqueue_fd, gint fd, gint events, gint flags)
 {
 	struct kevent event;
 	EV_SET (&event, fd, events, flags, 0, 0, 0);
 	return kevent (kqueue_fd, &event, 1, NULL, 0, NULL);
 }
 
-static gboolean
+static gpointer
 kqueue_init (gint wakeup_pipe_fd)
 {
+	gint kqueue_fd;
+	ThreadPoolIOKqueue *data;
+
 	kqueue_fd = kqueue ();
 	if (kqueue_fd == -1) {
 		g_error ("kqueue_init: kqueue () failed, error (%d) %s", errno, g_strerror (errno));
-		return FALSE;
+		return NULL;
 	}
 
-	if (KQUEUE_INIT_FD (wakeup_pipe_fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1) {
+	if (KQUEUE_INIT_FD (kqueue_fd, wakeup_pipe_fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1) {
 		g_error ("kqueue_init: kevent () failed, error (%d) %s", errno, g_strerror (errno));
 		close (kqueue_fd);
-		return FALSE;
+		return NULL;
 	}
 
-	kqueue_events = g_new0 (struct kevent, KQUEUE_NEVENTS);
+	data = g_new0 (ThreadPoolIOKqueue, 1);
+	data->fd = kqueue_fd;
+	data->events = g_new0 (struct kevent, KQUEUE_NEVENTS);
 
-	return TRUE;
+	return data;
 }
 
 static void
-kqueue_cleanup (void)
+kqueue_cleanup (gpointer backend_data)
 {
-	g_free (kqueue_events);
-	close (kqueue_fd);
+	ThreadPoolIOKqueue *data = backend_data;
+
+	g_free (data->events);
+	close (data->fd);
+	g_free (data);
 }
 
 static void
-kqueue_register_fd (gint fd, gint events, gboolean is_new)
+kqueue_register_fd (gpointer backend_data, gint fd, gint events, gboolean is_new)
 {
+	gint kqueue_fd = ((ThreadPoolIOKqueue*) backend_data)->fd;
+
 	if (events & EVENT_IN) {
-		if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1)
+		if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(read,enable) failed, error (%d) %s", errno, g_strerror (errno));
 	} else {
-		if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_ADD | EV_DISABLE) == -1)
+		if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_READ, EV_ADD | EV_DISABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(read,disable) failed, error (%d) %s", errno, g_strerror (errno));
 	}
 	if (events & EVENT_OUT) {
-		if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_ADD | EV_ENABLE) == -1)
+		if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(write,enable) failed, error (%d) %s", errno, g_strerror (errno));
 	} else {
-		if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_ADD | EV_DISABLE) == -1)
+		if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_WRITE, EV_ADD | EV_DISABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(write,disable) failed, error (%d) %s", errno, g_strerror (errno));
 	}
 }
 
 static void
-kqueue_remove_fd (gint fd)
+kqueue_remove_fd (gpointer backend_data, gint fd)
 {
+	gint kqueue_fd = ((ThreadPoolIOKqueue*) backend_data)->fd;
+
 	/* FIXME: a race between closing and adding operation in the Socket managed code trigger a ENOENT error */
-	if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_DELETE) == -1)
+	if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_READ, EV_DELETE) == -1)
 		g_error ("kqueue_register_fd: kevent(read,delete) failed, error (%d) %s", errno, g_strerror (errno));
-	if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_DELETE) == -1)
+	if (KQUEUE_INIT_FD (kqueue_fd, fd, EVFILT_WRITE, EV_DELETE) == -1)
 		g_error ("kqueue_register_fd: kevent(write,delete) failed, error (%d) %s", errno, g_strerror (errno));
 }
 
 static gint
-kqueue_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+kqueue_event_wait (gpointer backend_data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	ThreadPoolIOKqueue *data = backend_data;
+	struct kevent *kqueue_events = data->events;
 	gint i, ready;
 
 	memset (kqueue_events, 0, sizeof (struct kevent) * KQUEUE_NEVENTS);
 
 	mono_gc_set_skip_thread (TRUE);
 
-	ready = kevent (kqueue_fd, NULL, 0, kqueue_events, KQUEUE_NEVENTS, NULL);
+	ready = kevent (data->fd, NULL, 0, kqueue_events, KQUEUE_NEVENTS, NULL);
 
 	mono_gc_set_skip_thread (FALSE);
 
@@ -1,9 +1,11 @@
 
 #include "utils/mono-poll.h"
 
-static mono_pollfd *poll_fds;
-static guint poll_fds_capacity;
-static guint poll_fds_size;
+typedef struct {
+	mono_pollfd *fds;
+	guint fds_capacity;
+	guint fds_size;
+} ThreadPoolIOPoll;
 
 static inline void
 POLL_INIT_FD (mono_pollfd *poll_fd, gint fd, gint events)
@@ -13,35 +15,42 @@ POLL_INIT_FD (mono_pollfd *poll_fd, gint fd, gint events)
 	poll_fd->revents = 0;
 }
 
-static gboolean
+static gpointer
 poll_init (gint wakeup_pipe_fd)
 {
+	ThreadPoolIOPoll *data;
+
 	g_assert (wakeup_pipe_fd >= 0);
 
-	poll_fds_size = 1;
-	poll_fds_capacity = 64;
+	data = g_new0 (ThreadPoolIOPoll, 1);
+	data->fds_size = 1;
+	data->fds_capacity = 64;
 
-	poll_fds = g_new0 (mono_pollfd, poll_fds_capacity);
+	data->fds = g_new0 (mono_pollfd, data->fds_capacity);
 
-	POLL_INIT_FD (&poll_fds [0], wakeup_pipe_fd, MONO_POLLIN);
+	POLL_INIT_FD (&data->fds [0], wakeup_pipe_fd, MONO_POLLIN);
 
-	return TRUE;
+	return data;
 }
 
 static void
-poll_cleanup (void)
+poll_cleanup (gpointer backend_data)
 {
-	g_free (poll_fds);
+	ThreadPoolIOPoll *data = backend_data;
+
+	g_free (data->fds);
+	g_free (data);
 }
 
 static void
-poll_register_fd (gint fd, gint events, gboolean is_new)
+poll_register_fd (gpointer backend_data, gint fd, gint events, gboolean is_new)
 {
+	ThreadPoolIOPoll *data = backend_data;
 	gint i;
 	gint poll_event;
 
 	g_assert (fd >= 0);
-	g_assert (poll_fds_size <= poll_fds_capacity);
+	g_assert (data->fds_size <= data->fds_capacity);
 
 	g_assert ((events & ~(EVENT_IN | EVENT_OUT)) == 0);
 
@@ -51,62 +60,63 @@ poll_register_fd (gint fd, gint events, gboolean is_new)
 	if (events & EVENT_OUT)
 		poll_event |= MONO_POLLOUT;
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == fd) {
+	for (i = 0; i < data->fds_size; ++i) {
+		if (data->fds [i].fd == fd) {
 			g_assert (!is_new);
-			POLL_INIT_FD (&poll_fds [i], fd, poll_event);
+			POLL_INIT_FD (&data->fds [i], fd, poll_event);
 			return;
 		}
 	}
 
 	g_assert (is_new);
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == -1) {
-			POLL_INIT_FD (&poll_fds [i], fd, poll_event);
+	for (i = 0; i < data->fds_size; ++i) {
+		if (data->fds [i].fd == -1) {
+			POLL_INIT_FD (&data->fds [i], fd, poll_event);
 			return;
 		}
 	}
 
-	poll_fds_size += 1;
+	data->fds_size += 1;
 
-	if (poll_fds_size > poll_fds_capacity) {
-		poll_fds_capacity *= 2;
-		g_assert (poll_fds_size <= poll_fds_capacity);
+	if (data->fds_size > data->fds_capacity) {
+		data->fds_capacity *= 2;
+		g_assert (data->fds_size <= data->fds_capacity);
 
-		poll_fds = g_renew (mono_pollfd, poll_fds, poll_fds_capacity);
+		data->fds = g_renew (mono_pollfd, data->fds, data->fds_capacity);
 	}
 
-	POLL_INIT_FD (&poll_fds [poll_fds_size - 1], fd, poll_event);
+	POLL_INIT_FD (&data->fds [data->fds_size - 1], fd, poll_event);
 }
 
 static void
-poll_remove_fd (gint fd)
+poll_remove_fd (gpointer backend_data, gint fd)
 {
+	ThreadPoolIOPoll *data = backend_data;
 	gint i;
 
 	g_assert (fd >= 0);
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == fd) {
-			POLL_INIT_FD (&poll_fds [i], -1, 0);
+	for (i = 0; i < data->fds_size; ++i) {
+		if (data->fds [i].fd == fd) {
+			POLL_INIT_FD (&data->fds [i], -1, 0);
 			break;
 		}
 	}
 
-	/* if we don't find the fd in poll_fds,
+	/* if we don't find the fd in data->fds,
 	 * it means we try to delete it twice */
-	g_assert (i < poll_fds_size);
+	g_assert (i < data->fds_size);
 
 	/* if we find it again, it means we added
 	 * it twice */
-	for (; i < poll_fds_size; ++i)
-		g_assert (poll_fds [i].fd != fd);
+	for (; i < data->fds_size; ++i)
+		g_assert (data->fds [i].fd != fd);
 
-	/* reduce the value of poll_fds_size so we
+	/* reduce the value of data->fds_size so we
 	 * do not keep it too big */
-	while (poll_fds_size > 1 && poll_fds [poll_fds_size - 1].fd == -1)
-		poll_fds_size -= 1;
+	while (data->fds_size > 1 && data->fds [data->fds_size - 1].fd == -1)
+		data->fds_size -= 1;
 }
 
 static inline gint
@@ -140,8 +150,11 @@ poll_mark_bad_fds (mono_pollfd *poll_fds, gint poll_fds_size)
 }
 
 static gint
-poll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+poll_event_wait (gpointer backend_data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	ThreadPoolIOPoll *data = backend_data;
+	mono_pollfd *poll_fds = data->fds;
+	guint poll_fds_size = data->fds_size;
 	gint i, ready;
 
 	for (i = 0; i < poll_fds_size; ++i)
@@ -12,6 +12,7 @@
 #ifndef DISABLE_SOCKETS
 
 #include <glib.h>
+#include <stdlib.h>
 
 #if defined(HOST_WIN32)
 #include <windows.h>
@@ -29,12 +30,16 @@
 #include <mono/utils/mono-lazy-init.h>
 #include <mono/utils/mono-logger-internal.h>
 
+/* Each selector thread has its own backend data, as returned by init () */
 typedef struct {
-	gboolean (*init) (gint wakeup_pipe_fd);
-	void     (*cleanup) (void);
-	void     (*register_fd) (gint fd, gint events, gboolean is_new);
-	void     (*remove_fd) (gint fd);
-	gint     (*event_wait) (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data);
+	gpointer (*init) (gint wakeup_pipe_fd);
+	void     (*cleanup) (gpointer backend_data);
+	void     (*register_fd) (gpointer backend_data, gint fd, gint events, gboolean is_new);
+	void     (*remove_fd) (gpointer backend_data, gint fd);
+	gint     (*event_wait) (gpointer backend_data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data);
+	/* fds are registered once for both directions, and the callback is only
+	 * called when they become ready, instead of while they are ready */
+	gboolean edge_triggered;
 } ThreadPoolIOBackend;
 
 enum {
@@ -49,6 +54,8 @@ enum {
 
 #define UPDATES_CAPACITY 128
 
+#define SELECTORS_MAX 64
+
 /* Keep in sync with System.Net.Sockets.Socket.SocketOperation */
 enum {
 	AIO_OP_FIRST,
@@ -99,26 +106,53 @@ typedef struct {
 } ThreadPoolIOUpdate;
 
 typedef struct {
-	ThreadPoolIOBackend backend;
+	gpointer backend_data;
 
 	ThreadPoolIOUpdate updates [UPDATES_CAPACITY];
 	gint updates_size;
 	mono_mutex_t updates_lock;
 	mono_cond_t updates_cond;
+	/* edge triggered backends only, protected by updates_lock: fds with operations
+	 * queued in updates or in states, mapped to GINT_TO_POINTER (count) */
+	GHashTable *pending_operations;
 
 #if !defined(HOST_WIN32)
 	gint wakeup_pipes [2];
 #else
 	SOCKET wakeup_pipes [2];
 #endif
+
+	/* only accessed from the selector thread */
+	MonoGHashTable *states;
+	/* fds which need to be (re)registered with the backend before the next wait,
+	 * mapped to GINT_TO_POINTER (is_new + 1) */
+	GHashTable *pending_registrations;
+	/* edge triggered backends only: fds which became ready while no operation was
+	 * waiting for it, mapped to GINT_TO_POINTER (events) */
+	GHashTable *ready_events;
+
+	gboolean running;
+} ThreadPoolIOSelector;
+
+typedef struct {
+	ThreadPoolIOBackend backend;
+
+	/* each fd is handled by the selector at index fd % selectors_count */
+	ThreadPoolIOSelector *selectors;
+	gint selectors_count;
 } ThreadPoolIO;
 
 static mono_lazy_init_t io_status = MONO_LAZY_INIT_STATUS_NOT_INITIALIZED;
 
-static gboolean io_selector_running = FALSE;
-
 static ThreadPoolIO* threadpool_io;
 
+static ThreadPoolIOSelector*
+selector_for_fd (gint fd)
+{
+	g_assert (fd >= 0);
+	return &threadpool_io->selectors [fd % threadpool_io->selectors_count];
+}
+
 static int
 get_events_from_sockares (MonoSocketAsyncResult *ares)
 {
@@ -174,14 +208,14 @@ get_events (MonoMList *list)
 }
 
 static void
-selector_thread_wakeup (void)
+selector_thread_wakeup (ThreadPoolIOSelector *selector)
 {
 	gchar msg = 'c';
 	gint written;
 
 	for (;;) {
 #if !defined(HOST_WIN32)
-		written = write (threadpool_io->wakeup_pipes [1], &msg, 1);
+		written = write (selector->wakeup_pipes [1], &msg, 1);
 		if (written == 1)
 			break;
 		if (written == -1) {
@@ -189,7 +223,7 @@ selector_thread_wakeup (void)
 			break;
 		}
 #else
-		written = send (threadpool_io->wakeup_pipes [1], &msg, 1, 0);
+		written = send (selector->wakeup_pipes [1], &msg, 1, 0);
 		if (written == 1)
 			break;
 		if (written == SOCKET_ERROR) {
@@ -201,14 +235,14 @@ selector_thread_wakeup (void)
 }
 
 static void
-selector_thread_wakeup_drain_pipes (void)
+selector_thread_wakeup_drain_pipes (ThreadPoolIOSelector *selector)
 {
 	gchar buffer [128];
 	gint received;
 
 	for (;;) {
 #if !defined(HOST_WIN32)
-		received = read (threadpool_io->wakeup_pipes [0], buffer, sizeof (buffer));
+		received = read (selector->wakeup_pipes [0], buffer, sizeof (buffer));
 		if (received == 0)
 			break;
 		if (received == -1) {
@@ -217,7 +251,7 @@ selector_thread_wakeup_drain_pipes (void)
 			break;
 		}
 #else
-		received = recv (threadpool_io->wakeup_pipes [0], buffer, sizeof (buffer), 0);
+		received = recv (selector->wakeup_pipes [0], buffer, sizeof (buffer), 0);
 		if (received == 0)
 			break;
 		if (received == SOCKET_ERROR) {
@@ -229,7 +263,85 @@ selector_thread_wakeup_drain_pipes (void)
 	}
 }
 
+/*
+ * poll_fd_events:
+ *
+ *   Return which of EVENTS are ready on FD right now, without blocking.
+ */
+static gint
+poll_fd_events (gint fd, gint events)
+{
+	mono_pollfd pfd;
+	gint res = 0;
+
+	pfd.fd = fd;
+	pfd.events = ((events & EVENT_IN) ? MONO_POLLIN : 0) | ((events & EVENT_OUT) ? MONO_POLLOUT : 0);
+	pfd.revents = 0;
+
+	switch (mono_poll (&pfd, 1, 0)) {
+	case -1:
+		/* let the worker thread report the error */
+		return events;
+	case 0:
+		return 0;
+	}
+
+	if (pfd.revents & (MONO_POLLIN | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
+		res |= EVENT_IN;
+	if (pfd.revents & (MONO_POLLOUT | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
+		res |= EVENT_OUT;
+
+	return res & events;
+}
+
+/*
+ * ready_events_take:
+ *
+ *   Edge triggered backends only. Return TRUE if an edge for EVENT happened on FD
+ * while no operation was waiting for it, and the fd is still ready. The edge is
+ * consumed either way: if the fd is not ready anymore, the next edge will be
+ * reported by the backend.
+ */
+static gboolean
+ready_events_take (ThreadPoolIOSelector *selector, gint fd, gint event)
+{
+	gint ready;
+
+	ready = GPOINTER_TO_INT (g_hash_table_lookup (selector->ready_events, GINT_TO_POINTER (fd)));
+	if ((ready & event) == 0)
+		return FALSE;
+
+	if ((ready &= ~event) != 0)
+		g_hash_table_insert (selector->ready_events, GINT_TO_POINTER (fd), GINT_TO_POINTER (ready));
+	else
+		g_hash_table_remove (selector->ready_events, GINT_TO_POINTER (fd));
+
+	return poll_fd_events (fd, event) != 0;
+}
+
+/*
+ * pending_operations_update:
+ *
+ *   Edge triggered backends only. Add DELTA to the number of operations queued on FD.
+ *
+ * Locking: selector->updates_lock must be held
+ */
+static void
+pending_operations_update (ThreadPoolIOSelector *selector, gint fd, gint delta)
+{
+	gint count;
+
+	count = GPOINTER_TO_INT (g_hash_table_lookup (selector->pending_operations, GINT_TO_POINTER (fd))) + delta;
+	g_assert (count >= 0);
+
+	if (count > 0)
+		g_hash_table_insert (selector->pending_operations, GINT_TO_POINTER (fd), GINT_TO_POINTER (count));
+	else
+		g_hash_table_remove (selector->pending_operations, GINT_TO_POINTER (fd));
+}
+
 typedef struct {
+	ThreadPoolIOSelector *selector;
 	MonoDomain *domain;
 	MonoGHashTable *states;
 } FilterSockaresForDomainData;
@@ -241,6 +353,7 @@ filter_sockares_for_domain (gpointer key, gpointer value, gpointer user_data)
 	MonoMList *list = value, *element;
 	MonoDomain *domain;
 	MonoGHashTable *states;
+	gint removed = 0;
 
 	g_assert (user_data);
 	data = user_data;
@@ -249,10 +362,15 @@ filter_sockares_for_domain (gpointer key, gpointer value, gpointer user_data)
 
 	for (element = list; element; element = mono_mlist_next (element)) {
 		MonoSocketAsyncResult *sockares = (MonoSocketAsyncResult*) mono_mlist_get_data (element);
-		if (mono_object_domain (sockares) == domain)
+		if (mono_object_domain (sockares) == domain) {
 			mono_mlist_set_data (element, NULL);
+			removed += 1;
+		}
 	}
 
+	if (removed > 0 && threadpool_io->backend.edge_triggered)
+		pending_operations_update (data->selector, GPOINTER_TO_INT (key), -removed);
+
 	/* we skip all the first elements which are NULL */
 	for (; list; list = mono_mlist_next (list)) {
 		if (mono_mlist_get_data (list))
@@ -277,23 +395,95 @@ filter_sockares_for_domain (gpointer key, gpointer value, gpointer user_data)
 	mono_g_hash_table_replace (states, key, list);
 }
 
+/*
+ * registration_add:
+ *
+ *   Queue the registration of FD with the backend, so the registrations done while
+ * processing a batch of updates or events are done once per fd, right before the
+ * next wait.
+ */
+static void
+registration_add (ThreadPoolIOSelector *selector, gint fd, gboolean is_new)
+{
+	gpointer value;
+
+	/* keep is_new if the fd was added earlier in the batch */
+	if (g_hash_table_lookup_extended (selector->pending_registrations, GINT_TO_POINTER (fd), NULL, &value))
+		is_new = GPOINTER_TO_INT (value) - 1;
+
+	g_hash_table_insert (selector->pending_registrations, GINT_TO_POINTER (fd), GINT_TO_POINTER (is_new + 1));
+}
+
+/*
+ * registration_remove:
+ *
+ *   Cancel the pending registration of FD, and remove it from the backend if it
+ * was already registered.
+ */
+static void
+registration_remove (ThreadPoolIOSelector *selector, gint fd)
+{
+	gpointer value;
+
+	if (g_hash_table_lookup_extended (selector->pending_registrations, GINT_TO_POINTER (fd), NULL, &value)) {
+		g_hash_table_remove (selector->pending_registrations, GINT_TO_POINTER (fd));
+		/* it was never registered with the backend */
+		if (GPOINTER_TO_INT (value) - 1)
+			return;
+	}
+
+	threadpool_io->backend.remove_fd (selector->backend_data, fd);
+}
+
+static void
+registration_flush (ThreadPoolIOSelector *selector)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, selector->pending_registrations);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		gint fd = GPOINTER_TO_INT (key);
+		gint events;
+		gpointer k;
+		MonoMList *list = NULL;
+
+		if (!mono_g_hash_table_lookup_extended (selector->states, key, &k, (gpointer*) &list))
+			g_error ("registration_flush: fd %d not found in states table", fd);
+
+		events = get_events (list);
+
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: reg fd %3d, events = %2s | %2s | %3s",
+			fd, (events & EVENT_IN) ? "RD" : "..", (events & EVENT_OUT) ? "WR" : "..", (events & EVENT_ERR) ? "ERR" : "...");
+
+		threadpool_io->backend.register_fd (selector->backend_data, fd, events, GPOINTER_TO_INT (value) - 1);
+	}
+
+	g_hash_table_remove_all (selector->pending_registrations);
+}
+
 static void
 wait_callback (gint fd, gint events, gpointer user_data)
 {
+	ThreadPoolIOSelector *selector;
+
 	if (mono_runtime_is_shutting_down ())
 		return;
 
-	if (fd == threadpool_io->wakeup_pipes [0]) {
+	g_assert (user_data);
+	selector = user_data;
+
+	if (fd == selector->wakeup_pipes [0]) {
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: wke");
-		selector_thread_wakeup_drain_pipes ();
+		selector_thread_wakeup_drain_pipes (selector);
 	} else {
 		MonoGHashTable *states;
 		MonoMList *list = NULL;
 		gpointer k;
 		gboolean remove_fd = FALSE;
+		gint dispatched = 0;
 
-		g_assert (user_data);
-		states = user_data;
+		states = selector->states;
 
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: cal fd %3d, events = %2s | %2s | %3s",
 			fd, (events & EVENT_IN) ? "RD" : "..", (events & EVENT_OUT) ? "WR" : "..", (events & EVENT_ERR) ? "ERR" : "...");
@@ -303,31 +493,52 @@ wait_callback (gint fd, gint events, gpointer user_data)
 
 		if (list && (events & EVENT_IN) != 0) {
 			MonoSocketAsyncResult *sockares = get_sockares_for_event (&list, EVENT_IN);
-			if (sockares)
+			if (sockares) {
 				mono_threadpool_ms_enqueue_work_item (((MonoObject*) sockares)->vtable->domain, (MonoObject*) sockares);
+				dispatched += 1;
+			}
 		}
 		if (list && (events & EVENT_OUT) != 0) {
 			MonoSocketAsyncResult *sockares = get_sockares_for_event (&list, EVENT_OUT);
-			if (sockares)
+			if (sockares) {
 				mono_threadpool_ms_enqueue_work_item (((MonoObject*) sockares)->vtable->domain, (MonoObject*) sockares);
+				dispatched += 1;
+			}
 		}
 
 		remove_fd = (events & EVENT_ERR) == EVENT_ERR;
+
+		if (threadpool_io->backend.edge_triggered) {
+			/* there will be no other edge as long as the fd stays ready, so we remember
+			 * it for the next operation, which checks that the fd is still ready */
+			gint ready = GPOINTER_TO_INT (g_hash_table_lookup (selector->ready_events, GINT_TO_POINTER (fd)));
+			ready |= events & (EVENT_IN | EVENT_OUT);
+			if (ready != 0)
+				g_hash_table_insert (selector->ready_events, GINT_TO_POINTER (fd), GINT_TO_POINTER (ready));
+
+			mono_mutex_lock (&selector->updates_lock);
+			pending_operations_update (selector, fd, - (dispatched + (remove_fd ? mono_mlist_length (list) : 0)));
+			mono_mutex_unlock (&selector->updates_lock);
+		}
+
 		if (!remove_fd) {
 			mono_g_hash_table_replace (states, GINT_TO_POINTER (fd), list);
 
-			events = get_events (list);
+			/* edge triggered backends only need to be re-armed when operations are
+			 * still waiting, so the fd is reported again if it is still ready */
+			if (!threadpool_io->backend.edge_triggered || get_events (list) != 0) {
+				mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: res fd %3d", fd);
 
-			mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: res fd %3d, events = %2s | %2s | %2s",
-				fd, (events & EVENT_IN) ? "RD" : "..", (events & EVENT_OUT) ? "WR" : "..", (events & EVENT_ERR) ? "ERR" : "...");
-
-			threadpool_io->backend.register_fd (fd, events, FALSE);
+				registration_add (selector, fd, FALSE);
+			}
 		} else {
 			mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: err fd %d", fd);
 
 			mono_g_hash_table_remove (states, GINT_TO_POINTER (fd));
+			if (threadpool_io->backend.edge_triggered)
+				g_hash_table_remove (selector->ready_events, GINT_TO_POINTER (fd));
 
-			threadpool_io->backend.remove_fd (fd);
+			registration_remove (selector, fd);
 		}
 	}
 }
@@ -335,25 +546,29 @@ wait_callback (gint fd, gint events, gpointer user_data)
 static void
 selector_thread (gpointer data)
 {
+	ThreadPoolIOSelector *selector;
 	MonoGHashTable *states;
 
-	io_selector_running = TRUE;
+	g_assert (data);
+	selector = data;
 
 	if (mono_runtime_is_shutting_down ()) {
-		io_selector_running = FALSE;
+		selector->running = FALSE;
 		return;
 	}
 
-	states = mono_g_hash_table_new_type (g_direct_hash, g_direct_equal, MONO_HASH_VALUE_GC, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool states table");
+	states = selector->states = mono_g_hash_table_new_type (g_direct_hash, g_direct_equal, MONO_HASH_VALUE_GC, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool states table");
+	selector->pending_registrations = g_hash_table_new (g_direct_hash, g_direct_equal);
+	selector->ready_events = g_hash_table_new (g_direct_hash, g_direct_equal);
 
 	for (;;) {
 		gint i, j;
 		gint res;
 
-		mono_mutex_lock (&threadpool_io->updates_lock);
+		mono_mutex_lock (&selector->updates_lock);
 
-		for (i = 0; i < threadpool_io->updates_size; ++i) {
-			ThreadPoolIOUpdate *update = &threadpool_io->updates [i];
+		for (i = 0; i < selector->updates_size; ++i) {
+			ThreadPoolIOUpdate *update = &selector->updates [i];
 
 			switch (update->type) {
 			case UPDATE_EMPTY:
@@ -373,6 +588,17 @@ selector_thread (gpointer data)
 				g_assert (sockares);
 
 				exists = mono_g_hash_table_lookup_extended (states, GINT_TO_POINTER (fd), &k, (gpointer*) &list);
+
+				/* the operations already waiting in that direction go first */
+				if (exists && threadpool_io->backend.edge_triggered && (get_events (list) & get_events_from_sockares (sockares)) == 0
+					&& ready_events_take (selector, fd, get_events_from_sockares (sockares))) {
+					mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: rdy fd %3d", fd);
+
+					mono_threadpool_ms_enqueue_work_item (mono_object_domain (sockares), (MonoObject*) sockares);
+					pending_operations_update (selector, fd, -1);
+					break;
+				}
+
 				list = mono_mlist_append (list, (MonoObject*) sockares);
 				mono_g_hash_table_replace (states, sockares->handle, list);
 
@@ -381,7 +607,9 @@ selector_thread (gpointer data)
 				mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: %3s fd %3d, events = %2s | %2s | %2s",
 					exists ? "mod" : "add", fd, (events & EVENT_IN) ? "RD" : "..", (events & EVENT_OUT) ? "WR" : "..", (events & EVENT_ERR) ? "ERR" : "...");
 
-				threadpool_io->backend.register_fd (fd, events, !exists);
+				/* edge triggered backends keep the fd registered until it is removed */
+				if (!exists || !threadpool_io->backend.edge_triggered)
+					registration_add (selector, fd, !exists);
 
 				break;
 			}
@@ -395,18 +623,23 @@ selector_thread (gpointer data)
 
 				if (mono_g_hash_table_lookup_extended (states, GINT_TO_POINTER (fd), &k, (gpointer*) &list)) {
 					mono_g_hash_table_remove (states, GINT_TO_POINTER (fd));
+					g_hash_table_remove (selector->ready_events, GINT_TO_POINTER (fd));
 
-					for (j = i + 1; j < threadpool_io->updates_size; ++j) {
-						ThreadPoolIOUpdate *update = &threadpool_io->updates [j];
+					for (j = i + 1; j < selector->updates_size; ++j) {
+						ThreadPoolIOUpdate *update = &selector->updates [j];
 						if (update->type == UPDATE_ADD && update->data.add.fd == fd)
 							memset (update, 0, sizeof (ThreadPoolIOUpdate));
 					}
 
+					/* all the operations on the fd are either in list or were dropped above */
+					if (threadpool_io->backend.edge_triggered)
+						g_hash_table_remove (selector->pending_operations, GINT_TO_POINTER (fd));
+
 					for (; list; list = mono_mlist_remove_item (list, list))
 						mono_threadpool_ms_enqueue_work_item (mono_object_domain (mono_mlist_get_data (list)), mono_mlist_get_data (list));
 
 					mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: del fd %3d", fd);
-					threadpool_io->backend.remove_fd (fd);
+					registration_remove (selector, fd);
 				}
 
 				break;
@@ -417,13 +650,16 @@ selector_thread (gpointer data)
 				domain = update->data.remove_domain.domain;
 				g_assert (domain);
 
-				FilterSockaresForDomainData user_data = { .domain = domain, .states = states };
+				FilterSockaresForDomainData user_data = { .selector = selector, .domain = domain, .states = states };
 				mono_g_hash_table_foreach (states, filter_sockares_for_domain, &user_data);
 
-				for (j = i + 1; j < threadpool_io->updates_size; ++j) {
-					ThreadPoolIOUpdate *update = &threadpool_io->updates [j];
-					if (update->type == UPDATE_ADD && mono_object_domain (update->data.add.sockares) == domain)
+				for (j = i + 1; j < selector->updates_size; ++j) {
+					ThreadPoolIOUpdate *update = &selector->updates [j];
+					if (update->type == UPDATE_ADD && mono_object_domain (update->data.add.sockares) == domain) {
+						if (threadpool_io->backend.edge_triggered)
+							pending_operations_update (selector, update->data.add.fd, -1);
 						memset (update, 0, sizeof (ThreadPoolIOUpdate));
+					}
 				}
 
 				break;
@@ -433,56 +669,66 @@ selector_thread (gpointer data)
 			}
 		}
 
-		mono_cond_broadcast (&threadpool_io->updates_cond);
+		/* apply the registrations of the whole batch at once */
+		registration_flush (selector);
+
+		mono_cond_broadcast (&selector->updates_cond);
 
-		if (threadpool_io->updates_size > 0) {
-			threadpool_io->updates_size = 0;
-			memset (&threadpool_io->updates, 0, UPDATES_CAPACITY * sizeof (ThreadPoolIOUpdate));
+		if (selector->updates_size > 0) {
+			selector->updates_size = 0;
+			memset (&selector->updates, 0, UPDATES_CAPACITY * sizeof (ThreadPoolIOUpdate));
 		}
 
-		mono_mutex_unlock (&threadpool_io->updates_lock);
+		mono_mutex_unlock (&selector->updates_lock);
 
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: wai");
 
-		res = threadpool_io->backend.event_wait (wait_callback, states);
+		res = threadpool_io->backend.event_wait (selector->backend_data, wait_callback, selector);
 
 		if (res == -1 || mono_runtime_is_shutting_down ())
 			break;
 	}
 
+	g_hash_table_destroy (selector->pending_registrations);
+	selector->pending_registrations = NULL;
+
+	g_hash_table_destroy (selector->ready_events);
+	selector->ready_events = NULL;
+
 	mono_g_hash_table_destroy (states);
+	selector->states = NULL;
 
-	io_selector_running = FALSE;
+	selector->running = FALSE;
 }
 
-/* Locking: threadpool_io->updates_lock must be held */
+/* Locking: selector->updates_lock must be held */
 static ThreadPoolIOUpdate*
-update_get_new (void)
+update_get_new (ThreadPoolIOSelector *selector)
 {
 	ThreadPoolIOUpdate *update = NULL;
-	g_assert (threadpool_io->updates_size <= UPDATES_CAPACITY);
+	g_assert (selector->updates_size <= UPDATES_CAPACITY);
 
-	while (threadpool_io->updates_size == UPDATES_CAPACITY) {
+	while (selector->updates_size == UPDATES_CAPACITY) {
 		/* we wait for updates to be applied in the selector_thread and we loop
 		 * as long as none are available. if it happends too much, then we need
 		 * to increase UPDATES_CAPACITY */
-		mono_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+		mono_cond_wait (&selector->updates_cond, &selector->updates_lock);
 	}
 
-	g_assert (threadpool_io->updates_size < UPDATES_CAPACITY);
+	g_assert (selector->updates_size < UPDATES_CAPACITY);
 
-	update = &threadpool_io->updates [threadpool_io->updates_size ++];
+	update = &selector->updates [selector->updates_size ++];
 
 	return update;
 }
 
 static void
-wakeup_pipes_init (void)
+wakeup_pipes_init (ThreadPoolIOSelector *selector)
 {
 #if !defined(HOST_WIN32)
-	if (pipe (threadpool_io->wakeup_pipes) == -1)
+	if (pipe (selector->wakeup_pipes) == -1)
 		g_error ("wakeup_pipes_init: pipe () failed, error (%d) %s\n", errno, g_strerror (errno));
-	if (fcntl (threadpool_io->wakeup_pipes [0], F_SETFL, O_NONBLOCK) == -1)
+	if (fcntl (selector->wakeup_pipes [0], F_SETFL, O_NONBLOCK) == -1)
 		g_error ("wakeup_pipes_init: fcntl () failed, error (%d) %s\n", errno, g_strerror (errno));
 #else
 	struct sockaddr_in client;
@@ -493,8 +739,8 @@ wakeup_pipes_init (void)
 
 	server_sock = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
 	g_assert (server_sock != INVALID_SOCKET);
-	threadpool_io->wakeup_pipes [1] = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	g_assert (threadpool_io->wakeup_pipes [1] != INVALID_SOCKET);
+	selector->wakeup_pipes [1] = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	g_assert (selector->wakeup_pipes [1] != INVALID_SOCKET);
 
 	server.sin_family = AF_INET;
 	server.sin_addr.s_addr = inet_addr ("127.0.0.1");
@@ -513,18 +759,18 @@ wakeup_pipes_init (void)
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: listen () failed, error (%d)\n", WSAGetLastError ());
 	}
-	if (connect ((SOCKET) threadpool_io->wakeup_pipes [1], (SOCKADDR*) &server, sizeof (server)) == SOCKET_ERROR) {
+	if (connect ((SOCKET) selector->wakeup_pipes [1], (SOCKADDR*) &server, sizeof (server)) == SOCKET_ERROR) {
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: connect () failed, error (%d)\n", WSAGetLastError ());
 	}
 
 	size = sizeof (client);
-	threadpool_io->wakeup_pipes [0] = accept (server_sock, (SOCKADDR *) &client, &size);
-	g_assert (threadpool_io->wakeup_pipes [0] != INVALID_SOCKET);
+	selector->wakeup_pipes [0] = accept (server_sock, (SOCKADDR *) &client, &size);
+	g_assert (selector->wakeup_pipes [0] != INVALID_SOCKET);
 
 	arg = 1;
-	if (ioctlsocket (threadpool_io->wakeup_pipes [0], FIONBIO, &arg) == SOCKET_ERROR) {
-		closesocket (threadpool_io->wakeup_pipes [0]);
+	if (ioctlsocket (selector->wakeup_pipes [0], FIONBIO, &arg) == SOCKET_ERROR) {
+		closesocket (selector->wakeup_pipes [0]);
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: ioctlsocket () failed, error (%d)\n", WSAGetLastError ());
 	}
@@ -536,32 +782,51 @@ wakeup_pipes_init (void)
 static void
 initialize (void)
 {
+	const gchar *selectors_env;
+	gint i;
+
 	g_assert (!threadpool_io);
 	threadpool_io = g_new0 (ThreadPoolIO, 1);
 	g_assert (threadpool_io);
 
-	mono_mutex_init_recursive (&threadpool_io->updates_lock);
-	mono_cond_init (&threadpool_io->updates_cond, 0);
-	mono_gc_register_root ((void*)&threadpool_io->updates [0], sizeof (threadpool_io->updates), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool updates list");
+	if (!(selectors_env = g_getenv ("MONO_THREADPOOL_IO_SELECTORS")))
+		threadpool_io->selectors_count = 1;
+	else
+		threadpool_io->selectors_count = CLAMP (atoi (selectors_env), 1, SELECTORS_MAX);
 
-	threadpool_io->updates_size = 0;
+	threadpool_io->selectors = g_new0 (ThreadPoolIOSelector, threadpool_io->selectors_count);
 
 	threadpool_io->backend = backend_poll;
 	if (g_getenv ("MONO_ENABLE_AIO") != NULL) {
 #if defined(HAVE_EPOLL)
-		threadpool_io->backend = backend_epoll;
+		if (g_getenv ("MONO_THREADPOOL_IO_EDGE_TRIGGERED") != NULL)
+			threadpool_io->backend = backend_epoll_edge;
+		else
+			threadpool_io->backend = backend_epoll;
 #elif defined(HAVE_KQUEUE)
 		threadpool_io->backend = backend_kqueue;
 #endif
 	}
 
-	wakeup_pipes_init ();
+	for (i = 0; i < threadpool_io->selectors_count; ++i) {
+		ThreadPoolIOSelector *selector = &threadpool_io->selectors [i];
+
+		mono_mutex_init_recursive (&selector->updates_lock);
+		mono_cond_init (&selector->updates_cond, 0);
+		selector->pending_operations = g_hash_table_new (g_direct_hash, g_direct_equal);
+		mono_gc_register_root ((void*)&selector->updates [0], sizeof (selector->updates), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool updates list");
 
-	if (!threadpool_io->backend.init (threadpool_io->wakeup_pipes [0]))
-		g_error ("initialize: backend->init () failed");
+		selector->updates_size = 0;
 
-	if (!mono_thread_create_internal (mono_get_root_domain (), selector_thread, NULL, TRUE, SMALL_STACK))
-		g_error ("initialize: mono_thread_create_internal () failed");
+		wakeup_pipes_init (selector);
+
+		if (!(selector->backend_data = threadpool_io->backend.init (selector->wakeup_pipes [0])))
+			g_error ("initialize: backend->init () failed");
+
+		selector->running = TRUE;
+		if (!mono_thread_create_internal (mono_get_root_domain (), selector_thread, selector, TRUE, SMALL_STACK))
+			g_error ("initialize: mono_thread_create_internal () failed");
+	}
 }
 
 static void
@@ -569,24 +834,35 @@ cleanup (void)
 {
 	/* we make the assumption along the code that we are
 	 * cleaning up only if the runtime is shutting down */
+	gint i;
+
 	g_assert (mono_runtime_is_shutting_down ());
 
-	selector_thread_wakeup ();
-	while (io_selector_running)
-		g_usleep (1000);
+	for (i = 0; i < threadpool_io->selectors_count; ++i)
+		selector_thread_wakeup (&threadpool_io->selectors [i]);
 
-	mono_mutex_destroy (&threadpool_io->updates_lock);
-	mono_cond_destroy (&threadpool_io->updates_cond);
+	for (i = 0; i < threadpool_io->selectors_count; ++i) {
+		ThreadPoolIOSelector *selector = &threadpool_io->selectors [i];
 
-	threadpool_io->backend.cleanup ();
+		while (selector->running)
+			g_usleep (1000);
+
+		mono_mutex_destroy (&selector->updates_lock);
+		mono_cond_destroy (&selector->updates_cond);
+		g_hash_table_destroy (selector->pending_operations);
+
+		threadpool_io->backend.cleanup (selector->backend_data);
 
 #if !defined(HOST_WIN32)
-	close (threadpool_io->wakeup_pipes [0]);
-	close (threadpool_io->wakeup_pipes [1]);
+		close (selector->wakeup_pipes [0]);
+		close (selector->wakeup_pipes [1]);
 #else
-	closesocket (threadpool_io->wakeup_pipes [0]);
-	closesocket (threadpool_io->wakeup_pipes [1]);
+		closesocket (selector->wakeup_pipes [0]);
+		closesocket (selector->wakeup_pipes [1]);
 #endif
+	}
+
+	g_free (threadpool_io->selectors);
 
 	g_assert (threadpool_io);
 	g_free (threadpool_io);
@@ -643,7 +919,9 @@ mono_threadpool_ms_io_cleanup (void)
 MonoAsyncResult *
 mono_threadpool_ms_io_add (MonoAsyncResult *ares, MonoSocketAsyncResult *sockares)
 {
+	ThreadPoolIOSelector *selector;
 	ThreadPoolIOUpdate *update;
+	gint fd;
 
 	g_assert (ares);
 	g_assert (sockares);
@@ -657,17 +935,34 @@ mono_threadpool_ms_io_add (MonoAsyncResult *ares, MonoSocketAsyncResult *sockare
 
 	MONO_OBJECT_SETREF (sockares, ares, ares);
 
-	mono_mutex_lock (&threadpool_io->updates_lock);
+	fd = GPOINTER_TO_INT (sockares->handle);
+	selector = selector_for_fd (fd);
+
+	mono_mutex_lock (&selector->updates_lock);
+
+	if (threadpool_io->backend.edge_triggered) {
+		if (!g_hash_table_lookup (selector->pending_operations, GINT_TO_POINTER (fd)) && poll_fd_events (fd, get_events_from_sockares (sockares)) != 0) {
+			mono_mutex_unlock (&selector->updates_lock);
 
-	update = update_get_new ();
+			/* the operation can complete right away, and no other operation is queued
+			 * on the fd, so we queue it to the worker threads directly instead of going
+			 * through the selector thread */
+			mono_threadpool_ms_enqueue_work_item (mono_object_domain (sockares), (MonoObject*) sockares);
+			return ares;
+		}
+
+		pending_operations_update (selector, fd, 1);
+	}
+
+	update = update_get_new (selector);
 	update->type = UPDATE_ADD;
-	update->data.add.fd = GPOINTER_TO_INT (sockares->handle);
+	update->data.add.fd = fd;
 	update->data.add.sockares = sockares;
 	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	selector_thread_wakeup ();
+	selector_thread_wakeup (selector);
 
-	mono_mutex_unlock (&threadpool_io->updates_lock);
+	mono_mutex_unlock (&selector->updates_lock);
 
 	return ares;
 }
@@ -675,45 +970,54 @@ mono_threadpool_ms_io_add (MonoAsyncResult *ares, MonoSocketAsyncResult *sockare
 void
 mono_threadpool_ms_io_remove_socket (int fd)
 {
+	ThreadPoolIOSelector *selector;
 	ThreadPoolIOUpdate *update;
 
 	if (!mono_lazy_is_initialized (&io_status))
 		return;
 
-	mono_mutex_lock (&threadpool_io->updates_lock);
+	selector = selector_for_fd (fd);
 
-	update = update_get_new ();
+	mono_mutex_lock (&selector->updates_lock);
+
+	update = update_get_new (selector);
 	update->type = UPDATE_REMOVE_SOCKET;
 	update->data.add.fd = fd;
 	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	selector_thread_wakeup ();
+	selector_thread_wakeup (selector);
 
-	mono_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+	mono_cond_wait (&selector->updates_cond, &selector->updates_lock);
 
-	mono_mutex_unlock (&threadpool_io->updates_lock);
+	mono_mutex_unlock (&selector->updates_lock);
 }
 
 void
 mono_threadpool_ms_io_remove_domain_jobs (MonoDomain *domain)
 {
-	ThreadPoolIOUpdate *update;
+	gint i;
 
 	if (!mono_lazy_is_initialized (&io_status))
 		return;
 
-	mono_mutex_lock (&threadpool_io->updates_lock);
+	/* the sockets of the domain can be handled by any of the selectors */
+	for (i = 0; i < threadpool_io->selectors_count; ++i) {
+		ThreadPoolIOSelector *selector = &threadpool_io->selectors [i];
+		ThreadPoolIOUpdate *update;
 
-	update = update_get_new ();
-	update->type = UPDATE_REMOVE_DOMAIN;
-	update->data.remove_domain.domain = domain;
-	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
+		mono_mutex_lock (&selector->updates_lock);
+
+		update = update_get_new (selector);
+		update->type = UPDATE_REMOVE_DOMAIN;
+		update->data.remove_domain.domain = domain;
+		mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	selector_thread_wakeup ();
+		selector_thread_wakeup (selector);
 
-	mono_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+		mono_cond_wait (&selector->updates_cond, &selector->updates_lock);
 
-	mono_mutex_unlock (&threadpool_io->updates_lock);
+		mono_mutex_unlock (&selector->updates_lock);
+	}
 }
 
 void
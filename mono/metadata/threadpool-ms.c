@@ -42,6 +42,8 @@
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/mono-time.h>
 #include <mono/utils/mono-rand.h>
+#include <mono/utils/mono-semaphore.h>
+#include <mono/utils/mono-tls.h>
 
 #define CPU_USAGE_LOW 80
 #define CPU_USAGE_HIGH 95
@@ -83,11 +85,11 @@ typedef union {
 
 typedef struct {
 	MonoDomain *domain;
+	/* accessed with atomic operations, see domain_try_take_request */
 	gint32 outstanding_request;
 } ThreadPoolDomain;
 
 typedef MonoInternalThread ThreadPoolWorkingThread;
-typedef mono_cond_t ThreadPoolParkedThread;
 
 typedef struct {
 	gint32 wave_period;
@@ -129,8 +131,10 @@ typedef struct {
 	mono_mutex_t domains_lock;
 
 	GPtrArray *working_threads; // ThreadPoolWorkingThread* []
-	GPtrArray *parked_threads; // ThreadPoolParkedThread* []
-	mono_mutex_t active_threads_lock; /* protect access to working_threads and parked_threads */
+	mono_mutex_t active_threads_lock; /* protect access to working_threads */
+
+	/* parked workers wait on this semaphore, see worker_park and worker_try_unpark */
+	MonoSemType parked_threads_sem;
 
 	gint32 heuristic_completions;
 	guint32 heuristic_sample_start;
@@ -176,6 +180,9 @@ static gint32 monitor_status = MONITOR_STATUS_NOT_RUNNING;
 
 static ThreadPool* threadpool;
 
+/* The ThreadPoolDomain the current worker is executing a job in, if any */
+static MonoNativeTlsKey current_tpdomain_key;
+
 #define COUNTER_CHECK(counter) \
 	do { \
 		g_assert (counter._.max_working > 0); \
@@ -250,9 +257,11 @@ initialize (void)
 	threadpool->domains = g_ptr_array_new ();
 	mono_mutex_init_recursive (&threadpool->domains_lock);
 
-	threadpool->parked_threads = g_ptr_array_new ();
 	threadpool->working_threads = g_ptr_array_new ();
 	mono_mutex_init (&threadpool->active_threads_lock);
+	MONO_SEM_INIT (&threadpool->parked_threads_sem, 0);
+
+	mono_native_tls_alloc (&current_tpdomain_key, NULL);
 
 	threadpool->heuristic_adjustment_interval = 10;
 	mono_mutex_init (&threadpool->heuristic_lock);
@@ -303,7 +312,7 @@ initialize (void)
 	threadpool->suspended = FALSE;
 }
 
-static void worker_unpark (ThreadPoolParkedThread *thread);
+static gboolean worker_try_unpark (void);
 static void worker_kill (ThreadPoolWorkingThread *thread);
 
 static void
@@ -328,11 +337,11 @@ cleanup (void)
 	for (i = 0; i < threadpool->working_threads->len; ++i)
 		worker_kill ((ThreadPoolWorkingThread*) g_ptr_array_index (threadpool->working_threads, i));
 
-	/* unpark all threadpool->parked_threads */
-	for (i = 0; i < threadpool->parked_threads->len; ++i)
-		worker_unpark ((ThreadPoolParkedThread*) g_ptr_array_index (threadpool->parked_threads, i));
-
 	mono_mutex_unlock (&threadpool->active_threads_lock);
+
+	/* unpark all the parked threads */
+	while (worker_try_unpark ())
+		;
 }
 
 void
@@ -453,6 +462,32 @@ domain_any_has_request (void)
 	return res;
 }
 
+/*
+ * domain_try_take_request:
+ *
+ *   Atomically take one of the outstanding requests of TPDOMAIN. This doesn't need
+ * the domains_lock, as long as the caller makes sure TPDOMAIN can't be freed.
+ */
+static gboolean
+domain_try_take_request (ThreadPoolDomain *tpdomain)
+{
+	gint32 outstanding_request;
+
+	do {
+		outstanding_request = InterlockedRead (&tpdomain->outstanding_request);
+		if (outstanding_request <= 0)
+			return FALSE;
+	} while (InterlockedCompareExchange (&tpdomain->outstanding_request, outstanding_request - 1, outstanding_request) != outstanding_request);
+
+	return TRUE;
+}
+
+/*
+ * domain_get_next:
+ *
+ *   Return the next domain after CURRENT which has an outstanding request, and take
+ * one of its requests.
+ */
 static ThreadPoolDomain *
 domain_get_next (ThreadPoolDomain *current)
 {
@@ -474,7 +509,7 @@ domain_get_next (ThreadPoolDomain *current)
 		}
 		for (i = current_idx + 1; i < len + current_idx + 1; ++i) {
 			ThreadPoolDomain *tmp = g_ptr_array_index (threadpool->domains, i % len);
-			if (tmp->outstanding_request > 0) {
+			if (domain_try_take_request (tmp)) {
 				tpdomain = tmp;
 				break;
 			}
@@ -484,75 +519,89 @@ domain_get_next (ThreadPoolDomain *current)
 	return tpdomain;
 }
 
+/*
+ * worker_try_claim_parked:
+ *
+ *   Account for the wake up of one of the parked workers. Each successful claim must
+ * be matched by a post of parked_threads_sem, or a parked worker claiming itself.
+ */
+static gboolean
+worker_try_claim_parked (void)
+{
+	ThreadPoolCounter counter;
+
+	COUNTER_ATOMIC (counter, {
+		if (counter._.parked == 0)
+			return FALSE;
+		counter._.working ++;
+		counter._.parked --;
+	});
+
+	return TRUE;
+}
+
+/*
+ * worker_park:
+ *
+ *   Park the current worker until worker_try_unpark is called. The caller should have
+ * incremented the parked counter before calling this.
+ */
 static void
 worker_park (void)
 {
-	mono_cond_t cond;
 	MonoInternalThread *thread = mono_thread_internal_current ();
 
 	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] current worker parking", GetCurrentThreadId ());
 
-	mono_cond_init (&cond, 0);
-
 	mono_gc_set_skip_thread (TRUE);
 
 	MONO_PREPARE_BLOCKING;
 
 	mono_mutex_lock (&threadpool->active_threads_lock);
+	g_ptr_array_remove_fast (threadpool->working_threads, thread);
+	mono_mutex_unlock (&threadpool->active_threads_lock);
 
-	if (!mono_runtime_is_shutting_down ()) {
-		g_ptr_array_add (threadpool->parked_threads, &cond);
-		g_ptr_array_remove_fast (threadpool->working_threads, thread);
-
-		mono_cond_wait (&cond, &threadpool->active_threads_lock);
-
-		g_ptr_array_add (threadpool->working_threads, thread);
-		g_ptr_array_remove (threadpool->parked_threads, &cond);
-	}
+	/*
+	 * If we are shutting down, cleanup () might have already unparked all the parked
+	 * threads, so don't wait unless somebody already claimed a wake up.
+	 */
+	if (!mono_runtime_is_shutting_down () || !worker_try_claim_parked ())
+		MONO_SEM_WAIT_UNITERRUPTIBLE (&threadpool->parked_threads_sem);
 
+	mono_mutex_lock (&threadpool->active_threads_lock);
+	g_ptr_array_add (threadpool->working_threads, thread);
 	mono_mutex_unlock (&threadpool->active_threads_lock);
 
 	MONO_FINISH_BLOCKING;
 
 	mono_gc_set_skip_thread (FALSE);
 
-	mono_cond_destroy (&cond);
-
 	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] current worker unparking", GetCurrentThreadId ());
 }
 
+/*
+ * worker_try_unpark:
+ *
+ *   Wake up one of the parked workers, if any. This doesn't take any lock, so it can
+ * be called for every request.
+ */
 static gboolean
 worker_try_unpark (void)
 {
 	gboolean res = FALSE;
-	guint len;
 
 	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] try unpark worker", GetCurrentThreadId ());
 
-	MONO_PREPARE_BLOCKING;
-
-	mono_mutex_lock (&threadpool->active_threads_lock);
-	len = threadpool->parked_threads->len;
-	if (len > 0) {
-		mono_cond_t *cond = (mono_cond_t*) g_ptr_array_index (threadpool->parked_threads, len - 1);
-		mono_cond_signal (cond);
+	if (worker_try_claim_parked ()) {
+		MONO_SEM_POST (&threadpool->parked_threads_sem);
 		res = TRUE;
 	}
-	mono_mutex_unlock (&threadpool->active_threads_lock);
-
-	MONO_FINISH_BLOCKING;
 
 	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] try unpark worker, success? %s", GetCurrentThreadId (), res ? "yes" : "no");
 
 	return res;
 }
 
-static void
-worker_unpark (ThreadPoolParkedThread *thread)
-{
-	mono_cond_signal ((mono_cond_t*) thread);
-}
-
 static void
 worker_kill (ThreadPoolWorkingThread *thread)
 {
@@ -604,24 +653,17 @@ worker_thread (gpointer data)
 				counter._.parked ++;
 			});
 
+			/* the counters are restored by the thread unparking us */
 			mono_mutex_unlock (&threadpool->domains_lock);
 			worker_park ();
 			mono_mutex_lock (&threadpool->domains_lock);
 
-			COUNTER_ATOMIC (counter, {
-				counter._.working ++;
-				counter._.parked --;
-			});
-
 			if (retire)
 				retire = FALSE;
 
 			continue;
 		}
 
-		tpdomain->outstanding_request --;
-		g_assert (tpdomain->outstanding_request >= 0);
-
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] worker running in domain %p",
 			GetCurrentThreadId (), tpdomain->domain, tpdomain->outstanding_request);
 
@@ -631,22 +673,39 @@ worker_thread (gpointer data)
 
 		mono_mutex_unlock (&threadpool->domains_lock);
 
-		mono_thread_push_appdomain_ref (tpdomain->domain);
-		if (mono_domain_set (tpdomain->domain, FALSE)) {
-			MonoObject *exc = NULL;
-			MonoObject *res = mono_runtime_invoke (mono_defaults.threadpool_perform_wait_callback_method, NULL, NULL, &exc);
-			if (exc)
-				mono_thread_internal_unhandled_exception (exc);
-			else if (res && *(MonoBoolean*) mono_object_unbox (res) == FALSE)
-				retire = TRUE;
+		/* the job reference taken above keeps tpdomain alive, see worker_request */
+		mono_native_tls_set_value (current_tpdomain_key, tpdomain);
 
-			mono_thread_clr_state (thread , ~ThreadState_Background);
-			if (!mono_thread_test_state (thread , ThreadState_Background))
-				ves_icall_System_Threading_Thread_SetState (thread, ThreadState_Background);
+		do {
+			mono_thread_push_appdomain_ref (tpdomain->domain);
+			if (mono_domain_set (tpdomain->domain, FALSE)) {
+				MonoObject *exc = NULL;
+				MonoObject *res = mono_runtime_invoke (mono_defaults.threadpool_perform_wait_callback_method, NULL, NULL, &exc);
+				if (exc)
+					mono_thread_internal_unhandled_exception (exc);
+				else if (res && *(MonoBoolean*) mono_object_unbox (res) == FALSE)
+					retire = TRUE;
+
+				mono_thread_clr_state (thread , ~ThreadState_Background);
+				if (!mono_thread_test_state (thread , ThreadState_Background))
+					ves_icall_System_Threading_Thread_SetState (thread, ThreadState_Background);
+
+				mono_domain_set (mono_get_root_domain (), TRUE);
+			}
+			mono_thread_pop_appdomain_ref ();
 
-			mono_domain_set (mono_get_root_domain (), TRUE);
-		}
-		mono_thread_pop_appdomain_ref ();
+			/*
+			 * Fast path: if this is the only domain, keep running its requests without going
+			 * through domain_get_next, so the common case of a worker running the work items
+			 * it queued itself doesn't take the domains_lock. Other workers can still take
+			 * these requests in domain_get_next.
+			 */
+		} while (!retire && !mono_runtime_is_shutting_down ()
+			&& (thread->state & (ThreadState_StopRequested | ThreadState_SuspendRequested)) == 0
+			&& threadpool->domains->len == 1 && !mono_domain_is_unloading (tpdomain->domain)
+			&& domain_try_take_request (tpdomain));
+
+		mono_native_tls_set_value (current_tpdomain_key, NULL);
 
 		mono_mutex_lock (&threadpool->domains_lock);
 
@@ -725,22 +784,38 @@ worker_request (MonoDomain *domain)
 	if (mono_runtime_is_shutting_down ())
 		return FALSE;
 
-	mono_mutex_lock (&threadpool->domains_lock);
+	tpdomain = mono_native_tls_get_value (current_tpdomain_key);
+	if (tpdomain && tpdomain->domain == domain) {
+		/*
+		 * Fast path for requests made by a worker for the domain it is running in: the worker
+		 * holds a job reference on the domain, so tpdomain can't be removed and the domain
+		 * can't finish unloading until it returns, and we don't need the domains_lock.
+		 */
+		if (mono_domain_is_unloading (domain))
+			return FALSE;
 
-	/* synchronize check with worker_thread */
-	if (mono_domain_is_unloading (domain)) {
-		mono_mutex_unlock (&threadpool->domains_lock);
-		return FALSE;
-	}
+		InterlockedIncrement (&tpdomain->outstanding_request);
 
-	tpdomain = domain_get (domain, TRUE);
-	g_assert (tpdomain);
-	tpdomain->outstanding_request ++;
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker from worker, domain = %p, outstanding_request = %d",
+			GetCurrentThreadId (), tpdomain->domain, tpdomain->outstanding_request);
+	} else {
+		mono_mutex_lock (&threadpool->domains_lock);
 
-	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, domain = %p, outstanding_request = %d",
-		GetCurrentThreadId (), tpdomain->domain, tpdomain->outstanding_request);
+		/* synchronize check with worker_thread */
+		if (mono_domain_is_unloading (domain)) {
+			mono_mutex_unlock (&threadpool->domains_lock);
+			return FALSE;
+		}
 
-	mono_mutex_unlock (&threadpool->domains_lock);
+		tpdomain = domain_get (domain, TRUE);
+		g_assert (tpdomain);
+		InterlockedIncrement (&tpdomain->outstanding_request);
+
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, domain = %p, outstanding_request = %d",
+			GetCurrentThreadId (), tpdomain->domain, tpdomain->outstanding_request);
+
+		mono_mutex_unlock (&threadpool->domains_lock);
+	}
 
 	if (threadpool->suspended)
 		return FALSE;
@@ -19,6 +19,7 @@
 #ifndef DISABLE_JIT
 
 #include "abcremoval.h"
+#include "ir-emit.h"
 
 #if SIZEOF_VOID_P == 8
 #define OP_PCONST OP_I8CONST
@@ -324,6 +325,27 @@ get_relation_from_ins (MonoVariableRelationsEvaluationArea *area, MonoInst *ins,
 		value->value.variable.delta = 0;
 		area->defs [ins->dreg] = ins;
 		break;
+	case OP_STRLEN:
+		/* Same as OP_LDLEN, strings are represented by their length */
+		value->type = MONO_VARIABLE_SUMMARIZED_VALUE;
+		value->value.variable.variable = ins->sreg1;
+		value->value.variable.delta = 0;
+		value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
+		break;
+	case OP_IAND_IMM:
+		/* Masking with a positive constant gives 0 <= x <= imm */
+		if (ins->inst_imm >= 0) {
+			result->relation = MONO_LE_RELATION;
+			value->type = MONO_CONSTANT_SUMMARIZED_VALUE;
+			value->value.constant.value = ins->inst_imm;
+			value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
+		}
+		break;
+	case OP_ISHR_UN_IMM:
+		/* The result of an unsigned shift is non negative */
+		if (ins->inst_imm > 0)
+			value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
+		break;
 	case OP_LDADDR:
 		/* The result is non-null */
 		result->relation = MONO_GT_RELATION;
@@ -997,6 +1019,7 @@ remove_abc_from_inst (MonoInst *ins, MonoVariableRelationsEvaluationArea *area)
 					array_variable, index_variable);
 		}
 		NULLIFY_INS (ins);
+		InterlockedIncrement (&mono_jit_stats.bounds_checks_removed);
 	} else {
 		if (TRACE_ABC_REMOVAL) {
 			if (index_context->ranges.zero.lower >= 0) {
@@ -1355,7 +1378,7 @@ mono_perform_abc_removal (MonoCompile *cfg)
 			int related_index = cfg->next_vreg + i;
 			int related_variable = area.relations [i].related_value.value.variable.variable;
 			
-			area.relations [related_index].relation = MONO_EQ_RELATION;
+			area.relations [related_index].relation = MONO_SYMMETRIC_RELATION (area.relations [i].relation);
 			area.relations [related_index].relation_is_static_definition = TRUE;
 			area.relations [related_index].related_value.type = MONO_VARIABLE_SUMMARIZED_VALUE;
 			area.relations [related_index].related_value.value.variable.variable = i;
@@ -1375,4 +1398,863 @@ mono_perform_abc_removal (MonoCompile *cfg)
 	process_block (cfg, cfg->bblocks [0], &area);
 }
 
+/*
+ * Loop versioning
+ *
+ *   The relation graph can only prove checks whose bounds are implied by the
+ * conditions dominating them, so in loops like
+ *
+ *   for (i = start; i < count; i++)
+ *       a [offset + i] = 0;
+ *
+ * the checks are kept, since nothing relates COUNT or OFFSET to the length of A.
+ * For these loops, mono_abc_version_loops () creates a copy of the loop, and emits
+ * a guard before it which enters the original loop only if no index computed from
+ * the induction variable can be out of range. The checks covered by the guard are
+ * removed from the original loop, while the copy keeps all of them, so it can be
+ * used when the guard fails.
+ * This runs before SSA, when all the values used in more than one bblock are
+ * variables, so the induction variable, the bound and the arrays are recognized by
+ * looking at the definitions of variables inside the loop, and the loop itself is
+ * found without dominator information.
+ */
+
+#define VERSION_MAX_LOOP_SIZE 128
+#define VERSION_MAX_DELTA 16
+#define VERSION_MAX_ARRAYS 4
+
+typedef struct {
+	int array_reg;
+	/* Invariant added to the index, or -1 */
+	int offset_reg;
+	/* Offset of the length field, from the bounds checks */
+	int length_offset;
+	int max_delta;
+} VersionedArray;
+
+typedef struct {
+	MonoCompile *cfg;
+	MonoBasicBlock *header, *body, *preheader;
+	/* These are indexed by block_num */
+	guint8 *reach;
+	guint8 *in_loop;
+	guint8 *after_def;
+	MonoBasicBlock **stack;
+	/* The number of bblocks before versioning */
+	int num_bblocks;
+	GSList *blocks;
+	int size;
+	/* The induction variable, which is incremented by one at IV_DEF */
+	int iv_reg;
+	MonoInst *iv_def;
+	MonoBasicBlock *iv_def_bb;
+	/* The loop runs while IV < BOUND, or IV <= BOUND if BOUND_INCLUSIVE */
+	int bound_reg;
+	int bound_const;
+	gboolean bound_inclusive;
+	MonoInst *compare;
+	int min_delta;
+	VersionedArray arrays [VERSION_MAX_ARRAYS];
+	int narrays;
+	GSList *checks;
+} VersionedLoop;
+
+static inline gboolean
+ins_defines_reg (MonoInst *ins, int reg)
+{
+	const char *spec = INS_INFO (ins->opcode);
+
+	return spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && !MONO_IS_STORE_MEMINDEX (ins) && ins->dreg == reg;
+}
+
+static inline gboolean
+is_local_vreg (MonoCompile *cfg, int reg)
+{
+	return reg >= MAX (MONO_MAX_IREGS, MONO_MAX_FREGS) && !get_vreg_to_inst (cfg, reg);
+}
+
+/*
+ * Mark the blocks reachable from START without going through LOOP->header.
+ * Return whenever the header is reached.
+ */
+static gboolean
+version_mark_reachable (VersionedLoop *loop, MonoBasicBlock *start, guint8 *marks)
+{
+	MonoCompile *cfg = loop->cfg;
+	gboolean found = FALSE;
+	int sp = 0, i;
+
+	memset (marks, 0, cfg->num_bblocks);
+	marks [start->block_num] = 1;
+	loop->stack [sp ++] = start;
+	while (sp > 0) {
+		MonoBasicBlock *bb = loop->stack [-- sp];
+
+		for (i = 0; i < bb->out_count; ++i) {
+			MonoBasicBlock *succ = bb->out_bb [i];
+
+			if (succ == loop->header) {
+				found = TRUE;
+			} else if (!marks [succ->block_num]) {
+				marks [succ->block_num] = 1;
+				loop->stack [sp ++] = succ;
+			}
+		}
+	}
+	return found;
+}
+
+static gboolean
+version_can_clone_ins (MonoCompile *cfg, MonoInst *ins)
+{
+	const char *spec = INS_INFO (ins->opcode);
+
+	if (MONO_IS_CALL (ins) || MONO_IS_JUMP_TABLE (ins))
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_BR_REG:
+	case OP_CALL_HANDLER:
+	case OP_START_HANDLER:
+	case OP_ENDFINALLY:
+	case OP_ENDFILTER:
+	case OP_THROW:
+	case OP_RETHROW:
+	case OP_LOCALLOC:
+	case OP_LOCALLOC_IMM:
+	case OP_OUTARG_VT:
+	case OP_OUTARG_VTRETADDR:
+	case OP_JMP:
+	case OP_ARGLIST:
+		return FALSE;
+	default:
+		break;
+	}
+
+	if (MONO_IS_COND_BRANCH_OP (ins) && !ins->inst_false_bb)
+		return FALSE;
+
+	switch (spec [MONO_INST_DEST]) {
+	case ' ':
+	case 'i':
+	case 'f':
+		return TRUE;
+	case 'v':
+		/* Vtype temporaries are always variables, so they don't need renaming */
+		return MONO_IS_STORE_MEMBASE (ins) || get_vreg_to_inst (cfg, ins->dreg) != NULL;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * version_find_loop:
+ *
+ *   Find the natural loop whose header is HEADER, where HEADER ends with the loop
+ * condition, and check that it has a single entry and can be cloned.
+ */
+static gboolean
+version_find_loop (VersionedLoop *loop, MonoBasicBlock *header, guint8 *versioned)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *branch = header->last_ins;
+	MonoBasicBlock *bb, *exit;
+	int sp = 0, i, nlatches = 0;
+
+	if (!branch || !MONO_IS_COND_BRANCH_OP (branch) || !branch->inst_true_bb || !branch->inst_false_bb)
+		return FALSE;
+	if (branch->inst_true_bb == header || branch->inst_false_bb == header)
+		return FALSE;
+
+	/* Exactly one of the successors has to reach back to the header */
+	if (version_mark_reachable (loop, branch->inst_false_bb, loop->reach)) {
+		loop->body = branch->inst_false_bb;
+		exit = branch->inst_true_bb;
+	} else {
+		loop->body = branch->inst_true_bb;
+		exit = branch->inst_false_bb;
+	}
+	if (version_mark_reachable (loop, exit, loop->reach) || !version_mark_reachable (loop, loop->body, loop->reach))
+		return FALSE;
+
+	/* The loop is made of the blocks which can reach a latch without going through the header */
+	memset (loop->in_loop, 0, cfg->num_bblocks);
+	loop->in_loop [header->block_num] = 1;
+	for (i = 0; i < header->in_count; ++i) {
+		bb = header->in_bb [i];
+		if (loop->reach [bb->block_num] && !loop->in_loop [bb->block_num]) {
+			loop->in_loop [bb->block_num] = 1;
+			loop->stack [sp ++] = bb;
+			nlatches ++;
+		}
+	}
+	if (!nlatches)
+		return FALSE;
+	while (sp > 0) {
+		bb = loop->stack [-- sp];
+		for (i = 0; i < bb->in_count; ++i) {
+			MonoBasicBlock *pred = bb->in_bb [i];
+
+			if (loop->in_loop [pred->block_num])
+				continue;
+			/* An entry which doesn't go through the header */
+			if (!loop->reach [pred->block_num])
+				return FALSE;
+			loop->in_loop [pred->block_num] = 1;
+			loop->stack [sp ++] = pred;
+		}
+	}
+
+	loop->preheader = NULL;
+	for (i = 0; i < header->in_count; ++i) {
+		bb = header->in_bb [i];
+		if (loop->in_loop [bb->block_num])
+			continue;
+		if (loop->preheader)
+			return FALSE;
+		loop->preheader = bb;
+	}
+	if (!loop->preheader || loop->preheader == cfg->bb_entry || loop->preheader->region != -1)
+		return FALSE;
+	if (loop->preheader->last_ins && loop->preheader->last_ins->opcode == OP_BR_REG)
+		return FALSE;
+
+	loop->blocks = NULL;
+	loop->size = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MonoInst *ins;
+
+		if (!loop->in_loop [bb->block_num])
+			continue;
+		if (bb->block_num >= loop->num_bblocks || versioned [bb->block_num] || bb->region != -1 || (bb->flags & BB_EXCEPTION_HANDLER) || bb->extended)
+			return FALSE;
+		if ((!bb->last_ins || !MONO_IS_BRANCH_OP (bb->last_ins)) && bb->out_count > 1)
+			return FALSE;
+		for (ins = bb->code; ins; ins = ins->next) {
+			if (!version_can_clone_ins (cfg, ins))
+				return FALSE;
+			loop->size ++;
+		}
+		if (loop->size > VERSION_MAX_LOOP_SIZE)
+			return FALSE;
+		loop->blocks = g_slist_prepend_mempool (cfg->mempool, loop->blocks, bb);
+	}
+	loop->blocks = g_slist_reverse (loop->blocks);
+
+	return TRUE;
+}
+
+static int
+version_count_defs (VersionedLoop *loop, int reg, MonoInst **def, MonoBasicBlock **def_bb)
+{
+	GSList *l;
+	MonoInst *ins;
+	int count = 0;
+
+	for (l = loop->blocks; l; l = l->next) {
+		MonoBasicBlock *bb = l->data;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			if (ins_defines_reg (ins, reg)) {
+				count ++;
+				if (def)
+					*def = ins;
+				if (def_bb)
+					*def_bb = bb;
+			}
+		}
+	}
+	return count;
+}
+
+static gboolean
+version_is_invariant_var (VersionedLoop *loop, int reg)
+{
+	MonoInst *var = get_vreg_to_inst (loop->cfg, reg);
+
+	return var && !(var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) && version_count_defs (loop, reg, NULL, NULL) == 0;
+}
+
+static gboolean
+version_is_offset_var (VersionedLoop *loop, int reg)
+{
+	return version_is_invariant_var (loop, reg) && get_vreg_to_inst (loop->cfg, reg)->type == STACK_I4;
+}
+
+/*
+ * Whenever IV is a variable which is incremented by one once in each iteration of the loop.
+ */
+static gboolean
+version_check_iv (VersionedLoop *loop, int iv)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *var = get_vreg_to_inst (cfg, iv);
+	MonoInst *def = NULL, *ins;
+	MonoBasicBlock *def_bb = NULL;
+
+	if (!var || var->type != STACK_I4 || (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))
+		return FALSE;
+	if (version_count_defs (loop, iv, &def, &def_bb) != 1 || def_bb == loop->header)
+		return FALSE;
+
+	if (def->opcode == OP_MOVE && is_local_vreg (cfg, def->sreg1)) {
+		/* iv = t, t = iv + 1 */
+		MonoInst *inc = NULL;
+
+		for (ins = def_bb->code; ins != def; ins = ins->next) {
+			if (ins_defines_reg (ins, def->sreg1))
+				inc = ins;
+		}
+		if (!inc || inc->opcode != OP_IADD_IMM || inc->sreg1 != iv || inc->inst_imm != 1)
+			return FALSE;
+	} else if (def->opcode != OP_IADD_IMM || def->sreg1 != iv || def->inst_imm != 1) {
+		return FALSE;
+	}
+
+	/* The increment can't be executed twice without going through the loop condition */
+	memset (loop->after_def, 0, cfg->num_bblocks);
+	{
+		int i, sp = 0;
+
+		for (i = 0; i < def_bb->out_count; ++i) {
+			MonoBasicBlock *succ = def_bb->out_bb [i];
+
+			if (succ != loop->header && loop->in_loop [succ->block_num] && !loop->after_def [succ->block_num]) {
+				loop->after_def [succ->block_num] = 1;
+				loop->stack [sp ++] = succ;
+			}
+		}
+		while (sp > 0) {
+			MonoBasicBlock *bb = loop->stack [-- sp];
+
+			for (i = 0; i < bb->out_count; ++i) {
+				MonoBasicBlock *succ = bb->out_bb [i];
+
+				if (succ != loop->header && loop->in_loop [succ->block_num] && !loop->after_def [succ->block_num]) {
+					loop->after_def [succ->block_num] = 1;
+					loop->stack [sp ++] = succ;
+				}
+			}
+		}
+	}
+	if (loop->after_def [def_bb->block_num])
+		return FALSE;
+
+	loop->iv_reg = iv;
+	loop->iv_def = def;
+	loop->iv_def_bb = def_bb;
+	return TRUE;
+}
+
+/*
+ * Whenever the bound of the loop condition can be computed before the loop. It can be an
+ * invariant variable, or it can be computed in the header from invariant variables, like
+ * the 'a.Length - 1' in 'i < a.Length - 1'.
+ */
+static gboolean
+version_check_bound (VersionedLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+
+	for (ins = loop->header->code; ins != loop->compare; ins = ins->next) {
+		switch (ins->opcode) {
+		case OP_NOP:
+		case OP_IL_SEQ_POINT:
+			continue;
+		case OP_LDLEN:
+		case OP_STRLEN:
+		case OP_MOVE:
+		case OP_SEXT_I4:
+		case OP_ICONST:
+		case OP_IADD_IMM:
+		case OP_ISUB_IMM:
+		case OP_IADD:
+		case OP_ISUB:
+			break;
+		default:
+			return FALSE;
+		}
+		if (!is_local_vreg (cfg, ins->dreg))
+			return FALSE;
+		if (ins->sreg1 != -1 && !is_local_vreg (cfg, ins->sreg1) && !version_is_invariant_var (loop, ins->sreg1))
+			return FALSE;
+		if (ins->sreg2 != -1 && !is_local_vreg (cfg, ins->sreg2) && !version_is_invariant_var (loop, ins->sreg2))
+			return FALSE;
+	}
+
+	return loop->bound_reg == -1 || is_local_vreg (cfg, loop->bound_reg) || version_is_invariant_var (loop, loop->bound_reg);
+}
+
+static gboolean
+version_check_condition (VersionedLoop *loop)
+{
+	MonoBasicBlock *header = loop->header;
+	MonoInst *branch = header->last_ins;
+	MonoInst *compare = branch->prev;
+	CompRelation rel;
+
+	if (!compare || (compare->opcode != OP_ICOMPARE && compare->opcode != OP_ICOMPARE_IMM))
+		return FALSE;
+	if (branch->opcode < OP_IBEQ || branch->opcode > OP_IBLT_UN)
+		return FALSE;
+	loop->compare = compare;
+
+	/* The relation which holds inside the loop */
+	rel = mono_opcode_to_cond (branch->opcode);
+	if (branch->inst_false_bb == loop->body)
+		rel = mono_negate_cond (rel);
+
+	loop->bound_reg = -1;
+	loop->bound_const = 0;
+	if (compare->opcode == OP_ICOMPARE_IMM) {
+		if (rel != CMP_LT && rel != CMP_LE)
+			return FALSE;
+		if (!version_check_iv (loop, compare->sreg1))
+			return FALSE;
+		loop->bound_const = compare->inst_imm;
+	} else if ((rel == CMP_LT || rel == CMP_LE) && version_check_iv (loop, compare->sreg1)) {
+		loop->bound_reg = compare->sreg2;
+	} else if ((rel == CMP_GT || rel == CMP_GE) && version_check_iv (loop, compare->sreg2)) {
+		rel = rel == CMP_GT ? CMP_LT : CMP_LE;
+		loop->bound_reg = compare->sreg1;
+	} else {
+		return FALSE;
+	}
+	loop->bound_inclusive = rel == CMP_LE;
+
+	return version_check_bound (loop);
+}
+
+/*
+ * version_check_index:
+ *
+ *   Decompose the index of the bounds check INS in BB into IV + DELTA + OFFSET, where
+ * OFFSET is an invariant variable or -1.
+ */
+static gboolean
+version_check_index (VersionedLoop *loop, MonoBasicBlock *bb, MonoInst *check, int *delta, int *offset_reg)
+{
+	MonoCompile *cfg = loop->cfg;
+	int reg = check->sreg2;
+	int steps;
+
+	*delta = 0;
+	*offset_reg = -1;
+	for (steps = 0; steps < 4; ++steps) {
+		MonoInst *ins, *def = NULL;
+
+		if (reg == loop->iv_reg)
+			return *delta >= -VERSION_MAX_DELTA && *delta <= VERSION_MAX_DELTA;
+		if (!is_local_vreg (cfg, reg))
+			return FALSE;
+
+		for (ins = bb->code; ins != check; ins = ins->next) {
+			if (ins_defines_reg (ins, reg))
+				def = ins;
+		}
+		if (!def)
+			return FALSE;
+
+		switch (def->opcode) {
+		case OP_MOVE:
+		case OP_SEXT_I4:
+			reg = def->sreg1;
+			break;
+		case OP_IADD_IMM:
+			*delta += def->inst_imm;
+			reg = def->sreg1;
+			break;
+		case OP_ISUB_IMM:
+			*delta -= def->inst_imm;
+			reg = def->sreg1;
+			break;
+		case OP_IADD:
+			/* a [offset + i] */
+			if (*offset_reg != -1)
+				return FALSE;
+			if (version_is_offset_var (loop, def->sreg2)) {
+				*offset_reg = def->sreg2;
+				reg = def->sreg1;
+			} else if (version_is_offset_var (loop, def->sreg1)) {
+				*offset_reg = def->sreg1;
+				reg = def->sreg2;
+			} else {
+				return FALSE;
+			}
+			break;
+		default:
+			return FALSE;
+		}
+		if (*delta < -VERSION_MAX_DELTA || *delta > VERSION_MAX_DELTA)
+			return FALSE;
+	}
+	return FALSE;
+}
+
+/*
+ * version_collect_checks:
+ *
+ *   Collect the bounds checks which the guard can cover. These are the checks whose
+ * array is invariant, and whose index is computed from the induction variable before
+ * it is incremented.
+ */
+static void
+version_collect_checks (VersionedLoop *loop)
+{
+	GSList *l;
+	MonoInst *ins;
+	int i;
+
+	loop->checks = NULL;
+	loop->narrays = 0;
+	loop->min_delta = 0;
+	for (l = loop->blocks; l; l = l->next) {
+		MonoBasicBlock *bb = l->data;
+
+		if (loop->after_def [bb->block_num])
+			continue;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			VersionedArray *arr = NULL;
+			int delta, offset_reg;
+
+			if (ins == loop->iv_def)
+				break;
+			if (ins->opcode != OP_BOUNDS_CHECK)
+				continue;
+			if (!version_is_invariant_var (loop, ins->sreg1) || !version_check_index (loop, bb, ins, &delta, &offset_reg))
+				continue;
+
+			for (i = 0; i < loop->narrays; ++i) {
+				arr = &loop->arrays [i];
+				if (arr->array_reg == ins->sreg1 && arr->offset_reg == offset_reg && arr->length_offset == ins->inst_imm)
+					break;
+			}
+			if (i == loop->narrays) {
+				if (loop->narrays == VERSION_MAX_ARRAYS)
+					continue;
+				arr = &loop->arrays [loop->narrays ++];
+				arr->array_reg = ins->sreg1;
+				arr->offset_reg = offset_reg;
+				arr->length_offset = ins->inst_imm;
+				arr->max_delta = delta;
+			}
+			if (!loop->checks || delta < loop->min_delta)
+				loop->min_delta = delta;
+			arr->max_delta = MAX (arr->max_delta, delta);
+			loop->checks = g_slist_prepend_mempool (loop->cfg->mempool, loop->checks, ins);
+		}
+	}
+}
+
+static int
+version_map_vreg (GHashTable *vregs, int reg)
+{
+	gpointer res = g_hash_table_lookup (vregs, GINT_TO_POINTER (reg));
+
+	return res ? GPOINTER_TO_INT (res) : reg;
+}
+
+static MonoBasicBlock*
+version_clone_bblock (MonoCompile *cfg, MonoBasicBlock *bb, GHashTable *vregs)
+{
+	MonoBasicBlock *new_bb;
+	MonoInst *ins;
+
+	NEW_BBLOCK (cfg, new_bb);
+	new_bb->region = bb->region;
+	new_bb->real_offset = bb->real_offset;
+	new_bb->cil_code = bb->cil_code;
+	new_bb->cil_length = bb->cil_length;
+	new_bb->flags = bb->flags;
+	new_bb->out_of_line = bb->out_of_line;
+	new_bb->has_array_access = bb->has_array_access;
+
+	for (ins = bb->code; ins; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+		MonoInst *new_ins;
+
+		MONO_INST_NEW (cfg, new_ins, ins->opcode);
+		memcpy (new_ins, ins, sizeof (MonoInst));
+		new_ins->next = new_ins->prev = NULL;
+
+		new_ins->sreg1 = version_map_vreg (vregs, ins->sreg1);
+		new_ins->sreg2 = version_map_vreg (vregs, ins->sreg2);
+		new_ins->sreg3 = version_map_vreg (vregs, ins->sreg3);
+		if (MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins)) {
+			new_ins->dreg = version_map_vreg (vregs, ins->dreg);
+		} else if (spec [MONO_INST_DEST] != ' ' && is_local_vreg (cfg, ins->dreg)) {
+			new_ins->dreg = spec [MONO_INST_DEST] == 'f' ? mono_alloc_freg (cfg) : mono_alloc_ireg_copy (cfg, ins->dreg);
+			g_hash_table_insert (vregs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+		}
+
+		if (MONO_IS_COND_BRANCH_OP (ins)) {
+			new_ins->inst_many_bb = mono_mempool_alloc (cfg->mempool, sizeof (gpointer) * 2);
+			new_ins->inst_true_bb = ins->inst_true_bb;
+			new_ins->inst_false_bb = ins->inst_false_bb;
+		}
+
+		MONO_ADD_INS (new_bb, new_ins);
+	}
+
+	return new_bb;
+}
+
+/*
+ * version_emit_guard:
+ *
+ *   Emit a branch to FAIL_BB at the end of the current guard block, and start a new one.
+ */
+static MonoBasicBlock*
+version_emit_guard (MonoCompile *cfg, int opcode, MonoBasicBlock *fail_bb)
+{
+	MonoBasicBlock *bb = cfg->cbb, *next_bb;
+
+	NEW_BBLOCK (cfg, next_bb);
+	next_bb->region = bb->region;
+	next_bb->real_offset = bb->real_offset;
+	next_bb->cil_code = bb->cil_code;
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, opcode, fail_bb, next_bb);
+	bb->next_bb = next_bb;
+	cfg->cbb = next_bb;
+	return next_bb;
+}
+
+static void
+version_loop (VersionedLoop *loop, guint8 *versioned)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *header = loop->header;
+	MonoBasicBlock **clones = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * cfg->num_bblocks);
+	MonoBasicBlock *bb, *prev, *last, *guard, *orig_cbb;
+	GHashTable *vregs = g_hash_table_new (NULL, NULL);
+	MonoInst *ins, *jump;
+	GSList *l;
+	int i, bound_reg;
+
+	/* Create the slow copy of the loop, it is placed at the end of the method */
+	for (last = cfg->bb_entry; last->next_bb; last = last->next_bb)
+		;
+	for (l = loop->blocks; l; l = l->next) {
+		bb = l->data;
+		clones [bb->block_num] = version_clone_bblock (cfg, bb, vregs);
+		last->next_bb = clones [bb->block_num];
+		last = last->next_bb;
+	}
+	for (l = loop->blocks; l; l = l->next) {
+		MonoBasicBlock *clone;
+
+		bb = l->data;
+		clone = clones [bb->block_num];
+		for (i = 0; i < bb->out_count; ++i) {
+			MonoBasicBlock *succ = bb->out_bb [i];
+
+			mono_link_bblock (cfg, clone, loop->in_loop [succ->block_num] ? clones [succ->block_num] : succ);
+		}
+
+		ins = clone->last_ins;
+		if (ins && ins->opcode == OP_BR) {
+			if (loop->in_loop [ins->inst_target_bb->block_num])
+				ins->inst_target_bb = clones [ins->inst_target_bb->block_num];
+		} else if (ins && MONO_IS_COND_BRANCH_OP (ins)) {
+			if (loop->in_loop [ins->inst_true_bb->block_num])
+				ins->inst_true_bb = clones [ins->inst_true_bb->block_num];
+			if (loop->in_loop [ins->inst_false_bb->block_num])
+				ins->inst_false_bb = clones [ins->inst_false_bb->block_num];
+		} else if (bb->out_count == 1) {
+			/* The original falls through */
+			MONO_INST_NEW (cfg, jump, OP_BR);
+			jump->inst_target_bb = clone->out_bb [0];
+			MONO_ADD_INS (clone, jump);
+		}
+	}
+
+	/* The guard is placed right before the header, so it falls through into it */
+	for (prev = cfg->bb_entry; prev->next_bb != header; prev = prev->next_bb)
+		;
+	if (prev != loop->preheader && (!prev->last_ins || !MONO_IS_BRANCH_OP (prev->last_ins))) {
+		for (i = 0; i < prev->out_count; ++i) {
+			if (prev->out_bb [i] == header)
+				break;
+		}
+		if (i < prev->out_count) {
+			MONO_INST_NEW (cfg, jump, OP_BR);
+			jump->inst_target_bb = header;
+			MONO_ADD_INS (prev, jump);
+		}
+	}
+
+	guard = mono_split_edge (cfg, loop->preheader, header);
+	guard->block_num = cfg->num_bblocks ++;
+	guard->cil_code = header->cil_code;
+	guard->has_array_access = header->has_array_access;
+	mono_unlink_bblock (cfg, guard, header);
+	prev->next_bb = guard;
+
+	orig_cbb = cfg->cbb;
+	cfg->cbb = guard;
+
+	/* Compute the bound the same way as the header */
+	g_hash_table_remove_all (vregs);
+	for (ins = header->code; ins != loop->compare; ins = ins->next) {
+		MonoInst *new_ins;
+
+		if (ins->opcode == OP_NOP || ins->opcode == OP_IL_SEQ_POINT)
+			continue;
+		MONO_INST_NEW (cfg, new_ins, ins->opcode);
+		memcpy (new_ins, ins, sizeof (MonoInst));
+		new_ins->next = new_ins->prev = NULL;
+		new_ins->sreg1 = version_map_vreg (vregs, ins->sreg1);
+		new_ins->sreg2 = version_map_vreg (vregs, ins->sreg2);
+		new_ins->dreg = mono_alloc_ireg_copy (cfg, ins->dreg);
+		g_hash_table_insert (vregs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+		MONO_ADD_INS (guard, new_ins);
+	}
+	/* The guard blocks below are separate bblocks, so the bound has to live in a variable */
+	bound_reg = -1;
+	if (loop->bound_reg != -1) {
+		MonoInst *bound_var = mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL);
+
+		MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, bound_var->dreg, version_map_vreg (vregs, loop->bound_reg));
+		bound_reg = bound_var->dreg;
+	}
+
+	/* The smallest index is IV + MIN_DELTA */
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->iv_reg, -loop->min_delta);
+	version_emit_guard (cfg, OP_IBLT, clones [header->block_num]);
+
+	for (i = 0; i < loop->narrays; ++i) {
+		VersionedArray *arr = &loop->arrays [i];
+		int len_reg, limit_reg, sub;
+
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, arr->array_reg, 0);
+		version_emit_guard (cfg, OP_PBEQ, clones [header->block_num]);
+		if (arr->offset_reg != -1) {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, arr->offset_reg, 0);
+			version_emit_guard (cfg, OP_IBLT, clones [header->block_num]);
+		}
+
+		/* The limit is computed and used in the same guard block */
+		len_reg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, len_reg, arr->array_reg, arr->length_offset);
+		limit_reg = len_reg;
+		if (arr->offset_reg != -1) {
+			limit_reg = alloc_ireg (cfg);
+			MONO_EMIT_NEW_BIALU (cfg, OP_ISUB, limit_reg, len_reg, arr->offset_reg);
+		}
+
+		/*
+		 * The largest index is BOUND - 1 + MAX_DELTA (+ 1 if the condition is inclusive), so
+		 * BOUND + MAX_DELTA + INCLUSIVE <= LEN - OFFSET has to hold. An inclusive condition
+		 * also needs BOUND < INT_MAX, otherwise the increment could overflow.
+		 */
+		sub = MAX (arr->max_delta + (loop->bound_inclusive ? 1 : 0), loop->bound_inclusive ? 1 : 0);
+		if (sub > 0) {
+			int reg = alloc_ireg (cfg);
+
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, reg, limit_reg, sub);
+			limit_reg = reg;
+		}
+		if (bound_reg == -1) {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, limit_reg, loop->bound_const);
+			version_emit_guard (cfg, OP_IBLT, clones [header->block_num]);
+		} else {
+			MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, bound_reg, limit_reg);
+			version_emit_guard (cfg, OP_IBGT, clones [header->block_num]);
+		}
+	}
+
+	/* All the guards passed */
+	MONO_INST_NEW (cfg, jump, OP_BR);
+	jump->inst_target_bb = header;
+	MONO_ADD_INS (cfg->cbb, jump);
+	mono_link_bblock (cfg, cfg->cbb, header);
+	cfg->cbb->next_bb = header;
+	cfg->cbb = orig_cbb;
+
+	g_hash_table_destroy (vregs);
+
+	/* The original loop is only entered if all the indexes are in range */
+	for (l = loop->checks; l; l = l->next) {
+		ins = l->data;
+		if (REPORT_ABC_REMOVAL)
+			printf ("ARRAY-ACCESS: removed bounds check on array %d with index %d in versioned loop BB%d\n", ins->sreg1, ins->sreg2, header->block_num);
+		NULLIFY_INS (ins);
+	}
+	InterlockedAdd (&mono_jit_stats.bounds_checks_removed, g_slist_length (loop->checks));
+	InterlockedIncrement (&mono_jit_stats.loops_versioned);
+
+	for (l = loop->blocks; l; l = l->next)
+		versioned [((MonoBasicBlock*)l->data)->block_num] = 1;
+}
+
+/**
+ * mono_abc_version_loops:
+ * @cfg: Control Flow Graph
+ *
+ * Version the loops of CFG whose bounds checks can be removed when a guard computed
+ * before the loop holds. This works on the bblock list, before the depth first
+ * ordering and SSA are computed.
+ */
+void
+mono_abc_version_loops (MonoCompile *cfg)
+{
+	VersionedLoop loop;
+	MonoBasicBlock *bb;
+	guint8 *versioned;
+	int nbblocks = cfg->num_bblocks;
+	int size = 0;
+
+	if (cfg->gen_sdb_seq_points || nbblocks > 1000)
+		return;
+
+	verbose_level = cfg->verbose_level;
+
+	memset (&loop, 0, sizeof (loop));
+	loop.cfg = cfg;
+	loop.num_bblocks = nbblocks;
+	versioned = g_new0 (guint8, nbblocks);
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		/* Skip the bblocks created by versioning */
+		if (bb->block_num >= nbblocks || versioned [bb->block_num])
+			continue;
+		if (!bb->last_ins || !MONO_IS_COND_BRANCH_OP (bb->last_ins) || bb->region != -1)
+			continue;
+
+		/* Versioning adds bblocks, so these have to be sized for the current number */
+		if (!loop.reach || size != cfg->num_bblocks) {
+			size = cfg->num_bblocks;
+			g_free (loop.reach);
+			g_free (loop.in_loop);
+			g_free (loop.after_def);
+			g_free (loop.stack);
+			loop.reach = g_new0 (guint8, size);
+			loop.in_loop = g_new0 (guint8, size);
+			loop.after_def = g_new0 (guint8, size);
+			loop.stack = g_new0 (MonoBasicBlock*, size);
+		}
+		loop.header = bb;
+
+		if (!version_find_loop (&loop, bb, versioned))
+			continue;
+		if (!version_check_condition (&loop))
+			continue;
+		version_collect_checks (&loop);
+		if (!loop.checks)
+			continue;
+
+		if (REPORT_ABC_REMOVAL)
+			printf ("ABCREM: versioning loop BB%d with induction variable R%d\n", bb->block_num, loop.iv_reg);
+		version_loop (&loop, versioned);
+	}
+
+	g_free (loop.reach);
+	g_free (loop.in_loop);
+	g_free (loop.after_def);
+	g_free (loop.stack);
+	g_free (versioned);
+}
+
 #endif /* DISABLE_JIT */
@@ -806,6 +806,75 @@ class Tests
 			arr [i] = 1;
 		return llvm_ldlen_licm (arr);
 	}
+
+	static int versioned_loop_copy (int[] src, int[] dst, int start, int end) {
+		int n = 0;
+		try {
+			for (int i = start; i < end; ++i) {
+				dst [i] = src [i];
+				n ++;
+			}
+		} catch (IndexOutOfRangeException) {
+			return -n - 1;
+		}
+		return n;
+	}
+
+	static int versioned_loop_inclusive (int[] arr, int end) {
+		int sum = 0;
+		try {
+			for (int i = 0; i <= end; ++i)
+				sum += arr [i];
+		} catch (IndexOutOfRangeException) {
+			return -sum - 1;
+		}
+		return sum;
+	}
+
+	static int versioned_loop_offset (int[] arr, int end) {
+		int sum = 0;
+		try {
+			for (int i = 0; i < end; ++i)
+				sum += arr [i + 1];
+		} catch (IndexOutOfRangeException) {
+			return -sum - 1;
+		}
+		return sum;
+	}
+
+	public static int test_0_versioned_loop_bounds () {
+		int[] src = new int [] { 1, 2, 3, 4, 5 };
+		int[] dst = new int [5];
+
+		/* Bound below the length */
+		if (versioned_loop_copy (src, dst, 0, 3) != 3 || dst [2] != 3 || dst [3] != 0)
+			return 1;
+		/* Bound equal to the length */
+		if (versioned_loop_copy (src, dst, 0, 5) != 5 || dst [4] != 5)
+			return 2;
+		/* Bound above the length, the accesses in range still have to happen */
+		dst = new int [5];
+		if (versioned_loop_copy (src, dst, 0, 7) != -6 || dst [4] != 5)
+			return 3;
+		/* Negative start */
+		dst = new int [5];
+		if (versioned_loop_copy (src, dst, -2, 3) != -1 || dst [0] != 0)
+			return 4;
+		/* The destination is shorter than the source */
+		dst = new int [2];
+		if (versioned_loop_copy (src, dst, 0, 5) != -3 || dst [1] != 2)
+			return 5;
+
+		if (versioned_loop_inclusive (src, 4) != 15)
+			return 6;
+		if (versioned_loop_inclusive (src, 5) != -16)
+			return 7;
+		if (versioned_loop_offset (src, 4) != 14)
+			return 8;
+		if (versioned_loop_offset (src, 5) != -15)
+			return 9;
+		return 0;
+	}
 }
 
 
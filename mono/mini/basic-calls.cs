@@ -342,4 +342,72 @@ class Tests
 	    int res = arm64_stack_arg_reg_sbyte (null, null, null, null, null, null, null, -4, -7);
 		return res == -22 ? 0 : 1;
 	}
+
+	static int inline_starg (int a) {
+		a = a + 1;
+		return a * 2;
+	}
+
+	static int inline_starg_ref (string s) {
+		s = "abc";
+		return s.Length;
+	}
+
+	static int inline_finally_count;
+
+	static int inline_throws (int a) {
+		if (a < 0)
+			throw new ArgumentException ();
+		return a;
+	}
+
+	public static int test_0_inline_starg () {
+		int v = 3;
+		if (inline_starg (v) != 8 || v != 3)
+			return 1;
+		/* Constant arguments make the callee more likely to be inlined */
+		if (inline_starg (3) != 8)
+			return 2;
+		int sum = 0;
+		for (int i = 0; i < 4; ++i)
+			sum += inline_starg (i);
+		if (sum != 20)
+			return 3;
+		string s = "a";
+		if (inline_starg_ref (s) != 3 || s != "a")
+			return 4;
+		return 0;
+	}
+
+	/*
+	 * inline_throws is bigger than half the default inline limit, so it is only inlined
+	 * into a catch handler when its argument is a constant. Call sites in try and finally
+	 * clauses get the full limit.
+	 */
+	public static int test_0_inline_call_site_regions () {
+		int v = 5;
+
+		inline_finally_count = 0;
+		try {
+			inline_throws (-v);
+			return 1;
+		} catch (ArgumentException) {
+			if (inline_throws (v) != 5)
+				return 2;
+			if (inline_throws (5) != 5)
+				return 3;
+			try {
+				inline_throws (-v);
+				return 4;
+			} catch (ArgumentException) {
+				inline_finally_count ++;
+			}
+		} finally {
+			if (inline_throws (v) == 5)
+				inline_finally_count ++;
+		}
+		if (inline_finally_count != 2)
+			return 5;
+		return 0;
+	}
 }
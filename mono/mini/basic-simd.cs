@@ -3304,6 +3304,192 @@ public class SimdTests {
 		return 0;
 	}
 
+	static void AddArrays (int[] a, int[] b, int[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = b [i] + c [i] * 3 - 1;
+	}
+
+	public static int test_0_vectorize_int_add () {
+		for (int len = 0; len < 20; ++len) {
+			var a = new int [len];
+			var b = new int [len];
+			var c = new int [len];
+			for (int i = 0; i < len; ++i) {
+				b [i] = i;
+				c [i] = i * 2;
+			}
+			AddArrays (a, b, c);
+			for (int i = 0; i < len; ++i)
+				if (a [i] != i * 7 - 1)
+					return len + 1;
+		}
+		return 0;
+	}
+
+	static void ScaleArray (float[] a, float[] b, int start, int end) {
+		for (int i = start; i <= end; ++i)
+			a [i] = b [i] * 0.5f;
+	}
+
+	public static int test_0_vectorize_float_mul () {
+		var a = new float [23];
+		var b = new float [23];
+		for (int i = 0; i < b.Length; ++i)
+			b [i] = i + 0.25f;
+		ScaleArray (a, b, 3, 20);
+		for (int i = 0; i < a.Length; ++i) {
+			float expected = (i >= 3 && i <= 20) ? (i + 0.25f) * 0.5f : 0;
+			if (a [i] != expected)
+				return i + 1;
+		}
+		return 0;
+	}
+
+	static void XorBytes (byte[] a, byte[] b, byte key) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = (byte)((a [i] ^ b [i]) + key);
+	}
+
+	public static int test_0_vectorize_byte_xor () {
+		var a = new byte [37];
+		var b = new byte [37];
+		for (int i = 0; i < a.Length; ++i) {
+			a [i] = (byte)(i * 7);
+			b [i] = (byte)(255 - i);
+		}
+		XorBytes (a, b, 200);
+		for (int i = 0; i < a.Length; ++i)
+			if (a [i] != (byte)((((byte)(i * 7)) ^ (255 - i)) + 200))
+				return i + 1;
+		return 0;
+	}
+
+	static int SumInts (int[] a) {
+		int sum = 0;
+		for (int i = 0; i < a.Length; ++i)
+			sum += a [i];
+		return sum;
+	}
+
+	public static int test_0_vectorize_int_sum () {
+		for (int len = 0; len < 20; ++len) {
+			var a = new int [len];
+			for (int i = 0; i < len; ++i)
+				a [i] = i - 5;
+			if (SumInts (a) != len * (len - 1) / 2 - 5 * len)
+				return len + 1;
+		}
+		return 0;
+	}
+
+	static int SumBytes (byte[] a) {
+		int sum = 0;
+		for (int i = 0; i < a.Length; ++i)
+			sum += a [i];
+		return sum;
+	}
+
+	public static int test_0_vectorize_byte_sum () {
+		var a = new byte [1000];
+		int expected = 0;
+		for (int i = 0; i < a.Length; ++i) {
+			a [i] = (byte)(i * 13);
+			expected += a [i];
+		}
+		if (SumBytes (a) != expected)
+			return 1;
+		return 0;
+	}
+
+	static void Increment (int[] a) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = a [i] + 1;
+	}
+
+	public static int test_0_vectorize_same_array () {
+		var a = new int [11];
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = i;
+		Increment (a);
+		for (int i = 0; i < a.Length; ++i)
+			if (a [i] != i + 1)
+				return i + 1;
+		return 0;
+	}
+
+	static void MulAddArrays (float[] a, float[] b, float[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = b [i] * c [i] + b [i];
+	}
+
+	/* Doesn't need float scalars, so it can use the ymm regs with AVX2 */
+	public static int test_0_vectorize_float_elementwise () {
+		for (int len = 0; len < 40; ++len) {
+			var a = new float [len];
+			var b = new float [len];
+			var c = new float [len];
+			for (int i = 0; i < len; ++i) {
+				b [i] = i;
+				c [i] = i + 0.5f;
+			}
+			MulAddArrays (a, b, c);
+			for (int i = 0; i < len; ++i)
+				if (a [i] != (float)i * (i + 0.5f) + i)
+					return len + 1;
+		}
+		return 0;
+	}
+
+	static void MulShift (int[] a, int[] b) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = ((b [i] * 3) << 2) >> 1;
+	}
+
+	public static int test_0_vectorize_int_mul_shift () {
+		var a = new int [70];
+		var b = new int [70];
+		for (int i = 0; i < b.Length; ++i)
+			b [i] = i - 35;
+		MulShift (a, b);
+		for (int i = 0; i < a.Length; ++i)
+			if (a [i] != (((i - 35) * 3) << 2) >> 1)
+				return i + 1;
+		return 0;
+	}
+
+	static void AddPrefix (int[] a, int[] b, int n) {
+		for (int i = 0; i < n; ++i)
+			a [i] = a [i] + b [i];
+	}
+
+	static int SumPrefix (int[] a, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i)
+			sum += a [i];
+		return sum;
+	}
+
+	/* The bound is not a constant or the array length, and not a multiple of the vector width */
+	public static int test_0_vectorize_variable_bound () {
+		var b = new int [40];
+		for (int i = 0; i < b.Length; ++i)
+			b [i] = i + 1;
+
+		for (int n = -3; n <= 37; ++n) {
+			var a = new int [40];
+			for (int i = 0; i < a.Length; ++i)
+				a [i] = 100;
+			AddPrefix (a, b, n);
+			for (int i = 0; i < a.Length; ++i)
+				if (a [i] != (i < n ? 101 + i : 100))
+					return n + 10;
+			int expected = n > 0 ? n * (n + 1) / 2 : 0;
+			if (SumPrefix (b, n) != expected)
+				return n + 100;
+		}
+		return 0;
+	}
+
 	public static int Main (String[] args) {
 		return TestDriver.RunTests (typeof (SimdTests), args);
 	}
@@ -1368,4 +1368,72 @@ class Tests
 
 		return k == -32768 ? 0 : 1;
 	}
+
+	static int gvn_join (int a, int b, bool c) {
+		int x = a + b;
+		if (c)
+			a++;
+		int y = a + b;
+		return y - x;
+	}
+
+	static int gvn_reassign (int a, int b, bool c) {
+		int x = a * b;
+		int y;
+		if (c) {
+			y = a * b + 1;
+		} else {
+			a = 3;
+			y = a * b;
+		}
+		return x + y;
+	}
+
+	static int gvn_static_field;
+
+	static int gvn_load_after_branch_store (bool c) {
+		int x = gvn_static_field;
+		if (c)
+			gvn_static_field = x + 10;
+		return gvn_static_field - x;
+	}
+
+	static int gvn_div (int a, int b) {
+		int r = 0;
+		if (b != 0)
+			r = a / b;
+		try {
+			r += a / b;
+		} catch (DivideByZeroException) {
+			r = -1;
+		}
+		return r;
+	}
+
+	static int gvn_bounds (int[] a, int i, bool c) {
+		int x = a [i];
+		if (c)
+			a = new int [1];
+		try {
+			return x + a [i];
+		} catch (IndexOutOfRangeException) {
+			return -1;
+		}
+	}
+
+	public static int test_0_gvn_across_branches () {
+		if (gvn_join (5, 7, true) != 1 || gvn_join (5, 7, false) != 0)
+			return 1;
+		if (gvn_reassign (5, 7, true) != 71 || gvn_reassign (5, 7, false) != 56)
+			return 2;
+		gvn_static_field = 1;
+		if (gvn_load_after_branch_store (false) != 0 || gvn_load_after_branch_store (true) != 10)
+			return 3;
+		if (gvn_div (10, 2) != 10 || gvn_div (10, 0) != -1)
+			return 4;
+		int[] arr = new int [] { 1, 2, 3 };
+		if (gvn_bounds (arr, 2, false) != 6 || gvn_bounds (arr, 2, true) != -1)
+			return 5;
+		return 0;
+	}
 }
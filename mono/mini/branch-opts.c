@@ -1100,6 +1100,35 @@ mono_remove_bblock (MonoCompile *cfg, MonoBasicBlock *bb)
 	tmp_bb->next_bb = bb->next_bb;
 }
 
+/*
+ * mono_split_edge:
+ *
+ *   Create a new bblock on the edge between FROM and TO, and return it. The new bblock
+ * takes the place of FROM in the in_bb array of TO, so the arguments of phi
+ * instructions in TO remain valid. The caller is responsible for setting its block
+ * number and for adding it to the list of bblocks so it falls through into TO.
+ */
+MonoBasicBlock*
+mono_split_edge (MonoCompile *cfg, MonoBasicBlock *from, MonoBasicBlock *to)
+{
+	MonoBasicBlock *new_bb = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock));
+
+	new_bb->region = to->region;
+	new_bb->real_offset = to->real_offset;
+	new_bb->in_bb = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*));
+	new_bb->in_bb [0] = from;
+	new_bb->in_count = 1;
+	new_bb->out_bb = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*));
+	new_bb->out_bb [0] = to;
+	new_bb->out_count = 1;
+
+	replace_out_block (from, to, new_bb);
+	replace_out_block_in_code (from, to, new_bb);
+	replace_in_block (to, from, new_bb);
+
+	return new_bb;
+}
+
 void
 mono_remove_critical_edges (MonoCompile *cfg)
 {
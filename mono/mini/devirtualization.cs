@@ -85,6 +85,33 @@ sealed public class SealedFinal : Middle {
 	}
 }
 
+public class Other : Base {
+	public override int method2 () {
+		return 5;
+	}
+}
+
+public class MiddleOverride : Middle {
+	public override int method2 () {
+		return 6;
+	}
+}
+
+public interface IGetter {
+	int Get ();
+}
+
+public class Getter : IGetter {
+	public virtual int Get () {
+		return 1;
+	}
+}
+
+public class OverridingGetter : Getter {
+	public override int Get () {
+		return 2;
+	}
+}
 
 class Tests {
 
@@ -193,4 +220,106 @@ class Tests {
 		
 		return 0;
 	}
+
+	static int call_method2 (Base b) {
+		return b.method2 ();
+	}
+
+	static public int test_0_profiled_call_site_sees_other_class () {
+		Middle m = new Middle ();
+		for (int i = 0; i < 10000; ++i) {
+			if (call_method2 (m) != 2)
+				return 1;
+		}
+
+		if (call_method2 (new Other ()) != 5)
+			return 2;
+		if (call_method2 (new Base ()) != 1)
+			return 3;
+		if (call_method2 (new SealedFinal ()) != 2)
+			return 4;
+		if (call_method2 (m) != 2)
+			return 5;
+		return 0;
+	}
+
+	static public int test_0_profiled_call_site_null_receiver () {
+		SealedFinal x = new SealedFinal ();
+		for (int i = 0; i < 10000; ++i)
+			call_method2 (x);
+
+		try {
+			call_method2 (null);
+			return 1;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
+	/*
+	 * The tests below are run by 'make tieredcheck' with a low tier 0 threshold, so the
+	 * helpers are recompiled with a guard for the class seen by the warm up loop. A
+	 * subclass of that class has to fail the guard, even when it overrides nothing.
+	 */
+	static int call_method2_subclass (Base b) {
+		return b.method2 ();
+	}
+
+	static public int test_0_profiled_call_site_subclass_after_tier_up () {
+		Middle m = new Middle ();
+		for (int i = 0; i < 10000; ++i) {
+			if (call_method2_subclass (m) != 2)
+				return 1;
+		}
+
+		if (call_method2_subclass (new MiddleOverride ()) != 6)
+			return 2;
+		if (call_method2_subclass (new SealedFinal ()) != 2)
+			return 3;
+		if (call_method2_subclass (m) != 2)
+			return 4;
+		return 0;
+	}
+
+	static int call_get (IGetter g) {
+		return g.Get ();
+	}
+
+	static public int test_0_profiled_interface_call_site_after_tier_up () {
+		Getter g = new Getter ();
+		for (int i = 0; i < 10000; ++i) {
+			if (call_get (g) != 1)
+				return 1;
+		}
+
+		if (call_get (new OverridingGetter ()) != 2)
+			return 2;
+		if (call_get (g) != 1)
+			return 3;
+		return 0;
+	}
+
+	static int sum_method2 (Base[] arr) {
+		int sum = 0;
+		for (int i = 0; i < arr.Length; ++i)
+			sum += arr [i].method2 ();
+		return sum;
+	}
+
+	static public int test_0_profiled_call_site_changes_type_in_loop () {
+		Base[] arr = new Base [100];
+		for (int i = 0; i < arr.Length; ++i)
+			arr [i] = new Middle ();
+		/* The loop counter makes the method hot during the first call */
+		if (sum_method2 (arr) != 200)
+			return 1;
+		if (sum_method2 (arr) != 200)
+			return 2;
+
+		arr [50] = new Other ();
+		arr [99] = new MiddleOverride ();
+		if (sum_method2 (arr) != 98 * 2 + 5 + 6)
+			return 3;
+		return 0;
+	}
 }
\ No newline at end of file
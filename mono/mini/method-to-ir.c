@@ -72,6 +72,16 @@
 
 #define BRANCH_COST 10
 #define INLINE_LENGTH_LIMIT 20
+/* The amount the callee size is discounted by for each constant argument */
+#define INLINE_CONST_ARG_BONUS 4
+/* The deepest loop nesting of a call site taken into account when inlining */
+#define INLINE_MAX_LOOP_DEPTH 2
+/* Callees smaller than this are not charged against the inlining budget */
+#define INLINE_TINY_LENGTH 8
+/* The minimum amount of IL which can be inlined into a method */
+#define INLINE_MIN_BUDGET 200
+/* The IR cost above which an inlined method is rejected at the default limit */
+#define INLINE_COST_LIMIT 60
 
 /* These have 'cfg' as an implicit argument */
 #define INLINE_FAILURE(msg) do {									\
@@ -4056,6 +4066,66 @@ handle_unbox_gsharedvt (MonoCompile *cfg, MonoClass *klass, MonoInst *obj)
 	return ins;
 }
 
+/*
+ * mark_alloc:
+ *
+ *   Mark ALLOC, the call allocating an instance of KLASS, so mono_ssa_escape_analysis ()
+ * can remove it if the object doesn't escape.
+ */
+static MonoInst*
+mark_alloc (MonoClass *klass, MonoInst *alloc)
+{
+	if (MONO_IS_CALL (alloc) && !mono_class_has_finalizer (klass) && !mono_class_is_marshalbyref (klass))
+		((MonoCallInst*)alloc)->is_alloc = TRUE;
+	return alloc;
+}
+
+/*
+ * box_unbox_conv_op:
+ *
+ *   Return the opcode which converts VAL to the value 'box KLASS; unbox.any KLASS' would
+ * produce, OP_MOVE if VAL can be used as is, or -1 if the box can't be skipped. Boxing
+ * only stores the size of KLASS, so int32 values of small integer types are narrowed.
+ */
+static int
+box_unbox_conv_op (MonoCompile *cfg, MonoClass *klass, MonoInst *val)
+{
+	int load_op = mono_type_to_load_membase (cfg, &klass->byval_arg);
+
+	switch (load_op) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+		if (val->type != STACK_I4)
+			return -1;
+		break;
+	case OP_LOADR4_MEMBASE:
+		/* Boxing rounds the value to single precision */
+		return -1;
+	default:
+		/* Boxing doesn't widen int32 values to native ints or longs */
+		if (val->type == STACK_I4)
+			return -1;
+		break;
+	}
+
+	switch (load_op) {
+	case OP_LOADI1_MEMBASE:
+		return OP_ICONV_TO_I1;
+	case OP_LOADU1_MEMBASE:
+		return OP_ICONV_TO_U1;
+	case OP_LOADI2_MEMBASE:
+		return OP_ICONV_TO_I2;
+	case OP_LOADU2_MEMBASE:
+		return OP_ICONV_TO_U2;
+	default:
+		return OP_MOVE;
+	}
+}
+
 /*
  * Returns NULL and set the cfg exception on error.
  */
@@ -4132,7 +4202,7 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 
 			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
 			EMIT_NEW_ICONST (cfg, iargs [1], mono_gc_get_aligned_size_for_allocator (size));
-			return mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
+			return mark_alloc (klass, mono_emit_method_call (cfg, managed_alloc, iargs, NULL));
 		}
 		alloc_ftn = mono_class_get_allocation_ftn (vtable, for_box, &pass_lw);
 		if (pass_lw) {
@@ -4146,7 +4216,7 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 		}
 	}
 
-	return mono_emit_jit_icall (cfg, alloc_ftn, iargs);
+	return mark_alloc (klass, mono_emit_jit_icall (cfg, alloc_ftn, iargs));
 }
 	
 /*
@@ -5131,7 +5201,114 @@ static int inline_limit;
 static gboolean inline_limit_inited;
 
 static gboolean
-mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
+is_const_arg (MonoInst *arg)
+{
+	switch (arg->opcode) {
+	case OP_ICONST:
+	case OP_I8CONST:
+	case OP_R4CONST:
+	case OP_R8CONST:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * check_inline_cost:
+ *
+ *   Return whenever inlining METHOD, whose IL is CODE_SIZE bytes long, at the current
+ * call site is worth it. ARGS are the arguments of the call, or NULL.
+ * The callee size is discounted for each constant argument, since those allow parts
+ * of the callee to be folded away. The size limit grows with the loop nesting of the
+ * call site and when the tiered compilation mode found the method to be hot, and
+ * shrinks in exception handlers and in class constructors. The total amount of IL
+ * inlined into a method is limited by a budget proportional to its size.
+ * Also set cfg->inline_cost_limit to the IR cost limit inline_method () should use.
+ */
+static gboolean
+check_inline_cost (MonoCompile *cfg, MonoMethod *method, MonoInst **args, int code_size)
+{
+	MonoMethodSignature *sig;
+	const char *reason = NULL;
+	int i, region, cost, limit, depth = 0, nconst = 0;
+	gboolean cold = FALSE;
+
+	if (method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING)
+		return TRUE;
+
+	/* Inlined code has the IL offset of its call site in the outermost method */
+	if (cfg->real_offset < cfg->header->code_size) {
+		if (cfg->il_loop_depth)
+			depth = MIN (cfg->il_loop_depth [cfg->real_offset], INLINE_MAX_LOOP_DEPTH);
+
+		region = mono_find_block_region (cfg, cfg->real_offset);
+		if (region != -1 && (region & (0xf << 4)) != MONO_REGION_TRY && (region & (0xf << 4)) != MONO_REGION_FINALLY)
+			cold = TRUE;
+	}
+	if ((cfg->method->flags & METHOD_ATTRIBUTE_SPECIAL_NAME) && !strcmp (cfg->method->name, ".cctor"))
+		cold = TRUE;
+
+	cost = code_size;
+	if (args) {
+		sig = mono_method_signature (method);
+		for (i = 0; i < sig->param_count + sig->hasthis; ++i) {
+			if (is_const_arg (args [i]))
+				nconst ++;
+		}
+		cost -= nconst * INLINE_CONST_ARG_BONUS;
+	}
+
+	limit = inline_limit;
+	limit += limit * depth / 2;
+	if (cfg->inline_hot)
+		limit += limit / 2;
+	if (cold)
+		limit /= 2;
+
+	if (cost >= limit)
+		reason = "too big";
+	else if (code_size >= INLINE_TINY_LENGTH && cfg->inline_growth + code_size > cfg->inline_budget)
+		reason = "over budget";
+
+	if (cfg->verbose_level > 1)
+		printf ("INLINE %s %s: size %d cost %d limit %d depth %d const args %d%s%s budget %d/%d%s%s\n",
+				reason ? "REJECT" : "ACCEPT", mono_method_full_name (method, TRUE), code_size, cost, limit, depth, nconst,
+				cfg->inline_hot ? " hot" : "", cold ? " cold" : "", cfg->inline_growth, cfg->inline_budget,
+				reason ? ": " : "", reason ? reason : "");
+
+	if (reason)
+		return FALSE;
+
+	cfg->inline_cost_limit = INLINE_COST_LIMIT * limit / MAX (inline_limit, 1);
+	return TRUE;
+}
+
+/*
+ * mark_il_loop:
+ *
+ *   Increase the loop depth of the IL offsets between START and END, which are the
+ * target and the source of a backward branch.
+ */
+static void
+mark_il_loop (MonoCompile *cfg, MonoMethodHeader *header, guint32 start, guint32 end)
+{
+	guint32 i;
+
+	/* Only the outermost method is tracked, inlined code uses the depth of its call site */
+	if (header != cfg->header)
+		return;
+
+	if (!cfg->il_loop_depth)
+		cfg->il_loop_depth = mono_mempool_alloc0 (cfg->mempool, header->code_size);
+	for (i = start; i <= end && i < header->code_size; ++i) {
+		if (cfg->il_loop_depth [i] < 255)
+			cfg->il_loop_depth [i] ++;
+	}
+}
+
+static gboolean
+mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method, MonoInst **args)
 {
 	MonoMethodHeaderSummary header;
 	MonoVTable *vtable;
@@ -5175,7 +5352,7 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 			inline_limit = INLINE_LENGTH_LIMIT;
 		inline_limit_inited = TRUE;
 	}
-	if (header.code_size >= inline_limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
+	if (!check_inline_cost (cfg, method, args, header.code_size))
 		return FALSE;
 
 	/*
@@ -6818,9 +6995,14 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	MonoMethod *prev_current_method;
 	MonoGenericContext *prev_generic_context;
 	gboolean ret_var_set, prev_ret_var_set, prev_disable_inline, virtual = FALSE;
+	int cost_limit;
 
 	g_assert (cfg->exception_type == MONO_EXCEPTION_NONE);
 
+	/* Set by check_inline_cost (), nested inlining overwrites it */
+	cost_limit = cfg->inline_cost_limit ? cfg->inline_cost_limit : INLINE_COST_LIMIT;
+	cfg->inline_cost_limit = 0;
+
 #if (MONO_INLINE_CALLED_LIMITED_METHODS)
 	if ((! inline_always) && ! check_inline_called_method_name_limit (cmethod))
 		return 0;
@@ -6920,11 +7102,12 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	cfg->disable_inline = prev_disable_inline;
 	cfg->inline_depth --;
 
-	if ((costs >= 0 && costs < 60) || inline_always || (costs >= 0 && (cmethod->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))) {
+	if ((costs >= 0 && costs < cost_limit) || inline_always || (costs >= 0 && (cmethod->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))) {
 		if (cfg->verbose_level > 2)
 			printf ("INLINE END %s -> %s\n", mono_method_full_name (cfg->method, TRUE), mono_method_full_name (cmethod, TRUE));
 		
 		cfg->stat_inlined_methods++;
+		cfg->inline_growth += cheader->code_size;
 
 		/* always add some code to avoid block split failures */
 		MONO_INST_NEW (cfg, ins, OP_NOP);
@@ -6986,8 +7169,8 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 		cfg->headers_to_free = g_slist_prepend_mempool (cfg->mempool, cfg->headers_to_free, cheader);
 		return costs + 1;
 	} else {
-		if (cfg->verbose_level > 2)
-			printf ("INLINE ABORTED %s (cost %d)\n", mono_method_full_name (cmethod, TRUE), costs);
+		if (cfg->verbose_level > 1)
+			printf ("INLINE ABORTED %s (cost %d, limit %d)\n", mono_method_full_name (cmethod, TRUE), costs, cost_limit);
 		cfg->exception_type = MONO_EXCEPTION_NONE;
 		mono_loader_clear_error ();
 
@@ -7080,6 +7263,8 @@ get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset,
 			break;
 		case MonoShortInlineBrTarget:
 			target = start + cli_addr + 2 + (signed char)ip [1];
+			if (target <= start + cli_addr)
+				mark_il_loop (cfg, header, target - header->code, start + cli_addr - header->code);
 			GET_BBLOCK (cfg, bblock, target);
 			ip += 2;
 			if (ip < end)
@@ -7087,6 +7272,8 @@ get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset,
 			break;
 		case MonoInlineBrTarget:
 			target = start + cli_addr + 5 + (gint32)read32 (ip + 1);
+			if (target <= start + cli_addr)
+				mark_il_loop (cfg, header, target - header->code, start + cli_addr - header->code);
 			GET_BBLOCK (cfg, bblock, target);
 			ip += 5;
 			if (ip < end)
@@ -7575,7 +7762,7 @@ handle_ctor_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fs
 		g_assert (MONO_TYPE_IS_VOID (fsig->ret));
 		CHECK_CFG_EXCEPTION;
 	} else if ((cfg->opt & MONO_OPT_INLINE) && cmethod && !context_used && !vtable_arg &&
-			   mono_method_check_inlining (cfg, cmethod) &&
+			   mono_method_check_inlining (cfg, cmethod, sp) &&
 			   !mono_class_is_subclass_of (cmethod->klass, mono_defaults.exception_class, FALSE)) {
 		int costs;
 
@@ -7615,6 +7802,260 @@ handle_ctor_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fs
 	return;
 }
 
+/*
+ * emit_call_site_profile:
+ *
+ *   Emit code to record the class of THIS_INS, the receiver of a virtual call to CMETHOD
+ * made by tier 0 code, so the call can be devirtualized when the method is recompiled.
+ * The icall is only made when the class changes.
+ */
+static void
+emit_call_site_profile (MonoCompile *cfg, MonoMethod *cmethod, MonoInst *this_ins, guint32 il_offset)
+{
+	MonoCallSiteProfile *site;
+	MonoBasicBlock *done_bb;
+	MonoInst *iargs [2];
+	int vtable_reg, klass_reg, site_klass_reg;
+
+	site = mono_domain_alloc0 (cfg->domain, sizeof (MonoCallSiteProfile));
+	site->il_offset = il_offset;
+	site->cmethod = cmethod;
+	site->next = cfg->tier0_info->call_sites;
+	cfg->tier0_info->call_sites = site;
+
+	vtable_reg = alloc_preg (cfg);
+	klass_reg = alloc_preg (cfg);
+	site_klass_reg = alloc_preg (cfg);
+	NEW_BBLOCK (cfg, done_bb);
+
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP_FAULT (cfg, OP_LOAD_MEMBASE, vtable_reg, this_ins->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, klass_reg, vtable_reg, MONO_STRUCT_OFFSET (MonoVTable, klass));
+	EMIT_NEW_PCONST (cfg, iargs [0], site);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, site_klass_reg, iargs [0]->dreg, MONO_STRUCT_OFFSET (MonoCallSiteProfile, klass));
+	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, klass_reg, site_klass_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, done_bb);
+	iargs [1] = this_ins;
+	mono_emit_jit_icall (cfg, mono_tiered_record_call_site, iargs);
+	MONO_START_BB (cfg, done_bb);
+}
+
+/*
+ * get_guarded_devirt_target:
+ *
+ *   Return the method called by the virtual call to CMETHOD at IL_OFFSET if the tier 0
+ * code of the method being compiled has only seen receivers of one class at this call
+ * site, and set *OUT_KLASS to that class. Return NULL otherwise.
+ */
+static MonoMethod*
+get_guarded_devirt_target (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, guint32 il_offset, MonoClass **out_klass)
+{
+	MonoTieredMethodInfo *info;
+	MonoCallSiteProfile *site;
+	MonoClass *klass;
+	MonoMethod *target;
+	gboolean variance_used = FALSE;
+	int slot, offset;
+
+	if (!mono_tiered_compilation || cfg->tier0 || cfg->gshared || cfg->compile_aot || (cfg->opt & MONO_OPT_SHARED))
+		return NULL;
+	if (MONO_TYPE_ISSTRUCT (fsig->ret) || fsig->generic_param_count)
+		return NULL;
+
+	info = mono_tiered_get_method_info (cfg->domain, cfg->method);
+	if (!info)
+		return NULL;
+	for (site = info->call_sites; site; site = site->next) {
+		if (site->il_offset == il_offset && site->cmethod == cmethod)
+			break;
+	}
+	if (!site || !site->klass || site->polymorphic)
+		return NULL;
+
+	klass = site->klass;
+	if (klass->valuetype || klass->rank || klass->exception_type || mono_class_is_marshalbyref (klass) ||
+		klass->parent == mono_defaults.multicastdelegate_class)
+		return NULL;
+#ifndef DISABLE_REMOTING
+	if (klass == mono_defaults.transparent_proxy_class)
+		return NULL;
+#endif
+
+	slot = cmethod->slot;
+	if (slot == -1 && cmethod->is_inflated)
+		slot = ((MonoMethodInflated*)cmethod)->declaring->slot;
+	if (slot == -1)
+		return NULL;
+	mono_class_setup_vtable (klass);
+	if (!klass->vtable)
+		return NULL;
+	if (cmethod->klass->flags & TYPE_ATTRIBUTE_INTERFACE) {
+		offset = mono_class_interface_offset_with_variance (klass, cmethod->klass, &variance_used);
+		if (offset < 0 || variance_used)
+			return NULL;
+		slot += offset;
+	}
+	if (slot >= klass->vtable_size)
+		return NULL;
+
+	target = klass->vtable [slot];
+	if (!target || (target->flags & METHOD_ATTRIBUTE_ABSTRACT) || target->wrapper_type != MONO_WRAPPER_NONE ||
+		target->klass->valuetype || mono_method_signature (target)->generic_param_count)
+		return NULL;
+
+	*out_klass = klass;
+	return target;
+}
+
+/*
+ * emit_guarded_devirt_call:
+ *
+ *   Emit a virtual call to CMETHOD which calls TARGET directly, inlining it if possible,
+ * when the receiver is an instance of KLASS, and goes through the normal dispatch path
+ * otherwise. Return the result of the call.
+ */
+static MonoInst*
+emit_guarded_devirt_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **sp,
+						  MonoClass *klass, MonoMethod *target, guchar *ip, int *inline_costs)
+{
+	MonoBasicBlock *virtual_bb, *end_bb;
+	MonoInst **args, *ins, *store, *res_var = NULL;
+	int vtable_reg, klass_reg, nargs, costs = 0;
+
+	if (cfg->verbose_level > 2) {
+		char *name = mono_method_full_name (target, TRUE);
+		printf ("GUARDED DEVIRT: %s for receivers of class %s\n", name, klass->name);
+		g_free (name);
+	}
+	InterlockedIncrement (&mono_jit_stats.guarded_devirt_calls);
+
+	/* inline_method () overwrites the first argument with the result */
+	nargs = fsig->param_count + fsig->hasthis;
+	args = mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * nargs);
+	memcpy (args, sp, sizeof (MonoInst*) * nargs);
+	if (!MONO_TYPE_IS_VOID (fsig->ret))
+		res_var = mono_compile_create_var (cfg, fsig->ret, OP_LOCAL);
+
+	NEW_BBLOCK (cfg, virtual_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	vtable_reg = alloc_preg (cfg);
+	klass_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP_FAULT (cfg, OP_LOAD_MEMBASE, vtable_reg, sp [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, klass_reg, vtable_reg, MONO_STRUCT_OFFSET (MonoVTable, klass));
+	mini_emit_class_check_branch (cfg, klass_reg, klass, OP_PBNE_UN, virtual_bb);
+
+	/* Direct call */
+	if ((cfg->opt & MONO_OPT_INLINE) && mono_method_check_inlining (cfg, target, args))
+		costs = inline_method (cfg, target, mono_method_signature (target), args, ip, cfg->real_offset, FALSE);
+	if (costs) {
+		*inline_costs += costs;
+		ins = args [0];
+	} else {
+		ins = mono_emit_method_call_full (cfg, target, fsig, FALSE, args, NULL, NULL, NULL);
+		ins = mono_emit_widen_call_res (cfg, ins, fsig);
+	}
+	if (res_var)
+		EMIT_NEW_TEMPSTORE (cfg, store, res_var->inst_c0, ins);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Normal dispatch */
+	MONO_START_BB (cfg, virtual_bb);
+	memcpy (args, sp, sizeof (MonoInst*) * nargs);
+	ins = mono_emit_method_call_full (cfg, cmethod, fsig, FALSE, args, args [0], NULL, NULL);
+	ins = mono_emit_widen_call_res (cfg, ins, fsig);
+	if (res_var)
+		EMIT_NEW_TEMPSTORE (cfg, store, res_var->inst_c0, ins);
+
+	MONO_START_BB (cfg, end_bb);
+	if (!res_var)
+		return NULL;
+	EMIT_NEW_TEMPLOAD (cfg, ins, res_var->inst_c0);
+	return ins;
+}
+
+/*
+ * emit_iface_cached_call:
+ *
+ *   Emit an interface call to CMETHOD through a per call site inline cache, which calls
+ * the code of the implementation directly if the vtable of the receiver is in the
+ * cache, and goes through the IMT thunk otherwise. Return the result of the call.
+ */
+static MonoInst*
+emit_iface_cached_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **sp)
+{
+	MonoIfaceCallCache *cache;
+	MonoBasicBlock *hit_bb, *dispatch_bb, *end_bb;
+	MonoInst *cache_ins, *entry_var, *res_var = NULL, *addr, *ins, *store, *iargs [2];
+	int i, vtable_reg, entry_reg, entry_vtable_reg, megamorphic_reg;
+
+	cache = mono_domain_alloc0 (cfg->domain, sizeof (MonoIfaceCallCache));
+	cache->method = cmethod;
+	for (i = 0; i < MONO_IFACE_CACHE_SIZE; ++i)
+		cache->entries [i] = &cache->empty;
+	InterlockedIncrement (&mono_jit_stats.iface_cache_sites);
+
+	entry_var = mono_compile_create_var (cfg, &mono_defaults.int_class->byval_arg, OP_LOCAL);
+	if (!MONO_TYPE_IS_VOID (fsig->ret))
+		res_var = mono_compile_create_var (cfg, fsig->ret, OP_LOCAL);
+
+	NEW_BBLOCK (cfg, hit_bb);
+	NEW_BBLOCK (cfg, dispatch_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	vtable_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP_FAULT (cfg, OP_LOAD_MEMBASE, vtable_reg, sp [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	EMIT_NEW_PCONST (cfg, cache_ins, cache);
+	for (i = 0; i < MONO_IFACE_CACHE_SIZE; ++i) {
+		entry_reg = alloc_preg (cfg);
+		entry_vtable_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, entry_reg, cache_ins->dreg, MONO_STRUCT_OFFSET (MonoIfaceCallCache, entries) + i * sizeof (gpointer));
+		MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, entry_var->dreg, entry_reg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, entry_vtable_reg, entry_reg, MONO_STRUCT_OFFSET (MonoIfaceCacheEntry, vtable));
+		MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, vtable_reg, entry_vtable_reg);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, hit_bb);
+	}
+
+	/* Miss, update the cache unless the site is megamorphic */
+	megamorphic_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, megamorphic_reg, cache_ins->dreg, MONO_STRUCT_OFFSET (MonoIfaceCallCache, megamorphic));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, megamorphic_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBNE_UN, dispatch_bb);
+	iargs [0] = cache_ins;
+	iargs [1] = sp [0];
+	mono_emit_jit_icall (cfg, mono_iface_cache_miss, iargs);
+
+	/* Normal dispatch */
+	MONO_START_BB (cfg, dispatch_bb);
+	ins = mono_emit_method_call_full (cfg, cmethod, fsig, FALSE, sp, sp [0], NULL, NULL);
+	ins = mono_emit_widen_call_res (cfg, ins, fsig);
+	if (res_var)
+		EMIT_NEW_TEMPSTORE (cfg, store, res_var->inst_c0, ins);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Hit */
+	MONO_START_BB (cfg, hit_bb);
+	if (mono_jit_stats.enabled) {
+		int count_reg = alloc_ireg (cfg);
+
+		/* Not atomic, this is only an estimate */
+		EMIT_NEW_PCONST (cfg, addr, &mono_jit_stats.iface_cache_hits);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr->dreg, 0);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, count_reg, count_reg, 1);
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr->dreg, 0, count_reg);
+	}
+	EMIT_NEW_LOAD_MEMBASE (cfg, addr, OP_LOAD_MEMBASE, alloc_preg (cfg), entry_var->dreg, MONO_STRUCT_OFFSET (MonoIfaceCacheEntry, code));
+	ins = (MonoInst*)mono_emit_calli (cfg, fsig, sp, addr, NULL, NULL);
+	ins = mono_emit_widen_call_res (cfg, ins, fsig);
+	if (res_var)
+		EMIT_NEW_TEMPSTORE (cfg, store, res_var->inst_c0, ins);
+
+	MONO_START_BB (cfg, end_bb);
+	if (!res_var)
+		return NULL;
+	EMIT_NEW_TEMPLOAD (cfg, ins, res_var->inst_c0);
+	return ins;
+}
+
 /*
  * mono_method_to_ir:
  *
@@ -7761,7 +8202,13 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 		g_assert (sig->generic_param_count);
 
 	if (cfg->method == method) {
+		MonoTieredMethodInfo *tiered_info;
+
 		cfg->real_offset = 0;
+		cfg->inline_budget = MAX (INLINE_MIN_BUDGET, header->code_size * 2);
+		/* The method is being recompiled after its tier 0 code became hot */
+		tiered_info = cfg->tier0 ? NULL : mono_tiered_get_method_info (cfg->domain, method);
+		cfg->inline_hot = tiered_info && tiered_info->queued;
 	} else {
 		cfg->real_offset = inline_offset;
 	}
@@ -9145,7 +9592,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			/* Inlining */
 			if ((cfg->opt & MONO_OPT_INLINE) &&
 				(!virtual || !(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) || MONO_METHOD_IS_FINAL (cmethod)) &&
-			    mono_method_check_inlining (cfg, cmethod)) {
+			    mono_method_check_inlining (cfg, cmethod, sp)) {
 				int costs;
 				gboolean always = FALSE;
 
@@ -9427,6 +9874,35 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 			/* Common call */
 			INLINE_FAILURE ("call");
+
+			if (virtual && (cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) && !MONO_METHOD_IS_FINAL (cmethod) &&
+				cfg->method == method && sp [0]->type == STACK_OBJ) {
+				MonoMethod *guard_target;
+				MonoClass *guard_klass;
+
+				/* Profile the receiver types of virtual calls in tier 0 code */
+				if (cfg->tier0)
+					emit_call_site_profile (cfg, cmethod, sp [0], ip - header->code);
+
+				/* Guarded devirtualization of monomorphic call sites */
+				if (!tail_call && !imt_arg && !vtable_arg &&
+					(guard_target = get_guarded_devirt_target (cfg, cmethod, fsig, ip - header->code, &guard_klass))) {
+					ins = emit_guarded_devirt_call (cfg, cmethod, fsig, sp, guard_klass, guard_target, ip, &inline_costs);
+					emit_widen = FALSE;
+					goto call_end;
+				}
+			}
+
+			/* Per call site inline caches for interface calls */
+			if ((cfg->opt & MONO_OPT_IFACE_CACHE) && virtual && (cmethod->klass->flags & TYPE_ATTRIBUTE_INTERFACE) &&
+				!tail_call && !imt_arg && !vtable_arg && !fsig->generic_param_count && !MONO_TYPE_ISSTRUCT (fsig->ret) &&
+				sp [0]->type == STACK_OBJ && !cfg->gshared && !cfg->compile_aot && !(cfg->opt & MONO_OPT_SHARED) &&
+				!COMPILE_LLVM (cfg)) {
+				ins = emit_iface_cached_call (cfg, cmethod, fsig, sp);
+				emit_widen = FALSE;
+				goto call_end;
+			}
+
 			ins = mono_emit_method_call_full (cfg, cmethod, fsig, tail_call, sp, virtual ? sp [0] : NULL,
 											  imt_arg, vtable_arg);
 
@@ -10545,6 +11021,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			MonoInst *val;
 			MonoClass *enum_class;
 			MonoMethod *has_flag;
+			int conv_op;
 
 			CHECK_STACK (1);
 			--sp;
@@ -10568,6 +11045,38 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				UNVERIFIED;
 			if (target_type_is_incompatible (cfg, &klass->byval_arg, *sp))
 				UNVERIFIED;
+
+			/*
+			 * Look for:
+			 *
+			 *   box T
+			 *   unbox.any T
+			 *
+			 * The boxed object doesn't escape, so the value can be used directly, after the
+			 * conversion boxing implies.
+			 */
+			if (!mono_class_is_nullable (klass) &&
+				!mini_is_gsharedvt_klass (klass) &&
+				!MONO_TYPE_ISSTRUCT (&klass->byval_arg) &&
+				ip + 5 + 5 <= end && ip_in_bb (cfg, cfg->cbb, ip + 5) &&
+				ip [5] == CEE_UNBOX_ANY &&
+				mini_get_class (method, read32 (ip + 6), generic_context) == klass &&
+				(conv_op = box_unbox_conv_op (cfg, klass, val)) != -1) {
+				if (cfg->verbose_level > 3)
+					printf ("<box+unbox.any opt>\n");
+
+				if (conv_op != OP_MOVE) {
+					EMIT_NEW_UNALU (cfg, ins, conv_op, alloc_ireg (cfg), val->dreg);
+					ins->type = STACK_I4;
+					val = ins;
+				}
+
+				InterlockedIncrement (&mono_jit_stats.allocs_eliminated);
+				*sp++ = val;
+				ip += 5 + 5;
+				break;
+			}
+
 			/* frequent check in generic code: box (struct), brtrue */
 
 			/*
@@ -1430,6 +1430,12 @@ mono_arch_cpu_enumerate_simd_versions (void)
 	if (mono_hwcap_x86_has_sse4a)
 		sse_opts |= SIMD_VERSION_SSE4a;
 
+	if (mono_hwcap_x86_has_avx)
+		sse_opts |= SIMD_VERSION_AVX;
+
+	if (mono_hwcap_x86_has_avx2)
+		sse_opts |= SIMD_VERSION_AVX2;
+
 	return sse_opts;
 }
 
@@ -3763,6 +3769,12 @@ amd64_pop_reg (code, AMD64_RAX);
 #define LOOP_ALIGNMENT 8
 #define bb_is_loop_start(bb) ((bb)->loop_body_start && (bb)->nesting)
 
+/*
+ * Use the VEX encoded forms of the common SSE opcodes if AVX is available, they are
+ * required in the BB_AVX256 bblocks to avoid the SSE/AVX transition penalties.
+ */
+#define use_vex(cfg) (mono_hwcap_x86_has_avx && !(cfg)->compile_aot)
+
 #ifndef DISABLE_JIT
 void
 mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
@@ -5960,16 +5972,28 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 #ifdef MONO_ARCH_SIMD_INTRINSICS
 		/* TODO: Some of these IR opcodes are marked as no clobber when they indeed do. */
 		case OP_ADDPS:
-			amd64_sse_addps_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_addps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_addps_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_DIVPS:
-			amd64_sse_divps_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_divps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_divps_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_MULPS:
-			amd64_sse_mulps_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_mulps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_mulps_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_SUBPS:
-			amd64_sse_subps_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_subps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_subps_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_MAXPS:
 			amd64_sse_maxps_reg_reg (code, ins->sreg1, ins->sreg2);
@@ -6028,7 +6052,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 		case OP_PSHUFLED:
 			g_assert (ins->inst_c0 >= 0 && ins->inst_c0 <= 0xFF);
-			amd64_sse_pshufd_reg_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_c0);
+			if (use_vex (cfg))
+				amd64_vex_pshufd_reg_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_c0, AMD64_VEX_L128);
+			else
+				amd64_sse_pshufd_reg_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_c0);
 			break;
 		case OP_SHUFPS:
 			g_assert (ins->inst_c0 >= 0 && ins->inst_c0 <= 0xFF);
@@ -6094,39 +6121,72 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 
 		case OP_PAND:
-			amd64_sse_pand_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_pand_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_pand_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_POR:
-			amd64_sse_por_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_por_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_por_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PXOR:
-			amd64_sse_pxor_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_pxor_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_pxor_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 
 		case OP_PADDB:
-			amd64_sse_paddb_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_paddb_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_paddb_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PADDW:
-			amd64_sse_paddw_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_paddw_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_paddw_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PADDD:
-			amd64_sse_paddd_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_paddd_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_paddd_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PADDQ:
-			amd64_sse_paddq_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_paddq_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_paddq_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 
 		case OP_PSUBB:
-			amd64_sse_psubb_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_psubb_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_psubb_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PSUBW:
-			amd64_sse_psubw_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_psubw_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_psubw_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PSUBD:
-			amd64_sse_psubd_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_psubd_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_psubd_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PSUBQ:
-			amd64_sse_psubq_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_psubq_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_psubq_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 
 		case OP_PMAXB_UN:
@@ -6203,7 +6263,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 
 		case OP_PSUM_ABS_DIFF:
-			amd64_sse_psadbw_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_psadbw_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_psadbw_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 
 		case OP_UNPACK_LOWB:
@@ -6284,10 +6347,16 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 			
 		case OP_PMULW:
-			amd64_sse_pmullw_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_pmullw_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_pmullw_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PMULD:
-			amd64_sse_pmulld_reg_reg (code, ins->sreg1, ins->sreg2);
+			if (use_vex (cfg))
+				amd64_vex_pmulld_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L128);
+			else
+				amd64_sse_pmulld_reg_reg (code, ins->sreg1, ins->sreg2);
 			break;
 		case OP_PMULQ:
 			amd64_sse_pmuludq_reg_reg (code, ins->sreg1, ins->sreg2);
@@ -6321,21 +6390,30 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 
 		case OP_PSHRD:
-			amd64_sse_psrld_reg_imm (code, ins->dreg, ins->inst_imm);
+			if (use_vex (cfg))
+				amd64_vex_psrld_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L128);
+			else
+				amd64_sse_psrld_reg_imm (code, ins->dreg, ins->inst_imm);
 			break;
 		case OP_PSHRD_REG:
 			amd64_sse_psrld_reg_reg (code, ins->dreg, ins->sreg2);
 			break;
 
 		case OP_PSARD:
-			amd64_sse_psrad_reg_imm (code, ins->dreg, ins->inst_imm);
+			if (use_vex (cfg))
+				amd64_vex_psrad_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L128);
+			else
+				amd64_sse_psrad_reg_imm (code, ins->dreg, ins->inst_imm);
 			break;
 		case OP_PSARD_REG:
 			amd64_sse_psrad_reg_reg (code, ins->dreg, ins->sreg2);
 			break;
 
 		case OP_PSHLD:
-			amd64_sse_pslld_reg_imm (code, ins->dreg, ins->inst_imm);
+			if (use_vex (cfg))
+				amd64_vex_pslld_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L128);
+			else
+				amd64_sse_pslld_reg_imm (code, ins->dreg, ins->inst_imm);
 			break;
 		case OP_PSHLD_REG:
 			amd64_sse_pslld_reg_reg (code, ins->dreg, ins->sreg2);
@@ -6392,7 +6470,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			amd64_movd_xreg_reg_size (code, ins->dreg, ins->sreg1, 4);
 			break;
 		case OP_EXTRACT_I4:
-			amd64_movd_reg_xreg_size (code, ins->dreg, ins->sreg1, 4);
+			if (use_vex (cfg))
+				amd64_vex_movd_reg_xreg (code, ins->dreg, ins->sreg1);
+			else
+				amd64_movd_reg_xreg_size (code, ins->dreg, ins->sreg1, 4);
 			break;
 		case OP_EXTRACT_I8:
 			if (ins->inst_c0) {
@@ -6498,10 +6579,21 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			break;
 		case OP_STOREX_MEMBASE_REG:
 		case OP_STOREX_MEMBASE:
-			amd64_sse_movups_membase_reg (code, ins->dreg, ins->inst_offset, ins->sreg1);
+			/* The whole ymm reg is loaded/stored/copied in BB_AVX256 bblocks, this includes the spills */
+			if (bb->flags & BB_AVX256)
+				amd64_vex_movups_membase_reg (code, ins->dreg, ins->inst_offset, ins->sreg1, AMD64_VEX_L256);
+			else if (use_vex (cfg))
+				amd64_vex_movups_membase_reg (code, ins->dreg, ins->inst_offset, ins->sreg1, AMD64_VEX_L128);
+			else
+				amd64_sse_movups_membase_reg (code, ins->dreg, ins->inst_offset, ins->sreg1);
 			break;
 		case OP_LOADX_MEMBASE:
-			amd64_sse_movups_reg_membase (code, ins->dreg, ins->sreg1, ins->inst_offset);
+			if (bb->flags & BB_AVX256)
+				amd64_vex_movups_reg_membase (code, ins->dreg, ins->sreg1, ins->inst_offset, AMD64_VEX_L256);
+			else if (use_vex (cfg))
+				amd64_vex_movups_reg_membase (code, ins->dreg, ins->sreg1, ins->inst_offset, AMD64_VEX_L128);
+			else
+				amd64_sse_movups_reg_membase (code, ins->dreg, ins->sreg1, ins->inst_offset);
 			break;
 		case OP_LOADX_ALIGNED_MEMBASE:
 			amd64_sse_movaps_reg_membase (code, ins->dreg, ins->sreg1, ins->inst_offset);
@@ -6518,11 +6610,20 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 
 		case OP_XMOVE:
 			/*FIXME the peephole pass should have killed this*/
-			if (ins->dreg != ins->sreg1)
-				amd64_sse_movaps_reg_reg (code, ins->dreg, ins->sreg1);
+			if (ins->dreg != ins->sreg1) {
+				if (bb->flags & BB_AVX256)
+					amd64_vex_movaps_reg_reg (code, ins->dreg, ins->sreg1, AMD64_VEX_L256);
+				else if (use_vex (cfg))
+					amd64_vex_movaps_reg_reg (code, ins->dreg, ins->sreg1, AMD64_VEX_L128);
+				else
+					amd64_sse_movaps_reg_reg (code, ins->dreg, ins->sreg1);
+			}
 			break;		
 		case OP_XZERO:
-			amd64_sse_pxor_reg_reg (code, ins->dreg, ins->dreg);
+			if (use_vex (cfg))
+				amd64_vex_pxor_reg_reg_reg (code, ins->dreg, ins->dreg, ins->dreg, AMD64_VEX_L128);
+			else
+				amd64_sse_pxor_reg_reg (code, ins->dreg, ins->dreg);
 			break;
 		case OP_ICONV_TO_R4_RAW:
 			amd64_movd_xreg_reg_size (code, ins->dreg, ins->sreg1, 4);
@@ -6576,6 +6677,80 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			amd64_sse_movsd_reg_reg (code, ins->dreg, ins->sreg1);
 			amd64_sse_pshufd_reg_reg_imm (code, ins->dreg, ins->dreg, 0x44);
 			break;
+
+		case OP_AMD64_VPADDB:
+			amd64_vex_paddb_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPADDD:
+			amd64_vex_paddd_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSUBB:
+			amd64_vex_psubb_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSUBD:
+			amd64_vex_psubd_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPMULD:
+			amd64_vex_pmulld_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPAND:
+			amd64_vex_pand_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPOR:
+			amd64_vex_por_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPXOR:
+			amd64_vex_pxor_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VADDPS:
+			amd64_vex_addps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VSUBPS:
+			amd64_vex_subps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VMULPS:
+			amd64_vex_mulps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VDIVPS:
+			amd64_vex_divps_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSHLD:
+			amd64_vex_pslld_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSARD:
+			amd64_vex_psrad_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSHRD:
+			amd64_vex_psrld_reg_imm (code, ins->dreg, ins->sreg1, ins->inst_imm, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VPSUM_ABS_DIFF:
+			amd64_vex_psadbw_reg_reg_reg (code, ins->dreg, ins->sreg1, ins->sreg2, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VEXPAND_I1:
+			amd64_vex_movd_xreg_reg (code, ins->dreg, ins->sreg1);
+			amd64_vex_pbroadcastb_reg_reg (code, ins->dreg, ins->dreg, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VEXPAND_I4:
+			amd64_vex_movd_xreg_reg (code, ins->dreg, ins->sreg1);
+			amd64_vex_pbroadcastd_reg_reg (code, ins->dreg, ins->dreg, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VEXPAND_R4:
+			if (cfg->r4fp) {
+				amd64_vex_broadcastss_reg_reg (code, ins->dreg, ins->sreg1, AMD64_VEX_L256);
+			} else {
+				amd64_vex_cvtsd2ss_reg_reg (code, ins->dreg, ins->sreg1);
+				amd64_vex_broadcastss_reg_reg (code, ins->dreg, ins->dreg, AMD64_VEX_L256);
+			}
+			break;
+		case OP_AMD64_VEXTRACT_HIGH:
+			amd64_vex_extracti128_reg_reg_imm (code, ins->dreg, ins->sreg1, 1);
+			break;
+		case OP_AMD64_VZERO:
+			amd64_vex_pxor_reg_reg_reg (code, ins->dreg, ins->dreg, ins->dreg, AMD64_VEX_L256);
+			break;
+		case OP_AMD64_VZEROUPPER:
+			amd64_vex_zeroupper (code);
+			break;
 #endif
 		case OP_LIVERANGE_START: {
 			if (cfg->verbose_level > 1)
@@ -6778,6 +6953,20 @@ mono_arch_emit_prolog (MonoCompile *cfg)
 	async_exc_point (code);
 	mini_gc_set_slot_type_from_cfa (cfg, -cfa_offset, SLOT_NOREF);
 
+	if (cfg->tier0) {
+		/*
+		 * An 8 byte nop which mono_arch_patch_tier0_entry () replaces with a jump to the
+		 * optimized version of the method.  It has to be the first instruction: methods
+		 * start at the 16 byte alignment of the code manager, so it is 8 byte aligned
+		 * and can be replaced with a single store.
+		 */
+		g_assert (code == cfg->native_code);
+		/* nopl 0x0(%rax,%rax,1) */
+		*(code)++ = 0x0f; *(code)++ = 0x1f; *(code)++ = 0x44; *(code)++ = 0x00; *(code)++ = 0x00;
+		/* nopl (%rax) */
+		*(code)++ = 0x0f; *(code)++ = 0x1f; *(code)++ = 0x00;
+	}
+
 	if (!cfg->arch.omit_fp) {
 		amd64_push_reg (code, AMD64_RBP);
 		cfa_offset += 8;
@@ -7733,6 +7922,34 @@ mono_arch_flush_icache (guint8 *code, gint size)
 	/* Not needed */
 }
 
+/*
+ * mono_arch_patch_tier0_entry:
+ *
+ *   Replace the nop at the start of the tier 0 method at CODE with a jump to TARGET.
+ * The nop and the jump are both 8 bytes long, and CODE is always 8 byte aligned (see
+ * mono_arch_emit_prolog ()), so threads entering the method concurrently see either
+ * the old or the new instruction.
+ * Return FALSE if TARGET is out of range.
+ */
+gboolean
+mono_arch_patch_tier0_entry (guint8 *code, guint8 *target)
+{
+	guint8 buf [8];
+	guint8 *p = buf;
+	gint64 disp = target - (code + 5);
+
+	g_assert (!((gsize)code & 7));
+
+	if (!amd64_is_imm32 (disp))
+		return FALSE;
+
+	memcpy (buf, code, sizeof (buf));
+	x86_jump32 (p, (gint32)disp);
+	*(volatile gint64*)code = *(gint64*)buf;
+	mono_arch_flush_icache (code, sizeof (buf));
+	return TRUE;
+}
+
 void
 mono_arch_flush_register_windows (void)
 {
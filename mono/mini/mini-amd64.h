@@ -102,6 +102,8 @@ struct sigcontext {
 #define MONO_ARCH_SIMD_INTRINSICS 1
 #define MONO_ARCH_NEED_SIMD_BANK 1
 #define MONO_ARCH_USE_SHARED_FP_SIMD_BANK 1
+/* The loop vectorizer can use the 256 bit ymm regs in BB_AVX256 bblocks */
+#define MONO_ARCH_HAVE_AVX256 1
 #endif
 
 
@@ -356,6 +358,9 @@ typedef struct {
 #define MONO_ARCH_HAVE_SDB_TRAMPOLINES 1
 #define MONO_ARCH_HAVE_PATCH_CODE_NEW 1
 #define MONO_ARCH_HAVE_OP_GENERIC_CLASS_INIT 1
+#if !defined(__native_client_codegen__)
+#define MONO_ARCH_HAVE_TIERED_COMPILATION 1
+#endif
 
 #if defined(TARGET_OSX) || defined(__linux__)
 #define MONO_ARCH_HAVE_TLS_GET_REG 1
@@ -333,6 +333,11 @@ mono_spillvar_offset (MonoCompile *cfg, int spillvar, int bank)
 			size = regbank_spill_var_size [bank];
 		else
 			size = sizeof (mgreg_t);
+#ifdef MONO_ARCH_HAVE_AVX256
+		/* The spill slots are shared between bblocks, and BB_AVX256 bblocks spill whole ymm regs */
+		if (bank == MONO_REG_SIMD && cfg->uses_avx256)
+			size = 32;
+#endif
 
 		if (cfg->flags & MONO_CFG_HAS_SPILLUP) {
 			cfg->stack_offset += size - 1;
@@ -280,6 +280,22 @@ find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls, MonoJitInfo *res, Mo
  * the @lmf if necessary. @native_offset return the IP offset from the 
  * start of the function or -1 if that info is not available.
  */
+/*
+ * mini_get_unwind_cache:
+ *
+ *   Return the unwind cache to use when unwinding the frames of the thread owning JIT_TLS,
+ * or NULL if it can't be used, i.e. when unwinding another thread or from an async context.
+ */
+MonoUnwindCache*
+mini_get_unwind_cache (MonoJitTlsData *jit_tls)
+{
+	if (!jit_tls || mono_thread_info_is_async_context ())
+		return NULL;
+	if (jit_tls != mono_native_tls_get_value (mono_jit_tls_id))
+		return NULL;
+	return jit_tls->unwind_cache;
+}
+
 MonoJitInfo *
 mono_find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls, MonoJitInfo *res, MonoJitInfo *prev_ji, MonoContext *ctx,
 		    MonoContext *new_ctx, char **trace, MonoLMF **lmf, int *native_offset,
@@ -952,20 +968,16 @@ ves_icall_get_frame_info (gint32 skip, MonoBoolean need_file_info,
 }
 
 static MonoArray *
-glist_to_array (GList *list, MonoClass *eclass) 
+ptr_array_to_array (GPtrArray *arr, MonoClass *eclass)
 {
 	MonoDomain *domain = mono_domain_get ();
 	MonoArray *res;
-	int len, i;
 
-	if (!list)
+	if (!arr || !arr->len)
 		return NULL;
 
-	len = g_list_length (list);
-	res = mono_array_new (domain, eclass, len);
-
-	for (i = 0; list; list = list->next, i++)
-		mono_array_set (res, gpointer, i, list->data);
+	res = mono_array_new (domain, eclass, arr->len);
+	memcpy (mono_array_addr (res, gpointer, 0), arr->pdata, arr->len * sizeof (gpointer));
 
 	return res;
 }
@@ -1151,12 +1163,18 @@ build_native_trace (void)
 #endif
 }
 
+/*
+ * setup_stack_trace:
+ *
+ *   Store the ip/generic info pairs collected during the first pass into MONO_EX. Only the
+ * raw ips are saved, they are resolved to methods when the stack trace is queried by
+ * ves_icall_get_trace () or mono_exception_walk_trace ().
+ */
 static void
-setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *initial_trace_ips, GList **trace_ips)
+setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *initial_trace_ips, GPtrArray **trace_ips)
 {
 	if (mono_ex && !initial_trace_ips) {
-		*trace_ips = g_list_reverse (*trace_ips);
-		MONO_OBJECT_SETREF (mono_ex, trace_ips, glist_to_array (*trace_ips, mono_defaults.int_class));
+		MONO_OBJECT_SETREF (mono_ex, trace_ips, ptr_array_to_array (*trace_ips, mono_defaults.int_class));
 		MONO_OBJECT_SETREF (mono_ex, native_trace_ips, build_native_trace ());
 		if (dynamic_methods) {
 			/* These methods could go away anytime, so save a reference to them in the exception object */
@@ -1183,10 +1201,58 @@ setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *i
 			MONO_OBJECT_SETREF (mono_ex, dynamic_methods, list);
 		}
 	}
-	g_list_free (*trace_ips);
+	if (*trace_ips)
+		g_ptr_array_free (*trace_ips, TRUE);
 	*trace_ips = NULL;
 }
 
+/*
+ * The first pass of exception handling records the MonoJitInfo of the frames it unwinds
+ * through, so the second pass, which unwinds through the same frames, can avoid
+ * looking them up in the jit info tables again.
+ */
+#define EH_FRAME_CACHE_SIZE 32
+
+typedef struct {
+	int len, pos;
+	gpointer ips [EH_FRAME_CACHE_SIZE];
+	MonoJitInfo *jis [EH_FRAME_CACHE_SIZE];
+} EHFrameCache;
+
+static void
+eh_frame_cache_add (EHFrameCache *cache, MonoDomain *domain, MonoContext *ctx, StackFrameInfo *frame)
+{
+	if (!cache || cache->len == EH_FRAME_CACHE_SIZE)
+		return;
+	/* The lookup in the second pass assumes the frame belongs to the current domain */
+	if (!frame->ji || frame->domain != domain)
+		return;
+	cache->ips [cache->len] = MONO_CONTEXT_GET_IP (ctx);
+	cache->jis [cache->len] = frame->ji;
+	cache->len ++;
+}
+
+/*
+ * eh_frame_cache_lookup:
+ *
+ *   Return the MonoJitInfo recorded for the ip in CTX by the first pass, or NULL.
+ * Frames are looked up in the same order they were recorded.
+ */
+static MonoJitInfo*
+eh_frame_cache_lookup (EHFrameCache *cache, MonoContext *ctx)
+{
+	gpointer ip = MONO_CONTEXT_GET_IP (ctx);
+	int i;
+
+	for (i = cache->pos; i < cache->len; ++i) {
+		if (cache->ips [i] == ip) {
+			cache->pos = i + 1;
+			return cache->jis [i];
+		}
+	}
+	return NULL;
+}
+
 /*
  * mono_handle_exception_internal_first_pass:
  *
@@ -1195,7 +1261,7 @@ setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *i
  * OUT_FILTER_IDX. Return TRUE if the exception is caught, FALSE otherwise.
  */
 static gboolean
-mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint32 *out_filter_idx, MonoJitInfo **out_ji, MonoJitInfo **out_prev_ji, MonoObject *non_exception)
+mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint32 *out_filter_idx, MonoJitInfo **out_ji, MonoJitInfo **out_prev_ji, MonoObject *non_exception, EHFrameCache *frame_cache)
 {
 	MonoDomain *domain = mono_domain_get ();
 	MonoJitInfo *ji = NULL;
@@ -1203,7 +1269,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 	MonoJitTlsData *jit_tls = mono_native_tls_get_value (mono_jit_tls_id);
 	MonoLMF *lmf = mono_get_lmf ();
 	MonoArray *initial_trace_ips = NULL;
-	GList *trace_ips = NULL;
+	GPtrArray *trace_ips = NULL;
 	GSList *dynamic_methods = NULL;
 	MonoException *mono_ex;
 	gboolean stack_overflow = FALSE;
@@ -1257,6 +1323,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 
 		unwind_res = mono_find_jit_info_ext (domain, jit_tls, NULL, ctx, &new_ctx, NULL, &lmf, NULL, &frame);
 		if (unwind_res) {
+			eh_frame_cache_add (frame_cache, domain, ctx, &frame);
 			if (frame.type == FRAME_TYPE_DEBUGGER_INVOKE ||
 					frame.type == FRAME_TYPE_MANAGED_TO_NATIVE ||
 					frame.type == FRAME_TYPE_TRAMPOLINE) {
@@ -1290,9 +1357,10 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 			 * overflow.
 			 */
 			if (!initial_trace_ips && (frame_count < 1000)) {
-				trace_ips = g_list_prepend (trace_ips, MONO_CONTEXT_GET_IP (ctx));
-				trace_ips = g_list_prepend (trace_ips,
-											get_generic_info_from_stack_frame (ji, ctx));
+				if (!trace_ips)
+					trace_ips = g_ptr_array_sized_new (32);
+				g_ptr_array_add (trace_ips, MONO_CONTEXT_GET_IP (ctx));
+				g_ptr_array_add (trace_ips, get_generic_info_from_stack_frame (ji, ctx));
 			}
 		}
 
@@ -1431,6 +1499,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 	int i;
 	MonoObject *ex_obj;
 	MonoObject *non_exception = NULL;
+	EHFrameCache frame_cache;
 
 	g_assert (ctx != NULL);
 	if (!obj) {
@@ -1505,6 +1574,8 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 	 */
 	memcpy (&jit_tls->orig_ex_ctx, ctx, sizeof (MonoContext));
 
+	frame_cache.len = frame_cache.pos = 0;
+
 	if (!resume) {
 		gboolean res;
 
@@ -1537,7 +1608,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 		mono_profiler_exception_thrown (obj);
 		jit_tls->orig_ex_ctx_set = FALSE;
 
-		res = mono_handle_exception_internal_first_pass (&ctx_cp, obj, &first_filter_idx, &ji, &prev_ji, non_exception);
+		res = mono_handle_exception_internal_first_pass (&ctx_cp, obj, &first_filter_idx, &ji, &prev_ji, non_exception, &frame_cache);
 
 		if (!res) {
 			if (mini_get_debug_options ()->break_on_exc)
@@ -1597,7 +1668,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 		} else {
 			StackFrameInfo frame;
 
-			unwind_res = mono_find_jit_info_ext (domain, jit_tls, NULL, ctx, &new_ctx, NULL, &lmf, NULL, &frame);
+			unwind_res = mono_find_jit_info_ext (domain, jit_tls, eh_frame_cache_lookup (&frame_cache, ctx), ctx, &new_ctx, NULL, &lmf, NULL, &frame);
 			if (unwind_res) {
 				if (frame.type == FRAME_TYPE_DEBUGGER_INVOKE ||
 						frame.type == FRAME_TYPE_MANAGED_TO_NATIVE ||
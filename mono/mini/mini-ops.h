@@ -1160,6 +1160,31 @@ MINI_OP(OP_AMD64_MUL_REG_MEMBASE,        "amd64_mul_reg_membase", IREG, IREG, IR
 
 MINI_OP(OP_AMD64_LOADI8_MEMINDEX,        "amd64_loadi8_memindex", IREG, IREG, IREG)
 MINI_OP(OP_AMD64_SAVE_SP_TO_LMF,         "amd64_save_sp_to_lmf", NONE, NONE, NONE)
+
+/* AVX2 256 bit (ymm) versions of the SIMD opcodes, only used in BB_AVX256 bblocks */
+MINI_OP(OP_AMD64_VPADDB,                 "amd64_vpaddb", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPADDD,                 "amd64_vpaddd", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPSUBB,                 "amd64_vpsubb", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPSUBD,                 "amd64_vpsubd", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPMULD,                 "amd64_vpmuld", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPAND,                  "amd64_vpand", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPOR,                   "amd64_vpor", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPXOR,                  "amd64_vpxor", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VADDPS,                 "amd64_vaddps", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VSUBPS,                 "amd64_vsubps", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VMULPS,                 "amd64_vmulps", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VDIVPS,                 "amd64_vdivps", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VPSHLD,                 "amd64_vpshld", XREG, XREG, NONE)
+MINI_OP(OP_AMD64_VPSARD,                 "amd64_vpsard", XREG, XREG, NONE)
+MINI_OP(OP_AMD64_VPSHRD,                 "amd64_vpshrd", XREG, XREG, NONE)
+MINI_OP(OP_AMD64_VPSUM_ABS_DIFF,         "amd64_vpsumabsdiff", XREG, XREG, XREG)
+MINI_OP(OP_AMD64_VEXPAND_I1,             "amd64_vexpand_i1", XREG, IREG, NONE)
+MINI_OP(OP_AMD64_VEXPAND_I4,             "amd64_vexpand_i4", XREG, IREG, NONE)
+MINI_OP(OP_AMD64_VEXPAND_R4,             "amd64_vexpand_r4", XREG, FREG, NONE)
+/* Extract the high 128 bits of a ymm reg into an xmm reg */
+MINI_OP(OP_AMD64_VEXTRACT_HIGH,          "amd64_vextract_high", XREG, XREG, NONE)
+MINI_OP(OP_AMD64_VZERO,                  "amd64_vzero", XREG, NONE, NONE)
+MINI_OP(OP_AMD64_VZEROUPPER,             "amd64_vzeroupper", NONE, NONE, NONE)
 #endif
 
 #if  defined(__ppc__) || defined(__powerpc__) || defined(__ppc64__) || defined(TARGET_POWERPC)
@@ -60,6 +60,7 @@
 #include <mono/utils/mono-signal-handler.h>
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/checked-build.h>
+#include <mono/utils/mono-time.h>
 #include <mono/io-layer/io-layer.h>
 
 #include "mini.h"
@@ -99,11 +100,41 @@ int mini_verbose = 0;
  * it can load AOT code compiled by LLVM.
  */
 gboolean mono_use_llvm = FALSE;
+gboolean mono_tiered_compilation = FALSE;
+int mono_tiered_threshold = MONO_TIERED_DEFAULT_THRESHOLD;
 
-#define mono_jit_lock() mono_mutex_lock (&jit_mutex)
+#define mono_jit_lock() mini_jit_mutex_lock (&jit_mutex)
 #define mono_jit_unlock() mono_mutex_unlock (&jit_mutex)
 static mono_mutex_t jit_mutex;
 
+/*
+ * The methods currently being compiled.  A thread which needs a method another thread
+ * is compiling waits for that one instead of compiling it too, so threads only wait for
+ * each other if they need the same method.
+ */
+typedef struct {
+	MonoMethod *method;
+	MonoDomain *domain;
+	int ref_count;
+	gboolean done;
+	mono_cond_t cond;
+} JitCompilationEntry;
+
+/*
+ * The compiling thread might be blocked on something the waiting thread holds, like a
+ * class initialization lock, so we don't wait forever.
+ */
+#define JIT_COMPILATION_WAIT_TIMEOUT_MS 1000
+
+static mono_mutex_t jit_compilation_mutex;
+static GPtrArray *jit_compilation_entries;
+
+/* Tier 0 methods waiting to be recompiled by the tiered compilation thread */
+static mono_mutex_t tiered_mutex;
+static mono_cond_t tiered_cond;
+static GSList *tiered_queue;
+static gboolean tiered_thread_started;
+
 static MonoCodeManager *global_codeman;
 
 MonoDebugOptions debug_options;
@@ -919,6 +950,7 @@ setup_jit_tls_data (gpointer stack_start, gpointer abort_func)
 
 	jit_tls->abort_func = abort_func;
 	jit_tls->end_of_stack = stack_start;
+	jit_tls->unwind_cache = mono_unwind_cache_new ();
 
 	mono_set_jit_tls (jit_tls);
 
@@ -953,6 +985,7 @@ free_jit_tls_data (MonoJitTlsData *jit_tls)
 	mono_free_altstack (jit_tls);
 
 	g_free (jit_tls->first_lmf);
+	mono_unwind_cache_free (jit_tls->unwind_cache);
 	g_free (jit_tls);
 }
 
@@ -1691,6 +1724,25 @@ mini_init_gsctx (MonoDomain *domain, MonoMemPool *mp, MonoGenericContext *contex
 	}
 }
 
+/*
+ * mini_jit_mutex_lock:
+ *
+ *   Lock MUTEX, accounting the time spent waiting for it in mono_jit_stats.
+ */
+void
+mini_jit_mutex_lock (mono_mutex_t *mutex)
+{
+	gint64 start;
+
+	if (!mono_mutex_trylock (mutex))
+		return;
+
+	start = mono_100ns_ticks ();
+	mono_mutex_lock (mutex);
+	InterlockedAdd64 (&mono_jit_stats.jit_lock_wait_time, mono_100ns_ticks () - start);
+	InterlockedIncrement (&mono_jit_stats.jit_lock_contentions);
+}
+
 /*
  * LOCKING: Acquires the jit code hash lock.
  */
@@ -1787,6 +1839,300 @@ mono_jit_map_is_enabled (void)
 
 #endif
 
+/* LOCKING: Must be called with jit_compilation_mutex held. */
+static JitCompilationEntry*
+find_compilation_entry (MonoMethod *method, MonoDomain *domain)
+{
+	int i;
+
+	for (i = 0; i < jit_compilation_entries->len; ++i) {
+		JitCompilationEntry *entry = g_ptr_array_index (jit_compilation_entries, i);
+		if (entry->method == method && entry->domain == domain)
+			return entry;
+	}
+	return NULL;
+}
+
+/* LOCKING: Must be called with jit_compilation_mutex held. */
+static void
+compilation_entry_unref (JitCompilationEntry *entry)
+{
+	if (--entry->ref_count)
+		return;
+	mono_cond_destroy (&entry->cond);
+	g_free (entry);
+}
+
+/*
+ * wait_or_register_method_to_compile:
+ *
+ *   If another thread is compiling METHOD for DOMAIN, wait for it to finish and return
+ * TRUE.  Otherwise return FALSE, in which case the caller must compile the method.  If
+ * the caller is the only thread compiling it, *ENTRY is set to the compilation entry,
+ * which must be passed to unregister_method_to_compile () afterwards.
+ */
+static gboolean
+wait_or_register_method_to_compile (MonoMethod *method, MonoDomain *domain, JitCompilationEntry **entry)
+{
+	MonoJitTlsData *jit_tls = mono_native_tls_get_value (mono_jit_tls_id);
+	JitCompilationEntry *other;
+	gboolean waited = FALSE;
+	gint64 start, elapsed_ms;
+
+	*entry = NULL;
+
+	mono_mutex_lock (&jit_compilation_mutex);
+
+	other = find_compilation_entry (method, domain);
+	if (!other) {
+		*entry = g_new0 (JitCompilationEntry, 1);
+		(*entry)->method = method;
+		(*entry)->domain = domain;
+		(*entry)->ref_count = 1;
+		mono_cond_init (&(*entry)->cond, 0);
+		g_ptr_array_add (jit_compilation_entries, *entry);
+	} else if (!jit_tls || jit_tls->active_jit_methods) {
+		/*
+		 * We're compiling another method, so the other thread might be waiting for
+		 * us.  We just compile it, too, and whichever finishes last discards its code.
+		 */
+		mono_jit_stats.methods_compiled_concurrently++;
+	} else {
+		mono_jit_stats.methods_compile_waits++;
+		++other->ref_count;
+		start = mono_100ns_ticks ();
+		for (;;) {
+			elapsed_ms = (mono_100ns_ticks () - start) / 10000;
+			if (other->done) {
+				waited = TRUE;
+				break;
+			}
+			if (elapsed_ms >= JIT_COMPILATION_WAIT_TIMEOUT_MS) {
+				mono_jit_stats.methods_compile_wait_timeouts++;
+				break;
+			}
+			mono_cond_timedwait_ms (&other->cond, &jit_compilation_mutex, JIT_COMPILATION_WAIT_TIMEOUT_MS - elapsed_ms);
+		}
+		mono_jit_stats.methods_compile_wait_time += mono_100ns_ticks () - start;
+		compilation_entry_unref (other);
+	}
+
+	mono_mutex_unlock (&jit_compilation_mutex);
+
+	return waited;
+}
+
+static void
+unregister_method_to_compile (JitCompilationEntry *entry)
+{
+	mono_mutex_lock (&jit_compilation_mutex);
+	entry->done = TRUE;
+	g_ptr_array_remove_fast (jit_compilation_entries, entry);
+	mono_cond_broadcast (&entry->cond);
+	compilation_entry_unref (entry);
+	mono_mutex_unlock (&jit_compilation_mutex);
+}
+
+/*
+ * tiered_recompile:
+ *
+ *   Compile the method of INFO with the full set of optimizations, register the result
+ * in place of the tier 0 code, and make the tier 0 code jump to it, so callers which
+ * already have the address of the tier 0 code, like vtable slots, switch over as well.
+ */
+static void
+tiered_recompile (MonoTieredMethodInfo *info)
+{
+	MonoMethod *method = info->method;
+	MonoDomain *domain = info->domain;
+	MonoCompile *cfg;
+	MonoJitInfo *old;
+	GTimer *jit_timer;
+	gboolean replaced = FALSE;
+
+	jit_timer = g_timer_new ();
+	cfg = mini_method_compile (method, mono_get_optimizations_for_method (method, default_opt), domain, JIT_FLAG_RUN_CCTORS, 0, -1);
+	g_timer_stop (jit_timer);
+	mono_jit_stats.jit_time += g_timer_elapsed (jit_timer, NULL);
+	g_timer_destroy (jit_timer);
+
+	if (cfg->exception_type != MONO_EXCEPTION_NONE) {
+		/* Keep running the tier 0 code */
+		if (cfg->exception_type == MONO_EXCEPTION_OBJECT_SUPPLIED)
+			MONO_GC_UNREGISTER_ROOT (cfg->exception_ptr);
+		if (cfg->prof_options & MONO_PROFILE_JIT_COMPILATION)
+			mono_profiler_method_end_jit (method, NULL, MONO_PROFILE_FAILED);
+		mono_destroy_compile (cfg);
+		return;
+	}
+
+	mono_domain_lock (domain);
+	mono_domain_jit_code_hash_lock (domain);
+	old = mono_internal_hash_table_lookup (&domain->jit_code_hash, method);
+	if (old && old->code_start == info->tier0_code) {
+		mono_internal_hash_table_remove (&domain->jit_code_hash, method);
+		mono_internal_hash_table_insert (&domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
+		replaced = TRUE;
+	}
+	mono_domain_jit_code_hash_unlock (domain);
+	mono_domain_unlock (domain);
+
+	if (replaced) {
+		InterlockedIncrement (&mono_jit_stats.methods_tier1);
+		mono_emit_jit_map (cfg->jit_info);
+#ifdef MONO_ARCH_HAVE_TIERED_COMPILATION
+		if (mono_arch_patch_tier0_entry (info->tier0_code, cfg->native_code))
+			InterlockedIncrement (&mono_jit_stats.tier0_entries_patched);
+#endif
+	}
+
+	if (cfg->prof_options & MONO_PROFILE_JIT_COMPILATION)
+		mono_profiler_method_end_jit (method, cfg->jit_info, MONO_PROFILE_OK);
+
+	mono_destroy_compile (cfg);
+}
+
+static void
+tiered_compile_thread (gpointer unused)
+{
+	MonoTieredMethodInfo *info;
+
+	while (TRUE) {
+		mono_gc_set_skip_thread (TRUE);
+		MONO_PREPARE_BLOCKING;
+
+		mono_mutex_lock (&tiered_mutex);
+		while (!tiered_queue && !mono_runtime_is_shutting_down ())
+			mono_cond_timedwait_ms (&tiered_cond, &tiered_mutex, 1000);
+		info = NULL;
+		if (tiered_queue && !mono_runtime_is_shutting_down ()) {
+			info = tiered_queue->data;
+			tiered_queue = g_slist_delete_link (tiered_queue, tiered_queue);
+		}
+		mono_mutex_unlock (&tiered_mutex);
+
+		MONO_FINISH_BLOCKING;
+		mono_gc_set_skip_thread (FALSE);
+
+		if (!info)
+			break;
+
+		tiered_recompile (info);
+	}
+}
+
+/*
+ * mono_tiered_method_hot:
+ *
+ *   Called by tier 0 code when its counter reaches 0. Queue the method for
+ * recompilation by the tiered compilation thread, or recompile it right away
+ * if MONO_DEBUG=tiered-sync is set.
+ */
+void
+mono_tiered_method_hot (MonoTieredMethodInfo *info)
+{
+	gboolean start_thread = FALSE, recompile = FALSE;
+
+	mono_mutex_lock (&tiered_mutex);
+	if (!info->queued) {
+		info->queued = TRUE;
+		if (debug_options.tiered_sync) {
+			recompile = TRUE;
+		} else {
+			tiered_queue = g_slist_prepend (tiered_queue, info);
+			mono_cond_signal (&tiered_cond);
+			if (!tiered_thread_started)
+				tiered_thread_started = start_thread = TRUE;
+		}
+	}
+	mono_mutex_unlock (&tiered_mutex);
+
+	if (recompile)
+		tiered_recompile (info);
+	if (start_thread && !mono_thread_create_internal (mono_get_root_domain (), tiered_compile_thread, NULL, TRUE, 0))
+		g_warning ("Failed to create the tiered compilation thread, hot methods will not be recompiled.");
+}
+
+/*
+ * mono_tiered_record_call_site:
+ *
+ *   Called by tier 0 code when the receiver of the virtual call SITE has a different
+ * class than the last one seen.
+ */
+void
+mono_tiered_record_call_site (MonoCallSiteProfile *site, MonoObject *obj)
+{
+	if (site->klass)
+		site->polymorphic = TRUE;
+	site->klass = obj->vtable->klass;
+}
+
+/*
+ * mono_tiered_get_method_info:
+ *
+ *   Return the tier 0 state of METHOD in DOMAIN, or NULL if it was not compiled at tier 0.
+ */
+MonoTieredMethodInfo*
+mono_tiered_get_method_info (MonoDomain *domain, MonoMethod *method)
+{
+	MonoJitDomainInfo *info = domain_jit_info (domain);
+	MonoTieredMethodInfo *res = NULL;
+
+	mono_domain_lock (domain);
+	if (info->tier0_info_hash)
+		res = g_hash_table_lookup (info->tier0_info_hash, method);
+	mono_domain_unlock (domain);
+	return res;
+}
+
+/*
+ * mono_iface_cache_miss:
+ *
+ *   Called by the inline cache of an interface call site when the vtable of the
+ * receiver OBJ is not in CACHE. Add it to the cache, replacing the entries round robin,
+ * unless the site misses too often. The caller then makes the call through the normal
+ * IMT dispatch.
+ */
+void
+mono_iface_cache_miss (MonoIfaceCallCache *cache, MonoObject *obj)
+{
+	MonoIfaceCacheEntry *entry;
+	MonoVTable *vtable = obj->vtable;
+	MonoMethod *target;
+	gpointer code;
+	int misses;
+
+	InterlockedIncrement (&mono_jit_stats.iface_cache_misses);
+	misses = InterlockedIncrement (&cache->misses);
+	if (misses > MONO_IFACE_CACHE_MAX_MISSES) {
+		if (InterlockedCompareExchange (&cache->megamorphic, 1, 0) == 0)
+			InterlockedIncrement (&mono_jit_stats.iface_cache_megamorphic);
+		return;
+	}
+
+	/* Boxed valuetypes need an unboxing trampoline, proxies need the remoting wrappers */
+	if (vtable->klass->valuetype || mono_class_is_marshalbyref (vtable->klass))
+		return;
+#ifndef DISABLE_REMOTING
+	if (vtable->klass == mono_defaults.transparent_proxy_class)
+		return;
+#endif
+
+	target = mono_object_get_virtual_method (obj, cache->method);
+	if (!target || (target->flags & METHOD_ATTRIBUTE_ABSTRACT) || target->klass->valuetype ||
+		mono_method_signature (target)->generic_param_count)
+		return;
+	code = mono_compile_method (target);
+	if (!code)
+		return;
+
+	entry = mono_domain_alloc0 (vtable->domain, sizeof (MonoIfaceCacheEntry));
+	entry->vtable = vtable;
+	entry->code = code;
+	mono_memory_barrier ();
+	cache->entries [misses % MONO_IFACE_CACHE_SIZE] = entry;
+}
+
 static gpointer
 mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException **ex)
 {
@@ -1840,6 +2186,7 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException
 		}
 	}
 
+lookup_start:
 	info = lookup_method (target_domain, method);
 	if (info) {
 		/* We can't use a domain specific method in another domain */
@@ -1875,8 +2222,24 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException
 	}
 #endif
 
-	if (!code)
+	if (!code) {
+		JitCompilationEntry *entry;
+		MonoJitTlsData *jit_tls;
+
+		/* The other thread might have failed, so we look it up again instead of assuming it's there. */
+		if (wait_or_register_method_to_compile (method, target_domain, &entry))
+			goto lookup_start;
+
+		jit_tls = mono_native_tls_get_value (mono_jit_tls_id);
+		if (jit_tls)
+			++jit_tls->active_jit_methods;
 		code = mono_jit_compile_method_inner (method, target_domain, opt, ex);
+		if (jit_tls)
+			--jit_tls->active_jit_methods;
+
+		if (entry)
+			unregister_method_to_compile (entry);
+	}
 	if (!code)
 		return NULL;
 
@@ -2678,9 +3041,11 @@ mini_parse_debug_options (void)
 			mono_align_small_structs = TRUE;
 		else if (!strcmp (arg, "native-debugger-break"))
 			debug_options.native_debugger_break = TRUE;
+		else if (!strcmp (arg, "tiered-sync"))
+			debug_options.tiered_sync = TRUE;
 		else {
 			fprintf (stderr, "Invalid option for the MONO_DEBUG env variable: %s\n", arg);
-			fprintf (stderr, "Available options: 'handle-sigint', 'keep-delegates', 'reverse-pinvoke-exceptions', 'collect-pagefault-stats', 'break-on-unverified', 'no-gdb-backtrace', 'suspend-on-sigsegv', 'suspend-on-exception', 'suspend-on-unhandled', 'dont-free-domains', 'dyn-runtime-invoke', 'gdb', 'explicit-null-checks', 'gen-seq-points', 'gen-compact-seq-points', 'single-imm-size', 'init-stacks', 'casts', 'soft-breakpoints', 'check-pinvoke-callconv', 'arm-use-fallback-tls', 'debug-domain-unload', 'partial-sharing', 'align-small-structs', 'native-debugger-break'\n");
+			fprintf (stderr, "Available options: 'handle-sigint', 'keep-delegates', 'reverse-pinvoke-exceptions', 'collect-pagefault-stats', 'break-on-unverified', 'no-gdb-backtrace', 'suspend-on-sigsegv', 'suspend-on-exception', 'suspend-on-unhandled', 'dont-free-domains', 'dyn-runtime-invoke', 'gdb', 'explicit-null-checks', 'gen-seq-points', 'gen-compact-seq-points', 'single-imm-size', 'init-stacks', 'casts', 'soft-breakpoints', 'check-pinvoke-callconv', 'arm-use-fallback-tls', 'debug-domain-unload', 'partial-sharing', 'align-small-structs', 'native-debugger-break', 'tiered-sync'\n");
 			exit (1);
 		}
 	}
@@ -2740,6 +3105,24 @@ register_jit_stats (void)
 	mono_counters_register ("Methods JITted using mono JIT", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_without_llvm);
 	mono_counters_register ("Methods JITted using LLVM", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_with_llvm);
 	mono_counters_register ("Total time spent JITting (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_time);
+	mono_counters_register ("JIT lock contentions", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.jit_lock_contentions);
+	mono_counters_register ("JIT lock wait time", MONO_COUNTER_JIT | MONO_COUNTER_LONG | MONO_COUNTER_TIME, &mono_jit_stats.jit_lock_wait_time);
+	mono_counters_register ("Method compile waits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_compile_waits);
+	mono_counters_register ("Method compile wait timeouts", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_compile_wait_timeouts);
+	mono_counters_register ("Method compile wait time", MONO_COUNTER_JIT | MONO_COUNTER_LONG | MONO_COUNTER_TIME, &mono_jit_stats.methods_compile_wait_time);
+	mono_counters_register ("Tier 0 methods compiled", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_tier0);
+	mono_counters_register ("Methods recompiled at tier 1", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_tier1);
+	mono_counters_register ("Tier 0 entries patched", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.tier0_entries_patched);
+	mono_counters_register ("Guarded devirtualized calls", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.guarded_devirt_calls);
+	mono_counters_register ("Interface call cache sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_cache_sites);
+	mono_counters_register ("Interface call cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_cache_hits);
+	mono_counters_register ("Interface call cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_cache_misses);
+	mono_counters_register ("Interface call cache megamorphic sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_cache_megamorphic);
+	mono_counters_register ("Allocations eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocs_eliminated);
+	mono_counters_register ("Bounds checks removed", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.bounds_checks_removed);
+	mono_counters_register ("Loops versioned", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.loops_versioned);
+	mono_counters_register ("Loops vectorized", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.loops_vectorized);
+	mono_counters_register ("Methods compiled concurrently", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_compiled_concurrently);
 	mono_counters_register ("Basic blocks", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.basic_blocks);
 	mono_counters_register ("Max basic blocks", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.max_basic_blocks);
 	mono_counters_register ("Allocated vars", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocate_var);
@@ -2846,6 +3229,8 @@ mini_free_jit_domain_info (MonoDomain *domain)
 	}
 	if (info->method_code_hash)
 		g_hash_table_destroy (info->method_code_hash);
+	if (info->tier0_info_hash)
+		g_hash_table_destroy (info->tier0_info_hash);
 	g_hash_table_destroy (info->jump_trampoline_hash);
 	g_hash_table_destroy (info->jit_trampoline_hash);
 	g_hash_table_destroy (info->delegate_trampoline_hash);
@@ -2923,6 +3308,10 @@ mini_init (const char *filename, const char *runtime_version)
 #endif
 
 	mono_mutex_init_recursive (&jit_mutex);
+	mono_mutex_init (&jit_compilation_mutex);
+	mono_mutex_init (&tiered_mutex);
+	mono_cond_init (&tiered_cond, 0);
+	jit_compilation_entries = g_ptr_array_new ();
 
 	mono_cross_helpers_run ();
 
@@ -3180,6 +3569,9 @@ register_icalls (void)
 #if defined(USE_COOP_GC)
 	register_icall (mono_threads_state_poll, "mono_threads_state_poll", "void", FALSE);
 #endif
+	register_icall (mono_tiered_method_hot, "mono_tiered_method_hot", "void ptr", FALSE);
+	register_icall (mono_tiered_record_call_site, "mono_tiered_record_call_site", "void ptr object", FALSE);
+	register_icall (mono_iface_cache_miss, "mono_iface_cache_miss", "void ptr object", FALSE);
 
 #ifndef MONO_ARCH_NO_EMULATE_LONG_MUL_OPTS
 	register_opcode_emulation (OP_LMUL, "__emul_lmul", "long long long", mono_llmult, "mono_llmult", TRUE);
@@ -3482,6 +3874,9 @@ mini_cleanup (MonoDomain *domain)
 
 	mono_mutex_destroy (&jit_mutex);
 
+	g_ptr_array_free (jit_compilation_entries, TRUE);
+	mono_mutex_destroy (&jit_compilation_mutex);
+
 	mono_code_manager_cleanup ();
 
 #ifdef USE_JUMP_TABLES
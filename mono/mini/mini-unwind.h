@@ -159,6 +159,22 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 				   mgreg_t **save_locations, int save_locations_len,
 				   guint8 **out_cfa);
 
+typedef struct _MonoUnwindCache MonoUnwindCache;
+
+MonoUnwindCache*
+mono_unwind_cache_new (void);
+
+void
+mono_unwind_cache_free (MonoUnwindCache *cache);
+
+void
+mono_unwind_frame_cached (MonoUnwindCache *cache,
+						  guint8 *unwind_info, guint32 unwind_info_len, 
+						  guint8 *start_ip, guint8 *end_ip, guint8 *ip, guint8 **mark_locations,
+						  mono_unwind_reg_t *regs, int nregs,
+						  mgreg_t **save_locations, int save_locations_len,
+						  guint8 **out_cfa);
+
 void mono_unwind_init (void);
 
 void mono_unwind_cleanup (void);
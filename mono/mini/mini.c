@@ -81,7 +81,7 @@ int mono_break_at_bb_bb_num;
 gboolean mono_do_x86_stack_align = TRUE;
 gboolean mono_using_xdebug;
 
-#define mono_jit_lock() mono_mutex_lock (&jit_mutex)
+#define mono_jit_lock() mini_jit_mutex_lock (&jit_mutex)
 #define mono_jit_unlock() mono_mutex_unlock (&jit_mutex)
 static mono_mutex_t jit_mutex;
 
@@ -3165,6 +3165,126 @@ mono_insert_safepoints (MonoCompile *cfg)
 
 #endif
 
+#ifdef MONO_ARCH_HAVE_TIERED_COMPILATION
+
+/*
+ * tier0_emit_counter:
+ *
+ *   Make BB decrement the counter of the method, and call mono_tiered_method_hot () when
+ * it reaches 0. The code and the successors of BB are moved to a new bblock, so the
+ * edges into BB don't change.
+ */
+static void
+tier0_emit_counter (MonoCompile *cfg, MonoBasicBlock *bb)
+{
+	MonoBasicBlock *hot_bb, *body_bb;
+	MonoInst *addr, *jump, *iargs [1];
+	int counter_reg, dreg;
+
+	NEW_BBLOCK (cfg, body_bb);
+	body_bb->region = bb->region;
+	body_bb->real_offset = bb->real_offset;
+	body_bb->cil_code = bb->cil_code;
+	body_bb->flags = bb->flags;
+	body_bb->has_array_access = bb->has_array_access;
+	body_bb->code = bb->code;
+	body_bb->last_ins = bb->last_ins;
+	bb->code = bb->last_ins = NULL;
+	bb->has_array_access = FALSE;
+	while (bb->out_count) {
+		mono_link_bblock (cfg, body_bb, bb->out_bb [0]);
+		mono_unlink_bblock (cfg, bb, bb->out_bb [0]);
+	}
+
+	NEW_BBLOCK (cfg, hot_bb);
+	hot_bb->region = bb->region;
+	hot_bb->real_offset = bb->real_offset;
+
+	/* BB falls through into HOT_BB, which falls through into BODY_BB */
+	body_bb->next_bb = bb->next_bb;
+	hot_bb->next_bb = body_bb;
+	bb->next_bb = hot_bb;
+
+	cfg->cbb = bb;
+	EMIT_NEW_PCONST (cfg, addr, &cfg->tier0_info->counter);
+	counter_reg = alloc_ireg (cfg);
+	dreg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, counter_reg, addr->dreg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, dreg, counter_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr->dreg, 0, dreg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, dreg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBNE_UN, body_bb, hot_bb);
+
+	/* The callee can take locks and start a thread, so it is called through its icall wrapper */
+	cfg->cbb = hot_bb;
+	EMIT_NEW_PCONST (cfg, iargs [0], cfg->tier0_info);
+	mono_emit_jit_icall (cfg, mono_tiered_method_hot, iargs);
+	MONO_INST_NEW (cfg, jump, OP_BR);
+	jump->inst_target_bb = body_bb;
+	MONO_ADD_INS (hot_bb, jump);
+	mono_link_bblock (cfg, hot_bb, body_bb);
+}
+
+/*
+ * mono_insert_tier0_counters:
+ *
+ *   Make a tier 0 method decrement its counter on entry and at the start of its loops.
+ * Natural loops are not computed at tier 0, so loop headers are approximated by the
+ * targets of retreating edges in a depth first ordering. This adds bblocks, so it has
+ * to run before the depth first ordering used by the rest of the passes.
+ */
+static void
+mono_insert_tier0_counters (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb, *entry_bb, **bblocks, **counted;
+	int i, dfn = 0, ncounted = 0;
+
+	bblocks = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * (cfg->num_bblocks + 1));
+	counted = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * (cfg->num_bblocks + 1));
+	df_visit (cfg->bb_entry, &dfn, bblocks);
+
+	/* The safepoint of the method is added to the end of bb_entry, so count in the bblock after it */
+	g_assert (cfg->bb_entry->out_count == 1);
+	entry_bb = cfg->bb_entry->out_bb [0];
+	counted [ncounted ++] = entry_bb;
+
+	for (bb = cfg->bb_entry->next_bb; bb; bb = bb->next_bb) {
+		gboolean count = FALSE;
+
+		/* Skip handlers and the bblocks only reachable from them */
+		if (bb == entry_bb || (bb->flags & BB_EXCEPTION_HANDLER) || !bb->dfn)
+			continue;
+		for (i = 0; i < bb->in_count && !count; ++i) {
+			if (bb->in_bb [i]->dfn >= bb->dfn)
+				count = TRUE;
+		}
+		if (count)
+			counted [ncounted ++] = bb;
+	}
+
+	/* The depth first ordering is computed again once the counters are added */
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		bb->dfn = 0;
+		bb->df_parent = NULL;
+	}
+
+	for (i = 0; i < ncounted; ++i) {
+		if (cfg->verbose_level > 1)
+			printf ("ADDING TIER0 COUNTER TO BB %d\n", counted [i]->block_num);
+		tier0_emit_counter (cfg, counted [i]);
+	}
+}
+
+#else
+
+static void
+mono_insert_tier0_counters (MonoCompile *cfg)
+{
+	g_assert_not_reached ();
+}
+
+#endif
+
 /*
  * mini_method_compile:
  * @method: the method to compile
@@ -3191,6 +3311,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	gboolean compile_aot = (flags & JIT_FLAG_AOT) ? 1 : 0;
 	gboolean full_aot = (flags & JIT_FLAG_FULL_AOT) ? 1 : 0;
 	gboolean disable_direct_icalls = (flags & JIT_FLAG_NO_DIRECT_ICALLS) ? 1 : 0;
+	gboolean tier0 = (flags & JIT_FLAG_TIER0) ? 1 : 0;
 	gboolean gsharedvt_method = FALSE;
 #ifdef ENABLE_LLVM
 	gboolean llvm = (flags & JIT_FLAG_LLVM) ? 1 : 0;
@@ -3242,7 +3363,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	}
 
 #ifdef ENABLE_LLVM
-	try_llvm = mono_use_llvm || llvm;
+	try_llvm = (mono_use_llvm || llvm) && !tier0;
 #endif
 
  restart_compile:
@@ -3291,6 +3412,14 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	cfg->disable_direct_icalls = disable_direct_icalls;
 	if (try_generic_shared)
 		cfg->gshared = TRUE;
+	/* Shared code is registered under a different method, see tier0_method_is_eligible () */
+	cfg->tier0 = tier0 && !try_generic_shared;
+	if (cfg->tier0) {
+		cfg->tier0_info = mono_domain_alloc0 (cfg->domain, sizeof (MonoTieredMethodInfo));
+		cfg->tier0_info->counter = mono_tiered_threshold;
+		cfg->tier0_info->method = cfg->method;
+		cfg->tier0_info->domain = cfg->domain;
+	}
 	cfg->compile_llvm = try_llvm;
 	cfg->token_info_hash = g_hash_table_new (NULL, NULL);
 	if (cfg->compile_aot)
@@ -3611,6 +3740,20 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	if (!COMPILE_LLVM (cfg))
 		mono_if_conversion (cfg);
 
+	/* This has to run before the depth first ordering, since it adds bblocks */
+	if ((cfg->opt & MONO_OPT_ABCREM) && (cfg->opt & MONO_OPT_LOOP) && (cfg->flags & MONO_CFG_HAS_ARRAY_ACCESS) && !COMPILE_LLVM (cfg)) {
+		mono_abc_version_loops (cfg);
+#ifdef MONO_ARCH_SIMD_INTRINSICS
+		/* The vectorizer needs the bounds checks to be removed by versioning */
+		if (cfg->opt & MONO_OPT_VECTORIZE)
+			mono_simd_vectorize_loops (cfg);
+#endif
+	}
+
+	/* This adds bblocks too */
+	if (cfg->tier0)
+		mono_insert_tier0_counters (cfg);
+
 	MONO_SUSPEND_CHECK ();
 
 	/* Depth-first ordering on basic blocks */
@@ -3719,12 +3862,20 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	if (cfg->comp_done & MONO_COMP_SSA && !COMPILE_LLVM (cfg)) {
 		//mono_ssa_strength_reduction (cfg);
 
-		if (cfg->opt & MONO_OPT_DEADCE)
+		if (cfg->opt & MONO_OPT_GVN)
+			mono_ssa_gvn (cfg);
+
+		if (cfg->opt & MONO_OPT_DEADCE) {
+			mono_ssa_escape_analysis (cfg);
 			mono_ssa_deadce (cfg);
+		}
 
 		if ((cfg->flags & (MONO_CFG_HAS_LDELEMA|MONO_CFG_HAS_CHECK_THIS)) && (cfg->opt & MONO_OPT_ABCREM))
 			mono_perform_abc_removal (cfg);
 
+		if (cfg->opt & MONO_OPT_LOOP)
+			mono_ssa_loop_invariant_code_motion (cfg);
+
 		mono_ssa_remove (cfg);
 		mono_local_cprop (cfg);
 		mono_handle_global_vregs (cfg);
@@ -3928,6 +4079,19 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 
 	cfg->jit_info = create_jit_info (cfg, method_to_compile);
 
+	if (cfg->tier0) {
+		MonoJitDomainInfo *jit_info = domain_jit_info (cfg->domain);
+
+		cfg->tier0_info->tier0_code = cfg->native_code;
+		/* Make the call site profiles available to the recompilation */
+		mono_domain_lock (cfg->domain);
+		if (!jit_info->tier0_info_hash)
+			jit_info->tier0_info_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
+		g_hash_table_insert (jit_info->tier0_info_hash, cfg->method, cfg->tier0_info);
+		mono_domain_unlock (cfg->domain);
+		InterlockedIncrement (&mono_jit_stats.methods_tier0);
+	}
+
 #ifdef MONO_ARCH_HAVE_LIVERANGE_OPS
 	if (cfg->extend_live_ranges) {
 		/* Extend live ranges to cover the whole method */
@@ -4046,6 +4210,38 @@ create_jit_info_for_trampoline (MonoMethod *wrapper, MonoTrampInfo *info)
  *
  *   Main entry point for the JIT.
  */
+/* Optimizations which are too expensive for tier 0 code */
+#define TIER0_DISABLED_OPTIMIZATIONS (MONO_OPT_INLINE | MONO_OPT_LINEARS | MONO_OPT_SSA | MONO_OPT_ABCREM | MONO_OPT_SSAPRE | \
+	MONO_OPT_LOOP | MONO_OPT_CONSPROP | MONO_OPT_COPYPROP | MONO_OPT_DEADCE | MONO_OPT_BRANCH | MONO_OPT_CMOV | \
+	MONO_OPT_SCHED | MONO_OPT_ALIAS_ANALYSIS | MONO_OPT_GVN | MONO_OPT_IFACE_CACHE | MONO_OPT_VECTORIZE)
+
+/*
+ * tier0_method_is_eligible:
+ *
+ *   Return whenever METHOD can be compiled at tier 0 and later replaced by an optimized
+ * version.
+ */
+static gboolean
+tier0_method_is_eligible (MonoMethod *method, MonoDomain *domain, guint32 opt)
+{
+#ifdef MONO_ARCH_HAVE_TIERED_COMPILATION
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic)
+		return FALSE;
+	/* Other domains could be unloaded while the method is queued for recompilation */
+	if (domain != mono_get_root_domain () || (opt & MONO_OPT_SHARED))
+		return FALSE;
+	/* Shared generic code is registered under the shared method */
+	if ((opt & MONO_OPT_GSHARED) && mono_method_is_generic_sharable (method, FALSE))
+		return FALSE;
+	/* The debugger expects the code of a method to stay the same */
+	if (debug_options.gen_sdb_seq_points)
+		return FALSE;
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 gpointer
 mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, MonoException **jit_ex)
 {
@@ -4057,6 +4253,7 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	guint32 prof_options;
 	GTimer *jit_timer;
 	MonoMethod *prof_method, *shared;
+	JitFlags flags;
 
 	if ((method->iflags & METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL) ||
 	    (method->flags & METHOD_ATTRIBUTE_PINVOKE_IMPL)) {
@@ -4166,9 +4363,15 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		return NULL;
 	}
 
+	flags = JIT_FLAG_RUN_CCTORS;
+	if (mono_tiered_compilation && tier0_method_is_eligible (method, target_domain, opt)) {
+		flags |= JIT_FLAG_TIER0;
+		opt &= ~TIER0_DISABLED_OPTIMIZATIONS;
+	}
+
 	jit_timer = g_timer_new ();
 
-	cfg = mini_method_compile (method, opt, target_domain, JIT_FLAG_RUN_CCTORS, 0, -1);
+	cfg = mini_method_compile (method, opt, target_domain, flags, 0, -1);
 	prof_method = cfg->method;
 
 	g_timer_stop (jit_timer);
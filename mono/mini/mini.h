@@ -322,6 +322,8 @@ typedef struct
 	gpointer *memcpy_addr [17];
 	gpointer *bzero_addr [17];
 	gpointer llvm_module;
+	/* Maps MonoMethod to the MonoTieredMethodInfo of its tier 0 code, protected by the domain lock */
+	GHashTable *tier0_info_hash;
 } MonoJitDomainInfo;
 
 typedef struct {
@@ -505,6 +507,8 @@ extern const char *mono_build_date;
 extern gboolean mono_do_signal_chaining;
 extern gboolean mono_do_crash_chaining;
 extern MONO_API gboolean mono_use_llvm;
+extern gboolean mono_tiered_compilation;
+extern int mono_tiered_threshold;
 extern gboolean mono_do_single_method_regression;
 extern guint32 mono_single_method_regression_opt;
 extern MonoMethod *mono_current_single_method;
@@ -701,7 +705,9 @@ enum {
 	BB_EXCEPTION_UNSAFE     = 1 << 3,
 	BB_EXCEPTION_HANDLER    = 1 << 4,
 	/* for Native Client, mark the blocks that can be jumped to indirectly */
-	BB_INDIRECT_JUMP_TARGET = 1 << 5 
+	BB_INDIRECT_JUMP_TARGET = 1 << 5,
+	/* the SIMD vregs of this block hold 256 bit (ymm) values */
+	BB_AVX256               = 1 << 6
 };
 
 typedef struct MonoMemcpyArgs {
@@ -859,6 +865,8 @@ struct MonoCallInst {
 	guint32 rgctx_reg : 1;
 	/* Whenever the call will need an unbox trampoline */
 	guint need_unbox_trampoline : 1;
+	/* Whenever this is a call to an object allocator made by handle_alloc () */
+	guint is_alloc : 1;
 	regmask_t used_iregs;
 	regmask_t used_fregs;
 	GSList *out_ireg_args;
@@ -1086,6 +1094,12 @@ typedef struct {
 	 * Stores if we need to run a chained exception in Windows.
 	 */
 	gboolean mono_win_chained_exception_needs_run;
+
+	/* The number of methods this thread is compiling, see mono_jit_compile_method_with_opt () */
+	int active_jit_methods;
+
+	/* Decoded unwind info of recently unwound frames, see mono_unwind_frame_cached () */
+	MonoUnwindCache *unwind_cache;
 } MonoJitTlsData;
 
 /*
@@ -1342,7 +1356,7 @@ typedef enum {
 	((t) == MONO_TRAMPOLINE_HANDLER_BLOCK_GUARD)
 
 /* optimization flags */
-#define OPTFLAG(id,shift,name,descr) MONO_OPT_ ## id = 1 << shift,
+#define OPTFLAG(id,shift,name,descr) MONO_OPT_ ## id = 1U << shift,
 enum {
 #include "optflags-def.h"
 	MONO_OPT_LAST
@@ -1359,9 +1373,71 @@ typedef enum {
 	/* Whenever to compile with LLVM */
 	JIT_FLAG_LLVM = (1 << 3),
 	/* Whenever to disable direct calls to direct calls to icall functions */
-	JIT_FLAG_NO_DIRECT_ICALLS = (1 << 4)
+	JIT_FLAG_NO_DIRECT_ICALLS = (1 << 4),
+	/* Whenever to compile a quick, counting tier 0 version of the method */
+	JIT_FLAG_TIER0 = (1 << 5)
 } JitFlags;
 
+/* Number of calls + loop iterations after which a tier 0 method is recompiled */
+#define MONO_TIERED_DEFAULT_THRESHOLD 3000
+
+/* Number of (vtable, code) pairs remembered by the inline cache of an interface call */
+#define MONO_IFACE_CACHE_SIZE 2
+/* Number of misses after which an interface call site is considered megamorphic */
+#define MONO_IFACE_CACHE_MAX_MISSES 16
+
+typedef struct {
+	MonoVTable *vtable;
+	gpointer code;
+} MonoIfaceCacheEntry;
+
+/*
+ * The inline cache of an interface call site. The generated code compares the vtable
+ * of the receiver with the vtable of each entry, and calls the code of the matching
+ * entry directly. Entries are never modified once they are published, they are
+ * replaced as a whole by mono_iface_cache_miss (), so the code always belongs to the
+ * vtable it is read together with.
+ */
+typedef struct {
+	MonoIfaceCacheEntry *entries [MONO_IFACE_CACHE_SIZE];
+	MonoMethod *method;
+	gint32 misses;
+	/* Set when the site misses too often, the cache is no longer updated */
+	gint32 megamorphic;
+	/* The initial value of the entries */
+	MonoIfaceCacheEntry empty;
+} MonoIfaceCallCache;
+
+/*
+ * The receiver types seen by a virtual call site in tier 0 code, used to devirtualize
+ * the call when the method is recompiled.
+ */
+typedef struct _MonoCallSiteProfile MonoCallSiteProfile;
+struct _MonoCallSiteProfile {
+	MonoCallSiteProfile *next;
+	guint32 il_offset;
+	MonoMethod *cmethod;
+	/* The class of the last receiver */
+	MonoClass *klass;
+	/* Whenever receivers of more than one class were seen */
+	gboolean polymorphic;
+};
+
+/*
+ * The state of a method compiled at tier 0 by the tiered compilation mode. The
+ * method decrements COUNTER on entry and at the start of its loops, and calls
+ * mono_tiered_method_hot () when it reaches 0.
+ */
+typedef struct {
+	gint32 counter;
+	gboolean queued;
+	MonoMethod *method;
+	MonoDomain *domain;
+	guint8 *tier0_code;
+	/* Linked list of the profiled call sites */
+	MonoCallSiteProfile *call_sites;
+} MonoTieredMethodInfo;
+
 /* Bit-fields in the MonoBasicBlock.region */
 #define MONO_REGION_TRY       0
 #define MONO_REGION_FINALLY  16
@@ -1545,6 +1621,7 @@ typedef struct {
 	guint            uses_rgctx_reg : 1;
 	guint            uses_vtable_reg : 1;
 	guint            uses_simd_intrinsics : 1;
+	guint            uses_avx256 : 1;
 	guint            keep_cil_nops : 1;
 	guint            gen_seq_points : 1;
 	/* Generate seq points for use by the debugger */
@@ -1563,7 +1640,9 @@ typedef struct {
 	guint            gshared : 1;
 	guint            gsharedvt : 1;
 	guint            r4fp : 1;
+	guint            tier0 : 1;
 	int              r4_stack_type;
+	MonoTieredMethodInfo *tier0_info;
 	gpointer         debug_info;
 	guint32          lmf_offset;
     guint16          *intvars;
@@ -1571,6 +1650,12 @@ typedef struct {
 	GHashTable       *token_info_hash;
 	MonoCompileArch  arch;
 	guint32          inline_depth;
+	/* Inlining cost model state, see check_inline_cost () in method-to-ir.c */
+	guint8          *il_loop_depth;
+	int              inline_growth;
+	int              inline_budget;
+	int              inline_cost_limit;
+	gboolean         inline_hot;
 	/* Size of memory reserved for thunks */
 	int              thunk_area;
 	/* Thunks */
@@ -1747,8 +1832,26 @@ typedef struct {
 	gint32 alias_removed;
 	gint32 loads_eliminated;
 	gint32 stores_eliminated;
+	gint32 jit_lock_contentions;
+	gint32 methods_compile_waits;
+	gint32 methods_compile_wait_timeouts;
+	gint32 methods_compiled_concurrently;
+	gint32 methods_tier0;
+	gint32 methods_tier1;
+	gint32 tier0_entries_patched;
+	gint32 guarded_devirt_calls;
+	gint32 iface_cache_sites;
+	gint32 iface_cache_hits;
+	gint32 iface_cache_misses;
+	gint32 iface_cache_megamorphic;
+	gint32 allocs_eliminated;
+	gint32 bounds_checks_removed;
+	gint32 loops_versioned;
+	gint32 loops_vectorized;
 	int methods_with_llvm;
 	int methods_without_llvm;
+	gint64 jit_lock_wait_time;
+	gint64 methods_compile_wait_time;
 	char *max_ratio_method;
 	char *biggest_method;
 	double jit_time;
@@ -1951,6 +2054,11 @@ typedef struct {
 	 * Translate Debugger.Break () into a native breakpoint signal
 	 */
 	gboolean native_debugger_break;
+	/*
+	 * Recompile hot tier 0 methods on the thread which found them hot, instead of
+	 * queueing them for the tiered compilation thread. Used by the regression tests.
+	 */
+	gboolean tiered_sync;
 } MonoDebugOptions;
 
 enum {
@@ -2410,6 +2518,11 @@ gpointer*         mini_resolve_imt_method (MonoVTable *vt, gpointer *vtable_slot
 										   gboolean *out_need_rgctx_tramp, MonoMethod **variant_iface);
 
 gboolean          mono_running_on_valgrind (void);
+void              mini_jit_mutex_lock (mono_mutex_t *mutex);
+void              mono_tiered_method_hot (MonoTieredMethodInfo *info);
+void              mono_tiered_record_call_site (MonoCallSiteProfile *site, MonoObject *obj);
+MonoTieredMethodInfo *mono_tiered_get_method_info (MonoDomain *domain, MonoMethod *method);
+void              mono_iface_cache_miss (MonoIfaceCallCache *cache, MonoObject *obj);
 void*             mono_global_codeman_reserve (int size);
 void*             nacl_global_codeman_get_dest(void *data);
 void              mono_global_codeman_commit(void *data, int size, int newsize);
@@ -2419,6 +2532,7 @@ gint32*           mono_allocate_stack_slots (MonoCompile *cfg, gboolean backward
 void              mono_local_regalloc (MonoCompile *cfg, MonoBasicBlock *bb);
 MonoInst         *mono_branch_optimize_exception_target (MonoCompile *cfg, MonoBasicBlock *bb, const char * exname);
 void              mono_remove_critical_edges (MonoCompile *cfg);
+MonoBasicBlock   *mono_split_edge (MonoCompile *cfg, MonoBasicBlock *from, MonoBasicBlock *to);
 gboolean          mono_is_regsize_var (MonoType *t);
 void              mini_emit_memcpy (MonoCompile *cfg, int destreg, int doffset, int srcreg, int soffset, int size, int align);
 void              mini_emit_stobj (MonoCompile *cfg, MonoInst *dest, MonoInst *src, MonoClass *klass, gboolean native);
@@ -2491,6 +2605,7 @@ guint32   mono_arch_regalloc_cost               (MonoCompile *cfg, MonoMethodVar
 void      mono_arch_patch_code                  (MonoCompile *cfg, MonoMethod *method, MonoDomain *domain, guint8 *code, MonoJumpInfo *ji, gboolean run_cctors);
 void      mono_arch_patch_code_new              (MonoCompile *cfg, MonoDomain *domain, guint8 *code, MonoJumpInfo *ji, gpointer target);
 void      mono_arch_flush_icache                (guint8 *code, gint size);
+gboolean  mono_arch_patch_tier0_entry           (guint8 *code, guint8 *target);
 int       mono_arch_max_epilog_size             (MonoCompile *cfg);
 guint8   *mono_arch_emit_prolog                 (MonoCompile *cfg);
 void      mono_arch_emit_epilog                 (MonoCompile *cfg);
@@ -2664,6 +2779,7 @@ MONO_API gboolean mono_exception_walk_trace     (MonoException *ex, MonoExceptio
 void mono_restore_context                       (MonoContext *ctx);
 guint8* mono_jinfo_get_unwind_info              (MonoJitInfo *ji, guint32 *unwind_info_len);
 int  mono_jinfo_get_epilog_size                 (MonoJitInfo *ji);
+MonoUnwindCache* mini_get_unwind_cache           (MonoJitTlsData *jit_tls);
 
 gboolean
 mono_find_jit_info_ext (MonoDomain *domain, MonoJitTlsData *jit_tls, 
@@ -2705,6 +2821,8 @@ void        mono_ssa_deadce                     (MonoCompile *cfg);
 void        mono_ssa_strength_reduction         (MonoCompile *cfg);
 void        mono_free_loop_info                 (MonoCompile *cfg);
 void        mono_ssa_loop_invariant_code_motion (MonoCompile *cfg);
+void        mono_ssa_gvn                        (MonoCompile *cfg);
+void        mono_ssa_escape_analysis            (MonoCompile *cfg);
 
 void        mono_ssa_compute2                   (MonoCompile *cfg);
 void        mono_ssa_remove2                    (MonoCompile *cfg);
@@ -2736,7 +2854,7 @@ gboolean       mono_trace_eval                  (MonoMethod *method);
 extern void
 mono_perform_abc_removal (MonoCompile *cfg);
 extern void
-mono_perform_abc_removal (MonoCompile *cfg);
+mono_abc_version_loops (MonoCompile *cfg);
 extern void
 mono_perform_ssapre (MonoCompile *cfg);
 extern void
@@ -2885,15 +3003,18 @@ enum {
 	SIMD_VERSION_SSE41	= 1 << 4,
 	SIMD_VERSION_SSE42	= 1 << 5,
 	SIMD_VERSION_SSE4a	= 1 << 6,
+	SIMD_VERSION_AVX	= 1 << 7,
+	SIMD_VERSION_AVX2	= 1 << 8,
 	SIMD_VERSION_ALL	= SIMD_VERSION_SSE1 | SIMD_VERSION_SSE2 |
 			  SIMD_VERSION_SSE3 | SIMD_VERSION_SSSE3 |
 			  SIMD_VERSION_SSE41 | SIMD_VERSION_SSE42 |
-			  SIMD_VERSION_SSE4a,
+			  SIMD_VERSION_SSE4a | SIMD_VERSION_AVX |
+			  SIMD_VERSION_AVX2,
 
 	/* this value marks the end of the bit indexes used in 
 	 * this emum.
 	 */
-	SIMD_VERSION_INDEX_END = 6 
+	SIMD_VERSION_INDEX_END = 8 
 };
 
 enum {
@@ -2919,6 +3040,7 @@ void        mono_simd_simplify_indirection (MonoCompile *cfg);
 MonoInst*   mono_emit_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args);
 guint32     mono_arch_cpu_enumerate_simd_versions (void);
 void        mono_simd_intrinsics_init (void);
+void        mono_simd_vectorize_loops (MonoCompile *cfg);
 
 MonoInst*   mono_emit_native_types_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args);
 MonoType*   mini_native_type_replace_type (MonoType *type) MONO_LLVM_INTERNAL;
@@ -1667,6 +1667,182 @@ ncells ) {
 		var res = arm64_hfa_on_stack_inner (1, 2, 3, 4, 5, 6, 7, 8, s);
 		return res == 10.0 ? 0 : 1;
 	}
+
+	class LicmBox {
+		public int v;
+		public int w;
+	}
+
+	static int licm_static_field;
+
+	static int licm_field_alias (LicmBox a, LicmBox b, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += a.v;
+			b.v = i;
+		}
+		return sum;
+	}
+
+	static int licm_field_other_offset (LicmBox a, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += a.v;
+			a.w = i;
+		}
+		return sum;
+	}
+
+	static int licm_array_alias (int[] a, int[] b, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += a [1];
+			b [1] = i;
+		}
+		return sum;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void licm_set_static (int i) {
+		licm_static_field = i;
+	}
+
+	static int licm_static_call (int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += licm_static_field;
+			licm_set_static (i);
+		}
+		return sum;
+	}
+
+	public static int test_0_licm_load_aliased_by_store () {
+		LicmBox box = new LicmBox ();
+		box.v = 100;
+		if (licm_field_alias (box, box, 4) != 103)
+			return 1;
+		box.v = 100;
+		if (licm_field_alias (box, new LicmBox (), 4) != 400)
+			return 2;
+		box.v = 100;
+		if (licm_field_other_offset (box, 4) != 400 || box.w != 3)
+			return 3;
+
+		int[] arr = new int [] { 0, 100 };
+		if (licm_array_alias (arr, arr, 4) != 103)
+			return 4;
+		arr [1] = 100;
+		if (licm_array_alias (arr, new int [2], 4) != 400)
+			return 5;
+
+		licm_static_field = 100;
+		if (licm_static_call (4) != 103)
+			return 6;
+		return 0;
+	}
+
+	interface IShape {
+		int Sides ();
+	}
+
+	class Triangle : IShape {
+		public int Sides () { return 3; }
+	}
+
+	class Square : IShape {
+		public int Sides () { return 4; }
+	}
+
+	class Pentagon : IShape {
+		public virtual int Sides () { return 5; }
+	}
+
+	class Hexagon : Pentagon {
+		public override int Sides () { return 6; }
+	}
+
+	class FakePentagon : Pentagon {
+	}
+
+	struct Line : IShape {
+		public int Sides () { return 1; }
+	}
+
+	static int iface_cache_sides (IShape s) {
+		return s.Sides ();
+	}
+
+	public static int test_0_iface_call_site_megamorphic () {
+		IShape[] shapes = new IShape [] { new Triangle (), new Square (), new Pentagon (), new Hexagon (), new FakePentagon (), new Line () };
+		int[] expected = new int [] { 3, 4, 5, 6, 5, 1 };
+
+		for (int i = 0; i < 100; ++i) {
+			int j = i % shapes.Length;
+			if (iface_cache_sides (shapes [j]) != expected [j])
+				return j + 1;
+		}
+
+		try {
+			iface_cache_sides (null);
+			return 10;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
+	/* A separate call site, so the test above doesn't make it megamorphic */
+	static int iface_cache_sides2 (IShape s) {
+		return s.Sides ();
+	}
+
+	public static int test_0_iface_call_site_type_changes () {
+		IShape t = new Triangle ();
+		IShape s = new Square ();
+
+		/* Two types fit into the cache */
+		for (int i = 0; i < 100; ++i) {
+			if (iface_cache_sides2 (t) != 3 || iface_cache_sides2 (s) != 4)
+				return 1;
+		}
+		/* Then a third one comes along */
+		if (iface_cache_sides2 (new Hexagon ()) != 6)
+			return 2;
+		if (iface_cache_sides2 (t) != 3 || iface_cache_sides2 (s) != 4)
+			return 3;
+		return 0;
+	}
+
+	static T box_unbox_any<T> (T t) {
+		return (T)(object)t;
+	}
+
+	public static int test_0_box_unbox_any_small_ints () {
+		int i = 300;
+		int j = 70000;
+		int k = -1;
+
+		if ((byte)(object)(byte)i != 44)
+			return 1;
+		if ((sbyte)(object)(sbyte)i != 44)
+			return 2;
+		if ((short)(object)(short)j != 4464)
+			return 3;
+		if ((ushort)(object)(ushort)j != 4464)
+			return 4;
+		if ((char)(object)(char)j != (char)4464)
+			return 5;
+		if ((byte)(object)(byte)k != 255)
+			return 6;
+		if ((sbyte)(object)(sbyte)k != -1)
+			return 7;
+		if ((ushort)(object)(ushort)k != 65535)
+			return 8;
+		if (box_unbox_any<byte> ((byte)i) != 44)
+			return 9;
+		if (box_unbox_any<short> ((short)k) != -1)
+			return 10;
+		return 0;
+	}
 }
 
 #if MOBILE
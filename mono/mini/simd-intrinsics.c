@@ -1475,6 +1475,10 @@ simd_version_name (guint32 version)
 		return "sse42";
 	case SIMD_VERSION_SSE4a:
 		return "sse4a";
+	case SIMD_VERSION_AVX:
+		return "avx";
+	case SIMD_VERSION_AVX2:
+		return "avx2";
 	}
 	return "n/a";
 }
@@ -1682,5 +1686,1222 @@ mono_emit_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 	return NULL;
 }
 
+
+/*
+ * Loop vectorization
+ *
+ * Counted loops over arrays, which have the form left by mono_abc_version_loops ():
+ *
+ *   for (i = start; i < bound; ++i)
+ *       a [i] = b [i] op c [i]; / sum += a [i];
+ *
+ * i.e. a header which computes the bound and tests the induction variable, and a single
+ * body without calls or bounds checks, are rewritten to process 16 bytes of elements in
+ * each iteration. The vector loop is placed before the header, and the original loop runs
+ * the remaining iterations.
+ * All the accesses of the body have to use the induction variable as the index and the same
+ * element type, so each element is only accessed by its own lane, and a store can't be seen
+ * by the loads of another iteration.
+ * SIMD values can't live across bblocks, since mono_handle_global_vregs () doesn't handle
+ * them, so reductions are summed horizontally in each iteration of the vector loop.
+ * With AVX2, the vector body processes 32 bytes using the ymm regs. It is marked with
+ * BB_AVX256 so the backend loads, stores and spills the whole ymm regs, and it is left
+ * through a vzeroupper, so the SSE code outside of it runs without transition penalties.
+ */
+
+#define VECTOR_SIZE 16
+#define VECTOR_SIZE_AVX256 32
+#define VECTOR_MAX_LOOP_SIZE 64
+
+typedef enum {
+	VECTOR_ELEM_NONE,
+	VECTOR_ELEM_I4,
+	VECTOR_ELEM_R4,
+	VECTOR_ELEM_I1
+} VectorElemKind;
+
+typedef enum {
+	/* The induction variable */
+	VECTOR_VAL_INDEX = 1,
+	/* The address of the current element of an array */
+	VECTOR_VAL_ADDR,
+	/* A constant, which is broadcast to all the lanes */
+	VECTOR_VAL_CONST,
+	/* An element, which is computed in all the lanes */
+	VECTOR_VAL_ELEM,
+	/* The new value of a reduction variable */
+	VECTOR_VAL_REDUCTION,
+	/* The incremented induction variable */
+	VECTOR_VAL_IV_INC
+} VectorValKind;
+
+typedef struct {
+	VectorValKind kind;
+	/* VECTOR_VAL_ADDR: the scale of the index */
+	int shift;
+	/* VECTOR_VAL_ELEM: whenever a float value is exactly representable as a float */
+	gboolean exact;
+	/* VECTOR_VAL_ELEM: whenever the value is a zero extended byte loaded from memory */
+	gboolean u1_load;
+	/* VECTOR_VAL_REDUCTION: the reduction variable */
+	int var_reg;
+} VectorVal;
+
+typedef struct {
+	MonoCompile *cfg;
+	MonoBasicBlock *header, *body, *preheader;
+	MonoInst *compare;
+	/* The induction variable, incremented by one at IV_DEF */
+	int iv_reg;
+	MonoInst *iv_def, *iv_inc;
+	/* The loop runs while IV < BOUND, or IV <= BOUND if BOUND_INCLUSIVE */
+	int bound_reg;
+	int bound_const;
+	gboolean bound_inclusive;
+	VectorElemKind elem_kind;
+	/* The number of lanes */
+	int width;
+	/* Whenever the vector body uses the 256 bit ymm regs */
+	gboolean avx256;
+	/* Maps the local vregs of the body to VectorVal */
+	GHashTable *vals;
+	/* The variables which are reduced in the body */
+	GHashTable *reductions;
+	int nstores;
+} VectorLoop;
+
+static inline gboolean
+vector_is_local_vreg (MonoCompile *cfg, int reg)
+{
+	return reg >= MAX (MONO_MAX_IREGS, MONO_MAX_FREGS) && !get_vreg_to_inst (cfg, reg);
+}
+
+static inline gboolean
+vector_ins_defines_reg (MonoInst *ins, int reg)
+{
+	const char *spec = INS_INFO (ins->opcode);
+
+	return spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && !MONO_IS_STORE_MEMINDEX (ins) && ins->dreg == reg;
+}
+
+static int
+vector_count_defs (VectorLoop *loop, int reg, MonoInst **def)
+{
+	MonoBasicBlock *blocks [2] = { loop->header, loop->body };
+	MonoInst *ins;
+	int i, count = 0;
+
+	for (i = 0; i < 2; ++i) {
+		for (ins = blocks [i]->code; ins; ins = ins->next) {
+			if (vector_ins_defines_reg (ins, reg)) {
+				count ++;
+				if (def)
+					*def = ins;
+			}
+		}
+	}
+	return count;
+}
+
+static int
+vector_count_uses (VectorLoop *loop, int reg)
+{
+	MonoBasicBlock *blocks [2] = { loop->header, loop->body };
+	MonoInst *ins;
+	int i, count = 0;
+
+	for (i = 0; i < 2; ++i) {
+		for (ins = blocks [i]->code; ins; ins = ins->next) {
+			if (ins->sreg1 == reg)
+				count ++;
+			if (ins->sreg2 == reg)
+				count ++;
+			if (ins->sreg3 == reg)
+				count ++;
+			if ((MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins)) && ins->dreg == reg)
+				count ++;
+		}
+	}
+	return count;
+}
+
+static gboolean
+vector_is_invariant_var (VectorLoop *loop, int reg)
+{
+	MonoInst *var = get_vreg_to_inst (loop->cfg, reg);
+
+	return var && !(var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) && vector_count_defs (loop, reg, NULL) == 0;
+}
+
+static inline VectorVal*
+vector_get_val (VectorLoop *loop, int reg)
+{
+	return g_hash_table_lookup (loop->vals, GINT_TO_POINTER (reg));
+}
+
+static VectorVal*
+vector_set_val (VectorLoop *loop, int reg, VectorValKind kind)
+{
+	VectorVal *val = mono_mempool_alloc0 (loop->cfg->mempool, sizeof (VectorVal));
+
+	val->kind = kind;
+	g_hash_table_insert (loop->vals, GINT_TO_POINTER (reg), val);
+	return val;
+}
+
+/*
+ * vector_find_loop:
+ *
+ *   Check that HEADER ends with the condition of a loop made of HEADER and a single body
+ * block, which is only entered from its preheader.
+ */
+static gboolean
+vector_find_loop (VectorLoop *loop, MonoBasicBlock *header)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *branch = header->last_ins;
+	MonoBasicBlock *body, *preheader;
+	MonoInst *ins;
+	int size = 0;
+
+	if (!branch || !MONO_IS_COND_BRANCH_OP (branch) || !branch->inst_true_bb || !branch->inst_false_bb)
+		return FALSE;
+	if (header->region != -1 || header->extended || header->in_count != 2 || header->out_count != 2)
+		return FALSE;
+
+	body = branch->inst_true_bb;
+	if (body->in_count != 1 || body->out_count != 1 || body->out_bb [0] != header)
+		body = branch->inst_false_bb;
+	if (body == header || body->in_count != 1 || body->out_count != 1 || body->out_bb [0] != header)
+		return FALSE;
+	if (body->region != -1 || body->extended || (body->flags & BB_EXCEPTION_HANDLER))
+		return FALSE;
+
+	preheader = header->in_bb [0] == body ? header->in_bb [1] : header->in_bb [0];
+	if (preheader == body || preheader == cfg->bb_entry || preheader->region != -1)
+		return FALSE;
+	if (preheader->last_ins && preheader->last_ins->opcode == OP_BR_REG)
+		return FALSE;
+
+	for (ins = body->code; ins; ins = ins->next) {
+		if (MONO_IS_CALL (ins))
+			return FALSE;
+		if (++size > VECTOR_MAX_LOOP_SIZE)
+			return FALSE;
+	}
+
+	loop->header = header;
+	loop->body = body;
+	loop->preheader = preheader;
+	return TRUE;
+}
+
+/*
+ * Whenever IV is a variable which is incremented by one at the end of the body.
+ */
+static gboolean
+vector_check_iv (VectorLoop *loop, int iv)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *var = get_vreg_to_inst (cfg, iv);
+	MonoInst *def = NULL, *inc = NULL, *ins;
+
+	if (!var || var->type != STACK_I4 || (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))
+		return FALSE;
+	if (vector_count_defs (loop, iv, &def) != 1)
+		return FALSE;
+
+	for (ins = loop->body->code; ins && ins != def; ins = ins->next) {
+		if (def->opcode == OP_MOVE && vector_ins_defines_reg (ins, def->sreg1))
+			inc = ins;
+	}
+	/* The def is in the header */
+	if (!ins)
+		return FALSE;
+
+	if (def->opcode == OP_MOVE && vector_is_local_vreg (cfg, def->sreg1)) {
+		/* iv = t, t = iv + 1 */
+		if (!inc || inc->opcode != OP_IADD_IMM || inc->sreg1 != iv || inc->inst_imm != 1)
+			return FALSE;
+	} else if (def->opcode != OP_IADD_IMM || def->sreg1 != iv || def->inst_imm != 1) {
+		return FALSE;
+	}
+
+	/* Nothing can follow the increment */
+	for (ins = def->next; ins; ins = ins->next) {
+		if (ins->opcode != OP_NOP && ins->opcode != OP_IL_SEQ_POINT && !(ins->opcode == OP_BR && !ins->next))
+			return FALSE;
+	}
+
+	loop->iv_reg = iv;
+	loop->iv_def = def;
+	loop->iv_inc = inc;
+	return TRUE;
+}
+
+/*
+ * Whenever the bound of the loop condition can be computed before the loop, from invariant
+ * variables.
+ */
+static gboolean
+vector_check_bound (VectorLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+
+	for (ins = loop->header->code; ins != loop->compare; ins = ins->next) {
+		switch (ins->opcode) {
+		case OP_NOP:
+		case OP_IL_SEQ_POINT:
+			continue;
+		case OP_LDLEN:
+		case OP_STRLEN:
+		case OP_MOVE:
+		case OP_SEXT_I4:
+		case OP_ICONST:
+		case OP_IADD_IMM:
+		case OP_ISUB_IMM:
+		case OP_IADD:
+		case OP_ISUB:
+			break;
+		default:
+			return FALSE;
+		}
+		if (!vector_is_local_vreg (cfg, ins->dreg))
+			return FALSE;
+		if (ins->sreg1 != -1 && !vector_is_local_vreg (cfg, ins->sreg1) && !vector_is_invariant_var (loop, ins->sreg1))
+			return FALSE;
+		if (ins->sreg2 != -1 && !vector_is_local_vreg (cfg, ins->sreg2) && !vector_is_invariant_var (loop, ins->sreg2))
+			return FALSE;
+	}
+
+	return loop->bound_reg == -1 || vector_is_local_vreg (cfg, loop->bound_reg) || vector_is_invariant_var (loop, loop->bound_reg);
+}
+
+static gboolean
+vector_check_condition (VectorLoop *loop)
+{
+	MonoInst *branch = loop->header->last_ins;
+	MonoInst *compare = branch->prev;
+	CompRelation rel;
+
+	if (!compare || (compare->opcode != OP_ICOMPARE && compare->opcode != OP_ICOMPARE_IMM))
+		return FALSE;
+	if (branch->opcode < OP_IBEQ || branch->opcode > OP_IBLT_UN)
+		return FALSE;
+	loop->compare = compare;
+
+	/* The relation which holds inside the loop */
+	rel = mono_opcode_to_cond (branch->opcode);
+	if (branch->inst_false_bb == loop->body)
+		rel = mono_negate_cond (rel);
+
+	loop->bound_reg = -1;
+	loop->bound_const = 0;
+	if (compare->opcode == OP_ICOMPARE_IMM) {
+		if (rel != CMP_LT && rel != CMP_LE)
+			return FALSE;
+		if (!vector_check_iv (loop, compare->sreg1))
+			return FALSE;
+		loop->bound_const = compare->inst_imm;
+	} else if ((rel == CMP_LT || rel == CMP_LE) && vector_check_iv (loop, compare->sreg1)) {
+		loop->bound_reg = compare->sreg2;
+	} else if ((rel == CMP_GT || rel == CMP_GE) && vector_check_iv (loop, compare->sreg2)) {
+		rel = rel == CMP_GT ? CMP_LT : CMP_LE;
+		loop->bound_reg = compare->sreg1;
+	} else {
+		return FALSE;
+	}
+	loop->bound_inclusive = rel == CMP_LE;
+
+	return vector_check_bound (loop);
+}
+
+static gboolean
+vector_set_elem_kind (VectorLoop *loop, VectorElemKind kind)
+{
+	if (loop->elem_kind == VECTOR_ELEM_NONE) {
+		loop->elem_kind = kind;
+		loop->width = (loop->avx256 ? VECTOR_SIZE_AVX256 : VECTOR_SIZE) / (kind == VECTOR_ELEM_I1 ? 1 : 4);
+	}
+	return loop->elem_kind == kind;
+}
+
+/*
+ * vector_check_operand:
+ *
+ *   Whenever REG can be computed in all the lanes: it is either an element, a constant or
+ * an invariant variable. Set *IS_ELEM if it is an element.
+ */
+static gboolean
+vector_check_operand (VectorLoop *loop, int reg, gboolean *is_elem)
+{
+	MonoInst *var;
+	VectorVal *val;
+
+	*is_elem = FALSE;
+	val = vector_get_val (loop, reg);
+	if (val) {
+		*is_elem = val->kind == VECTOR_VAL_ELEM;
+		return val->kind == VECTOR_VAL_ELEM || val->kind == VECTOR_VAL_CONST;
+	}
+	if (!vector_is_invariant_var (loop, reg))
+		return FALSE;
+	var = get_vreg_to_inst (loop->cfg, reg);
+	if (loop->elem_kind == VECTOR_ELEM_R4)
+		/* Without r4fp, float variables can hold double values */
+		return loop->cfg->r4fp && var->type == STACK_R4;
+	return var->type == STACK_I4;
+}
+
+/* Whenever the value of REG is exactly representable in a float lane */
+static gboolean
+vector_is_exact (VectorLoop *loop, int reg)
+{
+	VectorVal *val = vector_get_val (loop, reg);
+
+	return loop->cfg->r4fp || !val || val->kind == VECTOR_VAL_CONST || val->exact;
+}
+
+static inline gboolean
+vector_is_float_op (int opcode)
+{
+	return opcode == OP_FADD || opcode == OP_FSUB || opcode == OP_FMUL || opcode == OP_FDIV ||
+		opcode == OP_RADD || opcode == OP_RSUB || opcode == OP_RMUL || opcode == OP_RDIV;
+}
+
+static int
+vector_simd_op (VectorLoop *loop, int opcode)
+{
+	gboolean bytes = loop->elem_kind == VECTOR_ELEM_I1;
+
+	switch (opcode) {
+	case OP_IADD:
+		return bytes ? OP_PADDB : OP_PADDD;
+	case OP_ISUB:
+		return bytes ? OP_PSUBB : OP_PSUBD;
+	case OP_IAND:
+		return OP_PAND;
+	case OP_IOR:
+		return OP_POR;
+	case OP_IXOR:
+		return OP_PXOR;
+	case OP_IMUL:
+		/* pmulld is SSE4.1 */
+		return !bytes && (simd_supported_versions & SIMD_VERSION_SSE41) ? OP_PMULD : -1;
+	case OP_ISHL_IMM:
+		return bytes ? -1 : OP_PSHLD;
+	case OP_ISHR_IMM:
+		return bytes ? -1 : OP_PSARD;
+	case OP_ISHR_UN_IMM:
+		return bytes ? -1 : OP_PSHRD;
+	case OP_FADD:
+	case OP_RADD:
+		return OP_ADDPS;
+	case OP_FSUB:
+	case OP_RSUB:
+		return OP_SUBPS;
+	case OP_FMUL:
+	case OP_RMUL:
+		return OP_MULPS;
+	case OP_FDIV:
+	case OP_RDIV:
+		return OP_DIVPS;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * vector_lane_op:
+ *
+ *   Return the opcode which computes OPCODE in all the lanes of the vector body, taking
+ * the vector size into account.
+ */
+static int
+vector_lane_op (VectorLoop *loop, int opcode)
+{
+	int op = vector_simd_op (loop, opcode);
+
+#ifdef MONO_ARCH_HAVE_AVX256
+	if (loop->avx256) {
+		switch (op) {
+		case OP_PADDB:
+			return OP_AMD64_VPADDB;
+		case OP_PADDD:
+			return OP_AMD64_VPADDD;
+		case OP_PSUBB:
+			return OP_AMD64_VPSUBB;
+		case OP_PSUBD:
+			return OP_AMD64_VPSUBD;
+		case OP_PMULD:
+			return OP_AMD64_VPMULD;
+		case OP_PAND:
+			return OP_AMD64_VPAND;
+		case OP_POR:
+			return OP_AMD64_VPOR;
+		case OP_PXOR:
+			return OP_AMD64_VPXOR;
+		case OP_PSHLD:
+			return OP_AMD64_VPSHLD;
+		case OP_PSARD:
+			return OP_AMD64_VPSARD;
+		case OP_PSHRD:
+			return OP_AMD64_VPSHRD;
+		case OP_ADDPS:
+			return OP_AMD64_VADDPS;
+		case OP_SUBPS:
+			return OP_AMD64_VSUBPS;
+		case OP_MULPS:
+			return OP_AMD64_VMULPS;
+		case OP_DIVPS:
+			return OP_AMD64_VDIVPS;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+#endif
+	return op;
+}
+
+/*
+ * vector_check_reduction:
+ *
+ *   Whenever INS is 'var = var op elem', and VAR is not used otherwise in the loop.
+ */
+static gboolean
+vector_check_reduction (VectorLoop *loop, MonoInst *ins)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *var, *move = NULL, *def = NULL;
+	VectorVal *val;
+	int var_reg, elem_reg;
+
+	if (loop->elem_kind == VECTOR_ELEM_R4)
+		/* Reassociating float additions changes the result */
+		return FALSE;
+
+	var_reg = get_vreg_to_inst (cfg, ins->sreg1) ? ins->sreg1 : ins->sreg2;
+	elem_reg = var_reg == ins->sreg1 ? ins->sreg2 : ins->sreg1;
+	if (ins->opcode == OP_ISUB && var_reg != ins->sreg1)
+		return FALSE;
+	var = get_vreg_to_inst (cfg, var_reg);
+	if (!var || var_reg == loop->iv_reg || var->type != STACK_I4 || (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))
+		return FALSE;
+
+	val = vector_get_val (loop, elem_reg);
+	if (!val || val->kind != VECTOR_VAL_ELEM)
+		return FALSE;
+	if (loop->elem_kind == VECTOR_ELEM_I1 && (ins->opcode != OP_IADD || !val->u1_load))
+		/* psadbw only computes the sum of unsigned bytes */
+		return FALSE;
+	if (vector_count_defs (loop, var_reg, &def) != 1 || vector_count_uses (loop, var_reg) != 1)
+		return FALSE;
+
+	if (ins->dreg != var_reg) {
+		/* t = var op elem, var = t */
+		if (!vector_is_local_vreg (cfg, ins->dreg) || def->opcode != OP_MOVE || def->sreg1 != ins->dreg)
+			return FALSE;
+		for (move = ins->next; move && move != def; move = move->next)
+			;
+		if (!move)
+			return FALSE;
+		val = vector_set_val (loop, ins->dreg, VECTOR_VAL_REDUCTION);
+		val->var_reg = var_reg;
+	}
+
+	g_hash_table_insert (loop->reductions, GINT_TO_POINTER (var_reg), GINT_TO_POINTER (var_reg));
+	return TRUE;
+}
+
+/*
+ * vector_check_body:
+ *
+ *   Check that all the instructions of the body can be computed in all the lanes.
+ */
+/* Whenever the vector body can use the 256 bit ymm regs */
+static gboolean
+vector_use_avx256 (MonoCompile *cfg)
+{
+#ifdef MONO_ARCH_HAVE_AVX256
+	/* AOT code can run on a different cpu */
+	return (simd_supported_versions & SIMD_VERSION_AVX2) && !cfg->compile_aot;
+#else
+	return FALSE;
+#endif
+}
+
+/*
+ * vector_has_scalar_fp:
+ *
+ *   Whenever the vector body of LOOP needs float scalars, i.e. constants or invariants
+ * which are broadcast. These are computed using the legacy SSE encodings, which can't be
+ * mixed with 256 bit AVX code without penalties.
+ */
+static gboolean
+vector_has_scalar_fp (VectorLoop *loop)
+{
+	MonoInst *ins;
+
+	if (loop->elem_kind != VECTOR_ELEM_R4)
+		return FALSE;
+	for (ins = loop->body->code; ins && ins != loop->iv_def; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+		VectorVal *val;
+
+		if (ins->opcode == OP_R4CONST)
+			return TRUE;
+		if (spec [MONO_INST_SRC1] == 'f') {
+			val = vector_get_val (loop, ins->sreg1);
+			if (!val || val->kind != VECTOR_VAL_ELEM)
+				return TRUE;
+		}
+		if (spec [MONO_INST_SRC2] == 'f') {
+			val = vector_get_val (loop, ins->sreg2);
+			if (!val || val->kind != VECTOR_VAL_ELEM)
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+vector_check_body (VectorLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+
+	loop->avx256 = vector_use_avx256 (cfg);
+	loop->elem_kind = VECTOR_ELEM_NONE;
+	loop->nstores = 0;
+	g_hash_table_remove_all (loop->vals);
+	g_hash_table_remove_all (loop->reductions);
+
+	for (ins = loop->body->code; ins && ins != loop->iv_def; ins = ins->next) {
+		VectorVal *val, *src;
+		gboolean elem1, elem2;
+		int size = 4;
+
+		if (ins == loop->iv_inc) {
+			vector_set_val (loop, ins->dreg, VECTOR_VAL_IV_INC);
+			continue;
+		}
+
+		switch (ins->opcode) {
+		case OP_NOP:
+		case OP_IL_SEQ_POINT:
+			break;
+		case OP_ICONST:
+		case OP_R4CONST:
+			if (!vector_is_local_vreg (cfg, ins->dreg))
+				return FALSE;
+			vector_set_val (loop, ins->dreg, VECTOR_VAL_CONST);
+			break;
+		case OP_MOVE:
+		case OP_SEXT_I4:
+		case OP_FMOVE:
+		case OP_RMOVE:
+			src = vector_get_val (loop, ins->sreg1);
+			if (ins->opcode == OP_MOVE && src && src->kind == VECTOR_VAL_REDUCTION && ins->dreg == src->var_reg)
+				/* Checked by vector_check_reduction () */
+				break;
+			if (!vector_is_local_vreg (cfg, ins->dreg))
+				return FALSE;
+			if (ins->sreg1 == loop->iv_reg || (src && src->kind == VECTOR_VAL_INDEX)) {
+				if (ins->opcode != OP_MOVE && ins->opcode != OP_SEXT_I4)
+					return FALSE;
+				vector_set_val (loop, ins->dreg, VECTOR_VAL_INDEX);
+			} else if (src && src->kind == VECTOR_VAL_ELEM && ins->opcode != OP_SEXT_I4) {
+				val = vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+				val->exact = src->exact;
+				val->u1_load = src->u1_load;
+			} else {
+				return FALSE;
+			}
+			break;
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+		case OP_X86_LEA: {
+			MonoInst *var = get_vreg_to_inst (cfg, ins->sreg1);
+
+			/* &a [i] */
+			src = vector_get_val (loop, ins->sreg2);
+			if (!vector_is_local_vreg (cfg, ins->dreg) || !var || var->type != STACK_OBJ || !vector_is_invariant_var (loop, ins->sreg1))
+				return FALSE;
+			if (ins->sreg2 != loop->iv_reg && !(src && src->kind == VECTOR_VAL_INDEX))
+				return FALSE;
+			if (ins->inst_imm != MONO_STRUCT_OFFSET (MonoArray, vector))
+				return FALSE;
+			val = vector_set_val (loop, ins->dreg, VECTOR_VAL_ADDR);
+			val->shift = ins->backend.shift_amount;
+			break;
+		}
+#endif
+		case OP_LOADU1_MEMBASE:
+		case OP_LOADI1_MEMBASE:
+		case OP_LOADI4_MEMBASE:
+		case OP_LOADU4_MEMBASE:
+		case OP_LOADR4_MEMBASE:
+			if (ins->opcode == OP_LOADR4_MEMBASE) {
+				if (!vector_set_elem_kind (loop, VECTOR_ELEM_R4))
+					return FALSE;
+			} else if (ins->opcode == OP_LOADU1_MEMBASE || ins->opcode == OP_LOADI1_MEMBASE) {
+				if (!vector_set_elem_kind (loop, VECTOR_ELEM_I1))
+					return FALSE;
+				size = 1;
+			} else if (!vector_set_elem_kind (loop, VECTOR_ELEM_I4)) {
+				return FALSE;
+			}
+			src = vector_get_val (loop, ins->sreg1);
+			if (!vector_is_local_vreg (cfg, ins->dreg) || !src || src->kind != VECTOR_VAL_ADDR || src->shift != (size == 1 ? 0 : 2) || ins->inst_offset != 0)
+				return FALSE;
+			val = vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+			val->exact = TRUE;
+			val->u1_load = ins->opcode == OP_LOADU1_MEMBASE;
+			break;
+		case OP_STOREI1_MEMBASE_REG:
+		case OP_STOREI1_MEMBASE_IMM:
+		case OP_STOREI4_MEMBASE_REG:
+		case OP_STOREI4_MEMBASE_IMM:
+		case OP_STORER4_MEMBASE_REG:
+			if (ins->opcode == OP_STORER4_MEMBASE_REG) {
+				if (!vector_set_elem_kind (loop, VECTOR_ELEM_R4))
+					return FALSE;
+			} else if (ins->opcode == OP_STOREI1_MEMBASE_REG || ins->opcode == OP_STOREI1_MEMBASE_IMM) {
+				if (!vector_set_elem_kind (loop, VECTOR_ELEM_I1))
+					return FALSE;
+				size = 1;
+			} else if (!vector_set_elem_kind (loop, VECTOR_ELEM_I4)) {
+				return FALSE;
+			}
+			src = vector_get_val (loop, ins->dreg);
+			if (!src || src->kind != VECTOR_VAL_ADDR || src->shift != (size == 1 ? 0 : 2) || ins->inst_offset != 0)
+				return FALSE;
+			if (ins->opcode != OP_STOREI1_MEMBASE_IMM && ins->opcode != OP_STOREI4_MEMBASE_IMM && !vector_check_operand (loop, ins->sreg1, &elem1))
+				return FALSE;
+			loop->nstores ++;
+			break;
+		case OP_IADD:
+		case OP_ISUB:
+		case OP_IAND:
+		case OP_IOR:
+		case OP_IXOR:
+		case OP_IMUL:
+		case OP_FADD:
+		case OP_FSUB:
+		case OP_FMUL:
+		case OP_FDIV:
+		case OP_RADD:
+		case OP_RSUB:
+		case OP_RMUL:
+		case OP_RDIV:
+			if (loop->elem_kind == VECTOR_ELEM_NONE || vector_simd_op (loop, ins->opcode) == -1)
+				return FALSE;
+			if (ins->opcode == OP_IADD || ins->opcode == OP_ISUB || ins->opcode == OP_IAND || ins->opcode == OP_IOR || ins->opcode == OP_IXOR) {
+				if (vector_check_reduction (loop, ins))
+					break;
+			}
+			if (!vector_is_local_vreg (cfg, ins->dreg))
+				return FALSE;
+			if (!vector_check_operand (loop, ins->sreg1, &elem1) || !vector_check_operand (loop, ins->sreg2, &elem2) || (!elem1 && !elem2))
+				return FALSE;
+			if ((loop->elem_kind == VECTOR_ELEM_R4) != vector_is_float_op (ins->opcode))
+				return FALSE;
+			if (vector_is_float_op (ins->opcode) && !cfg->r4fp) {
+				/*
+				 * Without r4fp, the operation is done in double precision. Its result, rounded
+				 * to float, is only the same as the float operation if the operands are floats.
+				 */
+				if (!vector_is_exact (loop, ins->sreg1) || !vector_is_exact (loop, ins->sreg2))
+					return FALSE;
+			}
+			val = vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+			val->exact = cfg->r4fp;
+			break;
+		case OP_IADD_IMM:
+		case OP_ISUB_IMM:
+		case OP_IAND_IMM:
+		case OP_IOR_IMM:
+		case OP_IXOR_IMM:
+		case OP_IMUL_IMM:
+		case OP_ISHL_IMM:
+		case OP_ISHR_IMM:
+		case OP_ISHR_UN_IMM: {
+			int opcode = (ins->opcode == OP_ISHL_IMM || ins->opcode == OP_ISHR_IMM || ins->opcode == OP_ISHR_UN_IMM) ? ins->opcode : mono_op_imm_to_op (ins->opcode);
+
+			src = vector_get_val (loop, ins->sreg1);
+			if (loop->elem_kind == VECTOR_ELEM_NONE || loop->elem_kind == VECTOR_ELEM_R4 || vector_simd_op (loop, opcode) == -1)
+				return FALSE;
+			if (!vector_is_local_vreg (cfg, ins->dreg) || !src || src->kind != VECTOR_VAL_ELEM)
+				return FALSE;
+			vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+			break;
+		}
+		case OP_ICONV_TO_I1:
+		case OP_ICONV_TO_U1:
+			/* The truncation is done by the byte lanes */
+			src = vector_get_val (loop, ins->sreg1);
+			if (loop->elem_kind != VECTOR_ELEM_I1 || !vector_is_local_vreg (cfg, ins->dreg) || !src || src->kind != VECTOR_VAL_ELEM)
+				return FALSE;
+			vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+			break;
+		case OP_FCONV_TO_R4:
+			src = vector_get_val (loop, ins->sreg1);
+			if (loop->elem_kind != VECTOR_ELEM_R4 || !vector_is_local_vreg (cfg, ins->dreg) || !src || src->kind != VECTOR_VAL_ELEM)
+				return FALSE;
+			val = vector_set_val (loop, ins->dreg, VECTOR_VAL_ELEM);
+			val->exact = TRUE;
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	if (loop->elem_kind == VECTOR_ELEM_NONE || (!loop->nstores && !g_hash_table_size (loop->reductions)))
+		return FALSE;
+	/* Fall back to the xmm regs if the ymm ones can't be used efficiently */
+	if (loop->avx256 && (vector_has_scalar_fp (loop) || (loop->bound_reg == -1 && loop->bound_const < loop->width - 1))) {
+		loop->avx256 = FALSE;
+		loop->width /= 2;
+	}
+	if (loop->bound_reg == -1 && loop->bound_const < loop->width - 1)
+		return FALSE;
+	return TRUE;
+}
+
+static inline int
+vector_map_reg (GHashTable *regs, int reg)
+{
+	gpointer res = g_hash_table_lookup (regs, GINT_TO_POINTER (reg));
+
+	return res ? GPOINTER_TO_INT (res) : reg;
+}
+
+static MonoInst*
+vector_emit_xop (MonoCompile *cfg, int opcode, int sreg1, int sreg2)
+{
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, opcode);
+	ins->dreg = alloc_ireg (cfg);
+	ins->sreg1 = sreg1;
+	ins->sreg2 = sreg2;
+	ins->type = STACK_VTYPE;
+	MONO_ADD_INS (cfg->cbb, ins);
+	return ins;
+}
+
+/* Broadcast the scalar in SREG to all the lanes */
+static int
+vector_emit_expand (VectorLoop *loop, int sreg)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+	int opcode;
+
+	switch (loop->elem_kind) {
+	case VECTOR_ELEM_I1:
+		opcode = OP_EXPAND_I1;
+		break;
+	case VECTOR_ELEM_R4:
+		opcode = OP_EXPAND_R4;
+		break;
+	default:
+		opcode = OP_EXPAND_I4;
+		break;
+	}
+#ifdef MONO_ARCH_HAVE_AVX256
+	if (loop->avx256)
+		/* These are done directly by vpbroadcast* */
+		return vector_emit_xop (cfg, opcode == OP_EXPAND_I1 ? OP_AMD64_VEXPAND_I1 : opcode == OP_EXPAND_R4 ? OP_AMD64_VEXPAND_R4 : OP_AMD64_VEXPAND_I4, sreg, -1)->dreg;
+#endif
+	ins = vector_emit_xop (cfg, opcode, sreg, -1);
+	if (opcode == OP_EXPAND_R4)
+		ins->backend.spill_var = mini_get_int_to_float_spill_area (cfg);
+	return ins->dreg;
+}
+
+static int
+vector_emit_expand_imm (VectorLoop *loop, int imm)
+{
+	int reg = alloc_ireg (loop->cfg);
+
+	MONO_EMIT_NEW_ICONST (loop->cfg, reg, imm);
+	return vector_emit_expand (loop, reg);
+}
+
+/*
+ * vector_get_xreg:
+ *
+ *   Return the vector reg holding REG in all the lanes. Constants and invariants are
+ * broadcast the first time they are used.
+ */
+static int
+vector_get_xreg (VectorLoop *loop, GHashTable *regs, GHashTable *expanded, int reg)
+{
+	VectorVal *val = vector_get_val (loop, reg);
+	int xreg;
+
+	if (val && val->kind == VECTOR_VAL_ELEM)
+		return vector_map_reg (regs, reg);
+
+	xreg = vector_map_reg (expanded, reg);
+	if (xreg == reg) {
+		xreg = vector_emit_expand (loop, vector_map_reg (regs, reg));
+		g_hash_table_insert (expanded, GINT_TO_POINTER (reg), GINT_TO_POINTER (xreg));
+	}
+	return xreg;
+}
+
+/*
+ * vector_emit_reduction:
+ *
+ *   Emit VAR = VAR op <the sum of the lanes of XREG>.
+ */
+static void
+vector_emit_reduction (VectorLoop *loop, int opcode, int var_reg, int xreg)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+	int hop, sreg;
+
+#ifdef MONO_ARCH_HAVE_AVX256
+	if (loop->avx256) {
+		/* Fold the high 128 bits into the low ones, the rest is done using the xmm regs */
+		hop = opcode == OP_ISUB ? OP_PADDD : vector_simd_op (loop, opcode);
+		if (loop->elem_kind == VECTOR_ELEM_I1) {
+			sreg = vector_emit_xop (cfg, OP_AMD64_VZERO, -1, -1)->dreg;
+			xreg = vector_emit_xop (cfg, OP_AMD64_VPSUM_ABS_DIFF, xreg, sreg)->dreg;
+			hop = OP_PADDD;
+		}
+		sreg = vector_emit_xop (cfg, OP_AMD64_VEXTRACT_HIGH, xreg, -1)->dreg;
+		xreg = vector_emit_xop (cfg, hop, xreg, sreg)->dreg;
+	}
+#endif
+
+	if (loop->elem_kind == VECTOR_ELEM_I1) {
+		/* psadbw against zero computes the sums of the two halves in the low dword of each qword */
+		if (!loop->avx256) {
+			sreg = vector_emit_xop (cfg, OP_XZERO, -1, -1)->dreg;
+			xreg = vector_emit_xop (cfg, OP_PSUM_ABS_DIFF, xreg, sreg)->dreg;
+		}
+		ins = vector_emit_xop (cfg, OP_PSHUFLED, xreg, -1);
+		ins->inst_c0 = mono_simd_shuffle_mask (2, 3, 0, 1);
+		xreg = vector_emit_xop (cfg, OP_PADDD, xreg, ins->dreg)->dreg;
+	} else {
+		hop = opcode == OP_ISUB ? OP_PADDD : vector_simd_op (loop, opcode);
+		ins = vector_emit_xop (cfg, OP_PSHUFLED, xreg, -1);
+		ins->inst_c0 = mono_simd_shuffle_mask (2, 3, 0, 1);
+		xreg = vector_emit_xop (cfg, hop, xreg, ins->dreg)->dreg;
+		ins = vector_emit_xop (cfg, OP_PSHUFLED, xreg, -1);
+		ins->inst_c0 = mono_simd_shuffle_mask (1, 0, 3, 2);
+		xreg = vector_emit_xop (cfg, hop, xreg, ins->dreg)->dreg;
+	}
+
+	MONO_INST_NEW (cfg, ins, OP_EXTRACT_I4);
+	ins->dreg = alloc_ireg (cfg);
+	ins->sreg1 = xreg;
+	ins->inst_c0 = 0;
+	ins->type = STACK_I4;
+	MONO_ADD_INS (cfg->cbb, ins);
+	sreg = ins->dreg;
+
+	MONO_EMIT_NEW_BIALU (cfg, opcode, var_reg, var_reg, sreg);
+}
+
+/*
+ * vector_emit_body:
+ *
+ *   Emit the vector version of the body of LOOP into the current bblock.
+ */
+static void
+vector_emit_body (VectorLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	GHashTable *regs = g_hash_table_new (NULL, NULL);
+	GHashTable *expanded = g_hash_table_new (NULL, NULL);
+	MonoInst *ins, *new_ins;
+	VectorVal *val;
+	int xreg, sreg;
+
+	for (ins = loop->body->code; ins; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+
+		if (ins == loop->iv_inc)
+			continue;
+		if (ins == loop->iv_def) {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, loop->iv_reg, loop->iv_reg, loop->width);
+			break;
+		}
+
+		switch (ins->opcode) {
+		case OP_NOP:
+		case OP_IL_SEQ_POINT:
+			break;
+		case OP_ICONST:
+		case OP_R4CONST:
+		case OP_SEXT_I4:
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+		case OP_X86_LEA:
+#endif
+			/* Scalars, which are only computed once */
+			MONO_INST_NEW (cfg, new_ins, ins->opcode);
+			memcpy (new_ins, ins, sizeof (MonoInst));
+			new_ins->next = new_ins->prev = NULL;
+			new_ins->sreg1 = vector_map_reg (regs, ins->sreg1);
+			new_ins->sreg2 = vector_map_reg (regs, ins->sreg2);
+			new_ins->dreg = spec [MONO_INST_DEST] == 'f' ? mono_alloc_freg (cfg) : mono_alloc_ireg_copy (cfg, ins->dreg);
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+			MONO_ADD_INS (cfg->cbb, new_ins);
+			break;
+		case OP_MOVE:
+		case OP_FMOVE:
+		case OP_RMOVE:
+		case OP_ICONV_TO_I1:
+		case OP_ICONV_TO_U1:
+		case OP_FCONV_TO_R4:
+			val = vector_get_val (loop, ins->sreg1);
+			if (val && val->kind == VECTOR_VAL_REDUCTION)
+				/* Emitted together with the reduction */
+				break;
+			/* Copies and conversions which are done by the lanes */
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (vector_map_reg (regs, ins->sreg1)));
+			break;
+		case OP_LOADU1_MEMBASE:
+		case OP_LOADI1_MEMBASE:
+		case OP_LOADI4_MEMBASE:
+		case OP_LOADU4_MEMBASE:
+		case OP_LOADR4_MEMBASE:
+			MONO_INST_NEW (cfg, new_ins, OP_LOADX_MEMBASE);
+			new_ins->dreg = alloc_ireg (cfg);
+			new_ins->sreg1 = vector_map_reg (regs, ins->sreg1);
+			new_ins->inst_offset = 0;
+			new_ins->type = STACK_VTYPE;
+			MONO_ADD_INS (cfg->cbb, new_ins);
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+			break;
+		case OP_STOREI1_MEMBASE_IMM:
+		case OP_STOREI4_MEMBASE_IMM:
+		case OP_STOREI1_MEMBASE_REG:
+		case OP_STOREI4_MEMBASE_REG:
+		case OP_STORER4_MEMBASE_REG:
+			if (ins->opcode == OP_STOREI1_MEMBASE_IMM || ins->opcode == OP_STOREI4_MEMBASE_IMM)
+				xreg = vector_emit_expand_imm (loop, ins->inst_imm);
+			else
+				xreg = vector_get_xreg (loop, regs, expanded, ins->sreg1);
+			MONO_INST_NEW (cfg, new_ins, OP_STOREX_MEMBASE);
+			new_ins->dreg = vector_map_reg (regs, ins->dreg);
+			new_ins->sreg1 = xreg;
+			new_ins->inst_offset = 0;
+			MONO_ADD_INS (cfg->cbb, new_ins);
+			break;
+		case OP_IADD_IMM:
+		case OP_ISUB_IMM:
+		case OP_IAND_IMM:
+		case OP_IOR_IMM:
+		case OP_IXOR_IMM:
+		case OP_IMUL_IMM:
+			xreg = vector_emit_xop (cfg, vector_lane_op (loop, mono_op_imm_to_op (ins->opcode)), vector_map_reg (regs, ins->sreg1), vector_emit_expand_imm (loop, ins->inst_imm))->dreg;
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (xreg));
+			break;
+		case OP_ISHL_IMM:
+		case OP_ISHR_IMM:
+		case OP_ISHR_UN_IMM:
+			new_ins = vector_emit_xop (cfg, vector_lane_op (loop, ins->opcode), vector_map_reg (regs, ins->sreg1), -1);
+			new_ins->inst_imm = ins->inst_imm & 0x1f;
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+			break;
+		default:
+			/* Binary operations and reductions */
+			if (g_hash_table_lookup (loop->reductions, GINT_TO_POINTER (ins->sreg1)) || g_hash_table_lookup (loop->reductions, GINT_TO_POINTER (ins->sreg2))) {
+				int var_reg = g_hash_table_lookup (loop->reductions, GINT_TO_POINTER (ins->sreg1)) ? ins->sreg1 : ins->sreg2;
+
+				sreg = var_reg == ins->sreg1 ? ins->sreg2 : ins->sreg1;
+				vector_emit_reduction (loop, ins->opcode, var_reg, vector_map_reg (regs, sreg));
+				break;
+			}
+			xreg = vector_emit_xop (cfg, vector_lane_op (loop, ins->opcode), vector_get_xreg (loop, regs, expanded, ins->sreg1), vector_get_xreg (loop, regs, expanded, ins->sreg2))->dreg;
+			g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (xreg));
+			break;
+		}
+	}
+
+	g_hash_table_destroy (regs);
+	g_hash_table_destroy (expanded);
+}
+
+/*
+ * vector_emit_loop:
+ *
+ *   Insert the vector loop between the preheader and the header of LOOP:
+ *
+ *   pre:   bound = <header prefix>
+ *          limit = bound - (width - 1)
+ *          if (bound < width - 1) goto header
+ *          if (iv >= limit) goto header
+ *   body:  <vector body>
+ *          iv += width
+ *          if (iv < limit) goto body
+ *   exit:  vzeroupper (only if the body uses the ymm regs)
+ *   header: <the original loop, which runs the remaining iterations>
+ */
+static void
+vector_emit_loop (VectorLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *header = loop->header;
+	MonoBasicBlock *prev, *pre, *body, *exit_bb, *orig_cbb;
+	GHashTable *regs = g_hash_table_new (NULL, NULL);
+	MonoInst *ins, *jump;
+	int i, bound_reg, limit_reg = -1;
+
+	/* The vector loop is placed right before the header, so it falls through into it */
+	for (prev = cfg->bb_entry; prev->next_bb != header; prev = prev->next_bb)
+		;
+	if (prev != loop->preheader && (!prev->last_ins || !MONO_IS_BRANCH_OP (prev->last_ins))) {
+		for (i = 0; i < prev->out_count; ++i) {
+			if (prev->out_bb [i] == header)
+				break;
+		}
+		if (i < prev->out_count) {
+			MONO_INST_NEW (cfg, jump, OP_BR);
+			jump->inst_target_bb = header;
+			MONO_ADD_INS (prev, jump);
+		}
+	}
+
+	pre = mono_split_edge (cfg, loop->preheader, header);
+	pre->block_num = cfg->num_bblocks ++;
+	pre->cil_code = header->cil_code;
+	pre->has_array_access = header->has_array_access;
+	mono_unlink_bblock (cfg, pre, header);
+	prev->next_bb = pre;
+
+	orig_cbb = cfg->cbb;
+	cfg->cbb = pre;
+
+	/* Compute the bound the same way as the header */
+	for (ins = header->code; ins != loop->compare; ins = ins->next) {
+		MonoInst *new_ins;
+
+		if (ins->opcode == OP_NOP || ins->opcode == OP_IL_SEQ_POINT)
+			continue;
+		MONO_INST_NEW (cfg, new_ins, ins->opcode);
+		memcpy (new_ins, ins, sizeof (MonoInst));
+		new_ins->next = new_ins->prev = NULL;
+		new_ins->sreg1 = vector_map_reg (regs, ins->sreg1);
+		new_ins->sreg2 = vector_map_reg (regs, ins->sreg2);
+		new_ins->dreg = mono_alloc_ireg_copy (cfg, ins->dreg);
+		g_hash_table_insert (regs, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (new_ins->dreg));
+		MONO_ADD_INS (pre, new_ins);
+	}
+
+	if (loop->bound_reg != -1) {
+		MonoBasicBlock *next_bb;
+		MonoInst *var;
+
+		bound_reg = vector_map_reg (regs, loop->bound_reg);
+
+		/*
+		 * The limit is used by the vector body, so it has to be a variable, while the bound
+		 * is a local vreg of this bblock. The limit is only used if computing it didn't
+		 * overflow.
+		 */
+		var = mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL);
+		limit_reg = var->dreg;
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, limit_reg, bound_reg, loop->width - 1);
+
+		NEW_BBLOCK (cfg, next_bb);
+		next_bb->region = pre->region;
+		next_bb->real_offset = pre->real_offset;
+		next_bb->cil_code = pre->cil_code;
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, bound_reg, loop->width - 1);
+		MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBLT, header, next_bb);
+		cfg->cbb->next_bb = next_bb;
+		cfg->cbb = next_bb;
+
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, loop->iv_reg, limit_reg);
+	} else {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->iv_reg, loop->bound_const - (loop->width - 1));
+	}
+	NEW_BBLOCK (cfg, body);
+	body->region = loop->body->region;
+	body->real_offset = loop->body->real_offset;
+	body->cil_code = loop->body->cil_code;
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, loop->bound_inclusive ? OP_IBGT : OP_IBGE, header, body);
+	cfg->cbb->next_bb = body;
+	cfg->cbb = body;
+
+	vector_emit_body (loop);
+
+	exit_bb = header;
+#ifdef MONO_ARCH_HAVE_AVX256
+	if (loop->avx256) {
+		body->flags |= BB_AVX256;
+		cfg->uses_avx256 = TRUE;
+
+		/* Clear the upper halves of the ymm regs before running the SSE code again */
+		NEW_BBLOCK (cfg, exit_bb);
+		exit_bb->region = body->region;
+		exit_bb->real_offset = body->real_offset;
+		exit_bb->cil_code = body->cil_code;
+		MONO_INST_NEW (cfg, ins, OP_AMD64_VZEROUPPER);
+		MONO_ADD_INS (exit_bb, ins);
+		mono_link_bblock (cfg, exit_bb, header);
+		exit_bb->next_bb = header;
+	}
+#endif
+
+	if (limit_reg != -1)
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, loop->iv_reg, limit_reg);
+	else
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->iv_reg, loop->bound_const - (loop->width - 1));
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, loop->bound_inclusive ? OP_IBLE : OP_IBLT, body, exit_bb);
+	body->next_bb = exit_bb;
+	cfg->cbb = orig_cbb;
+
+	g_hash_table_destroy (regs);
+
+	InterlockedIncrement (&mono_jit_stats.loops_vectorized);
+}
+
+/**
+ * mono_simd_vectorize_loops:
+ * @cfg: Control Flow Graph
+ *
+ * Add a vector version of the simple counted loops of CFG, which processes 16 bytes of
+ * elements in each iteration, or 32 bytes with AVX2. This works on the bblock list, before the depth first
+ * ordering and SSA are computed, and after mono_abc_version_loops () has removed the
+ * bounds checks of the loops.
+ */
+void
+mono_simd_vectorize_loops (MonoCompile *cfg)
+{
+	VectorLoop loop;
+	MonoBasicBlock *bb;
+	int nbblocks = cfg->num_bblocks;
+
+	if (!(simd_supported_versions & SIMD_VERSION_SSE2) || cfg->gen_sdb_seq_points || nbblocks > 1000)
+		return;
+
+	memset (&loop, 0, sizeof (loop));
+	loop.cfg = cfg;
+	loop.vals = g_hash_table_new (NULL, NULL);
+	loop.reductions = g_hash_table_new (NULL, NULL);
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		/* Skip the bblocks created by vectorization */
+		if (bb->block_num >= nbblocks)
+			continue;
+		if (!vector_find_loop (&loop, bb) || !vector_check_condition (&loop) || !vector_check_body (&loop))
+			continue;
+
+		DEBUG (printf ("[simd-vectorize] loop BB%d with induction variable R%d, %d lanes\n", bb->block_num, loop.iv_reg, loop.width));
+		vector_emit_loop (&loop);
+	}
+
+	g_hash_table_destroy (loop.vals);
+	g_hash_table_destroy (loop.reductions);
+}
+
 #endif /* DISABLE_JIT */
 #endif /* MONO_ARCH_SIMD_INTRINSICS */
@@ -1343,107 +1343,1333 @@ mono_ssa_strength_reduction (MonoCompile *cfg)
 }
 #endif
 
+/*
+ * Loop invariant code motion
+ *
+ *   Instructions whose operands are all defined outside a loop are moved to the
+ * preheader of the loop, i.e. the only predecessor of the loop header outside the loop,
+ * which is created if needed. Loops are processed innermost first, so code hoisted out
+ * of an inner loop can be hoisted out of the enclosing loops as well.
+ * Instructions which can fault or have side effects, like loads, are only moved if
+ * they are executed in the first iteration of the loop before anything else with a
+ * side effect. Loads are only moved if nothing in the loop can store to the memory
+ * they read, using the base register and offset of the stores to tell them apart.
+ */
+
+typedef enum {
+	LICM_NONE,
+	/* Can be executed speculatively */
+	LICM_PURE,
+	/* Can fault or has side effects */
+	LICM_GUARDED,
+	/* Reads memory */
+	LICM_LOAD
+} LicmKind;
+
+typedef struct {
+	/* Indexed by vreg */
+	MonoBasicBlock **def_bb;
+	MonoInst **def_ins;
+	guint8 *def_count;
+	guint8 *use_count;
+	int vregs_size;
+	/* Indexed by block_num, only valid for the loop being processed */
+	gboolean *in_loop;
+	gboolean *clean_out;
+	int *rpo_index;
+	GPtrArray *rpo;
+	GPtrArray *stores;
+	/* Whenever the loop contains an instruction which can write to any memory */
+	gboolean clobbers_memory;
+} LicmContext;
+
+static int
+licm_load_size (int opcode)
+{
+	switch (opcode) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+		return 1;
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+		return 2;
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADR4_MEMBASE:
+		return 4;
+	case OP_LOADI8_MEMBASE:
+	case OP_LOADR8_MEMBASE:
+		return 8;
+	case OP_LOAD_MEMBASE:
+		return SIZEOF_VOID_P;
+	default:
+		return 0;
+	}
+}
+
+static int
+licm_store_size (int opcode)
+{
+	switch (opcode) {
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+		return 1;
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_IMM:
+		return 2;
+	case OP_STOREI4_MEMBASE_REG:
+	case OP_STOREI4_MEMBASE_IMM:
+	case OP_STORER4_MEMBASE_REG:
+		return 4;
+	case OP_STOREI8_MEMBASE_REG:
+	case OP_STOREI8_MEMBASE_IMM:
+	case OP_STORER8_MEMBASE_REG:
+		return 8;
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		return SIZEOF_VOID_P;
+	default:
+		return 0;
+	}
+}
+
+static gboolean
+licm_is_const (MonoInst *ins)
+{
+	return ins->opcode == OP_ICONST || ins->opcode == OP_I8CONST || ins->opcode == OP_R8CONST || ins->opcode == OP_R4CONST;
+}
+
+static LicmKind
+licm_get_kind (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_MOVE:
+	case OP_FMOVE:
+	case OP_RMOVE:
+	case OP_AOTCONST:
+	case OP_IADD:
+	case OP_ISUB:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_ISHL:
+	case OP_ISHR:
+	case OP_ISHR_UN:
+	case OP_INEG:
+	case OP_INOT:
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+	case OP_IMUL_IMM:
+	case OP_IAND_IMM:
+	case OP_IOR_IMM:
+	case OP_IXOR_IMM:
+	case OP_ISHL_IMM:
+	case OP_ISHR_IMM:
+	case OP_ISHR_UN_IMM:
+	case OP_ICONV_TO_I1:
+	case OP_ICONV_TO_U1:
+	case OP_ICONV_TO_I2:
+	case OP_ICONV_TO_U2:
+	case OP_SEXT_I4:
+	case OP_ZEXT_I4:
+	case OP_ICONV_TO_R8:
+	case OP_FADD:
+	case OP_FSUB:
+	case OP_FMUL:
+	case OP_FNEG:
+	case OP_RADD:
+	case OP_RSUB:
+	case OP_RMUL:
+	case OP_RNEG:
+#if SIZEOF_REGISTER == 8
+	case OP_LADD:
+	case OP_LSUB:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+	case OP_LSHL:
+	case OP_LSHR:
+	case OP_LSHR_UN:
+	case OP_LNEG:
+	case OP_LNOT:
+	case OP_LADD_IMM:
+	case OP_LSUB_IMM:
+	case OP_LMUL_IMM:
+	case OP_LAND_IMM:
+	case OP_LOR_IMM:
+	case OP_LXOR_IMM:
+	case OP_LSHL_IMM:
+	case OP_LSHR_IMM:
+	case OP_LSHR_UN_IMM:
+	case OP_LCONV_TO_I1:
+	case OP_LCONV_TO_U1:
+	case OP_LCONV_TO_I2:
+	case OP_LCONV_TO_U2:
+	case OP_LCONV_TO_I4:
+	case OP_LCONV_TO_U4:
+#endif
+		return LICM_PURE;
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_CHECK_THIS:
+	case OP_GENERIC_CLASS_INIT:
+		return LICM_GUARDED;
+	default:
+		if (licm_load_size (ins->opcode))
+			return LICM_LOAD;
+		return LICM_NONE;
+	}
+}
+
+/*
+ * licm_has_side_effect:
+ *
+ *   Return whenever INS can fault or has an effect visible outside the method. Such
+ * instructions can't be reordered with a hoisted instruction which can fault.
+ */
+static gboolean
+licm_has_side_effect (MonoInst *ins)
+{
+	if (MONO_INS_HAS_NO_SIDE_EFFECT (ins) || licm_is_const (ins) || licm_get_kind (ins) == LICM_PURE)
+		return FALSE;
+	if (MONO_IS_BRANCH_OP (ins) || MONO_IS_SETCC (ins))
+		return FALSE;
+	switch (ins->opcode) {
+	case OP_COMPARE:
+	case OP_COMPARE_IMM:
+	case OP_ICOMPARE:
+	case OP_ICOMPARE_IMM:
+	case OP_LCOMPARE:
+	case OP_LCOMPARE_IMM:
+	case OP_FCOMPARE:
+	case OP_RCOMPARE:
+		return FALSE;
+	default:
+		break;
+	}
+	/* Loads which can't fault */
+	if (licm_load_size (ins->opcode) && !(ins->flags & MONO_INST_FAULT))
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * licm_may_write_memory:
+ *
+ *   Return whenever INS can write to memory other than the one described by a
+ * store membase instruction.
+ */
+static gboolean
+licm_may_write_memory (MonoInst *ins)
+{
+	if (licm_store_size (ins->opcode) || !licm_has_side_effect (ins))
+		return FALSE;
+	if (licm_load_size (ins->opcode) || MONO_IS_COND_EXC (ins))
+		return FALSE;
+	switch (ins->opcode) {
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_CHECK_THIS:
+	case OP_BOUNDS_CHECK:
+	case OP_NOT_NULL:
+	/* Only writes the card table */
+	case OP_CARD_TABLE_WBARRIER:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+static void
+licm_ensure_vreg (LicmContext *ctx, int vreg)
+{
+	int new_size;
+
+	if (vreg < ctx->vregs_size)
+		return;
+	new_size = MAX (ctx->vregs_size * 2, vreg + 1);
+	ctx->def_bb = g_renew (MonoBasicBlock*, ctx->def_bb, new_size);
+	ctx->def_ins = g_renew (MonoInst*, ctx->def_ins, new_size);
+	ctx->def_count = g_renew (guint8, ctx->def_count, new_size);
+	ctx->use_count = g_renew (guint8, ctx->use_count, new_size);
+	memset (ctx->def_bb + ctx->vregs_size, 0, (new_size - ctx->vregs_size) * sizeof (MonoBasicBlock*));
+	memset (ctx->def_ins + ctx->vregs_size, 0, (new_size - ctx->vregs_size) * sizeof (MonoInst*));
+	memset (ctx->def_count + ctx->vregs_size, 0, new_size - ctx->vregs_size);
+	memset (ctx->use_count + ctx->vregs_size, 0, new_size - ctx->vregs_size);
+	ctx->vregs_size = new_size;
+}
+
+static void
+licm_compute_defs (MonoCompile *cfg, LicmContext *ctx)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int i, num_sregs;
+	int sregs [MONO_MAX_SRC_REGS];
+
+	licm_ensure_vreg (ctx, cfg->next_vreg);
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (ins->opcode == OP_NOP)
+				continue;
+			if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && ins->dreg != -1) {
+				if (ctx->def_count [ins->dreg] < 2)
+					ctx->def_count [ins->dreg] ++;
+				ctx->def_bb [ins->dreg] = bb;
+				ctx->def_ins [ins->dreg] = ins;
+			}
+			if (MONO_IS_STORE_MEMBASE (ins) && ctx->use_count [ins->dreg] < 2)
+				ctx->use_count [ins->dreg] ++;
+			num_sregs = mono_inst_get_src_registers (ins, sregs);
+			for (i = 0; i < num_sregs; ++i) {
+				if (ctx->use_count [sregs [i]] < 2)
+					ctx->use_count [sregs [i]] ++;
+			}
+		}
+	}
+}
+
+/*
+ * licm_get_preheader:
+ *
+ *   Return the preheader of the loop headed by H, creating it if needed. Return NULL if
+ * the loop can't have one, i.e. it has more than one entry edge, or its entry crosses
+ * an exception handling region.
+ */
+static MonoBasicBlock*
+licm_get_preheader (MonoCompile *cfg, MonoBasicBlock *h)
+{
+	MonoBasicBlock *pred = NULL, *pre, *prev, **bblocks;
+	MonoInst *jump;
+	GSList *l;
+	int i;
+
+	for (i = 0; i < h->in_count; ++i) {
+		if (!g_list_find (h->loop_blocks, h->in_bb [i])) {
+			if (pred)
+				return NULL;
+			pred = h->in_bb [i];
+		}
+	}
+	if (!pred || pred->region != h->region)
+		return NULL;
+
+	if (pred != cfg->bb_entry && pred->out_count == 1 && (!pred->last_ins || pred->last_ins->opcode == OP_BR || !MONO_IS_BRANCH_OP (pred->last_ins)))
+		return pred;
+
+	/* The new bblock is placed right before H, so it falls through into it */
+	for (prev = cfg->bb_entry; prev && prev->next_bb != h; prev = prev->next_bb)
+		;
+	if (!prev || prev->region != h->region)
+		return NULL;
+	if (prev != pred && prev->last_ins && MONO_IS_COND_BRANCH_OP (prev->last_ins) && !prev->last_ins->inst_false_bb) {
+		prev->last_ins->inst_false_bb = h;
+	} else if (prev != pred && (!prev->last_ins || !MONO_IS_BRANCH_OP (prev->last_ins))) {
+		for (i = 0; i < prev->out_count; ++i) {
+			if (prev->out_bb [i] == h)
+				break;
+		}
+		if (i < prev->out_count) {
+			if (prev == cfg->bb_entry)
+				return NULL;
+			MONO_INST_NEW (cfg, jump, OP_BR);
+			jump->inst_target_bb = h;
+			MONO_ADD_INS (prev, jump);
+		}
+	}
+
+	pre = mono_split_edge (cfg, pred, h);
+	pre->block_num = cfg->max_block_num ++;
+	pre->nesting = h->nesting - 1;
+	prev->next_bb = pre;
+	pre->next_bb = h;
+
+	/* Add it to the depth first ordering */
+	bblocks = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * (cfg->num_bblocks + 2));
+	memcpy (bblocks, cfg->bblocks, sizeof (MonoBasicBlock*) * cfg->num_bblocks);
+	cfg->bblocks = bblocks;
+	pre->dfn = cfg->num_bblocks;
+	cfg->bblocks [cfg->num_bblocks ++] = pre;
+
+	/* Update the dominator tree */
+	pre->idom = h->idom;
+	for (l = h->idom->dominated; l; l = l->next) {
+		if (l->data == h)
+			l->data = pre;
+	}
+	pre->dominated = g_slist_prepend_mempool (cfg->mempool, NULL, h);
+	h->idom = pre;
+
+	/* The preheader belongs to the loops enclosing the loop of H */
+	for (i = 0; i < cfg->num_bblocks; ++i) {
+		MonoBasicBlock *bb = cfg->bblocks [i];
+
+		if (bb != h && bb->loop_blocks && g_list_find (bb->loop_blocks, h) && g_list_find (bb->loop_blocks, pred))
+			bb->loop_blocks = g_list_prepend_mempool (cfg->mempool, bb->loop_blocks, pre);
+	}
+
+	if (cfg->verbose_level > 1)
+		printf ("licm: created preheader BB%d for loop BB%d\n", pre->block_num, h->block_num);
+
+	return pre;
+}
+
+static void
+licm_rpo_visit (LicmContext *ctx, MonoBasicBlock *h, MonoBasicBlock *bb, gboolean *visited)
+{
+	int i;
+
+	visited [bb->block_num] = TRUE;
+	for (i = 0; i < bb->out_count; ++i) {
+		MonoBasicBlock *succ = bb->out_bb [i];
+
+		if (succ != h && ctx->in_loop [succ->block_num] && !visited [succ->block_num])
+			licm_rpo_visit (ctx, h, succ, visited);
+	}
+	g_ptr_array_add (ctx->rpo, bb);
+}
+
+/*
+ * licm_is_invariant:
+ *
+ *   Return whenever the value of SREG doesn't change inside the current loop. If it is
+ * defined by a constant in the loop, which can be moved along with its only user,
+ * *CONST_INS is set to the constant.
+ */
+static gboolean
+licm_is_invariant (MonoCompile *cfg, LicmContext *ctx, int sreg, MonoInst **const_ins)
+{
+	MonoInst *var = get_vreg_to_inst (cfg, sreg);
+	MonoInst *def;
+
+	*const_ins = NULL;
+	/* Hard registers */
+	if (sreg < MONO_MAX_IREGS || sreg < MONO_MAX_FREGS)
+		return FALSE;
+	if (var && (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))
+		return FALSE;
+	if (sreg >= ctx->vregs_size || ctx->def_count [sreg] == 0)
+		return TRUE;
+	if (ctx->def_count [sreg] > 1)
+		return FALSE;
+	if (!ctx->in_loop [ctx->def_bb [sreg]->block_num])
+		return TRUE;
+	def = ctx->def_ins [sreg];
+	if (!var && licm_is_const (def) && ctx->use_count [sreg] == 1) {
+		*const_ins = def;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+licm_load_is_clobbered (LicmContext *ctx, MonoInst *load)
+{
+	int size = licm_load_size (load->opcode);
+	int i;
+
+	if (load->flags & MONO_INST_INVARIANT_LOAD)
+		return FALSE;
+	if (ctx->clobbers_memory)
+		return TRUE;
+	for (i = 0; i < ctx->stores->len; ++i) {
+		MonoInst *store = g_ptr_array_index (ctx->stores, i);
+
+		if (store->inst_destbasereg != load->inst_basereg)
+			return TRUE;
+		if (!(store->inst_offset + licm_store_size (store->opcode) <= load->inst_offset || load->inst_offset + size <= store->inst_offset))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+licm_insert (MonoBasicBlock *pre, MonoInst *ins)
+{
+	if (pre->last_ins && MONO_IS_BRANCH_OP (pre->last_ins))
+		mono_bblock_insert_before_ins (pre, pre->last_ins, ins);
+	else
+		mono_bblock_insert_after_ins (pre, pre->last_ins, ins);
+}
+
+/*
+ * licm_try_hoist:
+ *
+ *   Move INS from BB to the preheader PRE if it is loop invariant. SAFE specifies
+ * whenever instructions which can fault can be moved.
+ */
+static gboolean
+licm_try_hoist (MonoCompile *cfg, LicmContext *ctx, MonoBasicBlock *bb, MonoInst *ins, MonoBasicBlock *pre, gboolean safe)
+{
+	LicmKind kind = licm_get_kind (ins);
+	const char *spec = INS_INFO (ins->opcode);
+	MonoInst *consts [MONO_MAX_SRC_REGS];
+	MonoInst *var = NULL, *const_ins, *move;
+	int sregs [MONO_MAX_SRC_REGS];
+	int i, num_sregs, nconsts, move_op = OP_NOP;
+
+	if (kind == LICM_NONE)
+		return FALSE;
+	if (kind != LICM_PURE && !safe)
+		return FALSE;
+	if (kind == LICM_LOAD && licm_load_is_clobbered (ctx, ins))
+		return FALSE;
+
+	nconsts = 0;
+	num_sregs = mono_inst_get_src_registers (ins, sregs);
+	for (i = 0; i < num_sregs; ++i) {
+		if (!licm_is_invariant (cfg, ctx, sregs [i], &const_ins))
+			return FALSE;
+		if (const_ins)
+			consts [nconsts ++] = const_ins;
+	}
+
+	if (spec [MONO_INST_DEST] != ' ') {
+		if (ins->dreg < MONO_MAX_IREGS || ins->dreg < MONO_MAX_FREGS)
+			return FALSE;
+		if (ins->dreg >= ctx->vregs_size || ctx->def_count [ins->dreg] != 1)
+			return FALSE;
+		var = get_vreg_to_inst (cfg, ins->dreg);
+		if (var) {
+			/* Moving a copy out of the loop would only add another copy */
+			if ((var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) || MONO_IS_MOVE (ins))
+				return FALSE;
+			move_op = mono_type_to_regmove (cfg, var->inst_vtype);
+			if (move_op == OP_VMOVE || move_op == OP_XMOVE)
+				return FALSE;
+		}
+	}
+
+	if (cfg->verbose_level > 1) {
+		printf ("licm in BB%d to BB%d on ", bb->block_num, pre->block_num);
+		mono_print_ins (ins);
+	}
+
+	for (i = 0; i < nconsts; ++i) {
+		MONO_REMOVE_INS (ctx->def_bb [consts [i]->dreg], consts [i]);
+		licm_insert (pre, consts [i]);
+		ctx->def_bb [consts [i]->dreg] = pre;
+	}
+
+	if (var) {
+		/*
+		 * Moving the definition of an SSA variable would extend its live range, which
+		 * prevents mono_ssa_remove () from coalescing it with the other versions of the
+		 * variable, so compute the value into a new vreg and copy it inside the loop.
+		 */
+		int dreg = mono_alloc_dreg (cfg, var->type);
+
+		licm_ensure_vreg (ctx, dreg);
+		MONO_INST_NEW (cfg, move, move_op);
+		move->dreg = ins->dreg;
+		move->sreg1 = dreg;
+		mono_bblock_insert_after_ins (bb, ins, move);
+		ctx->def_ins [ins->dreg] = move;
+		ins->dreg = dreg;
+		ctx->def_count [dreg] = 1;
+		ctx->use_count [dreg] = 1;
+		ctx->def_ins [dreg] = ins;
+	}
+
+	MONO_REMOVE_INS (bb, ins);
+	licm_insert (pre, ins);
+	if (spec [MONO_INST_DEST] != ' ')
+		ctx->def_bb [ins->dreg] = pre;
+	if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN)
+		pre->has_array_access = TRUE;
+
+	return TRUE;
+}
+
+static void
+licm_process_loop (MonoCompile *cfg, LicmContext *ctx, MonoBasicBlock *h)
+{
+	MonoBasicBlock *pre, *bb;
+	MonoInst *ins, *n;
+	GList *l;
+	GPtrArray *exits;
+	gboolean *visited;
+	int i, j;
+
+	pre = licm_get_preheader (cfg, h);
+	if (!pre)
+		return;
+
+	ctx->in_loop = g_new0 (gboolean, cfg->max_block_num);
+	ctx->clean_out = g_new0 (gboolean, cfg->max_block_num);
+	ctx->rpo_index = g_new0 (int, cfg->max_block_num);
+	visited = g_new0 (gboolean, cfg->max_block_num);
+	ctx->rpo = g_ptr_array_new ();
+	ctx->stores = g_ptr_array_new ();
+	ctx->clobbers_memory = FALSE;
+	exits = g_ptr_array_new ();
+
+	for (l = h->loop_blocks; l; l = l->next)
+		ctx->in_loop [((MonoBasicBlock*)l->data)->block_num] = TRUE;
+
+	for (l = h->loop_blocks; l; l = l->next) {
+		bb = l->data;
+
+		for (i = 0; i < bb->out_count; ++i) {
+			if (!ctx->in_loop [bb->out_bb [i]->block_num]) {
+				g_ptr_array_add (exits, bb);
+				break;
+			}
+		}
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (licm_store_size (ins->opcode))
+				g_ptr_array_add (ctx->stores, ins);
+			else if (licm_may_write_memory (ins))
+				ctx->clobbers_memory = TRUE;
+		}
+	}
+
+	/* Process the loop in reverse postorder, so the predecessors of a bblock come before it, except for back edges */
+	licm_rpo_visit (ctx, h, h, visited);
+	for (i = 0; i < ctx->rpo->len; ++i) {
+		bb = g_ptr_array_index (ctx->rpo, ctx->rpo->len - i - 1);
+		ctx->rpo_index [bb->block_num] = i;
+	}
+
+	for (i = 0; i < ctx->rpo->len; ++i) {
+		gboolean clean, dominates_exits;
+
+		bb = g_ptr_array_index (ctx->rpo, ctx->rpo->len - i - 1);
+
+		/*
+		 * CLEAN is TRUE if nothing with a side effect is executed between the start of an
+		 * iteration and the current instruction.
+		 */
+		clean = TRUE;
+		if (bb != h) {
+			for (j = 0; j < bb->in_count; ++j) {
+				MonoBasicBlock *in_bb = bb->in_bb [j];
+
+				if (!ctx->in_loop [in_bb->block_num] || ctx->rpo_index [in_bb->block_num] >= i || !ctx->clean_out [in_bb->block_num])
+					clean = FALSE;
+			}
+		}
+
+		/* Instructions which can fault are only moved if they are executed in every iteration */
+		dominates_exits = bb == h || exits->len > 0;
+		for (j = 0; j < exits->len && dominates_exits; ++j) {
+			MonoBasicBlock *dom = g_ptr_array_index (exits, j);
+
+			while (dom && dom != bb && dom != h)
+				dom = dom->idom;
+			if (dom != bb)
+				dominates_exits = FALSE;
+		}
+
+		MONO_BB_FOR_EACH_INS_SAFE (bb, n, ins) {
+			if (licm_try_hoist (cfg, ctx, bb, ins, pre, clean && dominates_exits && bb->region == pre->region))
+				continue;
+			if (clean && licm_has_side_effect (ins))
+				clean = FALSE;
+		}
+		ctx->clean_out [bb->block_num] = clean;
+	}
+
+	g_ptr_array_free (exits, TRUE);
+	g_ptr_array_free (ctx->rpo, TRUE);
+	g_ptr_array_free (ctx->stores, TRUE);
+	g_free (visited);
+	g_free (ctx->rpo_index);
+	g_free (ctx->clean_out);
+	g_free (ctx->in_loop);
+}
+
+static int
+compare_loop_nesting (const void *a, const void *b)
+{
+	MonoBasicBlock *bb1 = *(MonoBasicBlock**)a;
+	MonoBasicBlock *bb2 = *(MonoBasicBlock**)b;
+
+	return bb2->nesting - bb1->nesting;
+}
+
 void
 mono_ssa_loop_invariant_code_motion (MonoCompile *cfg)
 {
-	MonoBasicBlock *bb, *h, *idom;
-	MonoInst *ins, *n, *tins;
+	LicmContext ctx;
+	GPtrArray *headers;
 	int i;
 
 	g_assert (cfg->comp_done & MONO_COMP_SSA);
-	if (!(cfg->comp_done & MONO_COMP_LOOPS) || !(cfg->comp_done & MONO_COMP_SSA_DEF_USE))
+	if (!(cfg->comp_done & MONO_COMP_LOOPS) || !(cfg->comp_done & MONO_COMP_IDOM))
 		return;
 
-	for (bb = cfg->bb_entry->next_bb; bb; bb = bb->next_bb) {
-		GList *lp = bb->loop_blocks;
+	headers = g_ptr_array_new ();
+	for (i = 0; i < cfg->num_bblocks; ++i) {
+		MonoBasicBlock *bb = cfg->bblocks [i];
 
-		if (!lp)
-			continue;
-		h = (MonoBasicBlock *)lp->data;
-		if (bb != h)
-			continue;
-		MONO_BB_FOR_EACH_INS_SAFE (bb, n, ins) {
+		/*
+		 * The nesting check is needed to work around:
+		 * http://llvm.org/bugs/show_bug.cgi?id=17868
+		 */
+		if (bb->loop_blocks && bb != cfg->bb_entry && !(COMPILE_LLVM (cfg) && bb->nesting != 1))
+			g_ptr_array_add (headers, bb);
+	}
+
+	if (headers->len) {
+		memset (&ctx, 0, sizeof (ctx));
+		licm_compute_defs (cfg, &ctx);
+
+		/* Innermost loops first */
+		qsort (headers->pdata, headers->len, sizeof (gpointer), compare_loop_nesting);
+		for (i = 0; i < headers->len; ++i)
+			licm_process_loop (cfg, &ctx, g_ptr_array_index (headers, i));
+
+		g_free (ctx.def_bb);
+		g_free (ctx.def_ins);
+		g_free (ctx.def_count);
+		g_free (ctx.use_count);
+	}
+	g_ptr_array_free (headers, TRUE);
+
+	cfg->comp_done &=  ~MONO_COMP_SSA_DEF_USE;
+	for (i = 0; i < cfg->num_varinfo; i++) {
+		MonoMethodVar *info = MONO_VARINFO (cfg, i);
+		info->def = NULL;
+		info->uses = NULL;
+	}
+}
+
+/*
+ * Global value numbering
+ *
+ *   Instructions which compute the same value as an instruction in a dominating bblock
+ * are replaced by a copy of its result. The dominator tree is walked in preorder, with a
+ * scoped table of the available expressions. Loads are only considered equal if no
+ * instruction can write to memory between them, which is tracked using a memory
+ * generation number: it changes after every store or call, and at the start of every
+ * bblock which can be reached from somewhere other than its immediate dominator.
+ * Redundant null, bounds and class init checks are removed.
+ */
+
+typedef struct {
+	MonoInst *ins;
+	MonoBasicBlock *bb;
+	int mem_gen;
+} GvnValue;
+
+typedef struct {
+	GHashTable *values;
+	/* Stack of the values added by the bblocks currently being processed */
+	GPtrArray *scope;
+	/* Indexed by vreg */
+	guint8 *def_count;
+	int vregs_size;
+	/* Indexed by block_num */
+	int *mem_gen_out;
+	int mem_gen, next_mem_gen;
+	int num_replaced;
+} GvnContext;
+
+static guint
+gvn_value_hash (gconstpointer key)
+{
+	const GvnValue *v = key;
+	MonoInst *ins = v->ins;
+
+	return ins->opcode ^ (ins->sreg1 << 5) ^ (ins->sreg2 << 11) ^ (ins->sreg3 << 17) ^ (guint)ins->inst_c0 ^ ((guint)ins->inst_c1 << 3) ^ (v->mem_gen << 23);
+}
+
+static gboolean
+gvn_value_equal (gconstpointer ka, gconstpointer kb)
+{
+	const GvnValue *a = ka;
+	const GvnValue *b = kb;
+
+	return a->ins->opcode == b->ins->opcode && a->mem_gen == b->mem_gen &&
+		a->ins->sreg1 == b->ins->sreg1 && a->ins->sreg2 == b->ins->sreg2 && a->ins->sreg3 == b->ins->sreg3 &&
+		a->ins->inst_c0 == b->ins->inst_c0 && a->ins->inst_c1 == b->ins->inst_c1;
+}
+
+/*
+ * gvn_get_move_op:
+ *
+ *   Return the opcode used to copy the result of INS, or -1 if it can't be value numbered.
+ */
+static int
+gvn_get_move_op (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_FADD:
+	case OP_FSUB:
+	case OP_FMUL:
+	case OP_FNEG:
+	case OP_ICONV_TO_R8:
+	case OP_LOADR8_MEMBASE:
+		return OP_FMOVE;
+	case OP_RADD:
+	case OP_RSUB:
+	case OP_RMUL:
+	case OP_RNEG:
+	case OP_LOADR4_MEMBASE:
+		/* The result is either a float or a double depending on the float32 option */
+		return -1;
+	default:
+		break;
+	}
+	switch (INS_INFO (ins->opcode) [MONO_INST_DEST]) {
+	case 'i':
+		return OP_MOVE;
+#if SIZEOF_REGISTER == 8
+	case 'l':
+		return OP_MOVE;
+#endif
+	default:
+		return -1;
+	}
+}
+
+static gboolean
+gvn_is_check (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_CHECK_THIS:
+	case OP_NOT_NULL:
+	case OP_BOUNDS_CHECK:
+	case OP_GENERIC_CLASS_INIT:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+gvn_reg_is_value (MonoCompile *cfg, GvnContext *ctx, int vreg)
+{
+	if (vreg < MONO_MAX_IREGS || vreg < MONO_MAX_FREGS)
+		return FALSE;
+	if (vreg_is_volatile (cfg, vreg))
+		return FALSE;
+	return vreg >= ctx->vregs_size || ctx->def_count [vreg] <= 1;
+}
+
+static void
+gvn_process_bb (MonoCompile *cfg, GvnContext *ctx, MonoBasicBlock *bb)
+{
+	MonoInst *ins;
+	GvnValue key, *value;
+	GSList *l;
+	int i, num_sregs, move_op, scope_len;
+	int sregs [MONO_MAX_SRC_REGS];
+
+	if (bb->idom && bb->in_count == 1 && bb->in_bb [0] == bb->idom)
+		ctx->mem_gen = ctx->mem_gen_out [bb->idom->block_num];
+	else
+		ctx->mem_gen = ++ctx->next_mem_gen;
+	scope_len = ctx->scope->len;
+
+	MONO_BB_FOR_EACH_INS (bb, ins) {
+		LicmKind kind = licm_get_kind (ins);
+		gboolean check = gvn_is_check (ins);
+		gboolean is_value = TRUE;
+
+		if (check || kind == LICM_GUARDED) {
+			/* Handled below */
+		} else if (kind == LICM_PURE || kind == LICM_LOAD) {
+			if (MONO_IS_MOVE (ins) || (ins->flags & MONO_INST_VOLATILE))
+				is_value = FALSE;
+		} else {
+			is_value = FALSE;
+		}
+
+		move_op = check ? OP_NOP : gvn_get_move_op (ins);
+		if (move_op == -1)
+			is_value = FALSE;
+
+		if (is_value) {
+			num_sregs = mono_inst_get_src_registers (ins, sregs);
+			for (i = 0; i < num_sregs; ++i) {
+				if (!gvn_reg_is_value (cfg, ctx, sregs [i]))
+					is_value = FALSE;
+			}
+			if (!check && (ins->dreg < MONO_MAX_IREGS || ins->dreg < MONO_MAX_FREGS || vreg_is_volatile (cfg, ins->dreg) ||
+						   ins->dreg >= ctx->vregs_size || ctx->def_count [ins->dreg] != 1))
+				is_value = FALSE;
+		}
+
+		if (is_value) {
+			key.ins = ins;
+			key.bb = bb;
+			key.mem_gen = (kind == LICM_LOAD && !(ins->flags & MONO_INST_INVARIANT_LOAD)) ? ctx->mem_gen : 0;
+			value = g_hash_table_lookup (ctx->values, &key);
+			if (value && value->bb->region == bb->region) {
+				if (cfg->verbose_level > 1) {
+					printf ("gvn in BB%d: R%d is redundant with the result of BB%d: ", bb->block_num, ins->dreg, value->bb->block_num);
+					mono_print_ins (ins);
+				}
+				if (check) {
+					NULLIFY_INS (ins);
+				} else {
+					ins->opcode = move_op;
+					ins->sreg1 = value->ins->dreg;
+					ins->sreg2 = -1;
+					ins->sreg3 = -1;
+					ins->inst_c0 = 0;
+					ins->inst_c1 = 0;
+					ins->flags = 0;
+				}
+				ctx->num_replaced ++;
+				continue;
+			}
 			/*
-			 * Try to move instructions out of loop headers into the preceeding bblock.
+			 * SSA versions of variables are coalesced again by mono_ssa_remove (), so their
+			 * live ranges can't be extended.
 			 */
-			if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN || ins->opcode == OP_CHECK_THIS || ins->opcode == OP_AOTCONST || ins->opcode == OP_GENERIC_CLASS_INIT) {
-				gboolean skip;
-				int sreg;
-
-				idom = h->idom;
-				/*
-				 * h->nesting is needed to work around:
-				 * http://llvm.org/bugs/show_bug.cgi?id=17868
-				 */
-				if (!(idom && idom->last_ins && idom->last_ins->opcode == OP_BR && idom->last_ins->inst_target_bb == h && h->nesting == 1)) {
-					continue;
-				}
+			if (!value && (check || !get_vreg_to_inst (cfg, ins->dreg))) {
+				value = mono_mempool_alloc (cfg->mempool, sizeof (GvnValue));
+				*value = key;
+				g_hash_table_insert (ctx->values, value, value);
+				g_ptr_array_add (ctx->scope, value);
+			}
+		}
 
-				/*
-				 * Make sure there are no instructions with side effects before ins.
-				 */
-				skip = FALSE;
-				MONO_BB_FOR_EACH_INS (bb, tins) {
-					if (tins == ins)
-						break;
-					if (!MONO_INS_HAS_NO_SIDE_EFFECT (tins)) {
-						skip = TRUE;
-						break;
-					}
+		if (licm_store_size (ins->opcode) || licm_may_write_memory (ins))
+			ctx->mem_gen = ++ctx->next_mem_gen;
+	}
+
+	ctx->mem_gen_out [bb->block_num] = ctx->mem_gen;
+
+	for (l = bb->dominated; l; l = l->next)
+		gvn_process_bb (cfg, ctx, l->data);
+
+	/* Leave the scope of BB */
+	for (i = ctx->scope->len - 1; i >= scope_len; --i)
+		g_hash_table_remove (ctx->values, g_ptr_array_index (ctx->scope, i));
+	g_ptr_array_set_size (ctx->scope, scope_len);
+}
+
+/*
+ * mono_ssa_gvn:
+ *
+ *   Eliminate redundant computations using dominator based global value numbering.
+ */
+void
+mono_ssa_gvn (MonoCompile *cfg)
+{
+	GvnContext ctx;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+	if (!(cfg->comp_done & MONO_COMP_IDOM))
+		return;
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.vregs_size = cfg->next_vreg;
+	ctx.def_count = g_new0 (guint8, ctx.vregs_size);
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (ins->opcode != OP_NOP && spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && ins->dreg != -1 && ctx.def_count [ins->dreg] < 2)
+				ctx.def_count [ins->dreg] ++;
+		}
+	}
+	ctx.values = g_hash_table_new (gvn_value_hash, gvn_value_equal);
+	ctx.scope = g_ptr_array_new ();
+	ctx.mem_gen_out = g_new0 (int, MAX (cfg->max_block_num, cfg->num_bblocks) + 1);
+	/* Generation 0 is used by loads which don't depend on the state of memory */
+	ctx.next_mem_gen = 1;
+
+	gvn_process_bb (cfg, &ctx, cfg->bb_entry);
+
+	if (cfg->verbose_level > 1 && ctx.num_replaced)
+		printf ("gvn: removed %d redundant instructions\n", ctx.num_replaced);
+
+	g_hash_table_destroy (ctx.values);
+	g_ptr_array_free (ctx.scope, TRUE);
+	g_free (ctx.mem_gen_out);
+	g_free (ctx.def_count);
+}
+
+/*
+ * Escape analysis
+ *
+ *   Objects allocated by handle_alloc () whose references are only used in the basic
+ * block of the allocation to load and store their fields don't escape, so their fields
+ * can be kept in vregs. This removes the allocation along with the null checks and the
+ * write barriers of the stores. Objects used in more than one basic block are left
+ * alone since their fields would need phi nodes.
+ */
+
+#define ESCAPE_MAX_FIELDS 16
+
+typedef struct {
+	int offset;
+	int size;
+	gboolean is_float;
+	/* The vreg holding the current value of the field, or -1 if it is still zero */
+	int vreg;
+} EscapeField;
+
+typedef struct {
+	/* The references to the object and pointers derived from them */
+	GHashTable *aliases;
+	GHashTable *derived;
+	EscapeField fields [ESCAPE_MAX_FIELDS];
+	int nfields;
+	guint8 *def_count;
+	int vregs_size;
+} EscapeContext;
+
+static double r8_0 = 0.0;
+
+static gboolean
+escape_is_alias (EscapeContext *ctx, int vreg)
+{
+	return g_hash_table_lookup (ctx->aliases, GINT_TO_POINTER (vreg)) != NULL;
+}
+
+static gboolean
+escape_is_derived (EscapeContext *ctx, int vreg)
+{
+	return g_hash_table_lookup (ctx->derived, GINT_TO_POINTER (vreg)) != NULL;
+}
+
+static gboolean
+escape_is_store_imm (int opcode)
+{
+	switch (opcode) {
+	case OP_STOREI1_MEMBASE_IMM:
+	case OP_STOREI2_MEMBASE_IMM:
+	case OP_STOREI4_MEMBASE_IMM:
+	case OP_STOREI8_MEMBASE_IMM:
+	case OP_STORE_MEMBASE_IMM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+escape_is_float_access (int opcode)
+{
+	return opcode == OP_LOADR8_MEMBASE || opcode == OP_STORER8_MEMBASE_REG;
+}
+
+/*
+ * escape_add_field:
+ *
+ *   Record an access of SIZE bytes at OFFSET, returning FALSE if it overlaps other
+ * fields or accesses the same field differently.
+ */
+static gboolean
+escape_add_field (EscapeContext *ctx, int offset, int size, gboolean is_float)
+{
+	EscapeField *field;
+	int i;
+
+	if (offset < (int)sizeof (MonoObject))
+		return FALSE;
+
+	for (i = 0; i < ctx->nfields; ++i) {
+		field = &ctx->fields [i];
+		if (field->offset == offset)
+			return field->size == size && field->is_float == is_float;
+		if (offset < field->offset + field->size && field->offset < offset + size)
+			return FALSE;
+	}
+	if (ctx->nfields == ESCAPE_MAX_FIELDS)
+		return FALSE;
+	field = &ctx->fields [ctx->nfields ++];
+	field->offset = offset;
+	field->size = size;
+	field->is_float = is_float;
+	field->vreg = -1;
+	return TRUE;
+}
+
+static EscapeField*
+escape_get_field (EscapeContext *ctx, int offset)
+{
+	int i;
+
+	for (i = 0; i < ctx->nfields; ++i) {
+		if (ctx->fields [i].offset == offset)
+			return &ctx->fields [i];
+	}
+	g_assert_not_reached ();
+	return NULL;
+}
+
+static gboolean
+escape_reg_is_local (MonoCompile *cfg, EscapeContext *ctx, int vreg)
+{
+	return vreg >= MONO_MAX_IREGS && vreg < ctx->vregs_size && ctx->def_count [vreg] == 1 && !vreg_is_volatile (cfg, vreg);
+}
+
+static gboolean
+escape_ins_uses_aliases (EscapeContext *ctx, MonoInst *ins)
+{
+	int i, num_sregs;
+	int sregs [MONO_MAX_SRC_REGS];
+
+	num_sregs = mono_inst_get_src_registers (ins, sregs);
+	for (i = 0; i < num_sregs; ++i) {
+		if (escape_is_alias (ctx, sregs [i]) || escape_is_derived (ctx, sregs [i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+escape_phi_uses_aliases (EscapeContext *ctx, MonoInst *ins)
+{
+	int i;
+
+	if (!MONO_IS_PHI (ins))
+		return FALSE;
+	for (i = ins->inst_phi_args [0]; i > 0; i--) {
+		if (escape_is_alias (ctx, ins->inst_phi_args [i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * escape_check_uses:
+ *
+ *   Return whenever the object allocated by ALLOC in BB doesn't escape, collecting its
+ * aliases and its fields into CTX.
+ */
+static gboolean
+escape_check_uses (MonoCompile *cfg, EscapeContext *ctx, MonoInst *alloc)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int size;
+
+	if (!escape_reg_is_local (cfg, ctx, alloc->dreg))
+		return FALSE;
+	g_hash_table_insert (ctx->aliases, GINT_TO_POINTER (alloc->dreg), GINT_TO_POINTER (1));
+
+	for (ins = alloc->next; ins; ins = ins->next) {
+		if (escape_phi_uses_aliases (ctx, ins))
+			return FALSE;
+		if (!escape_ins_uses_aliases (ctx, ins))
+			continue;
+
+		if (ins->opcode == OP_MOVE) {
+			if (!escape_reg_is_local (cfg, ctx, ins->dreg))
+				return FALSE;
+			g_hash_table_insert (ctx->aliases, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (1));
+		} else if ((size = licm_load_size (ins->opcode)) && escape_is_alias (ctx, ins->inst_basereg)) {
+			/* LOADU4 doesn't match the representation of 32 bit values in 64 bit registers */
+			if (ins->opcode == OP_LOADR4_MEMBASE || (SIZEOF_REGISTER == 8 && ins->opcode == OP_LOADU4_MEMBASE))
+				return FALSE;
+			if (!escape_add_field (ctx, ins->inst_offset, size, escape_is_float_access (ins->opcode)))
+				return FALSE;
+		} else if ((size = licm_store_size (ins->opcode)) && escape_is_alias (ctx, ins->inst_destbasereg)) {
+			if (ins->opcode == OP_STORER4_MEMBASE_REG)
+				return FALSE;
+			/* Storing the reference itself makes it escape */
+			if (!escape_is_store_imm (ins->opcode) && (escape_is_alias (ctx, ins->sreg1) || escape_is_derived (ctx, ins->sreg1)))
+				return FALSE;
+			if (!escape_add_field (ctx, ins->inst_offset, size, escape_is_float_access (ins->opcode)))
+				return FALSE;
+		} else if ((ins->opcode == OP_PADD_IMM || ins->opcode == OP_ADD_IMM) && escape_is_alias (ctx, ins->sreg1)) {
+			/* The address of a field passed to a write barrier */
+			if (!escape_reg_is_local (cfg, ctx, ins->dreg))
+				return FALSE;
+			g_hash_table_insert (ctx->derived, GINT_TO_POINTER (ins->dreg), GINT_TO_POINTER (1));
+		} else if (ins->opcode == OP_CARD_TABLE_WBARRIER && escape_is_derived (ctx, ins->sreg1) && !escape_is_alias (ctx, ins->sreg2)) {
+		} else if ((ins->opcode == OP_CHECK_THIS || ins->opcode == OP_NOT_NULL || ins->opcode == OP_DUMMY_USE) && escape_is_alias (ctx, ins->sreg1)) {
+		} else {
+			return FALSE;
+		}
+	}
+
+	/* The aliases can't be used outside of the basic block of the allocation */
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			/* The uses following the allocation were checked above */
+			if (ins == alloc)
+				break;
+			if (escape_ins_uses_aliases (ctx, ins) || escape_phi_uses_aliases (ctx, ins))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * escape_replace_object:
+ *
+ *   Replace the fields of the object allocated by ALLOC with vregs, and remove the
+ * allocation.
+ */
+static void
+escape_replace_object (MonoCompile *cfg, EscapeContext *ctx, MonoInst *alloc)
+{
+	MonoInst *ins;
+	EscapeField *field;
+	int vreg;
+
+	for (ins = alloc->next; ins; ins = ins->next) {
+		if (ins->opcode == OP_NOP)
+			continue;
+		if (MONO_IS_PHI (ins))
+			continue;
+
+		if (ins->opcode == OP_MOVE && escape_is_alias (ctx, ins->sreg1)) {
+			NULLIFY_INS (ins);
+		} else if (licm_load_size (ins->opcode) && escape_is_alias (ctx, ins->inst_basereg)) {
+			field = escape_get_field (ctx, ins->inst_offset);
+			vreg = field->vreg;
+			ins->sreg1 = ins->sreg2 = -1;
+			ins->inst_offset = 0;
+			ins->flags = 0;
+			if (vreg == -1) {
+				/* Not yet stored, so still zero */
+				if (field->is_float) {
+					ins->opcode = OP_R8CONST;
+					ins->inst_p0 = &r8_0;
+				} else if (field->size == 8) {
+					ins->opcode = OP_I8CONST;
+					ins->inst_l = 0;
+				} else {
+					ins->opcode = OP_ICONST;
+					ins->inst_c0 = 0;
 				}
-				if (skip) {
-					/*
-					  printf ("%s\n", mono_method_full_name (cfg->method, TRUE));
-					  mono_print_ins (tins);
-					*/
-					continue;
+				continue;
+			}
+			switch (ins->opcode) {
+			case OP_LOADI1_MEMBASE:
+				ins->opcode = OP_ICONV_TO_I1;
+				break;
+			case OP_LOADU1_MEMBASE:
+				ins->opcode = OP_ICONV_TO_U1;
+				break;
+			case OP_LOADI2_MEMBASE:
+				ins->opcode = OP_ICONV_TO_I2;
+				break;
+			case OP_LOADU2_MEMBASE:
+				ins->opcode = OP_ICONV_TO_U2;
+				break;
+			case OP_LOADR8_MEMBASE:
+				ins->opcode = OP_FMOVE;
+				break;
+			default:
+				ins->opcode = OP_MOVE;
+				break;
+			}
+			ins->sreg1 = vreg;
+		} else if (licm_store_size (ins->opcode) && escape_is_alias (ctx, ins->inst_destbasereg)) {
+			field = escape_get_field (ctx, ins->inst_offset);
+			if (escape_is_store_imm (ins->opcode)) {
+				gint64 imm = ins->inst_imm;
+
+				if (field->size == 8) {
+					vreg = mono_alloc_lreg (cfg);
+					ins->opcode = OP_I8CONST;
+					ins->inst_l = imm;
+				} else {
+					vreg = mono_alloc_ireg (cfg);
+					ins->opcode = OP_ICONST;
+					ins->inst_c0 = imm;
 				}
+			} else if (field->is_float) {
+				vreg = mono_alloc_freg (cfg);
+				ins->opcode = OP_FMOVE;
+			} else {
+				/* Keep the GC type of references */
+				vreg = mono_alloc_ireg_copy (cfg, ins->sreg1);
+				ins->opcode = OP_MOVE;
+			}
+			ins->dreg = vreg;
+			ins->inst_offset = 0;
+			ins->flags = 0;
+			field->vreg = vreg;
+		} else if ((ins->opcode == OP_PADD_IMM || ins->opcode == OP_ADD_IMM) && escape_is_alias (ctx, ins->sreg1)) {
+			NULLIFY_INS (ins);
+		} else if (ins->opcode == OP_CARD_TABLE_WBARRIER && escape_is_derived (ctx, ins->sreg1)) {
+			NULLIFY_INS (ins);
+		} else if ((ins->opcode == OP_CHECK_THIS || ins->opcode == OP_NOT_NULL || ins->opcode == OP_DUMMY_USE) && escape_is_alias (ctx, ins->sreg1)) {
+			NULLIFY_INS (ins);
+		}
+	}
 
-				/* Make sure we don't move the instruction before the def of its sreg */
-				if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN || ins->opcode == OP_CHECK_THIS)
-					sreg = ins->sreg1;
-				else
-					sreg = -1;
-				if (sreg != -1) {
-					MonoInst *tins, *var;
-
-					skip = FALSE;
-					for (tins = ins->prev; tins; tins = tins->prev) {
-						const char *spec = INS_INFO (tins->opcode);
-
-						if (tins->opcode == OP_MOVE && tins->dreg == sreg) {
-							sreg = tins->sreg1;
-						} if (spec [MONO_INST_DEST] != ' ' && tins->dreg == sreg) {
-							skip = TRUE;
-							break;
-						}
+	/* The arguments of the call become dead and are removed by deadce */
+	NULLIFY_INS (alloc);
+}
+
+/*
+ * mono_ssa_escape_analysis:
+ *
+ *   Replace objects which don't escape the method with vregs holding their fields.
+ */
+void
+mono_ssa_escape_analysis (MonoCompile *cfg)
+{
+	EscapeContext ctx;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int nremoved = 0;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+
+	if (cfg->gen_sdb_seq_points)
+		return;
+
+	memset (&ctx, 0, sizeof (ctx));
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (!MONO_IS_CALL (ins) || !((MonoCallInst*)ins)->is_alloc)
+				continue;
+
+			if (!ctx.def_count) {
+				MonoBasicBlock *bb2;
+				MonoInst *ins2;
+
+				ctx.vregs_size = cfg->next_vreg;
+				ctx.def_count = g_new0 (guint8, ctx.vregs_size);
+				for (bb2 = cfg->bb_entry; bb2; bb2 = bb2->next_bb) {
+					MONO_BB_FOR_EACH_INS (bb2, ins2) {
+						const char *spec = INS_INFO (ins2->opcode);
+
+						if (ins2->opcode != OP_NOP && spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins2) && ins2->dreg != -1 && ctx.def_count [ins2->dreg] < 2)
+							ctx.def_count [ins2->dreg] ++;
 					}
-					if (skip)
-						continue;
-					var = get_vreg_to_inst (cfg, sreg);
-					if (var && (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))
-						continue;
-					ins->sreg1 = sreg;
 				}
+				ctx.aliases = g_hash_table_new (NULL, NULL);
+				ctx.derived = g_hash_table_new (NULL, NULL);
+			}
 
-				if (cfg->verbose_level > 1) {
-					printf ("licm in BB%d on ", bb->block_num);
-					mono_print_ins (ins);
-				}
-				//{ static int count = 0; count ++; printf ("%d\n", count); }
-				MONO_REMOVE_INS (bb, ins);
-				mono_bblock_insert_before_ins (idom, idom->last_ins, ins);
-				if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN)
-					idom->has_array_access = TRUE;
+			g_hash_table_remove_all (ctx.aliases);
+			g_hash_table_remove_all (ctx.derived);
+			ctx.nfields = 0;
+
+			if (!escape_check_uses (cfg, &ctx, ins))
+				continue;
+
+			if (cfg->verbose_level > 1) {
+				printf ("escape analysis: replacing the object allocated in BB%d with %d vregs: ", bb->block_num, ctx.nfields);
+				mono_print_ins (ins);
 			}
+			escape_replace_object (cfg, &ctx, ins);
+			nremoved ++;
 		}
 	}
 
-	cfg->comp_done &=  ~MONO_COMP_SSA_DEF_USE;
-	for (i = 0; i < cfg->num_varinfo; i++) {
-		MonoMethodVar *info = MONO_VARINFO (cfg, i);
-		info->def = NULL;
-		info->uses = NULL;
+	if (nremoved)
+		InterlockedAdd (&mono_jit_stats.allocs_eliminated, nremoved);
+
+	if (ctx.def_count) {
+		g_hash_table_destroy (ctx.aliases);
+		g_hash_table_destroy (ctx.derived);
+		g_free (ctx.def_count);
 	}
 }
 
@@ -482,28 +482,29 @@ typedef struct {
 	int cfa_reg, cfa_offset;
 } UnwindState;
 
+/* The result of decoding the unwind info up to a given location */
+typedef struct {
+	int cfa_reg, cfa_offset;
+	int nsaved;
+	/* Registers saved by this frame, as (dwarf reg, offset from the CFA) pairs */
+	guint16 saved_regs [NUM_REGS];
+	gint32 saved_offsets [NUM_REGS];
+} UnwindFrameState;
+
 /*
- * Given the state of the current frame as stored in REGS, execute the unwind 
- * operations in unwind_info until the location counter reaches POS. The result is 
- * stored back into REGS. OUT_CFA will receive the value of the CFA.
- * If SAVE_LOCATIONS is non-NULL, it should point to an array of size SAVE_LOCATIONS_LEN.
- * On return, the nth entry will point to the address of the stack slot where register
- * N was saved, or NULL, if it was not saved by this frame.
- * MARK_LOCATIONS should contain the locations marked by mono_emit_unwind_op_mark_loc (), if any.
- * This function is signal safe.
+ * decode_unwind_state:
+ *
+ *   Execute the unwind operations in UNWIND_INFO until the location counter reaches
+ * IP, and store the resulting cfa and saved register locations into OUT.
  */
-void
-mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len, 
-				   guint8 *start_ip, guint8 *end_ip, guint8 *ip, guint8 **mark_locations,
-				   mono_unwind_reg_t *regs, int nregs,
-				   mgreg_t **save_locations, int save_locations_len,
-				   guint8 **out_cfa)
+static void
+decode_unwind_state (guint8 *unwind_info, guint32 unwind_info_len, guint8 *start_ip, guint8 *ip,
+					 guint8 **mark_locations, UnwindFrameState *out)
 {
 	Loc locations [NUM_REGS];
 	guint8 reg_saved [NUM_REGS];
 	int i, pos, reg, cfa_reg = -1, cfa_offset = 0, offset;
 	guint8 *p;
-	guint8 *cfa_val;
 	UnwindState state_stack [1];
 	int state_stack_pos;
 
@@ -521,7 +522,7 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 
 		switch (op) {
 		case DW_CFA_advance_loc:
-			UNW_DEBUG (print_dwarf_state (cfa_reg, cfa_offset, pos, nregs, locations));
+			UNW_DEBUG (print_dwarf_state (cfa_reg, cfa_offset, pos, NUM_REGS, locations));
 			pos += *p & 0x3f;
 			p ++;
 			break;
@@ -608,33 +609,189 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 		}
 	}
 
-	if (save_locations)
-		memset (save_locations, 0, save_locations_len * sizeof (mgreg_t*));
-
 	g_assert (cfa_reg != -1);
-	cfa_val = (guint8*)regs [mono_dwarf_reg_to_hw_reg (cfa_reg)] + cfa_offset;
+	out->cfa_reg = cfa_reg;
+	out->cfa_offset = cfa_offset;
+	out->nsaved = 0;
 	for (i = 0; i < NUM_REGS; ++i) {
 		if (reg_saved [i] && locations [i].loc_type == LOC_OFFSET) {
-			int hreg = mono_dwarf_reg_to_hw_reg (i);
-			g_assert (hreg < nregs);
-			if (IS_DOUBLE_REG (i))
-				regs [hreg] = *(guint64*)(cfa_val + locations [i].offset);
-			else
-				regs [hreg] = *(mgreg_t*)(cfa_val + locations [i].offset);
-			if (save_locations && hreg < save_locations_len)
-				save_locations [hreg] = (mgreg_t*)(cfa_val + locations [i].offset);
+			out->saved_regs [out->nsaved] = i;
+			out->saved_offsets [out->nsaved] = locations [i].offset;
+			out->nsaved ++;
 		}
 	}
+}
+
+/*
+ * apply_unwind_state:
+ *
+ *   Compute the CFA and restore the registers saved by the frame described by
+ * CFA_REG/CFA_OFFSET/SAVED_REGS/SAVED_OFFSETS.
+ */
+static void
+apply_unwind_state (int cfa_reg, int cfa_offset, int nsaved, guint16 *saved_regs, gint32 *saved_offsets,
+					mono_unwind_reg_t *regs, int nregs,
+					mgreg_t **save_locations, int save_locations_len,
+					guint8 **out_cfa)
+{
+	guint8 *cfa_val;
+	int i;
+
+	if (save_locations)
+		memset (save_locations, 0, save_locations_len * sizeof (mgreg_t*));
+
+	cfa_val = (guint8*)regs [mono_dwarf_reg_to_hw_reg (cfa_reg)] + cfa_offset;
+	for (i = 0; i < nsaved; ++i) {
+		int reg = saved_regs [i];
+		int hreg = mono_dwarf_reg_to_hw_reg (reg);
+
+		g_assert (hreg < nregs);
+		if (IS_DOUBLE_REG (reg))
+			regs [hreg] = *(guint64*)(cfa_val + saved_offsets [i]);
+		else
+			regs [hreg] = *(mgreg_t*)(cfa_val + saved_offsets [i]);
+		if (save_locations && hreg < save_locations_len)
+			save_locations [hreg] = (mgreg_t*)(cfa_val + saved_offsets [i]);
+	}
 
 	*out_cfa = cfa_val;
 }
 
+/*
+ * Given the state of the current frame as stored in REGS, execute the unwind 
+ * operations in unwind_info until the location counter reaches POS. The result is 
+ * stored back into REGS. OUT_CFA will receive the value of the CFA.
+ * If SAVE_LOCATIONS is non-NULL, it should point to an array of size SAVE_LOCATIONS_LEN.
+ * On return, the nth entry will point to the address of the stack slot where register
+ * N was saved, or NULL, if it was not saved by this frame.
+ * MARK_LOCATIONS should contain the locations marked by mono_emit_unwind_op_mark_loc (), if any.
+ * This function is signal safe.
+ */
+void
+mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len, 
+				   guint8 *start_ip, guint8 *end_ip, guint8 *ip, guint8 **mark_locations,
+				   mono_unwind_reg_t *regs, int nregs,
+				   mgreg_t **save_locations, int save_locations_len,
+				   guint8 **out_cfa)
+{
+	UnwindFrameState state;
+
+	decode_unwind_state (unwind_info, unwind_info_len, start_ip, ip, mark_locations, &state);
+	apply_unwind_state (state.cfa_reg, state.cfa_offset, state.nsaved, state.saved_regs, state.saved_offsets,
+						regs, nregs, save_locations, save_locations_len, out_cfa);
+}
+
+/*
+ * The unwind cache stores the result of decoding the unwind info of a frame, keyed by the
+ * unwind info and the offset of the ip inside the method, so repeatedly unwinding through
+ * the same call sites, like when throwing exceptions in a loop, doesn't need to interpret
+ * the unwind ops again. The unwind info is never freed, so the keys remain valid.
+ */
+#define UNWIND_CACHE_SIZE 128
+#define UNWIND_CACHE_MAX_SAVED 16
+
+typedef struct {
+	guint8 *unwind_info;
+	guint32 unwind_info_len;
+	gint32 ip_offset;
+	/* The offset of the location marked by DW_CFA_mono_advance_loc, or -1 */
+	gint32 mark_offset;
+	gint16 cfa_reg;
+	guint8 nsaved;
+	gint32 cfa_offset;
+	guint16 saved_regs [UNWIND_CACHE_MAX_SAVED];
+	gint32 saved_offsets [UNWIND_CACHE_MAX_SAVED];
+} UnwindCacheEntry;
+
+struct _MonoUnwindCache {
+	/* Set while the cache is in use, so nested unwinding from signal handlers bypasses it */
+	gboolean busy;
+	UnwindCacheEntry entries [UNWIND_CACHE_SIZE];
+};
+
+static gint32 unwind_cache_hits, unwind_cache_misses;
+
+MonoUnwindCache*
+mono_unwind_cache_new (void)
+{
+	return g_new0 (MonoUnwindCache, 1);
+}
+
+void
+mono_unwind_cache_free (MonoUnwindCache *cache)
+{
+	g_free (cache);
+}
+
+/*
+ * mono_unwind_frame_cached:
+ *
+ *   Same as mono_unwind_frame (), but look up the decoded unwind state in CACHE first,
+ * and store it there on a miss. CACHE should only be used by one thread.
+ */
+void
+mono_unwind_frame_cached (MonoUnwindCache *cache,
+						  guint8 *unwind_info, guint32 unwind_info_len, 
+						  guint8 *start_ip, guint8 *end_ip, guint8 *ip, guint8 **mark_locations,
+						  mono_unwind_reg_t *regs, int nregs,
+						  mgreg_t **save_locations, int save_locations_len,
+						  guint8 **out_cfa)
+{
+	UnwindCacheEntry *entry;
+	UnwindFrameState state;
+	gint32 ip_offset, mark_offset;
+	guint32 hash;
+
+	if (!cache || cache->busy) {
+		mono_unwind_frame (unwind_info, unwind_info_len, start_ip, end_ip, ip, mark_locations, regs, nregs, save_locations, save_locations_len, out_cfa);
+		return;
+	}
+
+	cache->busy = TRUE;
+
+	ip_offset = ip - start_ip;
+	mark_offset = (mark_locations && mark_locations [0]) ? mark_locations [0] - start_ip : -1;
+	hash = ((((gsize)unwind_info) >> 3) * 31) ^ (ip_offset * 7) ^ mark_offset;
+	entry = &cache->entries [hash % UNWIND_CACHE_SIZE];
+
+	if (entry->unwind_info == unwind_info && entry->unwind_info_len == unwind_info_len &&
+		entry->ip_offset == ip_offset && entry->mark_offset == mark_offset) {
+		unwind_cache_hits ++;
+		apply_unwind_state (entry->cfa_reg, entry->cfa_offset, entry->nsaved, entry->saved_regs, entry->saved_offsets,
+							regs, nregs, save_locations, save_locations_len, out_cfa);
+		cache->busy = FALSE;
+		return;
+	}
+
+	unwind_cache_misses ++;
+	decode_unwind_state (unwind_info, unwind_info_len, start_ip, ip, mark_locations, &state);
+	if (state.nsaved <= UNWIND_CACHE_MAX_SAVED) {
+		/* Invalidate the entry while it is being filled in */
+		entry->unwind_info = NULL;
+		entry->unwind_info_len = unwind_info_len;
+		entry->ip_offset = ip_offset;
+		entry->mark_offset = mark_offset;
+		entry->cfa_reg = state.cfa_reg;
+		entry->cfa_offset = state.cfa_offset;
+		entry->nsaved = state.nsaved;
+		memcpy (entry->saved_regs, state.saved_regs, state.nsaved * sizeof (guint16));
+		memcpy (entry->saved_offsets, state.saved_offsets, state.nsaved * sizeof (gint32));
+		entry->unwind_info = unwind_info;
+	}
+	apply_unwind_state (state.cfa_reg, state.cfa_offset, state.nsaved, state.saved_regs, state.saved_offsets,
+						regs, nregs, save_locations, save_locations_len, out_cfa);
+
+	cache->busy = FALSE;
+}
+
 void
 mono_unwind_init (void)
 {
 	mono_mutex_init_recursive (&unwind_mutex);
 
 	mono_counters_register ("Unwind info size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_info_size);
+	mono_counters_register ("Unwind cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_cache_hits);
+	mono_counters_register ("Unwind cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_cache_misses);
 }
 
 void
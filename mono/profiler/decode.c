@@ -1917,6 +1917,63 @@ lookup_monitor (uintptr_t objid)
 	return cd;
 }
 
+#define LOCK_HISTOGRAM_BUCKETS 24
+
+typedef struct _LockDesc LockDesc;
+struct _LockDesc {
+	LockDesc *next;
+	uintptr_t addr;
+	int kind;
+	uint64_t count;
+	uint64_t wait_time;
+	uint64_t max_wait_time;
+	uint64_t buckets [LOCK_HISTOGRAM_BUCKETS];
+	TraceDesc waiter_traces;
+	TraceDesc owner_traces;
+};
+
+static LockDesc* lock_hash [SMALL_HASH_SIZE] = {0};
+static int num_locks = 0;
+
+static LockDesc*
+lookup_lock (int kind, uintptr_t addr)
+{
+	int slot = ((addr >> 3) & 0xffff) % SMALL_HASH_SIZE;
+	LockDesc *ld = lock_hash [slot];
+	while (ld && (ld->addr != addr || ld->kind != kind))
+		ld = ld->next;
+	if (!ld) {
+		ld = calloc (sizeof (LockDesc), 1);
+		ld->addr = addr;
+		ld->kind = kind;
+		ld->next = lock_hash [slot];
+		lock_hash [slot] = ld;
+		num_locks++;
+	}
+	return ld;
+}
+
+/* Keep in sync with RuntimeLocks in mono/metadata/lock-tracer.h */
+static const char*
+lock_kind_name (int kind)
+{
+	switch (kind) {
+	case MONO_PROFILER_LOCK_MONITOR: return "monitor";
+	case 1: return "loader";
+	case 2: return "image data";
+	case 3: return "domain";
+	case 4: return "domain assemblies";
+	case 5: return "domain jit code hash";
+	case 6: return "icall";
+	case 7: return "assembly binding";
+	case 8: return "marshal";
+	case 9: return "classes";
+	case 10: return "loader global data";
+	case 11: return "threads";
+	default: return "unknown";
+	}
+}
+
 static const char*
 monitor_ev_name (int ev)
 {
@@ -2649,6 +2706,62 @@ decode_buffer (ProfContext *ctx)
 		case TYPE_MONITOR: {
 			int event = (*p >> 4) & 0x3;
 			int has_bt = *p & TYPE_MONITOR_BT;
+			if (*p & TYPE_MONITOR_LOCK) {
+				int subtype = *p & (TYPE_MONITOR_LOCK | 0x30);
+				uint64_t tdiff = decode_uleb128 (p + 1, &p);
+				int kind = decode_uleb128 (p, &p);
+				intptr_t lockdiff = decode_sleb128 (p, &p);
+				uintptr_t addr = kind == MONO_PROFILER_LOCK_MONITOR ? OBJ_ADDR (lockdiff) : (uintptr_t)(ptr_base + lockdiff);
+				LockDesc *ldesc = lookup_lock (kind, addr);
+				uint64_t wait = 0;
+				MethodDesc* sframes [8];
+				MethodDesc** frames = sframes;
+				int record;
+				int num_bt = 0;
+				LOG_TIME (time_base, tdiff);
+				time_base += tdiff;
+				record = (!thread_filter || thread_filter == thread->thread_id);
+				if (!(time_base >= time_from && time_base < time_to))
+					record = 0;
+				if (subtype == TYPE_MONITOR_LOCK_HISTOGRAM) {
+					int i, num_buckets;
+					ldesc->count = decode_uleb128 (p, &p);
+					ldesc->wait_time = decode_uleb128 (p, &p);
+					ldesc->max_wait_time = decode_uleb128 (p, &p);
+					num_buckets = decode_uleb128 (p, &p);
+					for (i = 0; i < num_buckets; ++i) {
+						uint64_t count = decode_uleb128 (p, &p);
+						ldesc->buckets [MIN (i, LOCK_HISTOGRAM_BUCKETS - 1)] += count;
+					}
+					if (debug)
+						fprintf (outfile, "%s lock %p histogram: %llu waits\n", lock_kind_name (kind), (void*)addr, (unsigned long long) ldesc->count);
+					break;
+				}
+				if (subtype == TYPE_MONITOR_LOCK_WAIT)
+					wait = decode_uleb128 (p, &p);
+				if (has_bt) {
+					num_bt = 8;
+					frames = decode_bt (sframes, &num_bt, p, &p, ptr_base);
+					if (!frames) {
+						fprintf (outfile, "Cannot load backtrace\n");
+						return 0;
+					}
+					if (record)
+						add_trace_methods (frames, num_bt, subtype == TYPE_MONITOR_LOCK_WAIT ? &ldesc->waiter_traces : &ldesc->owner_traces, subtype == TYPE_MONITOR_LOCK_WAIT ? wait : 1);
+				} else {
+					if (record)
+						add_trace_thread (thread, subtype == TYPE_MONITOR_LOCK_WAIT ? &ldesc->waiter_traces : &ldesc->owner_traces, subtype == TYPE_MONITOR_LOCK_WAIT ? wait : 1);
+				}
+				if (debug) {
+					if (subtype == TYPE_MONITOR_LOCK_WAIT)
+						fprintf (outfile, "%s lock %p waited %llu ns\n", lock_kind_name (kind), (void*)addr, (unsigned long long) wait);
+					else
+						fprintf (outfile, "%s lock %p released while contended\n", lock_kind_name (kind), (void*)addr);
+				}
+				if (frames != sframes)
+					free (frames);
+				break;
+			}
 			uint64_t tdiff = decode_uleb128 (p + 1, &p);
 			intptr_t objdiff = decode_sleb128 (p, &p);
 			MethodDesc* sframes [8];
@@ -3228,6 +3341,65 @@ dump_monitors (void)
 	fprintf (outfile, "\tLock failures: %llu\n", (unsigned long long) monitor_failed);
 }
 
+static int
+compare_lock (const void *a, const void *b)
+{
+	LockDesc *const*A = a;
+	LockDesc *const*B = b;
+	if ((*B)->wait_time == (*A)->wait_time)
+		return 0;
+	if ((*B)->wait_time < (*A)->wait_time)
+		return -1;
+	return 1;
+}
+
+static void
+dump_lock_histogram (LockDesc *ldesc)
+{
+	int i;
+	for (i = 0; i < LOCK_HISTOGRAM_BUCKETS; ++i) {
+		if (!ldesc->buckets [i])
+			continue;
+		if (i == 0)
+			fprintf (outfile, "\t\t%10s - %-10s: %llu\n", "0ns", "1024ns", (unsigned long long) ldesc->buckets [i]);
+		else if (i == LOCK_HISTOGRAM_BUCKETS - 1)
+			fprintf (outfile, "\t\t%8lluus - %-10s: %llu\n", (1ULL << (i + 9)) / 1000, "", (unsigned long long) ldesc->buckets [i]);
+		else
+			fprintf (outfile, "\t\t%8lluus - %8lluus: %llu\n", (1ULL << (i + 9)) / 1000, (1ULL << (i + 10)) / 1000, (unsigned long long) ldesc->buckets [i]);
+	}
+}
+
+static void
+dump_locks (void)
+{
+	LockDesc **locks;
+	int i, j;
+	if (!num_locks)
+		return;
+	locks = malloc (sizeof (void*) * num_locks);
+	for (i = 0, j = 0; i < SMALL_HASH_SIZE; ++i) {
+		LockDesc *ldesc = lock_hash [i];
+		while (ldesc) {
+			locks [j++] = ldesc;
+			ldesc = ldesc->next;
+		}
+	}
+	qsort (locks, num_locks, sizeof (void*), compare_lock);
+	fprintf (outfile, "\nTop contended locks\n");
+	for (i = 0; i < num_locks; ++i) {
+		LockDesc *ldesc = locks [i];
+		if (!ldesc->count)
+			continue;
+		fprintf (outfile, "\t%s lock %p: %llu waits\n", lock_kind_name (ldesc->kind), (void*)ldesc->addr, (unsigned long long) ldesc->count);
+		fprintf (outfile, "\t\t%.6f secs total wait time, %.6f max, %.6f average\n",
+			ldesc->wait_time/1000000000.0, ldesc->max_wait_time/1000000000.0, ldesc->wait_time/1000000000.0/ldesc->count);
+		dump_lock_histogram (ldesc);
+		dump_traces (&ldesc->waiter_traces, "ns waited");
+		dump_traces (&ldesc->owner_traces, "contended releases");
+	}
+	free (locks);
+}
+
 static void
 dump_gcs (void)
 {
@@ -3879,8 +4051,10 @@ print_reports (ProfContext *ctx, const char *reps, int parse_only)
 			continue;
 		}
 		if ((opt = match_option (p, "monitor")) != p) {
-			if (!parse_only)
+			if (!parse_only) {
 				dump_monitors ();
+				dump_locks ();
+			}
 			continue;
 		}
 		if ((opt = match_option (p, "heapshot")) != p) {
@@ -280,6 +280,28 @@ typedef struct _LogBuffer LogBuffer;
  * [object: sleb128] the lock object as a difference from obj_base
  * if exinfo.low3bits == MONO_PROFILER_MONITOR_CONTENTION
  *	If the TYPE_MONITOR_BT flag is set, a backtrace follows.
+ * if exinfo & TYPE_MONITOR_LOCK (format_version > 11), the event is instead one of
+ * TYPE_MONITOR_LOCK_WAIT, TYPE_MONITOR_LOCK_RELEASE, TYPE_MONITOR_LOCK_HISTOGRAM,
+ * plus the TYPE_MONITOR_BT flag, and applies to both monitors and runtime locks:
+ * [time diff: uleb128] nanoseconds since last timing
+ * [kind: uleb128] MONO_PROFILER_LOCK_MONITOR or the kind of runtime lock (RuntimeLocks in lock-tracer.h)
+ * [lock: sleb128] for monitors the lock object as a difference from obj_base,
+ * otherwise the address of the lock as a difference from ptr_base
+ * if exinfo == TYPE_MONITOR_LOCK_WAIT
+ *	[wait: uleb128] nanoseconds the thread waited for the lock
+ *	If the TYPE_MONITOR_BT flag is set, a backtrace of the waiting thread follows.
+ * if exinfo == TYPE_MONITOR_LOCK_RELEASE
+ *	the owner released the lock while other threads were waiting for it
+ *	If the TYPE_MONITOR_BT flag is set, a backtrace of the owner follows.
+ * if exinfo == TYPE_MONITOR_LOCK_HISTOGRAM
+ *	emitted at shutdown with the wait times of the whole run
+ *	[count: uleb128] number of waits
+ *	[total: uleb128] total wait time in nanoseconds
+ *	[max: uleb128] longest wait in nanoseconds
+ *	[num_buckets: uleb128] number of histogram buckets
+ *	[bucket: uleb128]* num_buckets wait counts: bucket 0 counts the waits shorter than
+ *	1024 nanoseconds, bucket i the waits between 2^(i+9) and 2^(i+10) nanoseconds,
+ *	and the last bucket all the longer waits as well
  *
  * type heap format
  * type: TYPE_HEAP
@@ -1702,6 +1724,164 @@ monitor_event (MonoProfiler *profiler, MonoObject *object, MonoProfilerMonitorEv
 	process_requests (profiler);
 }
 
+/*
+ * Wait time statistics per lock, emitted at shutdown. Monitors are keyed by
+ * object address, so a lock object moved by the GC shows up as two locks.
+ */
+#define LOCK_HISTOGRAM_BUCKETS 24
+
+typedef struct {
+	void *lock;
+	int kind;
+	uint64_t count;
+	uint64_t total_time;
+	uint64_t max_time;
+	uint64_t buckets [LOCK_HISTOGRAM_BUCKETS];
+} LockStats;
+
+static mono_mutex_t lock_stats_mutex;
+static GHashTable *lock_stats;
+
+static int
+lock_histogram_bucket (uint64_t wait_ns)
+{
+	int bucket = 0;
+
+	for (wait_ns >>= 10; wait_ns && bucket < LOCK_HISTOGRAM_BUCKETS - 1; wait_ns >>= 1)
+		bucket++;
+
+	return bucket;
+}
+
+static void
+lock_stats_add (void *lock, int kind, uint64_t wait_ns)
+{
+	LockStats *stats;
+
+	mono_mutex_lock (&lock_stats_mutex);
+
+	stats = g_hash_table_lookup (lock_stats, lock);
+	if (!stats) {
+		stats = g_new0 (LockStats, 1);
+		stats->lock = lock;
+		stats->kind = kind;
+		g_hash_table_insert (lock_stats, lock, stats);
+	}
+
+	stats->count++;
+	stats->total_time += wait_ns;
+	if (wait_ns > stats->max_time)
+		stats->max_time = wait_ns;
+	stats->buckets [lock_histogram_bucket (wait_ns)]++;
+
+	mono_mutex_unlock (&lock_stats_mutex);
+}
+
+static void
+emit_lock (LogBuffer *logbuffer, void *lock, int kind)
+{
+	emit_value (logbuffer, kind);
+	if (kind == MONO_PROFILER_LOCK_MONITOR)
+		emit_obj (logbuffer, lock);
+	else
+		emit_ptr (logbuffer, lock);
+}
+
+static void
+lock_contention (MonoProfiler *profiler, void *lock, int kind, MonoProfilerLockEvent event, uint64_t wait_ns)
+{
+	int do_bt;
+	uint64_t now;
+	FrameData data;
+	LogBuffer *logbuffer;
+
+	/*
+	 * Runtime locks are reported while they are held, and walking the stack and
+	 * registering the methods on it takes other runtime locks.
+	 */
+	do_bt = (kind == MONO_PROFILER_LOCK_MONITOR && nocalls && InterlockedRead (&runtime_inited) && !notraces)? TYPE_MONITOR_BT: 0;
+
+	if (event == MONO_PROFILER_LOCK_WAIT)
+		lock_stats_add (lock, kind, wait_ns);
+
+	if (do_bt)
+		collect_bt (&data);
+	logbuffer = ensure_logbuf (
+		EVENT_SIZE /* event */ +
+		LEB128_SIZE /* time */ +
+		LEB128_SIZE /* kind */ +
+		LEB128_SIZE /* lock */ +
+		LEB128_SIZE /* wait */ +
+		(do_bt ? (
+			LEB128_SIZE /* flags */ +
+			LEB128_SIZE /* count */ +
+			data.count * (
+				LEB128_SIZE /* method */
+			)
+		) : 0)
+	);
+	now = current_time ();
+	ENTER_LOG (logbuffer, "lock");
+	emit_byte (logbuffer, (event == MONO_PROFILER_LOCK_WAIT ? TYPE_MONITOR_LOCK_WAIT : TYPE_MONITOR_LOCK_RELEASE) | do_bt | TYPE_MONITOR);
+	emit_time (logbuffer, now);
+	emit_lock (logbuffer, lock, kind);
+	if (event == MONO_PROFILER_LOCK_WAIT)
+		emit_uvalue (logbuffer, wait_ns);
+	if (do_bt)
+		emit_bt (profiler, logbuffer, &data);
+	EXIT_LOG (logbuffer);
+	/* runtime locks are reported while they are held, which is no place for a collection */
+	if (kind == MONO_PROFILER_LOCK_MONITOR)
+		process_requests (profiler);
+}
+
+static void
+emit_lock_histogram (LockStats *stats)
+{
+	LogBuffer *logbuffer;
+	uint64_t now;
+	int i;
+
+	logbuffer = ensure_logbuf (
+		EVENT_SIZE /* event */ +
+		LEB128_SIZE /* time */ +
+		LEB128_SIZE /* kind */ +
+		LEB128_SIZE /* lock */ +
+		LEB128_SIZE /* count */ +
+		LEB128_SIZE /* total */ +
+		LEB128_SIZE /* max */ +
+		LEB128_SIZE /* num_buckets */ +
+		LOCK_HISTOGRAM_BUCKETS * (
+			LEB128_SIZE /* bucket */
+		)
+	);
+	now = current_time ();
+	ENTER_LOG (logbuffer, "lock-histogram");
+	emit_byte (logbuffer, TYPE_MONITOR_LOCK_HISTOGRAM | TYPE_MONITOR);
+	emit_time (logbuffer, now);
+	emit_lock (logbuffer, stats->lock, stats->kind);
+	emit_uvalue (logbuffer, stats->count);
+	emit_uvalue (logbuffer, stats->total_time);
+	emit_uvalue (logbuffer, stats->max_time);
+	emit_value (logbuffer, LOCK_HISTOGRAM_BUCKETS);
+	for (i = 0; i < LOCK_HISTOGRAM_BUCKETS; ++i)
+		emit_uvalue (logbuffer, stats->buckets [i]);
+	EXIT_LOG (logbuffer);
+}
+
+static void
+dump_lock_histograms (MonoProfiler *prof)
+{
+	GHashTableIter iter;
+	gpointer stats;
+
+	mono_mutex_lock (&lock_stats_mutex);
+	g_hash_table_iter_init (&iter, lock_stats);
+	while (g_hash_table_iter_next (&iter, NULL, &stats))
+		emit_lock_histogram (stats);
+	mono_mutex_unlock (&lock_stats_mutex);
+}
+
 static void
 thread_start (MonoProfiler *prof, uintptr_t tid)
 {
@@ -3851,6 +4031,8 @@ log_shutdown (MonoProfiler *prof)
 	}
 #endif
 
+	dump_lock_histograms (prof);
+
 	g_ptr_array_free (prof->sorted_sample_events, TRUE);
 
 	if (TLS_GET (LogBuffer, tlsbuffer))
@@ -4717,6 +4899,9 @@ mono_profiler_startup (const char *desc)
 		return;
 	init_thread ();
 
+	mono_mutex_init (&lock_stats_mutex);
+	lock_stats = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
 	mono_profiler_install (prof, log_shutdown);
 	mono_profiler_install_gc (gc_event, gc_resize);
 	mono_profiler_install_allocation (gc_alloc);
@@ -4735,6 +4920,7 @@ mono_profiler_startup (const char *desc)
 	mono_profiler_install_code_buffer_new (code_buffer_new);
 	mono_profiler_install_exception (throw_exc, method_exc_leave, clause_exc);
 	mono_profiler_install_monitor (monitor_event);
+	mono_profiler_install_lock_contention (lock_contention);
 	mono_profiler_install_runtime_initialized (runtime_initialized);
 	if (do_coverage)
 		mono_profiler_install_coverage_filter (coverage_filter);
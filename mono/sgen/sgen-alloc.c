@@ -58,6 +58,10 @@ static guint64 stat_bytes_alloced_los = 0;
 
 #endif
 
+static guint64 stat_tlab_refills = 0;
+static guint64 stat_tlab_size_increases = 0;
+static guint64 stat_tlab_size_decreases = 0;
+
 /*
  * Allocation is done from a Thread Local Allocation Buffer (TLAB). TLABs are allocated
  * from nursery fragments.
@@ -77,6 +81,8 @@ static __thread char *tlab_start;
 static __thread char *tlab_next;
 static __thread char *tlab_temp_end;
 static __thread char *tlab_real_end;
+static __thread guint32 tlab_thread_size;
+static __thread guint32 tlab_thread_refills;
 /* Used by the managed allocator/wbarrier */
 static __thread char **tlab_next_addr MONO_ATTR_USED;
 #endif
@@ -86,13 +92,24 @@ static __thread char **tlab_next_addr MONO_ATTR_USED;
 #define TLAB_NEXT	tlab_next
 #define TLAB_TEMP_END	tlab_temp_end
 #define TLAB_REAL_END	tlab_real_end
+#define TLAB_SIZE	tlab_thread_size
+#define TLAB_REFILLS	tlab_thread_refills
 #else
 #define TLAB_START	(__thread_info__->tlab_start)
 #define TLAB_NEXT	(__thread_info__->tlab_next)
 #define TLAB_TEMP_END	(__thread_info__->tlab_temp_end)
 #define TLAB_REAL_END	(__thread_info__->tlab_real_end)
+#define TLAB_SIZE	(__thread_info__->tlab_size)
+#define TLAB_REFILLS	(__thread_info__->tlab_refills)
 #endif
 
+/*
+ * A thread whose TLAB was refilled this often between two collections gets bigger
+ * TLABs, and one that didn't need more than one gets smaller ones.
+ */
+#define TLAB_GROW_REFILLS	16
+#define TLAB_SHRINK_REFILLS	1
+
 static GCObject*
 alloc_degraded (GCVTable vtable, size_t size, gboolean for_mature)
 {
@@ -250,7 +267,7 @@ sgen_alloc_obj_nolock (GCVTable vtable, size_t size)
 				return alloc_degraded (vtable, size, FALSE);
 
 			available_in_tlab = (int)(TLAB_REAL_END - TLAB_NEXT);//We'll never have tlabs > 2Gb
-			if (size > tlab_size || available_in_tlab > SGEN_MAX_NURSERY_WASTE) {
+			if (size > TLAB_SIZE || available_in_tlab > SGEN_MAX_NURSERY_WASTE) {
 				/* Allocate directly from the nursery */
 				p = sgen_nursery_alloc (size);
 				if (!p) {
@@ -281,20 +298,23 @@ sgen_alloc_obj_nolock (GCVTable vtable, size_t size)
 				zero_tlab_if_necessary (p, size);
 			} else {
 				size_t alloc_size = 0;
+				size_t thread_tlab_size = TLAB_SIZE;
 				if (TLAB_START)
 					SGEN_LOG (3, "Retire TLAB: %p-%p [%ld]", TLAB_START, TLAB_REAL_END, (long)(TLAB_REAL_END - TLAB_NEXT - size));
 				sgen_nursery_retire_region (p, available_in_tlab);
 
-				p = sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+				p = sgen_nursery_alloc_range (thread_tlab_size, size, &alloc_size);
 				if (!p) {
 					/* See comment above in similar case. */
-					sgen_ensure_free_space (tlab_size);
+					sgen_ensure_free_space (thread_tlab_size);
 					if (!degraded_mode)
-						p = sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+						p = sgen_nursery_alloc_range (thread_tlab_size, size, &alloc_size);
 				}
 				if (!p)
 					return alloc_degraded (vtable, size, FALSE);
 
+				++TLAB_REFILLS;
+
 				/* Allocate a new TLAB from the current nursery fragment */
 				TLAB_START = (char*)p;
 				TLAB_NEXT = TLAB_START;
@@ -347,7 +367,7 @@ sgen_try_alloc_obj_nolock (GCVTable vtable, size_t size)
 	if (real_size > SGEN_MAX_SMALL_OBJ_SIZE)
 		return NULL;
 
-	if (G_UNLIKELY (size > tlab_size)) {
+	if (G_UNLIKELY (size > TLAB_SIZE)) {
 		/* Allocate directly from the nursery */
 		p = sgen_nursery_alloc (size);
 		if (!p)
@@ -389,11 +409,13 @@ sgen_try_alloc_obj_nolock (GCVTable vtable, size_t size)
 			size_t alloc_size = 0;
 
 			sgen_nursery_retire_region (p, available_in_tlab);
-			new_next = sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+			new_next = sgen_nursery_alloc_range (TLAB_SIZE, size, &alloc_size);
 			p = (void**)new_next;
 			if (!p)
 				return NULL;
 
+			++TLAB_REFILLS;
+
 			TLAB_START = (char*)new_next;
 			TLAB_NEXT = new_next + size;
 			TLAB_REAL_END = new_next + alloc_size;
@@ -466,7 +488,7 @@ sgen_alloc_obj (GCVTable vtable, size_t size)
  * We may want to explicitly free these objects.
  */
 GCObject*
-sgen_alloc_obj_pinned (GCVTable vtable, size_t size)
+sgen_alloc_obj_pinned_nolock (GCVTable vtable, size_t size)
 {
 	GCObject *p;
 
@@ -474,8 +496,6 @@ sgen_alloc_obj_pinned (GCVTable vtable, size_t size)
 		return NULL;
 	size = ALIGN_UP (size);
 
-	LOCK_GC;
-
 	if (size > SGEN_MAX_SMALL_OBJ_SIZE) {
 		/* large objects are always pinned anyway */
 		p = sgen_los_alloc_large_inner (vtable, size);
@@ -487,6 +507,16 @@ sgen_alloc_obj_pinned (GCVTable vtable, size_t size)
 		SGEN_LOG (6, "Allocated pinned object %p, vtable: %p (%s), size: %zd", p, vtable, sgen_client_vtable_get_name (vtable), size);
 		binary_protocol_alloc_pinned (p, vtable, size, sgen_client_get_provenance ());
 	}
+	return p;
+}
+
+GCObject*
+sgen_alloc_obj_pinned (GCVTable vtable, size_t size)
+{
+	GCObject *p;
+
+	LOCK_GC;
+	p = sgen_alloc_obj_pinned_nolock (vtable, size);
 	UNLOCK_GC;
 	return p;
 }
@@ -518,12 +548,47 @@ sgen_init_tlab_info (SgenThreadInfo* info)
 	info->tlab_next_addr = &TLAB_NEXT;
 	info->tlab_temp_end_addr = &TLAB_TEMP_END;
 	info->tlab_real_end_addr = &TLAB_REAL_END;
+	info->tlab_size_addr = &TLAB_SIZE;
+	info->tlab_refills_addr = &TLAB_REFILLS;
+
+	TLAB_SIZE = tlab_size;
+	TLAB_REFILLS = 0;
 
 #ifdef HAVE_KW_THREAD
 	tlab_next_addr = &tlab_next;
 #endif
 }
 
+/*
+ * Pick the size of the thread's TLABs for the next cycle based on how often it had to
+ * get a new one in the last.  The size doubles or halves each time, so it takes a few
+ * collections to adapt.  A single thread never gets more than a small part of the
+ * nursery.
+ */
+static void
+adjust_tlab_size (SgenThreadInfo *info)
+{
+	size_t max_size = MAX (tlab_size, MIN (SGEN_MAX_TLAB_SIZE, sgen_nursery_allocator_get_usable_size () / 64));
+	guint32 *size = info->tlab_size_addr;
+	guint32 *refills = info->tlab_refills_addr;
+	guint32 old_size = *size;
+
+	stat_tlab_refills += *refills;
+
+	if (*refills >= TLAB_GROW_REFILLS && *size < max_size) {
+		*size = MIN (*size * 2, max_size);
+		++stat_tlab_size_increases;
+	} else if (*refills <= TLAB_SHRINK_REFILLS && *size > tlab_size) {
+		*size = MAX (*size / 2, tlab_size);
+		++stat_tlab_size_decreases;
+	}
+
+	if (*size != old_size)
+		SGEN_LOG (4, "Thread %p TLAB size %d -> %d after %d refills", info, old_size, *size, *refills);
+
+	*refills = 0;
+}
+
 /*
  * Clear the thread local TLAB variables for all threads.
  */
@@ -538,6 +603,8 @@ sgen_clear_tlabs (void)
 		*info->tlab_next_addr = NULL;
 		*info->tlab_temp_end_addr = NULL;
 		*info->tlab_real_end_addr = NULL;
+
+		adjust_tlab_size (info);
 	} END_FOREACH_THREAD
 }
 
@@ -559,6 +626,10 @@ sgen_init_allocator (void)
 	g_assert (tlab_temp_end_offset != -1);
 #endif
 
+	mono_counters_register ("# TLAB refills", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_refills);
+	mono_counters_register ("# TLAB size increases", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_size_increases);
+	mono_counters_register ("# TLAB size decreases", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_size_decreases);
+
 #ifdef HEAVY_STATISTICS
 	mono_counters_register ("# objects allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_objects_alloced);
 	mono_counters_register ("bytes allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_bytes_alloced);
@@ -417,12 +417,14 @@ sgen_card_table_finish_minor_collection (void)
 	sgen_card_tables_collect_stats (FALSE);
 }
 
+/*
+ * This must be done before any objects are copied, because with overlapping cards it
+ * clears the whole card table, so it would lose the remsets added for them.  In parallel
+ * collections objects are copied before the card table scan starts.
+ */
 static void
-sgen_card_table_scan_remsets (ScanCopyContext ctx)
+sgen_card_table_start_scan_remsets (void)
 {
-	SGEN_TV_DECLARE (atv);
-	SGEN_TV_DECLARE (btv);
-
 	sgen_card_tables_collect_stats (TRUE);
 
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
@@ -434,6 +436,14 @@ sgen_card_table_scan_remsets (ScanCopyContext ctx)
 	/*Then we clear*/
 	sgen_card_table_clear_cards ();
 #endif
+}
+
+static void
+sgen_card_table_scan_remsets (ScanCopyContext ctx)
+{
+	SGEN_TV_DECLARE (atv);
+	SGEN_TV_DECLARE (btv);
+
 	SGEN_TV_GETTIME (atv);
 	sgen_get_major_collector ()->scan_card_table (FALSE, ctx);
 	SGEN_TV_GETTIME (btv);
@@ -596,6 +606,7 @@ sgen_card_table_init (SgenRememberedSet *remset)
 	remset->wbarrier_generic_nostore = sgen_card_table_wbarrier_generic_nostore;
 	remset->record_pointer = sgen_card_table_record_pointer;
 
+	remset->start_scan_remsets = sgen_card_table_start_scan_remsets;
 	remset->scan_remsets = sgen_card_table_scan_remsets;
 
 	remset->finish_minor_collection = sgen_card_table_finish_minor_collection;
@@ -170,6 +170,12 @@ typedef mword SgenDescriptor;
 */
 #define SGEN_MAX_NURSERY_WASTE 512
 
+/*
+ * TLABs of threads that allocate a lot grow up to this size.  Light allocators keep the
+ * default size, `tlab_size`.
+ */
+#define SGEN_MAX_TLAB_SIZE (1024 * 64)
+
 
 /*
  * Minimum allowance for nursery allocations, as a multiple of the size of nursery.
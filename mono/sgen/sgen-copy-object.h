@@ -19,6 +19,13 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+/*
+ * This is included once for the serial and once for the parallel copy functions of the
+ * nursery collectors, but the functions here only need to be defined once.
+ */
+#ifndef __MONO_SGEN_COPY_OBJECT_H__
+#define __MONO_SGEN_COPY_OBJECT_H__
+
 extern guint64 stat_copy_object_called_nursery;
 extern guint64 stat_objects_copied_nursery;
 
@@ -84,3 +91,76 @@ copy_object_no_checks (void *obj, SgenGrayQueue *queue)
 
 	return destination;
 }
+
+#ifdef COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION
+/*
+ * The parallel version of copy_object_no_checks().  Several threads might try to copy
+ * OBJ at the same time, so the forwarding pointer is installed with a CAS and only the
+ * thread that wins enqueues its copy.  The other copies are wasted.
+ *
+ * Returns the new location of OBJ, which is OBJ itself if it had to be pinned.
+ */
+static MONO_NEVER_INLINE void*
+copy_object_no_checks_par (void *obj, SgenGrayQueue *queue)
+{
+	mword vtable_word = *(mword*)obj;
+	GCVTable vt;
+	gboolean has_references;
+	mword objsize;
+	void *destination;
+
+	/* Another thread might have copied or pinned it since our caller checked. */
+	if (SGEN_POINTER_IS_TAGGED_FORWARDED (vtable_word))
+		return SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+	if (SGEN_POINTER_IS_TAGGED_PINNED (vtable_word))
+		return obj;
+
+	vt = (GCVTable)vtable_word;
+	has_references = SGEN_VTABLE_HAS_REFERENCES (vt);
+	objsize = SGEN_ALIGN_UP (sgen_client_par_object_get_size (vt, obj));
+	destination = COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION (vt, obj, objsize, has_references);
+
+	if (G_UNLIKELY (!destination)) {
+		if ((mword)SGEN_PIN_OBJECT_PAR (obj, vt) == (mword)vt) {
+			sgen_pin_object_par (obj, queue);
+			sgen_set_pinned_from_failed_allocation (objsize);
+			return obj;
+		}
+		/* Somebody beat us to it. */
+		vtable_word = *(mword*)obj;
+		if (SGEN_POINTER_IS_TAGGED_FORWARDED (vtable_word))
+			return SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+		return obj;
+	}
+
+	sgen_client_pre_copy_checks (destination, vt, obj, objsize);
+
+	/* FIXME: assumes object layout */
+	memcpy ((char*)destination + sizeof (mword), (char*)obj + sizeof (mword), objsize - sizeof (mword));
+
+	if ((mword)SGEN_FORWARD_OBJECT_PAR (obj, destination, vt) == (mword)vt) {
+		binary_protocol_copy (obj, destination, vt, objsize);
+		sgen_client_update_copied_object (destination, vt, obj, objsize);
+		if (has_references) {
+			SGEN_LOG (9, "Enqueuing gray object %p (%s)", destination, sgen_client_vtable_get_name (vt));
+			GRAY_OBJECT_ENQUEUE (queue, destination, sgen_vtable_get_descriptor (vt));
+		}
+		return destination;
+	}
+
+	/*
+	 * We lost the race.  Our copy is never referenced, but it still looks like an
+	 * object, so clear it to make sure it doesn't keep anything alive.
+	 */
+	memset ((char*)destination + sizeof (mword), 0, objsize - sizeof (mword));
+	HEAVY_STAT (++stat_slots_allocated_in_vain);
+
+	vtable_word = *(mword*)obj;
+	if (SGEN_POINTER_IS_TAGGED_FORWARDED (vtable_word))
+		return SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+	SGEN_ASSERT (0, SGEN_POINTER_IS_TAGGED_PINNED (vtable_word), "How did we lose the race if the object was neither forwarded nor pinned?");
+	return obj;
+}
+#endif
+
+#endif
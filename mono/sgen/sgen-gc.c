@@ -245,6 +245,8 @@ static gboolean do_scan_starts_check = FALSE;
  * GC.Collect().
  */
 static gboolean allow_synchronous_major = TRUE;
+/* The number of workers for the parallel major collector, or 0 for one per CPU. */
+static int num_parallel_mark_workers = 0;
 static gboolean disable_minor_collections = FALSE;
 static gboolean disable_major_collections = FALSE;
 static gboolean do_verify_nursery = FALSE;
@@ -306,6 +308,13 @@ static SGEN_TV_DECLARE (time_major_conc_collection_end);
 static SGEN_TV_DECLARE (last_minor_collection_start_tv);
 static SGEN_TV_DECLARE (last_minor_collection_end_tv);
 
+/* The nursery collection pause goal, or 0 if the nursery isn't sized adaptively. */
+static gint64 nursery_max_pause = 0;
+/* Free bytes in the nursery after the last collection. */
+static mword nursery_bytes_available = 0;
+static guint64 stat_nursery_grows = 0;
+static guint64 stat_nursery_shrinks = 0;
+
 int gc_debug_level = 0;
 FILE* gc_debug_file;
 
@@ -363,6 +372,17 @@ LOCK_DECLARE (sgen_interruption_mutex);
 
 int current_collection_generation = -1;
 static volatile gboolean concurrent_collection_in_progress = FALSE;
+/*
+ * Only set while the workers are copying objects in a parallel nursery collection or in
+ * the finishing pause of a parallel concurrent major collection.
+ */
+static volatile gboolean parallel_collection_in_progress = FALSE;
+
+/*
+ * Protects the global remset and the pin queue while the workers of a parallel
+ * collection are running.
+ */
+LOCK_DECLARE (parallel_collection_mutex);
 
 /* objects that are ready to be finalized */
 static SgenPointerQueue fin_ready_queue = SGEN_POINTER_QUEUE_INIT (INTERNAL_MEM_FINALIZE_READY);
@@ -379,11 +399,11 @@ SgenHashTable roots_hash [ROOT_TYPE_NUM] = {
 };
 static mword roots_size = 0; /* amount of memory in the root set */
 
-/* The size of a TLAB */
+/* The initial and minimum size of a TLAB */
 /* The bigger the value, the less often we have to go to the slow path to allocate a new 
- * one, but the more space is wasted by threads not allocating much memory.
+ * one, but the more space is wasted by threads not allocating much memory.  Each thread
+ * adjusts its own size between this and SGEN_MAX_TLAB_SIZE, see sgen_clear_tlabs ().
  * FIXME: Tune this.
- * FIXME: Make this self-tuning for each thread.
  */
 guint32 tlab_size = (1024 * 4);
 
@@ -449,7 +469,7 @@ gray_queue_redirect (SgenGrayQueue *queue)
 	}
 
 	if (wake) {
-		g_assert (concurrent_collection_in_progress);
+		g_assert (concurrent_collection_in_progress || parallel_collection_in_progress);
 		sgen_workers_ensure_awake ();
 	}
 }
@@ -457,7 +477,7 @@ gray_queue_redirect (SgenGrayQueue *queue)
 static void
 gray_queue_enable_redirect (SgenGrayQueue *queue)
 {
-	if (!concurrent_collection_in_progress)
+	if (!concurrent_collection_in_progress && !parallel_collection_in_progress)
 		return;
 
 	sgen_gray_queue_set_alloc_prepare (queue, gray_queue_redirect, sgen_workers_get_distribute_section_gray_queue ());
@@ -532,6 +552,20 @@ sgen_add_to_global_remset (gpointer ptr, gpointer obj)
 	binary_protocol_global_remset (ptr, obj, (gpointer)SGEN_LOAD_VTABLE (obj));
 }
 
+/*
+ * sgen_add_to_global_remset_par:
+ *
+ *   Same as `sgen_add_to_global_remset()`, but for the workers of a parallel nursery
+ * collection.  Takes the global remset lock.
+ */
+void
+sgen_add_to_global_remset_par (gpointer ptr, gpointer obj)
+{
+	mono_mutex_lock (&parallel_collection_mutex);
+	sgen_add_to_global_remset (ptr, obj);
+	mono_mutex_unlock (&parallel_collection_mutex);
+}
+
 /*
  * sgen_drain_gray_stack:
  *
@@ -761,6 +795,28 @@ sgen_pin_object (GCObject *object, GrayQueue *queue)
 	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
 }
 
+/*
+ * The parallel version of `sgen_pin_object()`.  The object must already have been pinned
+ * with `SGEN_PIN_OBJECT_PAR()` by the caller, which guarantees that only one worker gets
+ * here for any given object.
+ */
+void
+sgen_pin_object_par (GCObject *object, GrayQueue *queue)
+{
+	SGEN_ASSERT (0, parallel_collection_in_progress, "Why are we pinning in parallel outside of a parallel collection?");
+	SGEN_ASSERT (0, SGEN_OBJECT_IS_PINNED (object), "The object must be pinned by the caller");
+
+	mono_mutex_lock (&parallel_collection_mutex);
+	sgen_pin_stage_ptr (object);
+	++objects_pinned;
+	sgen_pin_stats_register_object (object, safe_object_get_size (object));
+	mono_mutex_unlock (&parallel_collection_mutex);
+
+	binary_protocol_pin (object, (gpointer)LOAD_VTABLE (object), safe_object_get_size (object));
+
+	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
+}
+
 /* Sort the addresses in array in increasing order.
  * Done using a by-the book heap sort. Which has decent and stable performance, is pretty cache efficient.
  */
@@ -1264,6 +1320,9 @@ init_stats (void)
 
 	mono_counters_register ("Number of pinned objects", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pinned_objects);
 
+	mono_counters_register ("# nursery grows", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_nursery_grows);
+	mono_counters_register ("# nursery shrinks", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_nursery_shrinks);
+
 #ifdef HEAVY_STATISTICS
 	mono_counters_register ("WBarrier remember pointer", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_wbarrier_add_to_global_remset);
 	mono_counters_register ("WBarrier arrayref copy", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_wbarrier_arrayref_copy);
@@ -1305,7 +1364,7 @@ reset_pinned_from_failed_allocation (void)
 void
 sgen_set_pinned_from_failed_allocation (mword objsize)
 {
-	bytes_pinned_from_failed_allocation += objsize;
+	SGEN_ATOMIC_ADD_P (bytes_pinned_from_failed_allocation, objsize);
 }
 
 gboolean
@@ -1322,6 +1381,18 @@ sgen_collection_is_concurrent (void)
 	return FALSE;
 }
 
+gboolean
+sgen_collection_is_parallel (void)
+{
+	switch (current_collection_generation) {
+	case GENERATION_NURSERY:
+	case GENERATION_OLD:
+		return parallel_collection_in_progress;
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 sgen_concurrent_collection_in_progress (void)
 {
@@ -1418,7 +1489,7 @@ job_scan_los_mod_union_card_table (void *worker_data_untyped, SgenThreadPoolJob
 static void
 init_gray_queue (void)
 {
-	if (sgen_collection_is_concurrent ())
+	if (sgen_collection_is_concurrent () || sgen_collection_is_parallel ())
 		sgen_workers_init_distribute_gray_queue ();
 	sgen_gray_object_queue_init (&gray_queue, NULL);
 }
@@ -1449,6 +1520,7 @@ enqueue_scan_from_roots_jobs (char *heap_start, char *heap_end, SgenObjectOperat
 	/* Threads */
 
 	stdj = (ScanThreadDataJob*)sgen_thread_pool_job_alloc ("scan thread data", job_scan_thread_data, sizeof (ScanThreadDataJob));
+	stdj->ops = ops;
 	stdj->heap_start = heap_start;
 	stdj->heap_end = heap_end;
 	sgen_workers_enqueue_job (&stdj->job);
@@ -1466,6 +1538,50 @@ enqueue_scan_from_roots_jobs (char *heap_start, char *heap_end, SgenObjectOperat
 	sgen_workers_enqueue_job (&sfej->job);
 }
 
+/*
+ * Adaptive nursery sizing
+ *
+ * With `max-pause` the nursery we allocate is only the upper bound, and the mutator
+ * only gets a power of two sized part of it.  Most of the time of a nursery collection
+ * goes into copying the survivors, which are bounded by how much the mutator could
+ * allocate, so if a collection goes over the goal we shrink the usable part.  If we
+ * are well under the goal but a sizable part of what was allocated survived, objects
+ * are probably promoted only because they didn't have time to die, so we grow it.
+ */
+#define NURSERY_MIN_USABLE_SIZE		(256 * 1024)
+#define NURSERY_GROW_SURVIVAL_RATIO	0.05
+
+static void
+adjust_nursery_usable_size (gint64 pause)
+{
+	size_t usable_size = sgen_nursery_allocator_get_usable_size ();
+	size_t min_usable_size = MIN (NURSERY_MIN_USABLE_SIZE, sgen_nursery_size);
+	size_t new_usable_size = usable_size;
+	mword promoted = sgen_minor_collector.get_and_reset_bytes_promoted ();
+	double survival_rate = nursery_bytes_available ? (double)promoted / nursery_bytes_available : 0.0;
+
+	if (pause > nursery_max_pause) {
+		gint64 projected_pause = pause;
+		while (new_usable_size > min_usable_size && projected_pause > nursery_max_pause) {
+			new_usable_size /= 2;
+			projected_pause /= 2;
+		}
+	} else if (pause * 2 < nursery_max_pause && survival_rate > NURSERY_GROW_SURVIVAL_RATIO && usable_size < sgen_nursery_size) {
+		new_usable_size = usable_size * 2;
+	}
+
+	SGEN_LOG (2, "Nursery sizing: pause %ld ticks, survival rate %.3f, usable size %zu -> %zu", (long)pause, survival_rate, usable_size, new_usable_size);
+
+	if (new_usable_size == usable_size)
+		return;
+
+	if (new_usable_size > usable_size)
+		++stat_nursery_grows;
+	else
+		++stat_nursery_shrinks;
+	sgen_nursery_allocator_set_usable_size (new_usable_size);
+}
+
 /*
  * Perform a nursery collection.
  *
@@ -1479,8 +1595,13 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	char *nursery_next;
 	mword fragment_total;
 	ScanJob *sj;
-	SgenObjectOperations *object_ops = &sgen_minor_collector.serial_ops;
-	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (object_ops, &gray_queue);
+	/*
+	 * Parallel nursery collections are not done while a concurrent major collection is
+	 * in progress, because then the workers are busy marking.
+	 */
+	gboolean parallel = sgen_minor_collector.is_parallel && !concurrent_collection_in_progress;
+	SgenObjectOperations *object_ops = parallel ? &sgen_minor_collector.parallel_ops : &sgen_minor_collector.serial_ops;
+	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (&sgen_minor_collector.serial_ops, &gray_queue);
 	TV_DECLARE (atv);
 	TV_DECLARE (btv);
 
@@ -1490,6 +1611,10 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	TV_GETTIME (last_minor_collection_start_tv);
 	atv = last_minor_collection_start_tv;
 
+	/* Major collections might have promoted, too. */
+	if (nursery_max_pause)
+		sgen_minor_collector.get_and_reset_bytes_promoted ();
+
 	binary_protocol_collection_begin (gc_stats.minor_gc_count, GENERATION_NURSERY);
 
 	if (do_verify_nursery || do_dump_nursery_content)
@@ -1503,6 +1628,8 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 
 	check_scan_starts ();
 
+	parallel_collection_in_progress = parallel;
+
 	sgen_nursery_alloc_prepare_for_minor ();
 
 	degraded_mode = 0;
@@ -1558,6 +1685,25 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	SGEN_LOG (2, "Finding pinned pointers: %zd in %ld usecs", sgen_get_pinned_count (), TV_ELAPSED (btv, atv));
 	SGEN_LOG (4, "Start scan with %zd pinned objects", sgen_get_pinned_count ());
 
+	remset.start_scan_remsets ();
+
+	/*
+	 * The roots are reported to the profiler before the workers of a parallel collection
+	 * start, so the profiler isn't called while they scan and update the roots.
+	 */
+	sgen_client_collecting_minor (&fin_ready_queue, &critical_fin_queue);
+
+	/*
+	 * In a parallel collection the workers do all the copying, so we hand them the
+	 * pinned objects we have already enqueued, as well as everything the jobs find.
+	 */
+	if (parallel) {
+		SGEN_ASSERT (0, sgen_workers_all_done (), "Why are the workers not done when we start a nursery collection?");
+		major_collector.start_parallel_alloc ();
+		sgen_workers_start_all_workers (object_ops);
+		gray_queue_enable_redirect (WORKERS_DISTRIBUTE_GRAY_QUEUE);
+	}
+
 	/*
 	 * FIXME: When we finish a concurrent collection we do a nursery collection first,
 	 * as part of which we scan the card table.  Then, later, we scan the mod union
@@ -1576,14 +1722,22 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 
 	sgen_drain_gray_stack (-1, ctx);
 
-	/* FIXME: Why do we do this at this specific, seemingly random, point? */
-	sgen_client_collecting_minor (&fin_ready_queue, &critical_fin_queue);
-
 	TV_GETTIME (atv);
 	time_minor_scan_pinned += TV_ELAPSED (btv, atv);
 
 	enqueue_scan_from_roots_jobs (sgen_get_nursery_start (), nursery_next, object_ops);
 
+	if (parallel) {
+		sgen_workers_wait_for_jobs_finished ();
+		sgen_workers_join ();
+
+		/* From here on the main thread finishes up serially. */
+		sgen_gray_object_queue_disable_alloc_prepare (&gray_queue);
+		g_assert (sgen_section_gray_queue_is_empty (sgen_workers_get_distribute_section_gray_queue ()));
+		major_collector.finish_parallel_alloc ();
+		parallel_collection_in_progress = FALSE;
+	}
+
 	TV_GETTIME (btv);
 	time_minor_scan_roots += TV_ELAPSED (atv, btv);
 
@@ -1603,7 +1757,13 @@ collect_nursery (SgenGrayQueue *unpin_queue, gboolean finish_up_concurrent_mark)
 	 * next allocations.
 	 */
 	sgen_client_binary_protocol_reclaim_start (GENERATION_NURSERY);
+
+	/* The fragments are yet to be built, so the new size takes effect right away. */
+	if (nursery_max_pause)
+		adjust_nursery_usable_size (TV_ELAPSED (last_minor_collection_start_tv, atv));
+
 	fragment_total = sgen_build_nursery_fragments (nursery_section, unpin_queue);
+	nursery_bytes_available = fragment_total;
 	if (!fragment_total)
 		degraded_mode = 1;
 
@@ -1916,7 +2076,17 @@ major_finish_collection (const char *reason, size_t old_next_pin_slot, gboolean
 	TV_GETTIME (btv);
 
 	if (concurrent_collection_in_progress) {
-		object_ops = &major_collector.major_ops_concurrent_finish;
+		/*
+		 * With the parallel collector all the workers help finishing the marking.  Once
+		 * they're done we switch back to the serial ops.
+		 */
+		if (major_collector.is_parallel) {
+			parallel_collection_in_progress = TRUE;
+			major_collector.start_parallel_alloc ();
+			object_ops = &major_collector.major_ops_conc_par_finish;
+		} else {
+			object_ops = &major_collector.major_ops_concurrent_finish;
+		}
 
 		major_copy_or_mark_from_roots (NULL, COPY_OR_MARK_FROM_ROOTS_FINISH_CONCURRENT, object_ops);
 
@@ -1924,6 +2094,12 @@ major_finish_collection (const char *reason, size_t old_next_pin_slot, gboolean
 
 		sgen_workers_join ();
 
+		if (major_collector.is_parallel) {
+			major_collector.finish_parallel_alloc ();
+			parallel_collection_in_progress = FALSE;
+			object_ops = &major_collector.major_ops_concurrent_finish;
+		}
+
 		SGEN_ASSERT (0, sgen_gray_object_queue_is_empty (&gray_queue), "Why is the gray queue not empty after workers have finished working?");
 
 #ifdef SGEN_DEBUG_INTERNAL_ALLOC
@@ -1978,6 +2154,7 @@ major_finish_collection (const char *reason, size_t old_next_pin_slot, gboolean
 	 * next allocations.
 	 */
 	fragment_total = sgen_build_nursery_fragments (nursery_section, NULL);
+	nursery_bytes_available = fragment_total;
 	if (!fragment_total)
 		degraded_mode = 1;
 	SGEN_LOG (4, "Free space in nursery after major %ld", (long)fragment_total);
@@ -2436,6 +2613,19 @@ sgen_object_is_live (GCObject *obj)
 	return sgen_is_object_alive_and_on_current_collection (obj);
 }
 
+/*
+ * Whether `obj` will never move, because it's in the LOS or was allocated pinned.
+ */
+gboolean
+sgen_object_never_moves (GCObject *obj)
+{
+	if (ptr_in_nursery (obj))
+		return FALSE;
+	if (sgen_safe_object_get_size (obj) > SGEN_MAX_SMALL_OBJ_SIZE)
+		return TRUE;
+	return major_collector.obj_is_from_pinned_alloc ((char*)obj);
+}
+
 /*
  * `System.GC.WaitForPendingFinalizers` first checks `sgen_have_pending_finalizers()` to
  * determine whether it can exit quickly.  The latter must therefore only return FALSE if
@@ -2832,6 +3022,7 @@ sgen_gc_init (void)
 	gc_debug_file = stderr;
 
 	LOCK_INIT (sgen_interruption_mutex);
+	LOCK_INIT (parallel_collection_mutex);
 
 	if ((env = g_getenv (MONO_GC_PARAMS_NAME))) {
 		opts = g_strsplit (env, ",", -1);
@@ -2865,13 +3056,17 @@ sgen_gc_init (void)
 	sgen_client_init ();
 
 	if (!minor_collector_opt) {
-		sgen_simple_nursery_init (&sgen_minor_collector);
+		sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
 	} else {
 		if (!strcmp (minor_collector_opt, "simple")) {
 		use_simple_nursery:
-			sgen_simple_nursery_init (&sgen_minor_collector);
+			sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
+		} else if (!strcmp (minor_collector_opt, "simple-par")) {
+			sgen_simple_nursery_init (&sgen_minor_collector, TRUE);
 		} else if (!strcmp (minor_collector_opt, "split")) {
-			sgen_split_nursery_init (&sgen_minor_collector);
+			sgen_split_nursery_init (&sgen_minor_collector, FALSE);
+		} else if (!strcmp (minor_collector_opt, "split-par")) {
+			sgen_split_nursery_init (&sgen_minor_collector, TRUE);
 		} else {
 			sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `simple` instead.", "Unknown minor collector `%s'.", minor_collector_opt);
 			goto use_simple_nursery;
@@ -2883,11 +3078,22 @@ sgen_gc_init (void)
 		sgen_marksweep_init (&major_collector);
 	} else if (!major_collector_opt || !strcmp (major_collector_opt, "marksweep-conc")) {
 		sgen_marksweep_conc_init (&major_collector);
+	} else if (!strcmp (major_collector_opt, "marksweep-conc-par")) {
+		sgen_marksweep_conc_par_init (&major_collector);
 	} else {
 		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `marksweep` instead.", "Unknown major collector `%s'.", major_collector_opt);
 		goto use_marksweep_major;
 	}
 
+	/*
+	 * The serial concurrent major collector's worker is the only thread that may mark, so
+	 * we can't have more workers for the nursery.
+	 */
+	if (sgen_minor_collector.is_parallel && major_collector.is_concurrent && !major_collector.is_parallel) {
+		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using a serial nursery collector.", "Parallel nursery collectors can't be used with a concurrent major collector.");
+		sgen_minor_collector.is_parallel = FALSE;
+	}
+
 	sgen_nursery_size = DEFAULT_NURSERY_SIZE;
 
 	if (opts) {
@@ -2927,6 +3133,25 @@ sgen_gc_init (void)
 				continue;
 			}
 
+			if (g_str_has_prefix (opt, "max-pause=")) {
+				long val;
+				char *endptr;
+				opt = strchr (opt, '=') + 1;
+				val = strtol (opt, &endptr, 10);
+				if (!strcmp (endptr, "ms"))
+					endptr += 2;
+				if (!*opt || *endptr || val < 1) {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`max-pause` must be a positive number of milliseconds.");
+					continue;
+				}
+				if (!sgen_minor_collector.get_and_reset_bytes_promoted) {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`max-pause` is not supported by this nursery collector.");
+					continue;
+				}
+				nursery_max_pause = SGEN_TV_FROM_MSEC (val);
+				continue;
+			}
+
 #ifdef USER_CONFIG
 			if (g_str_has_prefix (opt, "nursery-size=")) {
 				size_t val;
@@ -2990,6 +3215,24 @@ sgen_gc_init (void)
 				}
 			}
 
+			if (g_str_has_prefix (opt, "parallel-mark-workers=")) {
+				long val;
+				char *endptr;
+				if (!major_collector.is_parallel) {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`parallel-mark-workers` is only valid for the parallel major collector.");
+					continue;
+				}
+
+				opt = strchr (opt, '=') + 1;
+				val = strtol (opt, &endptr, 10);
+				if (!*opt || *endptr || val < 1 || val > SGEN_THREADPOOL_MAX_NUM_THREADS) {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using default value.", "`parallel-mark-workers` must be an integer in the range 1-%d.", SGEN_THREADPOOL_MAX_NUM_THREADS);
+					continue;
+				}
+				num_parallel_mark_workers = (int)val;
+				continue;
+			}
+
 			if (!strcmp (opt, "cementing")) {
 				cement_enabled = TRUE;
 				continue;
@@ -3017,12 +3260,15 @@ sgen_gc_init (void)
 			fprintf (stderr, "  max-heap-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  soft-heap-limit=n (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  nursery-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
-			fprintf (stderr, "  major=COLLECTOR (where COLLECTOR is `marksweep', `marksweep-conc', `marksweep-par')\n");
-			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple' or `split')\n");
+			fprintf (stderr, "  max-pause=N (where N is the nursery collection pause goal in milliseconds)\n");
+			fprintf (stderr, "  major=COLLECTOR (where COLLECTOR is `marksweep', `marksweep-conc', `marksweep-conc-par')\n");
+			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple', `simple-par', `split' or `split-par')\n");
 			fprintf (stderr, "  wbarrier=WBARRIER (where WBARRIER is `remset' or `cardtable')\n");
 			fprintf (stderr, "  [no-]cementing\n");
 			if (major_collector.is_concurrent)
 				fprintf (stderr, "  allow-synchronous-major=FLAG (where FLAG is `yes' or `no')\n");
+			if (major_collector.is_parallel)
+				fprintf (stderr, "  parallel-mark-workers=N (where N is the number of marking threads)\n");
 			if (major_collector.print_gc_param_usage)
 				major_collector.print_gc_param_usage ();
 			if (sgen_minor_collector.print_gc_param_usage)
@@ -3188,10 +3434,20 @@ sgen_gc_init (void)
 	if (major_collector.post_param_init)
 		major_collector.post_param_init (&major_collector);
 
-	if (major_collector.needs_thread_pool)
-		sgen_workers_init (1);
+	if (sgen_minor_collector.is_parallel || major_collector.is_parallel) {
+		int num_workers = MIN (mono_cpu_count (), SGEN_THREADPOOL_MAX_NUM_THREADS);
+		if (major_collector.is_parallel && num_parallel_mark_workers)
+			num_workers = num_parallel_mark_workers;
+		sgen_workers_init (num_workers);
+	} else if (major_collector.needs_thread_pool) {
+		int num_threads = 1;
+		if (!major_collector.is_concurrent && major_collector.num_sweep_threads > 1)
+			num_threads = MIN (major_collector.num_sweep_threads, SGEN_THREADPOOL_MAX_NUM_THREADS);
+		sgen_workers_init (num_threads);
+	}
 
 	sgen_memgov_init (max_heap, soft_limit, debug_print_allowance, allowance_ratio, save_target);
+	sgen_los_init ();
 
 	memset (&remset, 0, sizeof (remset));
 
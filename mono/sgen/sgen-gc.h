@@ -257,9 +257,18 @@ sgen_get_nursery_end (void)
 #define SGEN_FORWARD_OBJECT(obj,fw_addr) do {				\
 		*(void**)(obj) = SGEN_POINTER_TAG_FORWARDED ((fw_addr));	\
 	} while (0)
+/*
+ * Atomically forward OBJ to FW_ADDR, provided its vtable word is still VTABLE.  Evaluates
+ * to the old vtable word, so the caller won the race iff that's VTABLE.
+ */
+#define SGEN_FORWARD_OBJECT_PAR(obj,fw_addr,vtable)	\
+	SGEN_CAS_PTR ((gpointer*)(obj), SGEN_POINTER_TAG_FORWARDED ((fw_addr)), (gpointer)(vtable))
 #define SGEN_PIN_OBJECT(obj) do {	\
 		*(void**)(obj) = SGEN_POINTER_TAG_PINNED (*(void**)(obj)); \
 	} while (0)
+/* Like SGEN_FORWARD_OBJECT_PAR, but pins the object instead. */
+#define SGEN_PIN_OBJECT_PAR(obj,vtable)	\
+	SGEN_CAS_PTR ((gpointer*)(obj), SGEN_POINTER_TAG_PINNED ((vtable)), (gpointer)(vtable))
 #define SGEN_CEMENT_OBJECT(obj) do {	\
 		*(void**)(obj) = SGEN_POINTER_TAG_CEMENTED (*(void**)(obj)); \
 	} while (0)
@@ -398,11 +407,18 @@ struct _SgenThreadInfo {
 	char **tlab_temp_end_addr;
 	char **tlab_real_end_addr;
 
+	/* The size of the TLABs this thread gets, adjusted at every collection. */
+	guint32 *tlab_size_addr;
+	/* TLABs allocated since the last collection. */
+	guint32 *tlab_refills_addr;
+
 #ifndef HAVE_KW_THREAD
 	char *tlab_start;
 	char *tlab_next;
 	char *tlab_temp_end;
 	char *tlab_real_end;
+	guint32 tlab_size;
+	guint32 tlab_refills;
 #endif
 };
 
@@ -450,6 +466,7 @@ void sgen_add_to_global_remset (gpointer ptr, gpointer obj);
 
 int sgen_get_current_collection_generation (void);
 gboolean sgen_collection_is_concurrent (void);
+gboolean sgen_collection_is_parallel (void);
 gboolean sgen_concurrent_collection_in_progress (void);
 
 typedef struct _SgenFragment SgenFragment;
@@ -534,10 +551,15 @@ sgen_nursery_is_object_alive (GCObject *obj)
 
 typedef struct {
 	gboolean is_split;
+	gboolean is_parallel;
 
 	GCObject* (*alloc_for_promotion) (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references);
+	/* Only called from the workers of parallel collections.  OBJ is always in the nursery. */
+	GCObject* (*alloc_for_promotion_par) (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references);
 
 	SgenObjectOperations serial_ops;
+	/* Used by the workers in parallel collections.  Only filled in if `is_parallel`. */
+	SgenObjectOperations parallel_ops;
 
 	void (*prepare_to_space) (char *to_space_bitmap, size_t space_bitmap_size);
 	void (*clear_fragments) (void);
@@ -545,6 +567,8 @@ typedef struct {
 	void (*build_fragments_release_exclude_head) (void);
 	void (*build_fragments_finish) (SgenFragmentAllocator *allocator);
 	void (*init_nursery) (SgenFragmentAllocator *allocator, char *start, char *end);
+	/* Bytes promoted since the last call.  Optional, used for adaptive nursery sizing. */
+	mword (*get_and_reset_bytes_promoted) (void);
 
 	gboolean (*handle_gc_param) (const char *opt); /* Optional */
 	void (*print_gc_param_usage) (void); /* Optional */
@@ -552,8 +576,8 @@ typedef struct {
 
 extern SgenMinorCollector sgen_minor_collector;
 
-void sgen_simple_nursery_init (SgenMinorCollector *collector);
-void sgen_split_nursery_init (SgenMinorCollector *collector);
+void sgen_simple_nursery_init (SgenMinorCollector *collector, gboolean parallel);
+void sgen_split_nursery_init (SgenMinorCollector *collector, gboolean parallel);
 
 /* Updating references */
 
@@ -564,7 +588,7 @@ sgen_update_reference (GCObject **p, GCObject *o, gboolean allow_null)
 {
 	if (!allow_null)
 		SGEN_ASSERT (0, o, "Cannot update a reference with a NULL pointer");
-	SGEN_ASSERT (0, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Can't update a reference in the worker thread");
+	SGEN_ASSERT (0, sgen_collection_is_parallel () || !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Can't update a reference in the worker thread");
 	*p = o;
 }
 
@@ -600,7 +624,14 @@ typedef struct _SgenMajorCollector SgenMajorCollector;
 struct _SgenMajorCollector {
 	size_t section_size;
 	gboolean is_concurrent;
+	/* Whether the concurrent collector marks with more than one worker. */
+	gboolean is_parallel;
 	gboolean needs_thread_pool;
+	/*
+	 * How many thread pool threads the sweep can use.  Only honored if the thread pool
+	 * isn't sized for marking.
+	 */
+	int num_sweep_threads;
 	gboolean supports_cardtable;
 	gboolean sweeps_lazily;
 
@@ -620,8 +651,18 @@ struct _SgenMajorCollector {
 	SgenObjectOperations major_ops_concurrent_start;
 	SgenObjectOperations major_ops_concurrent;
 	SgenObjectOperations major_ops_concurrent_finish;
+	/* Used by the workers in the finishing pause if `is_parallel`. */
+	SgenObjectOperations major_ops_conc_par_finish;
 
 	GCObject* (*alloc_object) (GCVTable vtable, size_t size, gboolean has_references);
+	/*
+	 * Used by the workers of parallel collections, between `start_parallel_alloc` and
+	 * `finish_parallel_alloc`.  Objects allocated this way only become visible to the
+	 * rest of the collector after the latter.
+	 */
+	GCObject* (*alloc_object_par) (GCVTable vtable, size_t size, gboolean has_references);
+	void (*start_parallel_alloc) (void);
+	void (*finish_parallel_alloc) (void);
 	void (*free_pinned_object) (GCObject *obj, size_t size);
 
 	/*
@@ -651,6 +692,8 @@ struct _SgenMajorCollector {
 	gboolean (*drain_gray_stack) (ScanCopyContext ctx);
 	gboolean (*ptr_is_in_non_pinned_space) (char *ptr, char **start);
 	gboolean (*ptr_is_from_pinned_alloc) (char *ptr);
+	/* `obj` must be a small object in the major heap. */
+	gboolean (*obj_is_from_pinned_alloc) (char *obj);
 	void (*report_pinned_memory_usage) (void);
 	size_t (*get_num_major_sections) (void);
 	size_t (*get_bytes_survived_last_sweep) (void);
@@ -671,6 +714,7 @@ void sgen_marksweep_fixed_init (SgenMajorCollector *collector);
 void sgen_marksweep_par_init (SgenMajorCollector *collector);
 void sgen_marksweep_fixed_par_init (SgenMajorCollector *collector);
 void sgen_marksweep_conc_init (SgenMajorCollector *collector);
+void sgen_marksweep_conc_par_init (SgenMajorCollector *collector);
 SgenMajorCollector* sgen_get_major_collector (void);
 
 
@@ -682,6 +726,7 @@ typedef struct _SgenRememberedSet {
 	void (*wbarrier_generic_nostore) (gpointer ptr);
 	void (*record_pointer) (gpointer ptr);
 
+	void (*start_scan_remsets) (void);
 	void (*scan_remsets) (ScanCopyContext ctx);
 
 	void (*clear_cards) (void);
@@ -810,6 +855,8 @@ enum {
 };
 
 void sgen_pin_object (GCObject *object, SgenGrayQueue *queue);
+void sgen_pin_object_par (GCObject *object, SgenGrayQueue *queue);
+void sgen_add_to_global_remset_par (gpointer ptr, gpointer obj);
 void sgen_set_pinned_from_failed_allocation (mword objsize);
 
 void sgen_ensure_free_space (size_t size);
@@ -854,6 +901,9 @@ struct _LOSObject {
 extern LOSObject *los_object_list;
 extern mword los_memory_usage;
 
+gboolean sgen_object_never_moves (GCObject *obj);
+
+void sgen_los_init (void);
 void sgen_los_free_object (LOSObject *obj);
 void* sgen_los_alloc_large_inner (GCVTable vtable, size_t size);
 void sgen_los_sweep (void);
@@ -868,6 +918,7 @@ gboolean mono_sgen_los_describe_pointer (char *ptr);
 LOSObject* sgen_los_header_for_object (GCObject *data);
 mword sgen_los_object_size (LOSObject *obj);
 void sgen_los_pin_object (GCObject *obj);
+gboolean sgen_los_pin_object_par (GCObject *obj);
 gboolean sgen_los_object_is_pinned (GCObject *obj);
 void sgen_los_mark_mod_union_card (GCObject *mono_obj, void **ptr);
 
@@ -877,6 +928,8 @@ void sgen_los_mark_mod_union_card (GCObject *mono_obj, void **ptr);
 void sgen_clear_nursery_fragments (void);
 void sgen_nursery_allocator_prepare_for_pinning (void);
 void sgen_nursery_allocator_set_nursery_bounds (char *nursery_start, char *nursery_end);
+void sgen_nursery_allocator_set_usable_size (size_t size);
+size_t sgen_nursery_allocator_get_usable_size (void);
 mword sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpin_queue);
 void sgen_init_nursery_allocator (void);
 void sgen_nursery_allocator_init_heavy_stats (void);
@@ -994,6 +1047,7 @@ void sgen_clear_tlabs (void);
 
 GCObject* sgen_alloc_obj (GCVTable vtable, size_t size);
 GCObject* sgen_alloc_obj_pinned (GCVTable vtable, size_t size);
+GCObject* sgen_alloc_obj_pinned_nolock (GCVTable vtable, size_t size);
 GCObject* sgen_alloc_obj_mature (GCVTable vtable, size_t size);
 
 /* Debug support */
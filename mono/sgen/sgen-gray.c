@@ -31,6 +31,7 @@ guint64 stat_gray_queue_enqueue_fast_path;
 guint64 stat_gray_queue_dequeue_fast_path;
 guint64 stat_gray_queue_enqueue_slow_path;
 guint64 stat_gray_queue_dequeue_slow_path;
+guint64 stat_gray_queue_section_steal;
 #endif
 
 #define GRAY_QUEUE_LENGTH_LIMIT	64
@@ -49,6 +50,60 @@ guint64 stat_gray_queue_dequeue_slow_path;
 #define STATE_ASSERT(s,v)
 #endif
 
+static void
+lock_queue (SgenGrayQueue *queue)
+{
+	if (queue->parallel)
+		mono_mutex_lock (&queue->steal_mutex);
+}
+
+static void
+unlock_queue (SgenGrayQueue *queue)
+{
+	if (queue->parallel)
+		mono_mutex_unlock (&queue->steal_mutex);
+}
+
+/* Only called by the owner of the queue. */
+static void
+link_first_section (SgenGrayQueue *queue, GrayQueueSection *section)
+{
+	lock_queue (queue);
+
+	section->prev = NULL;
+	section->next = queue->first;
+	if (queue->first)
+		queue->first->prev = section;
+	else
+		queue->last = section;
+	queue->first = section;
+	++queue->num_sections;
+
+	unlock_queue (queue);
+}
+
+/* Only called by the owner of the queue. */
+static GrayQueueSection*
+unlink_first_section (SgenGrayQueue *queue)
+{
+	GrayQueueSection *section;
+
+	lock_queue (queue);
+
+	section = queue->first;
+	queue->first = section->next;
+	if (queue->first)
+		queue->first->prev = NULL;
+	else
+		queue->last = NULL;
+	--queue->num_sections;
+
+	unlock_queue (queue);
+
+	section->next = section->prev = NULL;
+	return section;
+}
+
 void
 sgen_gray_object_alloc_queue_section (SgenGrayQueue *queue)
 {
@@ -75,8 +130,7 @@ sgen_gray_object_alloc_queue_section (SgenGrayQueue *queue)
 	STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_FLOATING, GRAY_QUEUE_SECTION_STATE_ENQUEUED);
 
 	/* Link it with the others */
-	section->next = queue->first;
-	queue->first = section;
+	link_first_section (queue, section);
 	queue->cursor = section->entries - 1;
 }
 
@@ -149,8 +203,7 @@ sgen_gray_object_dequeue (SgenGrayQueue *queue)
 #endif
 
 	if (G_UNLIKELY (queue->cursor < GRAY_FIRST_CURSOR_POSITION (queue->first))) {
-		GrayQueueSection *section = queue->first;
-		queue->first = section->next;
+		GrayQueueSection *section = unlink_first_section (queue);
 		section->next = queue->free_list;
 
 		STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_ENQUEUED, GRAY_QUEUE_SECTION_STATE_FREE_LIST);
@@ -170,10 +223,7 @@ sgen_gray_object_dequeue_section (SgenGrayQueue *queue)
 	if (!queue->first)
 		return NULL;
 
-	section = queue->first;
-	queue->first = section->next;
-
-	section->next = NULL;
+	section = unlink_first_section (queue);
 	section->size = queue->cursor - section->entries + 1;
 
 	queue->cursor = queue->first ? queue->first->entries + queue->first->size - 1 : NULL;
@@ -191,8 +241,7 @@ sgen_gray_object_enqueue_section (SgenGrayQueue *queue, GrayQueueSection *sectio
 	if (queue->first)
 		queue->first->size = queue->cursor - queue->first->entries + 1;
 
-	section->next = queue->first;
-	queue->first = section;
+	link_first_section (queue, section);
 	queue->cursor = queue->first->entries + queue->first->size - 1;
 #ifdef SGEN_CHECK_GRAY_OBJECT_ENQUEUE
 	if (queue->enqueue_check_func) {
@@ -237,6 +286,58 @@ sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enq
 	sgen_gray_object_queue_trim_free_list (queue);
 }
 
+/*
+ * Makes the queue safe for other threads to steal sections from it with
+ * `sgen_gray_object_steal_section()`.  The queue stays parallel for its whole lifetime.
+ */
+void
+sgen_gray_object_queue_init_parallel (SgenGrayQueue *queue)
+{
+	if (queue->parallel)
+		return;
+	mono_mutex_init (&queue->steal_mutex);
+	queue->parallel = TRUE;
+}
+
+/*
+ * Takes the oldest section away from QUEUE, which is owned by another thread.  Returns
+ * NULL if there's nothing to steal or if the queue is contended.  The section the owner
+ * is currently working on is never stolen.
+ */
+GrayQueueSection*
+sgen_gray_object_steal_section (SgenGrayQueue *queue)
+{
+	GrayQueueSection *section;
+
+	SGEN_ASSERT (0, queue->parallel, "Can only steal from parallel gray queues");
+
+	if (queue->num_sections <= 1)
+		return NULL;
+
+	if (mono_mutex_trylock (&queue->steal_mutex) != 0)
+		return NULL;
+
+	if (queue->num_sections <= 1) {
+		mono_mutex_unlock (&queue->steal_mutex);
+		return NULL;
+	}
+
+	section = queue->last;
+	queue->last = section->prev;
+	queue->last->next = NULL;
+	--queue->num_sections;
+
+	mono_mutex_unlock (&queue->steal_mutex);
+
+	section->prev = NULL;
+
+	STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_ENQUEUED, GRAY_QUEUE_SECTION_STATE_FLOATING);
+
+	HEAVY_STAT (stat_gray_queue_section_steal ++);
+
+	return section;
+}
+
 static void
 invalid_prepare_func (SgenGrayQueue *queue)
 {
@@ -378,6 +479,7 @@ sgen_init_gray_queues (void)
 	mono_counters_register ("Gray Queue dequeue fast path", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_gray_queue_dequeue_fast_path);
 	mono_counters_register ("Gray Queue enqueue slow path", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_gray_queue_enqueue_slow_path);
 	mono_counters_register ("Gray Queue dequeue slow path", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_gray_queue_dequeue_slow_path);
+	mono_counters_register ("Gray Queue section steal", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_gray_queue_section_steal);
 #endif
 }
 #endif
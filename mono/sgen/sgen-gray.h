@@ -52,9 +52,9 @@
 
 /* SGEN_GRAY_QUEUE_HEADER_SIZE is number of machine words */
 #ifdef SGEN_CHECK_GRAY_OBJECT_SECTIONS
-#define SGEN_GRAY_QUEUE_HEADER_SIZE	4
+#define SGEN_GRAY_QUEUE_HEADER_SIZE	5
 #else
-#define SGEN_GRAY_QUEUE_HEADER_SIZE	2
+#define SGEN_GRAY_QUEUE_HEADER_SIZE	3
 #endif
 
 #define SGEN_GRAY_QUEUE_SECTION_SIZE	(128 - SGEN_GRAY_QUEUE_HEADER_SIZE)
@@ -91,7 +91,7 @@ struct _GrayQueueSection {
 	GrayQueueSectionState state;
 #endif
 	int size;
-	GrayQueueSection *next;
+	GrayQueueSection *next, *prev;
 	GrayQueueEntry entries [SGEN_GRAY_QUEUE_SECTION_SIZE];
 };
 
@@ -100,10 +100,19 @@ typedef struct _SgenGrayQueue SgenGrayQueue;
 typedef void (*GrayQueueAllocPrepareFunc) (SgenGrayQueue*);
 typedef void (*GrayQueueEnqueueCheckFunc) (GCObject*);
 
+/*
+ * A parallel gray queue can have sections stolen from it by other threads.  The owner
+ * pushes and pops entries at the `first` section without synchronization, while thieves
+ * only ever take the `last` section, and only if it's not also the first one.  Changes
+ * to the section list itself are done with `steal_mutex` held.
+ */
 struct _SgenGrayQueue {
 	GrayQueueEntry *cursor;
-	GrayQueueSection *first;
+	GrayQueueSection *first, *last;
 	GrayQueueSection *free_list;
+	volatile gint32 num_sections;
+	gboolean parallel;
+	mono_mutex_t steal_mutex;
 	GrayQueueAllocPrepareFunc alloc_prepare_func;
 #ifdef SGEN_CHECK_GRAY_OBJECT_ENQUEUE
 	GrayQueueEnqueueCheckFunc enqueue_check_func;
@@ -132,6 +141,7 @@ extern guint64 stat_gray_queue_enqueue_fast_path;
 extern guint64 stat_gray_queue_dequeue_fast_path;
 extern guint64 stat_gray_queue_enqueue_slow_path;
 extern guint64 stat_gray_queue_dequeue_slow_path;
+extern guint64 stat_gray_queue_section_steal;
 #endif
 
 void sgen_init_gray_queues (void);
@@ -142,6 +152,8 @@ GrayQueueSection* sgen_gray_object_dequeue_section (SgenGrayQueue *queue);
 void sgen_gray_object_enqueue_section (SgenGrayQueue *queue, GrayQueueSection *section);
 void sgen_gray_object_queue_trim_free_list (SgenGrayQueue *queue);
 void sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func);
+void sgen_gray_object_queue_init_parallel (SgenGrayQueue *queue);
+GrayQueueSection* sgen_gray_object_steal_section (SgenGrayQueue *queue);
 void sgen_gray_object_queue_init_invalid (SgenGrayQueue *queue);
 void sgen_gray_queue_set_alloc_prepare (SgenGrayQueue *queue, GrayQueueAllocPrepareFunc alloc_prepare_func, void *data);
 void sgen_gray_object_queue_init_with_alloc_prepare (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func,
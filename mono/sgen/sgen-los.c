@@ -39,7 +39,9 @@
 #include "mono/sgen/sgen-protocol.h"
 #include "mono/sgen/sgen-cardtable.h"
 #include "mono/sgen/sgen-memory-governor.h"
+#include "mono/sgen/sgen-thread-pool.h"
 #include "mono/sgen/sgen-client.h"
+#include "mono/utils/mono-counters.h"
 
 #define LOS_SECTION_SIZE	(1024 * 1024)
 
@@ -58,12 +60,30 @@
 #define LOS_SECTION_FOR_OBJ(obj)	((LOSSection*)((mword)(obj) & ~(mword)(LOS_SECTION_SIZE - 1)))
 #define LOS_CHUNK_INDEX(obj,section)	(((char*)(obj) - (char*)(section)) >> LOS_CHUNK_BITS)
 
+/*
+ * Free chunks smaller than LOS_NUM_FAST_SIZES chunks have a free list per size.  Larger
+ * ones are binned by powers of two: the first bin holds free chunks of
+ * LOS_NUM_FAST_SIZES up to twice that many chunks, and so on.  Free list 0 is unused.
+ */
 #define LOS_NUM_FAST_SIZES		32
+#define LOS_NUM_FAST_SIZES_BITS		5
+/* Three power of two bins are enough for free chunks of up to LOS_SECTION_NUM_CHUNKS. */
+#define LOS_NUM_FREE_LISTS		(LOS_NUM_FAST_SIZES + 3)
+
+/* Free chunks at least this big get their pages decommitted in the background. */
+#define LOS_DECOMMIT_MIN_SIZE		(16 * LOS_CHUNK_SIZE)
 
+/*
+ * Free chunks are always coalesced with their neighbours, so the chunk after a free chunk
+ * and the one before it are never free.
+ */
 typedef struct _LOSFreeChunks LOSFreeChunks;
 struct _LOSFreeChunks {
 	LOSFreeChunks *next_size;
+	LOSFreeChunks *prev_size;
 	size_t size;
+	/* whether the pages after the first one have been decommitted */
+	gboolean decommitted;
 };
 
 typedef struct _LOSSection LOSSection;
@@ -77,10 +97,22 @@ LOSObject *los_object_list = NULL;
 mword los_memory_usage = 0;
 
 static LOSSection *los_sections = NULL;
-static LOSFreeChunks *los_fast_free_lists [LOS_NUM_FAST_SIZES]; /* 0 is for larger sizes */
+static LOSFreeChunks *los_free_lists [LOS_NUM_FREE_LISTS];
 static mword los_num_objects = 0;
 static int los_num_sections = 0;
 
+/*
+ * The free lists are only ever used with the GC lock held, except by the decommit job,
+ * which doesn't take the GC lock, so we need this lock, too.
+ */
+static mono_mutex_t los_free_lists_mutex;
+static SgenThreadPoolJob * volatile decommit_job;
+
+static mword stat_los_free_bytes;
+static mword stat_los_largest_free_chunk;
+static mword stat_los_bytes_decommitted;
+static guint64 stat_los_chunks_coalesced;
+
 //#define USE_MALLOC
 //#define LOS_CONSISTENCY_CHECK
 //#define LOS_DUMMY
@@ -98,6 +130,21 @@ sgen_los_object_size (LOSObject *obj)
 	return obj->size & ~1L;
 }
 
+static int
+free_list_index (size_t num_chunks)
+{
+	int index;
+
+	if (num_chunks < LOS_NUM_FAST_SIZES)
+		return num_chunks;
+
+	index = LOS_NUM_FAST_SIZES;
+	for (num_chunks >>= LOS_NUM_FAST_SIZES_BITS + 1; num_chunks; num_chunks >>= 1)
+		++index;
+	g_assert (index < LOS_NUM_FREE_LISTS);
+	return index;
+}
+
 #ifdef LOS_CONSISTENCY_CHECK
 static void
 los_consistency_check (void)
@@ -127,19 +174,19 @@ los_consistency_check (void)
 			g_assert (!section->free_chunk_map [i]);
 	}
 
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i) {
+	for (i = 0; i < LOS_NUM_FREE_LISTS; ++i) {
 		LOSFreeChunks *size_chunks;
-		for (size_chunks = los_fast_free_lists [i]; size_chunks; size_chunks = size_chunks->next_size) {
+		for (size_chunks = los_free_lists [i]; size_chunks; size_chunks = size_chunks->next_size) {
 			LOSSection *section = LOS_SECTION_FOR_OBJ (size_chunks);
 			int j, num_chunks, start_index;
 
-			if (i == 0)
-				g_assert (size_chunks->size >= LOS_NUM_FAST_SIZES * LOS_CHUNK_SIZE);
-			else
-				g_assert (size_chunks->size == i * LOS_CHUNK_SIZE);
-
 			num_chunks = size_chunks->size >> LOS_CHUNK_BITS;
+			g_assert (free_list_index (num_chunks) == i);
+			g_assert (!size_chunks->next_size || size_chunks->next_size->prev_size == size_chunks);
+
 			start_index = LOS_CHUNK_INDEX (size_chunks, section);
+			g_assert (!section->free_chunk_map [start_index - 1]);
+			g_assert (start_index + num_chunks > LOS_SECTION_NUM_CHUNKS || !section->free_chunk_map [start_index + num_chunks]);
 			for (j = start_index; j < start_index + num_chunks; ++j)
 				g_assert (section->free_chunk_map [j]);
 		}
@@ -150,42 +197,56 @@ los_consistency_check (void)
 #endif
 
 static void
-add_free_chunk (LOSFreeChunks *free_chunks, size_t size)
+add_free_chunk (LOSFreeChunks *free_chunks, size_t size, gboolean decommitted)
 {
-	size_t num_chunks = size >> LOS_CHUNK_BITS;
+	int index = free_list_index (size >> LOS_CHUNK_BITS);
 
 	free_chunks->size = size;
+	free_chunks->decommitted = decommitted;
 
-	if (num_chunks >= LOS_NUM_FAST_SIZES)
-		num_chunks = 0;
-	free_chunks->next_size = los_fast_free_lists [num_chunks];
-	los_fast_free_lists [num_chunks] = free_chunks;
+	free_chunks->prev_size = NULL;
+	free_chunks->next_size = los_free_lists [index];
+	if (free_chunks->next_size)
+		free_chunks->next_size->prev_size = free_chunks;
+	los_free_lists [index] = free_chunks;
+}
+
+static void
+remove_free_chunk (LOSFreeChunks *free_chunks)
+{
+	if (free_chunks->prev_size) {
+		free_chunks->prev_size->next_size = free_chunks->next_size;
+	} else {
+		int index = free_list_index (free_chunks->size >> LOS_CHUNK_BITS);
+		g_assert (los_free_lists [index] == free_chunks);
+		los_free_lists [index] = free_chunks->next_size;
+	}
+	if (free_chunks->next_size)
+		free_chunks->next_size->prev_size = free_chunks->prev_size;
 }
 
 static LOSFreeChunks*
-get_from_size_list (LOSFreeChunks **list, size_t size)
+get_from_size_list (int index, size_t size)
 {
-	LOSFreeChunks *free_chunks = NULL;
+	LOSFreeChunks *free_chunks;
 	LOSSection *section;
 	size_t i, num_chunks, start_index;
 
-
 	g_assert ((size & (LOS_CHUNK_SIZE - 1)) == 0);
 
-	while (*list) {
-		free_chunks = *list;
+	/* Only the lists of the power of two bins can have chunks that are too small. */
+	for (free_chunks = los_free_lists [index]; free_chunks; free_chunks = free_chunks->next_size) {
 		if (free_chunks->size >= size)
 			break;
-		list = &(*list)->next_size;
 	}
 
-	if (!*list)
+	if (!free_chunks)
 		return NULL;
 
-	*list = free_chunks->next_size;
+	remove_free_chunk (free_chunks);
 
 	if (free_chunks->size > size)
-		add_free_chunk ((LOSFreeChunks*)((char*)free_chunks + size), free_chunks->size - size);
+		add_free_chunk ((LOSFreeChunks*)((char*)free_chunks + size), free_chunks->size - size, free_chunks->decommitted);
 
 	num_chunks = size >> LOS_CHUNK_BITS;
 
@@ -207,8 +268,9 @@ static LOSObject*
 get_los_section_memory (size_t size)
 {
 	LOSSection *section;
-	LOSFreeChunks *free_chunks;
+	LOSFreeChunks *free_chunks = NULL;
 	size_t num_chunks;
+	int i;
 
 	size += LOS_CHUNK_SIZE - 1;
 	size &= ~(LOS_CHUNK_SIZE - 1);
@@ -219,18 +281,13 @@ get_los_section_memory (size_t size)
 	g_assert (num_chunks > 0);
 
  retry:
-	if (num_chunks >= LOS_NUM_FAST_SIZES) {
-		free_chunks = get_from_size_list (&los_fast_free_lists [0], size);
-	} else {
-		size_t i;
-		for (i = num_chunks; i < LOS_NUM_FAST_SIZES; ++i) {
-			free_chunks = get_from_size_list (&los_fast_free_lists [i], size);
-			if (free_chunks)
-				break;
-		}
-		if (!free_chunks)
-			free_chunks = get_from_size_list (&los_fast_free_lists [0], size);
+	mono_mutex_lock (&los_free_lists_mutex);
+	for (i = free_list_index (num_chunks); i < LOS_NUM_FREE_LISTS; ++i) {
+		free_chunks = get_from_size_list (i, size);
+		if (free_chunks)
+			break;
 	}
+	mono_mutex_unlock (&los_free_lists_mutex);
 
 	if (free_chunks)
 		return (LOSObject*)free_chunks;
@@ -243,10 +300,9 @@ get_los_section_memory (size_t size)
 	if (!section)
 		return NULL;
 
-	free_chunks = (LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE);
-	free_chunks->size = LOS_SECTION_SIZE - LOS_CHUNK_SIZE;
-	free_chunks->next_size = los_fast_free_lists [0];
-	los_fast_free_lists [0] = free_chunks;
+	mono_mutex_lock (&los_free_lists_mutex);
+	add_free_chunk ((LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE), LOS_SECTION_SIZE - LOS_CHUNK_SIZE, FALSE);
+	mono_mutex_unlock (&los_free_lists_mutex);
 
 	section->num_free_chunks = LOS_SECTION_NUM_CHUNKS;
 
@@ -267,7 +323,8 @@ static void
 free_los_section_memory (LOSObject *obj, size_t size)
 {
 	LOSSection *section = LOS_SECTION_FOR_OBJ (obj);
-	size_t num_chunks, i, start_index;
+	LOSFreeChunks *free_chunks = (LOSFreeChunks*)obj;
+	size_t num_chunks, i, start_index, end_index;
 
 	size += LOS_CHUNK_SIZE - 1;
 	size &= ~(LOS_CHUNK_SIZE - 1);
@@ -287,16 +344,48 @@ free_los_section_memory (LOSObject *obj, size_t size)
 	 */
 
 	start_index = LOS_CHUNK_INDEX (obj, section);
-	for (i = start_index; i < start_index + num_chunks; ++i) {
+	end_index = start_index + num_chunks;
+	for (i = start_index; i < end_index; ++i) {
 		g_assert (!section->free_chunk_map [i]);
 		section->free_chunk_map [i] = 1;
 	}
 
-	add_free_chunk ((LOSFreeChunks*)obj, size);
+	mono_mutex_lock (&los_free_lists_mutex);
+
+	/* Coalesce with the free chunks after and before us. */
+	if (end_index <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [end_index]) {
+		LOSFreeChunks *next = (LOSFreeChunks*)((char*)section + (end_index << LOS_CHUNK_BITS));
+		remove_free_chunk (next);
+		size += next->size;
+		++stat_los_chunks_coalesced;
+	}
+	if (section->free_chunk_map [start_index - 1]) {
+		for (i = start_index - 1; section->free_chunk_map [i - 1]; --i)
+			;
+		free_chunks = (LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS));
+		remove_free_chunk (free_chunks);
+		size += free_chunks->size;
+		++stat_los_chunks_coalesced;
+	}
+
+	add_free_chunk (free_chunks, size, FALSE);
+
+	mono_mutex_unlock (&los_free_lists_mutex);
 }
 
 static int pagesize;
 
+void
+sgen_los_init (void)
+{
+	mono_mutex_init (&los_free_lists_mutex);
+
+	mono_counters_register ("LOS free bytes", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &stat_los_free_bytes);
+	mono_counters_register ("LOS largest free chunk", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &stat_los_largest_free_chunk);
+	mono_counters_register ("LOS bytes decommitted", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_MONOTONIC, &stat_los_bytes_decommitted);
+	mono_counters_register ("# LOS free chunks coalesced", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_los_chunks_coalesced);
+}
+
 void
 sgen_los_free_object (LOSObject *obj)
 {
@@ -411,13 +500,58 @@ sgen_los_alloc_large_inner (GCVTable vtable, size_t size)
 
 static void sgen_los_unpin_object (GCObject *data);
 
+/*
+ * Gives the pages of big free chunks back to the OS.  Only the first page of a free chunk
+ * is kept, because that's where its header is.  We hold the free lists lock while we
+ * decommit a free list, so nothing can be allocated from it in the meantime.
+ */
+static void
+decommit_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
+{
+	int i;
+
+	if (!pagesize)
+		pagesize = mono_pagesize ();
+
+	for (i = free_list_index (LOS_DECOMMIT_MIN_SIZE >> LOS_CHUNK_BITS); i < LOS_NUM_FREE_LISTS; ++i) {
+		LOSFreeChunks *free_chunks;
+
+		mono_mutex_lock (&los_free_lists_mutex);
+		for (free_chunks = los_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size) {
+			char *start = (char*)free_chunks + sizeof (LOSFreeChunks);
+			char *end = (char*)free_chunks + free_chunks->size;
+
+			if (free_chunks->decommitted)
+				continue;
+
+			start = (char*)(((mword)start + pagesize - 1) & ~(mword)(pagesize - 1));
+			end = (char*)((mword)end & ~(mword)(pagesize - 1));
+			if (end > start) {
+				sgen_decommit_os_memory (start, end - start);
+				stat_los_bytes_decommitted += end - start;
+			}
+			free_chunks->decommitted = TRUE;
+		}
+		mono_mutex_unlock (&los_free_lists_mutex);
+	}
+
+	decommit_job = NULL;
+}
+
 void
 sgen_los_sweep (void)
 {
 	LOSObject *bigobj, *prevbo;
 	LOSSection *section, *prev;
+	SgenThreadPoolJob *job;
 	int i;
 	int num_sections = 0;
+	mword free_bytes = 0;
+
+	/* The decommit job from the last sweep might still be running. */
+	job = decommit_job;
+	if (job)
+		sgen_thread_pool_job_wait (job);
 
 	/* sweep the big objects list */
 	prevbo = NULL;
@@ -448,15 +582,18 @@ sgen_los_sweep (void)
 		bigobj = bigobj->next;
 	}
 
-	/* Try to free memory */
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i)
-		los_fast_free_lists [i] = NULL;
-
+	/*
+	 * Try to free memory.  Free chunks are coalesced, so an empty section has a single
+	 * free chunk spanning it.
+	 */
 	prev = NULL;
 	section = los_sections;
 	while (section) {
 		if (section->num_free_chunks == LOS_SECTION_NUM_CHUNKS) {
 			LOSSection *next = section->next;
+			LOSFreeChunks *free_chunks = (LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE);
+			g_assert (free_chunks->size == LOS_SECTION_SIZE - LOS_CHUNK_SIZE);
+			remove_free_chunk (free_chunks);
 			if (prev)
 				prev->next = next;
 			else
@@ -468,15 +605,7 @@ sgen_los_sweep (void)
 			continue;
 		}
 
-		for (i = 0; i <= LOS_SECTION_NUM_CHUNKS; ++i) {
-			if (section->free_chunk_map [i]) {
-				int j;
-				for (j = i + 1; j <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [j]; ++j)
-					;
-				add_free_chunk ((LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS)), (j - i) << LOS_CHUNK_BITS);
-				i = j - 1;
-			}
-		}
+		free_bytes += section->num_free_chunks << LOS_CHUNK_BITS;
 
 		prev = section;
 		section = section->next;
@@ -484,22 +613,37 @@ sgen_los_sweep (void)
 		++num_sections;
 	}
 
+	stat_los_free_bytes = free_bytes;
+	stat_los_largest_free_chunk = 0;
+	for (i = LOS_NUM_FREE_LISTS - 1; i > 0 && !stat_los_largest_free_chunk; --i) {
+		LOSFreeChunks *free_chunks;
+		for (free_chunks = los_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size)
+			stat_los_largest_free_chunk = MAX (stat_los_largest_free_chunk, free_chunks->size);
+	}
+
 #ifdef LOS_CONSISTENCY_CHECK
 	los_consistency_check ();
 #endif
 
 	/*
 	g_print ("LOS sections: %d  objects: %d  usage: %d\n", num_sections, los_num_objects, los_memory_usage);
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i) {
+	for (i = 0; i < LOS_NUM_FREE_LISTS; ++i) {
 		int num_chunks = 0;
 		LOSFreeChunks *free_chunks;
-		for (free_chunks = los_fast_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size)
+		for (free_chunks = los_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size)
 			++num_chunks;
 		g_print ("  %d: %d\n", i, num_chunks);
 	}
 	*/
 
 	g_assert (los_num_sections == num_sections);
+
+	if (sgen_thread_pool_get_num_threads ()) {
+		decommit_job = sgen_thread_pool_job_alloc ("LOS decommit", decommit_job_func, sizeof (SgenThreadPoolJob));
+		sgen_thread_pool_job_enqueue (decommit_job);
+	} else {
+		decommit_job_func (NULL, NULL);
+	}
 }
 
 gboolean
@@ -685,6 +829,23 @@ sgen_los_pin_object (GCObject *data)
 	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
 }
 
+/*
+ * Pins the object atomically, for when several threads mark at the same time.  Returns
+ * whether we were the ones to pin it.
+ */
+gboolean
+sgen_los_pin_object_par (GCObject *data)
+{
+	LOSObject *obj = sgen_los_header_for_object (data);
+	mword old_size = obj->size;
+	if (old_size & 1)
+		return FALSE;
+	if (SGEN_CAS_PTR ((gpointer*)&obj->size, (gpointer)(old_size | 1), (gpointer)old_size) != (gpointer)old_size)
+		return FALSE;
+	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
+	return TRUE;
+}
+
 static void
 sgen_los_unpin_object (GCObject *data)
 {
@@ -25,12 +25,30 @@
  * SCAN_OBJECT_FUNCTION_NAME must be defined to be the function name of the object scanning
  * function.
  *
- * DRAIN_GRAY_STACK_FUNCTION_NAME must be defined to be the function name of the gray stack
+ * DRAIN_GRAY_STACK_FUNCTION_NAME can be defined to be the function name of the gray stack
  * draining function.
  *
  * Define COPY_OR_MARK_WITH_EVACUATION to support evacuation.
+ *
+ * Define COPY_OR_MARK_PARALLEL if several threads mark at the same time.  Mark bits are
+ * then set atomically and nursery objects are copied with the parallel copy function.
+ * This can't be combined with evacuation.
  */
 
+#if defined (COPY_OR_MARK_PARALLEL) && defined (COPY_OR_MARK_WITH_EVACUATION)
+#error "Parallel marking doesn't support evacuation."
+#endif
+
+#undef MS_MARK_OBJECT_AND_ENQUEUE_FUNC
+#undef ADD_TO_GLOBAL_REMSET_FUNC
+#ifdef COPY_OR_MARK_PARALLEL
+#define MS_MARK_OBJECT_AND_ENQUEUE_FUNC	MS_MARK_OBJECT_AND_ENQUEUE_PAR
+#define ADD_TO_GLOBAL_REMSET_FUNC	sgen_add_to_global_remset_par
+#else
+#define MS_MARK_OBJECT_AND_ENQUEUE_FUNC	MS_MARK_OBJECT_AND_ENQUEUE
+#define ADD_TO_GLOBAL_REMSET_FUNC	sgen_add_to_global_remset
+#endif
+
 /* Returns whether the object is still in the nursery. */
 static inline MONO_ALWAYS_INLINE gboolean
 COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
@@ -85,7 +103,11 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 	do_copy_object:
 #endif
 		old_obj = obj;
+#ifdef COPY_OR_MARK_PARALLEL
+		obj = copy_object_no_checks_par (obj, queue);
+#else
 		obj = copy_object_no_checks (obj, queue);
+#endif
 		if (G_UNLIKELY (old_obj == obj)) {
 			/*
 			 * If we fail to evacuate an object we just stop doing it for a
@@ -97,6 +119,7 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 				block = MS_BLOCK_FOR_OBJ (obj);
 				size_index = block->obj_size_index;
 				evacuate_block_obj_sizes [size_index] = FALSE;
+				block->is_sparse = FALSE;
 				MS_MARK_OBJECT_AND_ENQUEUE (obj, sgen_obj_get_descriptor (obj), block, queue);
 				return FALSE;
 			}
@@ -123,8 +146,18 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 		 */
 		block = MS_BLOCK_FOR_OBJ (obj);
 		MS_CALC_MARK_BIT (word, bit, obj);
+#ifdef COPY_OR_MARK_PARALLEL
+		{
+			/* Threads that lost the copying race get here, too. */
+			gboolean first;
+			MS_SET_MARK_BIT_PAR (block, word, bit, first);
+			if (!first)
+				return FALSE;
+		}
+#else
 		SGEN_ASSERT (9, !MS_MARK_BIT (block, word, bit), "object %p already marked", obj);
 		MS_SET_MARK_BIT (block, word, bit);
+#endif
 		binary_protocol_mark (obj, (gpointer)LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
 
 		return FALSE;
@@ -166,7 +199,7 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 			{
 				int size_index = block->obj_size_index;
 
-				if (evacuate_block_obj_sizes [size_index] && !block->has_pinned) {
+				if ((evacuate_block_obj_sizes [size_index] || block->is_sparse) && !block->has_pinned) {
 					HEAVY_STAT (++stat_optimized_copy_major_small_evacuate);
 					if (block->is_to_space)
 						return FALSE;
@@ -175,7 +208,7 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 			}
 #endif
 
-			MS_MARK_OBJECT_AND_ENQUEUE (obj, desc, block, queue);
+			MS_MARK_OBJECT_AND_ENQUEUE_FUNC (obj, desc, block, queue);
 		} else {
 			HEAVY_STAT (++stat_optimized_copy_major_large);
 
@@ -183,7 +216,12 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 				return FALSE;
 			binary_protocol_pin (obj, (gpointer)SGEN_LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
 
+#ifdef COPY_OR_MARK_PARALLEL
+			if (!sgen_los_pin_object_par (obj))
+				return FALSE;
+#else
 			sgen_los_pin_object (obj);
+#endif
 			if (SGEN_OBJECT_HAS_REFERENCES (obj))
 				GRAY_OBJECT_ENQUEUE (queue, obj, sgen_obj_get_descriptor (obj));
 		}
@@ -218,7 +256,7 @@ SCAN_OBJECT_FUNCTION_NAME (GCObject *obj, SgenDescriptor desc, SgenGrayQueue *qu
 			gboolean __still_in_nursery = COPY_OR_MARK_FUNCTION_NAME ((ptr), __old, queue); \
 			if (G_UNLIKELY (__still_in_nursery && !sgen_ptr_in_nursery ((ptr)) && !SGEN_OBJECT_IS_CEMENTED (*(ptr)))) { \
 				void *__copy = *(ptr);			\
-				sgen_add_to_global_remset ((ptr), __copy); \
+				ADD_TO_GLOBAL_REMSET_FUNC ((ptr), __copy); \
 			}						\
 		}							\
 	} while (0)
@@ -227,6 +265,7 @@ SCAN_OBJECT_FUNCTION_NAME (GCObject *obj, SgenDescriptor desc, SgenGrayQueue *qu
 #include "sgen-scan-object.h"
 }
 
+#ifdef DRAIN_GRAY_STACK_FUNCTION_NAME
 static gboolean
 DRAIN_GRAY_STACK_FUNCTION_NAME (ScanCopyContext ctx)
 {
@@ -247,8 +286,10 @@ DRAIN_GRAY_STACK_FUNCTION_NAME (ScanCopyContext ctx)
 		SCAN_OBJECT_FUNCTION_NAME (obj, desc, ctx.queue);
 	}
 }
+#endif
 
 #undef COPY_OR_MARK_FUNCTION_NAME
 #undef COPY_OR_MARK_WITH_EVACUATION
+#undef COPY_OR_MARK_PARALLEL
 #undef SCAN_OBJECT_FUNCTION_NAME
 #undef DRAIN_GRAY_STACK_FUNCTION_NAME
@@ -19,6 +19,12 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+/*
+ * CONCURRENT_NAME(x) must be defined to give the names of the functions defined here, as
+ * well as of the copy/mark functions they call, from their serial names.  The parallel
+ * versions use the `_par` suffix.
+ */
+
 extern guint64 stat_scan_object_called_major;
 
 /*
@@ -39,7 +45,7 @@ extern guint64 stat_scan_object_called_major;
 		binary_protocol_scan_process_reference ((obj), (ptr), __old); \
 		if (__old && !sgen_ptr_in_nursery (__old)) {		\
 			PREFETCH_READ (__old);			\
-			major_copy_or_mark_object_concurrent ((ptr), __old, queue); \
+			CONCURRENT_NAME (major_copy_or_mark_object_concurrent) ((ptr), __old, queue); \
 		} else {						\
 			if (G_UNLIKELY (sgen_ptr_in_nursery (__old) && !sgen_ptr_in_nursery ((ptr)))) \
 				ADD_TO_GLOBAL_REMSET ((full_object), (ptr), __old); \
@@ -52,7 +58,7 @@ extern guint64 stat_scan_object_called_major;
 #define ADD_TO_GLOBAL_REMSET(object,ptr,target)	mark_mod_union_card ((object), (void**)(ptr))
 
 static void
-major_scan_object_no_mark_concurrent_anywhere (GCObject *full_object, SgenDescriptor desc, SgenGrayQueue *queue)
+CONCURRENT_NAME (major_scan_object_no_mark_concurrent_anywhere) (GCObject *full_object, SgenDescriptor desc, SgenGrayQueue *queue)
 {
 	char *start = (char*)full_object;
 
@@ -73,16 +79,16 @@ major_scan_object_no_mark_concurrent_anywhere (GCObject *full_object, SgenDescri
 }
 
 static void
-major_scan_object_no_mark_concurrent_start (GCObject *start, SgenDescriptor desc, SgenGrayQueue *queue)
+CONCURRENT_NAME (major_scan_object_no_mark_concurrent_start) (GCObject *start, SgenDescriptor desc, SgenGrayQueue *queue)
 {
-	major_scan_object_no_mark_concurrent_anywhere (start, desc, queue);
+	CONCURRENT_NAME (major_scan_object_no_mark_concurrent_anywhere) (start, desc, queue);
 }
 
 static void
-major_scan_object_no_mark_concurrent (GCObject *start, SgenDescriptor desc, SgenGrayQueue *queue)
+CONCURRENT_NAME (major_scan_object_no_mark_concurrent) (GCObject *start, SgenDescriptor desc, SgenGrayQueue *queue)
 {
 	SGEN_ASSERT (0, !sgen_ptr_in_nursery (start), "Why are we scanning nursery objects in the concurrent collector?");
-	major_scan_object_no_mark_concurrent_anywhere (start, desc, queue);
+	CONCURRENT_NAME (major_scan_object_no_mark_concurrent_anywhere) (start, desc, queue);
 }
 
 #undef HANDLE_PTR
@@ -90,17 +96,17 @@ major_scan_object_no_mark_concurrent (GCObject *start, SgenDescriptor desc, Sgen
                 void *__old = *(ptr);                                   \
                 binary_protocol_scan_process_reference ((obj), (ptr), __old); \
                 if (__old) {                                            \
-                        gboolean __still_in_nursery = major_copy_or_mark_object_no_evacuation ((ptr), __old, queue); \
+                        gboolean __still_in_nursery = CONCURRENT_NAME (major_copy_or_mark_object_no_evacuation) ((ptr), __old, queue); \
                         if (G_UNLIKELY (__still_in_nursery && !sgen_ptr_in_nursery ((ptr)) && !SGEN_OBJECT_IS_CEMENTED (*(ptr)))) { \
                                 void *__copy = *(ptr);                  \
-                                sgen_add_to_global_remset ((ptr), __copy); \
+                                CONCURRENT_NAME (sgen_add_to_global_remset) ((ptr), __copy); \
                         }						\
                 }                                                       \
         } while (0)
 
 
 static void
-major_scan_vtype_concurrent_finish (GCObject *full_object, char *start, SgenDescriptor desc, SgenGrayQueue *queue BINARY_PROTOCOL_ARG (size_t size))
+CONCURRENT_NAME (major_scan_vtype_concurrent_finish) (GCObject *full_object, char *start, SgenDescriptor desc, SgenGrayQueue *queue BINARY_PROTOCOL_ARG (size_t size))
 {
 	SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP;
 
@@ -118,3 +124,5 @@ major_scan_vtype_concurrent_finish (GCObject *full_object, char *start, SgenDesc
 
 	SGEN_OBJECT_LAYOUT_STATISTICS_COMMIT_BITMAP;
 }
+
+#undef CONCURRENT_NAME
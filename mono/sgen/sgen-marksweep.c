@@ -41,6 +41,7 @@
 #include "mono/sgen/sgen-thread-pool.h"
 #include "mono/sgen/sgen-client.h"
 #include "mono/utils/mono-membar.h"
+#include "mono/utils/mono-proclib.h"
 
 #if defined(ARCH_MIN_MS_BLOCK_SIZE) && defined(ARCH_MIN_MS_BLOCK_SIZE_SHIFT)
 #define MS_BLOCK_SIZE	ARCH_MIN_MS_BLOCK_SIZE
@@ -113,6 +114,8 @@ struct _MSBlockInfo {
 	unsigned int has_references : 1;
 	unsigned int has_pinned : 1;	/* means cannot evacuate */
 	unsigned int is_to_space : 1;
+	/* less than `sparse_block_threshold` occupied at the last sweep */
+	unsigned int is_sparse : 1;
 	void ** volatile free_list;
 	MSBlockInfo * volatile next_free;
 	guint8 * volatile cardtable_mod_union;
@@ -148,6 +151,19 @@ typedef struct {
 
 #define MS_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] & (ONE_P << (b)))
 #define MS_SET_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] |= (ONE_P << (b)))
+/* Atomically sets the mark bit.  FIRST is set to whether it wasn't set before. */
+#define MS_SET_MARK_BIT_PAR(bl,w,b,first)	do {			\
+		mword __old_word = (bl)->mark_words [(w)];		\
+		(first) = FALSE;					\
+		while (!(__old_word & (ONE_P << (b)))) {		\
+			mword __prev_word = (mword)SGEN_CAS_PTR ((gpointer*)&(bl)->mark_words [(w)], (gpointer)(__old_word | (ONE_P << (b))), (gpointer)__old_word); \
+			if (__prev_word == __old_word) {		\
+				(first) = TRUE;				\
+				break;					\
+			}						\
+			__old_word = __prev_word;			\
+		}							\
+	} while (0)
 
 #define MS_OBJ_ALLOCED(o,b)	(*(void**)(o) && (*(char**)(o) < MS_BLOCK_FOR_BLOCK_INFO (b) || *(char**)(o) >= MS_BLOCK_FOR_BLOCK_INFO (b) + MS_BLOCK_SIZE))
 
@@ -172,6 +188,13 @@ static gboolean *evacuate_block_obj_sizes;
 static float evacuation_threshold = 0.666f;
 static float concurrent_evacuation_threshold = 0.666f;
 static gboolean want_evacuation = FALSE;
+/*
+ * Blocks occupied less than this are evacuated individually in non-concurrent majors,
+ * regardless of their size class.  Zero disables it.
+ */
+static float sparse_block_threshold = 0.0f;
+/* Whether the current major evacuates any sparse blocks. */
+static gboolean have_sparse_blocks = FALSE;
 
 static gboolean lazy_sweep = FALSE;
 
@@ -187,6 +210,10 @@ static volatile int sweep_state = SWEEP_STATE_SWEPT;
 
 static gboolean concurrent_mark;
 static gboolean concurrent_sweep = TRUE;
+/* Zero means pick a default based on the number of CPUs. */
+static int sweep_threads = 0;
+
+#define MS_DEFAULT_MAX_SWEEP_THREADS	4
 
 #define BLOCK_IS_TAGGED_HAS_REFERENCES(bl)	SGEN_POINTER_IS_TAGGED_1 ((bl))
 #define BLOCK_TAG_HAS_REFERENCES(bl)		SGEN_POINTER_TAG_1 ((bl))
@@ -245,7 +272,11 @@ static MSBlockInfo * volatile *free_block_lists [MS_BLOCK_TYPE_MAX];
 static guint64 stat_major_blocks_alloced = 0;
 static guint64 stat_major_blocks_freed = 0;
 static guint64 stat_major_blocks_lazy_swept = 0;
+static guint64 stat_major_blocks_checked_on_demand = 0;
+static guint64 stat_major_sweep_alloc_stalls = 0;
 static guint64 stat_major_objects_evacuated = 0;
+static guint64 stat_major_sparse_blocks_evacuated = 0;
+static mword stat_major_fragmented_bytes = 0;
 
 #if SIZEOF_VOID_P != 8
 static guint64 stat_major_blocks_freed_ideal = 0;
@@ -506,19 +537,28 @@ add_free_block (MSBlockInfo * volatile *free_blocks, int size_index, MSBlockInfo
 }
 
 static void major_finish_sweep_checking (void);
+static void sweep_size_class_on_demand (MSBlockInfo * volatile *free_blocks, int size_index);
 
-static gboolean
-ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
+/* How often each size class ran out of free blocks, decayed at every sweep. */
+static guint32 *size_class_demand;
+
+/*
+ * Allocates a new block with all its slots in its free list.  The block is not added to
+ * any of the free block lists or to `allocated_blocks`.
+ *
+ * Thread safe
+ */
+static MSBlockInfo*
+ms_new_block (int size_index, gboolean pinned, gboolean has_references)
 {
 	int size = block_obj_sizes [size_index];
 	int count = MS_BLOCK_FREE / size;
 	MSBlockInfo *info;
-	MSBlockInfo * volatile * free_blocks = FREE_BLOCKS (pinned, has_references);
 	char *obj_start;
 	int i;
 
 	if (!sgen_memgov_try_alloc_space (MS_BLOCK_SIZE, SPACE_MAJOR))
-		return FALSE;
+		return NULL;
 
 	info = (MSBlockInfo*)ms_get_empty_block ();
 
@@ -536,6 +576,7 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	 * want further evacuation.
 	 */
 	info->is_to_space = (sgen_get_current_collection_generation () == GENERATION_OLD);
+	info->is_sparse = FALSE;
 	info->state = (info->is_to_space || sgen_concurrent_collection_in_progress ()) ? BLOCK_STATE_MARKING : BLOCK_STATE_SWEPT;
 	SGEN_ASSERT (6, !sweep_in_progress () || info->state == BLOCK_STATE_SWEPT, "How do we add a new block to be swept while sweeping?");
 	info->cardtable_mod_union = NULL;
@@ -556,6 +597,18 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	/* the last one */
 	*(void**)obj_start = NULL;
 
+	return info;
+}
+
+static gboolean
+ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
+{
+	MSBlockInfo * volatile * free_blocks = FREE_BLOCKS (pinned, has_references);
+	MSBlockInfo *info = ms_new_block (size_index, pinned, has_references);
+
+	if (!info)
+		return FALSE;
+
 	add_free_block (free_blocks, size_index, info);
 
 	/*
@@ -565,6 +618,8 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	 * The memory barrier here and in `sweep_job_func()` are required because we need
 	 * `allocated_blocks` synchronized between this and the sweep thread.
 	 */
+	if (sweep_in_progress ())
+		++stat_major_sweep_alloc_stalls;
 	major_finish_sweep_checking ();
 	mono_memory_barrier ();
 
@@ -586,6 +641,12 @@ ptr_is_from_pinned_alloc (char *ptr)
 	return FALSE;
 }
 
+static gboolean
+obj_is_from_pinned_alloc (char *ptr)
+{
+	return MS_BLOCK_FOR_OBJ (ptr)->pinned;
+}
+
 static void
 ensure_can_access_block_free_list (MSBlockInfo *block)
 {
@@ -652,7 +713,16 @@ alloc_obj (GCVTable vtable, size_t size, gboolean pinned, gboolean has_reference
 	void *obj;
 
 	if (!free_blocks [size_index]) {
-		if (G_UNLIKELY (!ms_alloc_block (size_index, pinned, has_references)))
+		++size_class_demand [size_index];
+
+		/*
+		 * Allocating a new block has to wait for the sweep to finish, so if there are
+		 * blocks of this size class left to check we'd rather do that ourselves.
+		 */
+		if (sweep_in_progress ())
+			sweep_size_class_on_demand (free_blocks, size_index);
+
+		if (!free_blocks [size_index] && G_UNLIKELY (!ms_alloc_block (size_index, pinned, has_references)))
 			return NULL;
 	}
 
@@ -670,6 +740,106 @@ major_alloc_object (GCVTable vtable, size_t size, gboolean has_references)
 	return alloc_obj (vtable, size, FALSE, has_references);
 }
 
+/*
+ * In parallel collections each worker promotes objects into blocks that only it
+ * allocates from, so no synchronization is needed.  We can't publish those blocks in
+ * `allocated_blocks` right away, because the (mod union) card table scans iterate over it
+ * at the same time, so we collect them here and publish them in
+ * `major_finish_parallel_alloc()`.
+ */
+typedef struct {
+	/* Indexed by size index and whether the block has references. */
+	MSBlockInfo **current_blocks;
+	SgenPointerQueue new_blocks;
+} MSWorkerAllocState;
+
+static MSWorkerAllocState *worker_alloc_states;
+static int num_worker_alloc_states;
+
+#define WORKER_CURRENT_BLOCK_INDEX(size_index,has_references)	((size_index) * 2 + ((has_references) ? 1 : 0))
+
+static GCObject*
+major_alloc_object_par (GCVTable vtable, size_t size, gboolean has_references)
+{
+	int size_index = MS_BLOCK_OBJ_SIZE_INDEX (size);
+	int worker_index = sgen_thread_pool_get_current_thread_index ();
+	MSWorkerAllocState *state;
+	MSBlockInfo **current;
+	MSBlockInfo *block;
+	void *obj;
+
+	SGEN_ASSERT (9, worker_index >= 0 && worker_index < num_worker_alloc_states, "Parallel allocation must happen in a worker thread");
+
+	state = &worker_alloc_states [worker_index];
+	current = &state->current_blocks [WORKER_CURRENT_BLOCK_INDEX (size_index, has_references)];
+	block = *current;
+
+	if (G_UNLIKELY (!block || !block->free_list)) {
+		block = ms_new_block (size_index, FALSE, has_references);
+		if (G_UNLIKELY (!block))
+			return NULL;
+		sgen_pointer_queue_add (&state->new_blocks, block);
+		*current = block;
+	}
+
+	obj = block->free_list;
+	block->free_list = *(void**)obj;
+
+	/* FIXME: assumes object layout */
+	*(GCVTable*)obj = vtable;
+
+	return obj;
+}
+
+static void
+major_start_parallel_alloc (void)
+{
+	int i;
+
+	if (!worker_alloc_states) {
+		num_worker_alloc_states = sgen_thread_pool_get_num_threads ();
+		worker_alloc_states = sgen_alloc_internal_dynamic (sizeof (MSWorkerAllocState) * num_worker_alloc_states, INTERNAL_MEM_MS_TABLES, TRUE);
+		for (i = 0; i < num_worker_alloc_states; ++i) {
+			worker_alloc_states [i].current_blocks = sgen_alloc_internal_dynamic (sizeof (MSBlockInfo*) * num_block_obj_sizes * 2, INTERNAL_MEM_MS_TABLES, TRUE);
+			sgen_pointer_queue_init (&worker_alloc_states [i].new_blocks, INTERNAL_MEM_MS_TABLES);
+		}
+	}
+
+	/*
+	 * The workers allocate new blocks, which must not race with the sweep thread
+	 * compacting `allocated_blocks`.
+	 */
+	major_finish_sweep_checking ();
+}
+
+/*
+ * Called with the world stopped after all workers are done.  Publishes the blocks the
+ * workers allocated and puts the ones with free slots left into the free lists.
+ */
+static void
+major_finish_parallel_alloc (void)
+{
+	int i;
+	size_t j;
+
+	for (i = 0; i < num_worker_alloc_states; ++i) {
+		MSWorkerAllocState *state = &worker_alloc_states [i];
+
+		for (j = 0; j < state->new_blocks.next_slot; ++j) {
+			MSBlockInfo *block = state->new_blocks.data [j];
+
+			if (block->free_list)
+				add_free_block (FREE_BLOCKS (FALSE, block->has_references), block->obj_size_index, block);
+
+			sgen_pointer_queue_add (&allocated_blocks, BLOCK_TAG (block));
+			SGEN_ATOMIC_ADD_P (num_major_sections, 1);
+		}
+
+		sgen_pointer_queue_clear (&state->new_blocks);
+		memset (state->current_blocks, 0, sizeof (MSBlockInfo*) * num_block_obj_sizes * 2);
+	}
+}
+
 /*
  * We're not freeing the block if it's empty.  We leave that work for
  * the next major collection.
@@ -818,13 +988,20 @@ set_sweep_state (int new, int expected)
 
 static gboolean ensure_block_is_checked_for_sweeping (int block_index, gboolean wait, gboolean *have_checked);
 
-static SgenThreadPoolJob * volatile sweep_job;
+typedef struct {
+	SgenThreadPoolJob job;
+	int index;
+} SweepJob;
+
+/* Each sweep job nulls its slot when it's done. */
+static SgenThreadPoolJob * volatile sweep_jobs [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static volatile gint32 num_sweep_jobs_running;
 
 static void
 major_finish_sweep_checking (void)
 {
 	int block_index;
-	SgenThreadPoolJob *job;
+	int i;
 
  retry:
 	switch (sweep_state) {
@@ -856,10 +1033,12 @@ major_finish_sweep_checking (void)
 	set_sweep_state (SWEEP_STATE_SWEEPING, SWEEP_STATE_SWEEPING_AND_ITERATING);
 
  wait:
-	job = sweep_job;
-	if (job)
-		sgen_thread_pool_job_wait (job);
-	SGEN_ASSERT (0, !sweep_job, "Why did the sweep job not null itself?");
+	for (i = 0; i < SGEN_THREADPOOL_MAX_NUM_THREADS; ++i) {
+		SgenThreadPoolJob *job = sweep_jobs [i];
+		if (job)
+			sgen_thread_pool_job_wait (job);
+		SGEN_ASSERT (0, !sweep_jobs [i], "Why did the sweep job not null itself?");
+	}
 	SGEN_ASSERT (0, sweep_state == SWEEP_STATE_SWEPT, "How is the sweep job done but we're not swept?");
 }
 
@@ -1104,6 +1283,19 @@ mark_mod_union_card (GCObject *obj, void **ptr)
 			INC_NUM_MAJOR_OBJECTS_MARKED ();		\
 		}							\
 	} while (0)
+#define MS_MARK_OBJECT_AND_ENQUEUE_PAR(obj,desc,block,queue) do {	\
+		int __word, __bit;					\
+		gboolean __first;					\
+		MS_CALC_MARK_BIT (__word, __bit, (obj));		\
+		SGEN_ASSERT (9, MS_OBJ_ALLOCED ((obj), (block)), "object %p not allocated", obj); \
+		MS_SET_MARK_BIT_PAR ((block), __word, __bit, __first);	\
+		if (__first) {						\
+			if (sgen_gc_descr_has_references (desc))			\
+				GRAY_OBJECT_ENQUEUE ((queue), (obj), (desc)); \
+			binary_protocol_mark ((obj), (gpointer)LOAD_VTABLE ((obj)), sgen_safe_object_get_size ((obj))); \
+			INC_NUM_MAJOR_OBJECTS_MARKED ();		\
+		}							\
+	} while (0)
 
 static void
 pin_major_object (GCObject *obj, SgenGrayQueue *queue)
@@ -1150,6 +1342,38 @@ major_copy_or_mark_object_concurrent (GCObject **ptr, GCObject *obj, SgenGrayQue
 	}
 }
 
+/*
+ * The same as `major_copy_or_mark_object_concurrent()`, but for when several workers mark
+ * at the same time.
+ */
+static void
+major_copy_or_mark_object_concurrent_par (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
+{
+	SGEN_ASSERT (9, sgen_concurrent_collection_in_progress (), "Why are we scanning concurrently when there's no concurrent collection on?");
+
+	g_assert (!SGEN_OBJECT_IS_FORWARDED (obj));
+
+	if (!sgen_ptr_in_nursery (obj)) {
+		mword objsize;
+
+		objsize = SGEN_ALIGN_UP (sgen_safe_object_get_size (obj));
+
+		if (objsize <= SGEN_MAX_SMALL_OBJ_SIZE) {
+			MSBlockInfo *block = MS_BLOCK_FOR_OBJ (obj);
+			MS_MARK_OBJECT_AND_ENQUEUE_PAR (obj, sgen_obj_get_descriptor (obj), block, queue);
+		} else {
+			if (!sgen_los_pin_object_par (obj))
+				return;
+
+			binary_protocol_mark (obj, SGEN_LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
+
+			if (SGEN_OBJECT_HAS_REFERENCES (obj))
+				GRAY_OBJECT_ENQUEUE (queue, obj, sgen_obj_get_descriptor (obj));
+			INC_NUM_MAJOR_OBJECTS_MARKED ();
+		}
+	}
+}
+
 static long long
 major_get_and_reset_num_major_objects_marked (void)
 {
@@ -1209,12 +1433,18 @@ static void major_scan_object_with_evacuation (GCObject *start, mword desc, Sgen
 #define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_with_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
+/* Used by the workers in the finishing pause of the parallel concurrent collector. */
+#define COPY_OR_MARK_PARALLEL
+#define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_no_evacuation_par
+#define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_no_evacuation_par
+#include "sgen-marksweep-drain-gray-stack.h"
+
 static gboolean
 drain_gray_stack (ScanCopyContext ctx)
 {
-	gboolean evacuation = FALSE;
+	gboolean evacuation = have_sparse_blocks;
 	int i;
-	for (i = 0; i < num_block_obj_sizes; ++i) {
+	for (i = 0; !evacuation && i < num_block_obj_sizes; ++i) {
 		if (evacuate_block_obj_sizes [i]) {
 			evacuation = TRUE;
 			break;
@@ -1227,6 +1457,10 @@ drain_gray_stack (ScanCopyContext ctx)
 		return drain_gray_stack_no_evacuation (ctx);
 }
 
+#define CONCURRENT_NAME(x)	x
+#include "sgen-marksweep-scan-object-concurrent.h"
+
+#define CONCURRENT_NAME(x)	x ## _par
 #include "sgen-marksweep-scan-object-concurrent.h"
 
 static void
@@ -1247,6 +1481,18 @@ major_copy_or_mark_object_concurrent_finish_canonical (GCObject **ptr, SgenGrayQ
 	major_copy_or_mark_object_no_evacuation (ptr, *ptr, queue);
 }
 
+static void
+major_copy_or_mark_object_concurrent_par_canonical (GCObject **ptr, SgenGrayQueue *queue)
+{
+	major_copy_or_mark_object_concurrent_par (ptr, *ptr, queue);
+}
+
+static void
+major_copy_or_mark_object_conc_par_finish_canonical (GCObject **ptr, SgenGrayQueue *queue)
+{
+	major_copy_or_mark_object_no_evacuation_par (ptr, *ptr, queue);
+}
+
 static void
 mark_pinned_objects_in_block (MSBlockInfo *block, size_t first_entry, size_t last_entry, SgenGrayQueue *queue)
 {
@@ -1412,6 +1658,7 @@ bitcount (mword d)
 static size_t *sweep_slots_available;
 static size_t *sweep_slots_used;
 static size_t *sweep_num_blocks;
+static size_t *sweep_num_sparse_blocks;
 
 static volatile size_t num_major_sections_before_sweep;
 static volatile size_t num_major_sections_freed_in_sweep;
@@ -1422,7 +1669,7 @@ sweep_start (void)
 	int i;
 
 	for (i = 0; i < num_block_obj_sizes; ++i)
-		sweep_slots_available [i] = sweep_slots_used [i] = sweep_num_blocks [i] = 0;
+		sweep_slots_available [i] = sweep_slots_used [i] = sweep_num_blocks [i] = sweep_num_sparse_blocks [i] = 0;
 
 	/* clear all the free lists */
 	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i) {
@@ -1539,10 +1786,14 @@ ensure_block_is_checked_for_sweeping (int block_index, gboolean wait, gboolean *
 		if (!lazy_sweep)
 			sweep_block (block);
 
+		block->is_sparse = !block->pinned && nused < count * sparse_block_threshold;
+
 		if (!has_pinned) {
-			++sweep_num_blocks [obj_size_index];
-			sweep_slots_used [obj_size_index] += nused;
-			sweep_slots_available [obj_size_index] += count;
+			SGEN_ATOMIC_ADD_P (sweep_num_blocks [obj_size_index], 1);
+			SGEN_ATOMIC_ADD_P (sweep_slots_used [obj_size_index], nused);
+			SGEN_ATOMIC_ADD_P (sweep_slots_available [obj_size_index], count);
+			if (block->is_sparse)
+				SGEN_ATOMIC_ADD_P (sweep_num_sparse_blocks [obj_size_index], 1);
 		}
 
 		/*
@@ -1581,31 +1832,151 @@ ensure_block_is_checked_for_sweeping (int block_index, gboolean wait, gboolean *
 	return !!tagged_block;
 }
 
+/*
+ * To let sweeping follow allocation demand, the blocks to be swept are grouped by size
+ * class.  `sweep_size_class_blocks` holds indexes into `allocated_blocks`, the ones for
+ * size class `i` starting at `sweep_size_class_start [i]`.  The sweep jobs and allocating
+ * threads claim blocks by incrementing `sweep_size_class_next [i]`, so each block is
+ * claimed exactly once.
+ */
+static int *sweep_size_class_blocks;
+static int sweep_size_class_blocks_size;
+static int *sweep_size_class_start;
+static volatile gint32 *sweep_size_class_next;
+/* The order in which the sweep jobs go through the size classes, most demanded first. */
+static int *sweep_size_class_order;
+
+/*
+ * The number of allocating threads currently checking blocks on demand.  We can't compact
+ * the block array while any of them is at it.
+ */
+static volatile gint32 num_sweep_demand_helpers;
+
+static void
+sweep_prepare_size_classes (int num_blocks)
+{
+	int i, j;
+
+	if (num_blocks > sweep_size_class_blocks_size) {
+		if (sweep_size_class_blocks)
+			sgen_free_internal_dynamic (sweep_size_class_blocks, sizeof (int) * sweep_size_class_blocks_size, INTERNAL_MEM_MS_TABLES);
+		sweep_size_class_blocks_size = MAX (num_blocks, sweep_size_class_blocks_size * 2);
+		sweep_size_class_blocks = sgen_alloc_internal_dynamic (sizeof (int) * sweep_size_class_blocks_size, INTERNAL_MEM_MS_TABLES, TRUE);
+	}
+
+	for (i = 0; i <= num_block_obj_sizes; ++i)
+		sweep_size_class_start [i] = 0;
+	for (i = 0; i < num_blocks; ++i)
+		++sweep_size_class_start [((MSBlockInfo*)BLOCK_UNTAG (allocated_blocks.data [i]))->obj_size_index + 1];
+	for (i = 0; i < num_block_obj_sizes; ++i) {
+		sweep_size_class_start [i + 1] += sweep_size_class_start [i];
+		sweep_size_class_next [i] = 0;
+	}
+	for (i = 0; i < num_blocks; ++i) {
+		int size_index = ((MSBlockInfo*)BLOCK_UNTAG (allocated_blocks.data [i]))->obj_size_index;
+		sweep_size_class_blocks [sweep_size_class_start [size_index] + sweep_size_class_next [size_index]++] = i;
+	}
+	for (i = 0; i < num_block_obj_sizes; ++i)
+		sweep_size_class_next [i] = 0;
+
+	/* Insertion sort, it's only a few dozen size classes. */
+	for (i = 0; i < num_block_obj_sizes; ++i) {
+		for (j = i; j > 0 && size_class_demand [sweep_size_class_order [j - 1]] < size_class_demand [i]; --j)
+			sweep_size_class_order [j] = sweep_size_class_order [j - 1];
+		sweep_size_class_order [j] = i;
+	}
+
+	/* Halve the demand, so that older collections count less. */
+	for (i = 0; i < num_block_obj_sizes; ++i)
+		size_class_demand [i] /= 2;
+}
+
+/*
+ * Returns the index of the next block of size class `size_index` to check, or -1 if all of
+ * them have been claimed already.
+ */
+static int
+claim_block_of_size_class (int size_index)
+{
+	int start = sweep_size_class_start [size_index];
+	int num = sweep_size_class_start [size_index + 1] - start;
+	int claimed;
+
+	if (sweep_size_class_next [size_index] >= num)
+		return -1;
+	claimed = InterlockedIncrement (&sweep_size_class_next [size_index]) - 1;
+	if (claimed >= num)
+		return -1;
+
+	/*
+	 * We go from high to low block indexes.  Nursery collections will have to cooperate
+	 * with the sweep jobs to finish sweeping, and they will traverse from low to high, to
+	 * avoid constantly colliding on the same blocks.
+	 */
+	return sweep_size_class_blocks [start + num - 1 - claimed];
+}
+
+static void
+check_claimed_block (int block_index)
+{
+	/*
+	 * The block might have been freed by another thread doing some checking work.
+	 */
+	if (!ensure_block_is_checked_for_sweeping (block_index, TRUE, NULL))
+		SGEN_ATOMIC_ADD_P (num_major_sections_freed_in_sweep, 1);
+}
+
+/*
+ * Called from `alloc_obj()` when there are no free blocks for `size_index` while sweeping.
+ * Instead of allocating a new block, which would have to wait for the whole sweep to
+ * finish, we check the unclaimed blocks of that size class until one of them ends up on
+ * our free list.
+ */
+static void
+sweep_size_class_on_demand (MSBlockInfo * volatile *free_blocks, int size_index)
+{
+	int block_index;
+
+	InterlockedIncrement (&num_sweep_demand_helpers);
+
+	/*
+	 * The last sweep job sets the state to compacting before it checks for helpers, so
+	 * either it waits for us or we see that it's too late.
+	 */
+	if (sweep_state == SWEEP_STATE_SWEEPING || sweep_state == SWEEP_STATE_SWEEPING_AND_ITERATING) {
+		while (!free_blocks [size_index] && (block_index = claim_block_of_size_class (size_index)) >= 0) {
+			check_claimed_block (block_index);
+			++stat_major_blocks_checked_on_demand;
+		}
+	}
+
+	InterlockedDecrement (&num_sweep_demand_helpers);
+}
+
 static void
 sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 {
 	int block_index;
 	int num_blocks = num_major_sections_before_sweep;
+	int i;
 
 	SGEN_ASSERT (0, sweep_in_progress (), "Sweep thread called with wrong state");
 	SGEN_ASSERT (0, num_blocks <= allocated_blocks.next_slot, "How did we lose blocks?");
 
 	/*
-	 * We traverse the block array from high to low.  Nursery collections will have to
-	 * cooperate with the sweep thread to finish sweeping, and they will traverse from
-	 * low to high, to avoid constantly colliding on the same blocks.
+	 * All sweep jobs go through the size classes in the same order, so they share the
+	 * work on the most demanded ones first.
 	 */
-	for (block_index = num_blocks - 1; block_index >= 0; --block_index) {
-		gboolean have_checked;
-
-		/*
-		 * The block might have been freed by another thread doing some checking
-		 * work.
-		 */
-		if (!ensure_block_is_checked_for_sweeping (block_index, TRUE, &have_checked))
-			++num_major_sections_freed_in_sweep;
+	for (i = 0; i < num_block_obj_sizes; ++i) {
+		int size_index = sweep_size_class_order [i];
+		while ((block_index = claim_block_of_size_class (size_index)) >= 0)
+			check_claimed_block (block_index);
 	}
 
+	/* The last job to finish does the compaction. */
+	if (InterlockedDecrement (&num_sweep_jobs_running) > 0)
+		goto done;
+
 	while (!try_set_sweep_state (SWEEP_STATE_COMPACTING, SWEEP_STATE_SWEEPING)) {
 		/*
 		 * The main GC thread is currently iterating over the block array to help us
@@ -1615,6 +1986,10 @@ sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 		g_usleep (100);
 	}
 
+	/* Same for allocating threads that are still checking blocks. */
+	while (num_sweep_demand_helpers)
+		g_usleep (100);
+
 	if (SGEN_MAX_ASSERT_LEVEL >= 6) {
 		for (block_index = num_blocks; block_index < allocated_blocks.next_slot; ++block_index) {
 			MSBlockInfo *block = BLOCK_UNTAG (allocated_blocks.data [block_index]);
@@ -1627,7 +2002,9 @@ sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 
 	sweep_finish ();
 
-	sweep_job = NULL;
+ done:
+	if (job)
+		sweep_jobs [((SweepJob*)job)->index] = NULL;
 }
 
 static void
@@ -1635,10 +2012,19 @@ sweep_finish (void)
 {
 	mword total_evacuate_heap = 0;
 	mword total_evacuate_saved = 0;
+	mword total_fragmented = 0;
 	int i;
 
 	for (i = 0; i < num_block_obj_sizes; ++i) {
 		float usage = (float)sweep_slots_used [i] / (float)sweep_slots_available [i];
+
+		if (sweep_num_blocks [i]) {
+			SGEN_LOG (2, "Major size class %d: %zu blocks, %zu sparse, %zu of %zu slots used",
+					block_obj_sizes [i], sweep_num_blocks [i], sweep_num_sparse_blocks [i],
+					sweep_slots_used [i], sweep_slots_available [i]);
+		}
+		total_fragmented += block_obj_sizes [i] * (sweep_slots_available [i] - sweep_slots_used [i]);
+
 		if (sweep_num_blocks [i] > 5 && usage < evacuation_threshold) {
 			evacuate_block_obj_sizes [i] = TRUE;
 			/*
@@ -1657,6 +2043,7 @@ sweep_finish (void)
 	}
 
 	want_evacuation = (float)total_evacuate_saved / (float)total_evacuate_heap > (1 - concurrent_evacuation_threshold);
+	stat_major_fragmented_bytes = total_fragmented;
 
 	set_sweep_state (SWEEP_STATE_SWEPT, SWEEP_STATE_COMPACTING);
 }
@@ -1664,6 +2051,8 @@ sweep_finish (void)
 static void
 major_sweep (void)
 {
+	int i;
+
 	set_sweep_state (SWEEP_STATE_SWEEPING, SWEEP_STATE_NEED_SWEEPING);
 
 	sweep_start ();
@@ -1673,11 +2062,22 @@ major_sweep (void)
 	num_major_sections_before_sweep = num_major_sections;
 	num_major_sections_freed_in_sweep = 0;
 
-	SGEN_ASSERT (0, !sweep_job, "We haven't finished the last sweep?");
+	sweep_prepare_size_classes (num_major_sections);
+
+	for (i = 0; i < SGEN_THREADPOOL_MAX_NUM_THREADS; ++i)
+		SGEN_ASSERT (0, !sweep_jobs [i], "We haven't finished the last sweep?");
 	if (concurrent_sweep) {
-		sweep_job = sgen_thread_pool_job_alloc ("sweep", sweep_job_func, sizeof (SgenThreadPoolJob));
-		sgen_thread_pool_job_enqueue (sweep_job);
+		int num_jobs = MAX (1, MIN (sweep_threads, sgen_thread_pool_get_num_threads ()));
+
+		num_sweep_jobs_running = num_jobs;
+		for (i = 0; i < num_jobs; ++i) {
+			SweepJob *job = (SweepJob*)sgen_thread_pool_job_alloc ("sweep", sweep_job_func, sizeof (SweepJob));
+			job->index = i;
+			sweep_jobs [i] = &job->job;
+			sgen_thread_pool_job_enqueue (&job->job);
+		}
 	} else {
+		num_sweep_jobs_running = 1;
 		sweep_job_func (NULL, NULL);
 	}
 }
@@ -1795,6 +2195,69 @@ major_finish_nursery_collection (void)
 #endif
 }
 
+/*
+ * Called with the world stopped and all blocks swept at the start of a non-concurrent
+ * major.  The live objects of blocks that were sparse when they were last swept are
+ * copied into the denser blocks of their size class, so the following sweep frees them.
+ * We take them off the free lists so that nothing gets copied into them.
+ */
+static void
+select_sparse_blocks_for_evacuation (void)
+{
+	MSBlockInfo *block;
+	int num_sparse = 0;
+	int i, j;
+
+	FOREACH_BLOCK_NO_LOCK (block) {
+		int count, num_free;
+		void **slot;
+
+		if (!block->is_sparse)
+			continue;
+
+		/* Those are already evacuated as a whole. */
+		if (evacuate_block_obj_sizes [block->obj_size_index]) {
+			block->is_sparse = FALSE;
+			continue;
+		}
+
+		/* The block might have filled up since it was swept. */
+		count = MS_BLOCK_FREE / block->obj_size;
+		num_free = 0;
+		for (slot = block->free_list; slot; slot = *slot)
+			++num_free;
+		if (count - num_free >= count * sparse_block_threshold) {
+			block->is_sparse = FALSE;
+			continue;
+		}
+
+		++num_sparse;
+	} END_FOREACH_BLOCK_NO_LOCK;
+
+	if (!num_sparse)
+		return;
+
+	/* Sparse blocks are never pinned blocks. */
+	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i) {
+		if (i & MS_BLOCK_FLAG_PINNED)
+			continue;
+		for (j = 0; j < num_block_obj_sizes; ++j) {
+			MSBlockInfo * volatile *prev = &free_block_lists [i][j];
+			while ((block = *prev)) {
+				if (block->is_sparse) {
+					*prev = block->next_free;
+					block->next_free = NULL;
+				} else {
+					prev = &block->next_free;
+				}
+			}
+		}
+	}
+
+	stat_major_sparse_blocks_evacuated += num_sparse;
+	have_sparse_blocks = TRUE;
+}
+
 static void
 major_start_major_collection (void)
 {
@@ -1829,12 +2292,17 @@ major_start_major_collection (void)
 	if (lazy_sweep)
 		binary_protocol_sweep_end (GENERATION_OLD, TRUE);
 
+	if (sparse_block_threshold > 0 && !sgen_concurrent_collection_in_progress ())
+		select_sparse_blocks_for_evacuation ();
+
 	set_sweep_state (SWEEP_STATE_NEED_SWEEPING, SWEEP_STATE_SWEPT);
 }
 
 static void
 major_finish_major_collection (ScannedObjectCounts *counts)
 {
+	have_sparse_blocks = FALSE;
+
 #ifdef SGEN_HEAVY_BINARY_PROTOCOL
 	if (binary_protocol_is_enabled ()) {
 		counts->num_scanned_objects = scanned_objects_list.next_slot;
@@ -2096,6 +2564,15 @@ major_handle_gc_param (const char *opt)
 		}
 		evacuation_threshold = (float)percentage / 100.0f;
 		return TRUE;
+	} else if (g_str_has_prefix (opt, "sparse-block-threshold=")) {
+		const char *arg = strchr (opt, '=') + 1;
+		int percentage = atoi (arg);
+		if (percentage < 0 || percentage > 100) {
+			fprintf (stderr, "sparse-block-threshold must be an integer in the range 0-100.\n");
+			exit (1);
+		}
+		sparse_block_threshold = (float)percentage / 100.0f;
+		return TRUE;
 	} else if (!strcmp (opt, "lazy-sweep")) {
 		lazy_sweep = TRUE;
 		return TRUE;
@@ -2108,6 +2585,15 @@ major_handle_gc_param (const char *opt)
 	} else if (!strcmp (opt, "no-concurrent-sweep")) {
 		concurrent_sweep = FALSE;
 		return TRUE;
+	} else if (g_str_has_prefix (opt, "sweep-threads=")) {
+		const char *arg = strchr (opt, '=') + 1;
+		int num = atoi (arg);
+		if (num < 1 || num > SGEN_THREADPOOL_MAX_NUM_THREADS) {
+			fprintf (stderr, "sweep-threads must be an integer in the range 1-%d.\n", SGEN_THREADPOOL_MAX_NUM_THREADS);
+			exit (1);
+		}
+		sweep_threads = num;
+		return TRUE;
 	}
 
 	return FALSE;
@@ -2119,9 +2605,11 @@ major_print_gc_param_usage (void)
 	fprintf (stderr,
 			""
 			"  evacuation-threshold=P (where P is a percentage, an integer in 0-100)\n"
+			"  sparse-block-threshold=P (where P is a percentage, an integer in 0-100)\n"
 			"  (no-)lazy-sweep\n"
 			"  (no-)concurrent-sweep\n"
-			);
+			"  sweep-threads=N (where N is an integer in 1-%d)\n",
+			SGEN_THREADPOOL_MAX_NUM_THREADS);
 }
 
 /*
@@ -2393,10 +2881,14 @@ post_param_init (SgenMajorCollector *collector)
 {
 	collector->sweeps_lazily = lazy_sweep;
 	collector->needs_thread_pool = concurrent_mark || concurrent_sweep;
+
+	if (!sweep_threads)
+		sweep_threads = MIN (mono_cpu_count (), MS_DEFAULT_MAX_SWEEP_THREADS);
+	collector->num_sweep_threads = concurrent_sweep ? sweep_threads : 0;
 }
 
 static void
-sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent)
+sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent, gboolean is_parallel)
 {
 	int i;
 
@@ -2413,6 +2905,12 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	sweep_slots_available = sgen_alloc_internal_dynamic (sizeof (size_t) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
 	sweep_slots_used = sgen_alloc_internal_dynamic (sizeof (size_t) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
 	sweep_num_blocks = sgen_alloc_internal_dynamic (sizeof (size_t) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+	sweep_num_sparse_blocks = sgen_alloc_internal_dynamic (sizeof (size_t) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+
+	size_class_demand = sgen_alloc_internal_dynamic (sizeof (guint32) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+	sweep_size_class_start = sgen_alloc_internal_dynamic (sizeof (int) * (num_block_obj_sizes + 1), INTERNAL_MEM_MS_TABLES, TRUE);
+	sweep_size_class_next = sgen_alloc_internal_dynamic (sizeof (gint32) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+	sweep_size_class_order = sgen_alloc_internal_dynamic (sizeof (int) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
 
 	/*
 	{
@@ -2434,7 +2932,11 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	mono_counters_register ("# major blocks allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_alloced);
 	mono_counters_register ("# major blocks freed", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed);
 	mono_counters_register ("# major blocks lazy swept", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_lazy_swept);
+	mono_counters_register ("# major blocks checked on demand", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_checked_on_demand);
+	mono_counters_register ("# major block allocs waiting for sweep", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_sweep_alloc_stalls);
 	mono_counters_register ("# major objects evacuated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_objects_evacuated);
+	mono_counters_register ("# major sparse blocks evacuated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_sparse_blocks_evacuated);
+	mono_counters_register ("Major fragmented bytes", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &stat_major_fragmented_bytes);
 #if SIZEOF_VOID_P != 8
 	mono_counters_register ("# major blocks freed ideally", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed_ideal);
 	mono_counters_register ("# major blocks freed less ideally", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed_less_ideal);
@@ -2446,6 +2948,7 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 
 	concurrent_mark = is_concurrent;
 	collector->is_concurrent = is_concurrent;
+	collector->is_parallel = is_parallel;
 	collector->needs_thread_pool = is_concurrent || concurrent_sweep;
 	if (is_concurrent)
 		collector->want_synchronous_collection = &want_evacuation;
@@ -2460,6 +2963,9 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->alloc_degraded = major_alloc_degraded;
 
 	collector->alloc_object = major_alloc_object;
+	collector->alloc_object_par = major_alloc_object_par;
+	collector->start_parallel_alloc = major_start_parallel_alloc;
+	collector->finish_parallel_alloc = major_finish_parallel_alloc;
 	collector->free_pinned_object = free_pinned_object;
 	collector->iterate_objects = major_iterate_objects;
 	collector->free_non_pinned_object = major_free_non_pinned_object;
@@ -2485,6 +2991,7 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->finish_major_collection = major_finish_major_collection;
 	collector->ptr_is_in_non_pinned_space = major_ptr_is_in_non_pinned_space;
 	collector->ptr_is_from_pinned_alloc = ptr_is_from_pinned_alloc;
+	collector->obj_is_from_pinned_alloc = obj_is_from_pinned_alloc;
 	collector->report_pinned_memory_usage = major_report_pinned_memory_usage;
 	collector->get_num_major_sections = get_num_major_sections;
 	collector->get_bytes_survived_last_sweep = get_bytes_survived_last_sweep;
@@ -2507,6 +3014,19 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 		collector->major_ops_concurrent_finish.copy_or_mark_object = major_copy_or_mark_object_concurrent_finish_canonical;
 		collector->major_ops_concurrent_finish.scan_object = major_scan_object_no_evacuation;
 		collector->major_ops_concurrent_finish.scan_vtype = major_scan_vtype_concurrent_finish;
+
+		if (is_parallel) {
+			/* The finishing pause uses the serial ops above once the workers are done. */
+			collector->major_ops_concurrent_start.copy_or_mark_object = major_copy_or_mark_object_concurrent_par_canonical;
+			collector->major_ops_concurrent_start.scan_object = major_scan_object_no_mark_concurrent_start_par;
+
+			collector->major_ops_concurrent.copy_or_mark_object = major_copy_or_mark_object_concurrent_par_canonical;
+			collector->major_ops_concurrent.scan_object = major_scan_object_no_mark_concurrent_par;
+
+			collector->major_ops_conc_par_finish.copy_or_mark_object = major_copy_or_mark_object_conc_par_finish_canonical;
+			collector->major_ops_conc_par_finish.scan_object = major_scan_object_no_evacuation_par;
+			collector->major_ops_conc_par_finish.scan_vtype = major_scan_vtype_concurrent_finish_par;
+		}
 	}
 
 #if !defined (FIXED_HEAP) && !defined (SGEN_PARALLEL_MARK)
@@ -2544,13 +3064,19 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 void
 sgen_marksweep_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, FALSE);
+	sgen_marksweep_init_internal (collector, FALSE, FALSE);
 }
 
 void
 sgen_marksweep_conc_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, TRUE);
+	sgen_marksweep_init_internal (collector, TRUE, FALSE);
+}
+
+void
+sgen_marksweep_conc_par_init (SgenMajorCollector *collector)
+{
+	sgen_marksweep_init_internal (collector, TRUE, TRUE);
 }
 
 #endif
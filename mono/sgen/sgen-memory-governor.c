@@ -253,6 +253,16 @@ sgen_free_os_memory (void *addr, size_t size, SgenAllocFlags flags)
 	total_alloc_max = MAX (total_alloc_max, total_alloc);
 }
 
+/*
+ * Give the pages back to the OS, but keep them mapped.  They read as zero when they're
+ * touched again.
+ */
+void
+sgen_decommit_os_memory (void *addr, size_t size)
+{
+	mono_mprotect (addr, size, MONO_MMAP_READ | MONO_MMAP_WRITE | MONO_MMAP_DISCARD);
+}
+
 size_t
 sgen_gc_get_total_heap_allocation (void)
 {
@@ -282,7 +292,7 @@ gboolean
 sgen_memgov_try_alloc_space (mword size, int space)
 {
 	if (sgen_memgov_available_free_space () < size) {
-		SGEN_ASSERT (4, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Memory shouldn't run out in worker thread");
+		SGEN_ASSERT (4, sgen_collection_is_parallel () || !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Memory shouldn't run out in worker thread");
 		return FALSE;
 	}
 
@@ -52,6 +52,7 @@ typedef enum {
 void* sgen_alloc_os_memory (size_t size, SgenAllocFlags flags, const char *assert_description);
 void* sgen_alloc_os_memory_aligned (size_t size, mword alignment, SgenAllocFlags flags, const char *assert_description);
 void sgen_free_os_memory (void *addr, size_t size, SgenAllocFlags flags);
+void sgen_decommit_os_memory (void *addr, size_t size);
 
 /* Error handling */
 void sgen_assert_memory_alloc (void *ptr, size_t requested_size, const char *assert_description);
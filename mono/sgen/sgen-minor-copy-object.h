@@ -26,6 +26,20 @@ extern guint64 stat_nursery_copy_object_failed_to_space; /* from sgen-gc.c */
 
 #include "sgen-copy-object.h"
 
+/*
+ * If SGEN_PARALLEL_COPY is defined, the functions are generated for the workers of a
+ * parallel nursery collection, which copy objects concurrently with each other.
+ */
+#undef COPY_OBJECT_NO_CHECKS
+#undef ADD_TO_GLOBAL_REMSET
+#ifdef SGEN_PARALLEL_COPY
+#define COPY_OBJECT_NO_CHECKS copy_object_no_checks_par
+#define ADD_TO_GLOBAL_REMSET sgen_add_to_global_remset_par
+#else
+#define COPY_OBJECT_NO_CHECKS copy_object_no_checks
+#define ADD_TO_GLOBAL_REMSET sgen_add_to_global_remset
+#endif
+
 /*
  * This is how the copying happens from the nursery to the old generation.
  * We assume that at this time all the pinned objects have been identified and
@@ -95,7 +109,7 @@ SERIAL_COPY_OBJECT (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
-	copy = copy_object_no_checks (obj, queue);
+	copy = COPY_OBJECT_NO_CHECKS (obj, queue);
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 }
 
@@ -135,7 +149,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		SGEN_UPDATE_REFERENCE (obj_slot, forwarded);
 #ifndef SGEN_SIMPLE_NURSERY
 		if (G_UNLIKELY (sgen_ptr_in_nursery (forwarded) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (forwarded)))
-			sgen_add_to_global_remset (obj_slot, forwarded);
+			ADD_TO_GLOBAL_REMSET (obj_slot, forwarded);
 #endif
 		return;
 	}
@@ -144,7 +158,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		SGEN_LOG (9, " (pinned, no change)");
 		HEAVY_STAT (++stat_nursery_copy_object_failed_pinned);
 		if (!sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (obj))
-			sgen_add_to_global_remset (obj_slot, obj);
+			ADD_TO_GLOBAL_REMSET (obj_slot, obj);
 		return;
 	}
 
@@ -189,7 +203,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		 * most once would be the icing on the cake.
 		 */
 		if (!sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (obj))
-			sgen_add_to_global_remset (obj_slot, obj);
+			ADD_TO_GLOBAL_REMSET (obj_slot, obj);
 
 		return;
 	}
@@ -197,20 +211,21 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
-	copy = copy_object_no_checks (obj, queue);
+	copy = COPY_OBJECT_NO_CHECKS (obj, queue);
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 #ifndef SGEN_SIMPLE_NURSERY
 	if (G_UNLIKELY (sgen_ptr_in_nursery (copy) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (copy)))
-		sgen_add_to_global_remset (obj_slot, copy);
+		ADD_TO_GLOBAL_REMSET (obj_slot, copy);
 #else
-	/* copy_object_no_checks () can return obj on OOM */
+	/* COPY_OBJECT_NO_CHECKS () can return obj on OOM */
 	if (G_UNLIKELY (obj == copy)) {
 		if (G_UNLIKELY (sgen_ptr_in_nursery (copy) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (copy)))
-			sgen_add_to_global_remset (obj_slot, copy);
+			ADD_TO_GLOBAL_REMSET (obj_slot, copy);
 	}
 #endif
 }
 
-#define FILL_MINOR_COLLECTOR_COPY_OBJECT(collector)	do {			\
-		(collector)->serial_ops.copy_or_mark_object = SERIAL_COPY_OBJECT;			\
+#undef FILL_MINOR_COLLECTOR_COPY_OBJECT
+#define FILL_MINOR_COLLECTOR_COPY_OBJECT(ops)	do {			\
+		(ops)->copy_or_mark_object = SERIAL_COPY_OBJECT;			\
 	} while (0)
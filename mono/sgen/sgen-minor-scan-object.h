@@ -21,13 +21,26 @@
 
 extern guint64 stat_scan_object_called_nursery;
 
+#undef SERIAL_SCAN_OBJECT
+#undef SERIAL_SCAN_VTYPE
+
 #if defined(SGEN_SIMPLE_NURSERY)
+#ifdef SGEN_PARALLEL_COPY
+#define SERIAL_SCAN_OBJECT simple_nursery_parallel_scan_object
+#define SERIAL_SCAN_VTYPE simple_nursery_parallel_scan_vtype
+#else
 #define SERIAL_SCAN_OBJECT simple_nursery_serial_scan_object
 #define SERIAL_SCAN_VTYPE simple_nursery_serial_scan_vtype
+#endif
 
 #elif defined (SGEN_SPLIT_NURSERY)
+#ifdef SGEN_PARALLEL_COPY
+#define SERIAL_SCAN_OBJECT split_nursery_parallel_scan_object
+#define SERIAL_SCAN_VTYPE split_nursery_parallel_scan_vtype
+#else
 #define SERIAL_SCAN_OBJECT split_nursery_serial_scan_object
 #define SERIAL_SCAN_VTYPE split_nursery_serial_scan_vtype
+#endif
 
 #else
 #error "Please define GC_CONF_NAME"
@@ -80,7 +93,8 @@ SERIAL_SCAN_VTYPE (GCObject *full_object, char *start, SgenDescriptor desc, Sgen
 #include "sgen-scan-object.h"
 }
 
-#define FILL_MINOR_COLLECTOR_SCAN_OBJECT(collector)	do {			\
-		(collector)->serial_ops.scan_object = SERIAL_SCAN_OBJECT;	\
-		(collector)->serial_ops.scan_vtype = SERIAL_SCAN_VTYPE; \
+#undef FILL_MINOR_COLLECTOR_SCAN_OBJECT
+#define FILL_MINOR_COLLECTOR_SCAN_OBJECT(ops)	do {			\
+		(ops)->scan_object = SERIAL_SCAN_OBJECT;	\
+		(ops)->scan_vtype = SERIAL_SCAN_VTYPE; \
 	} while (0)
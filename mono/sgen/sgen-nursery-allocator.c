@@ -82,6 +82,13 @@ static char *nursery_last_pinned_end = NULL;
 char *sgen_nursery_start;
 char *sgen_nursery_end;
 
+/*
+ * The mutator only gets fragments below this.  It's the nursery end unless the
+ * nursery is sized adaptively.
+ */
+static char *nursery_usable_end;
+static mword nursery_usable_size;
+
 #ifdef USER_CONFIG
 size_t sgen_nursery_size = (1 << 22);
 int sgen_nursery_bits = 22;
@@ -700,6 +707,22 @@ add_nursery_frag (SgenFragmentAllocator *allocator, size_t frag_size, char* frag
 	}
 }
 
+/*
+ * Like add_nursery_frag (), but the part of the fragment above the usable nursery end
+ * is only cleared.
+ */
+static void
+add_usable_nursery_frag (SgenFragmentAllocator *allocator, char* frag_start, char* frag_end)
+{
+	if (frag_end > nursery_usable_end) {
+		char *usable_end = MAX (frag_start, nursery_usable_end);
+		sgen_clear_range (usable_end, frag_end);
+		frag_end = usable_end;
+	}
+	if (frag_end > frag_start)
+		add_nursery_frag (allocator, frag_end - frag_start, frag_start, frag_end);
+}
+
 static void
 fragment_list_reverse (SgenFragmentAllocator *allocator)
 {
@@ -775,7 +798,7 @@ sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpi
 		g_assert (frag_size >= 0);
 		g_assert (size > 0);
 		if (frag_size && size)
-			add_nursery_frag (&mutator_allocator, frag_size, frag_start, frag_end);	
+			add_usable_nursery_frag (&mutator_allocator, frag_start, frag_end);
 
 		frag_size = size;
 #ifdef NALLOC_DEBUG
@@ -788,7 +811,7 @@ sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpi
 	frag_end = sgen_nursery_end;
 	frag_size = frag_end - frag_start;
 	if (frag_size)
-		add_nursery_frag (&mutator_allocator, frag_size, frag_start, frag_end);
+		add_usable_nursery_frag (&mutator_allocator, frag_start, frag_end);
 
 	/* Now it's safe to release the fragments exclude list. */
 	sgen_minor_collector.build_fragments_release_exclude_head ();
@@ -889,6 +912,7 @@ void
 sgen_init_nursery_allocator (void)
 {
 	sgen_register_fixed_internal_mem_type (INTERNAL_MEM_FRAGMENT, sizeof (SgenFragment));
+	mono_counters_register ("Nursery usable size", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &nursery_usable_size);
 #ifdef NALLOC_DEBUG
 	alloc_records = sgen_alloc_os_memory (sizeof (AllocRecord) * ALLOC_RECORD_COUNT, SGEN_ALLOC_INTERNAL | SGEN_ALLOC_ACTIVATE, "debugging memory");
 #endif
@@ -911,6 +935,8 @@ sgen_nursery_allocator_set_nursery_bounds (char *start, char *end)
 {
 	sgen_nursery_start = start;
 	sgen_nursery_end = end;
+	nursery_usable_end = end;
+	nursery_usable_size = end - start;
 
 	/*
 	 * This will not divide evenly for tiny nurseries (<4kb), so we make sure to be on
@@ -924,4 +950,22 @@ sgen_nursery_allocator_set_nursery_bounds (char *start, char *end)
 	sgen_minor_collector.init_nursery (&mutator_allocator, start, end);
 }
 
+/*
+ * Limits the fragments the mutator gets to the first `size` bytes of the nursery.
+ * Takes effect the next time the fragments are built.
+ */
+void
+sgen_nursery_allocator_set_usable_size (size_t size)
+{
+	SGEN_ASSERT (0, size > 0 && size <= (size_t)(sgen_nursery_end - sgen_nursery_start), "Invalid usable nursery size");
+	nursery_usable_end = sgen_nursery_start + size;
+	nursery_usable_size = size;
+}
+
+size_t
+sgen_nursery_allocator_get_usable_size (void)
+{
+	return nursery_usable_size;
+}
+
 #endif
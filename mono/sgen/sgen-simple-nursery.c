@@ -29,13 +29,54 @@
 #include "mono/sgen/sgen-protocol.h"
 #include "mono/sgen/sgen-layout-stats.h"
 #include "mono/sgen/sgen-client.h"
+#include "mono/sgen/sgen-thread-pool.h"
+
+static mword bytes_promoted;
+
+/*
+ * The workers of parallel collections each count into their own slot, so promotion
+ * doesn't bounce a shared counter between them.  The slots are padded to keep them
+ * on separate cache lines.
+ */
+typedef struct {
+	mword bytes_promoted;
+	char pad [64 - sizeof (mword)];
+} WorkerPromotionCount;
+
+static WorkerPromotionCount *worker_promotion_counts;
+static int num_workers_with_promotion_counts;
 
 static inline GCObject*
 alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references)
 {
+	bytes_promoted += objsize;
 	return major_collector.alloc_object (vtable, objsize, has_references);
 }
 
+static inline GCObject*
+alloc_for_promotion_par (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references)
+{
+	int worker_index = sgen_thread_pool_get_current_thread_index ();
+
+	SGEN_ASSERT (9, worker_index >= 0 && worker_index < num_workers_with_promotion_counts, "Parallel promotion must happen in a worker thread");
+	worker_promotion_counts [worker_index].bytes_promoted += objsize;
+	return major_collector.alloc_object_par (vtable, objsize, has_references);
+}
+
+static mword
+get_and_reset_bytes_promoted (void)
+{
+	mword result = bytes_promoted;
+	int i;
+
+	bytes_promoted = 0;
+	for (i = 0; i < num_workers_with_promotion_counts; ++i) {
+		result += worker_promotion_counts [i].bytes_promoted;
+		worker_promotion_counts [i].bytes_promoted = 0;
+	}
+	return result;
+}
+
 static SgenFragment*
 build_fragments_get_exclude_head (void)
 {
@@ -55,6 +96,10 @@ build_fragments_finish (SgenFragmentAllocator *allocator)
 static void
 prepare_to_space (char *to_space_bitmap, size_t space_bitmap_size)
 {
+	if (sgen_collection_is_parallel () && !worker_promotion_counts) {
+		num_workers_with_promotion_counts = sgen_thread_pool_get_num_threads ();
+		worker_promotion_counts = g_new0 (WorkerPromotionCount, num_workers_with_promotion_counts);
+	}
 }
 
 static void
@@ -73,18 +118,46 @@ init_nursery (SgenFragmentAllocator *allocator, char *start, char *end)
 
 #define SGEN_SIMPLE_NURSERY
 
+#define COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION alloc_for_promotion_par
+
 #define SERIAL_COPY_OBJECT simple_nursery_serial_copy_object
 #define SERIAL_COPY_OBJECT_FROM_OBJ simple_nursery_serial_copy_object_from_obj
 
 #include "sgen-minor-copy-object.h"
 #include "sgen-minor-scan-object.h"
 
+static void
+fill_serial_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
+#define SGEN_PARALLEL_COPY
+
+#undef SERIAL_COPY_OBJECT
+#undef SERIAL_COPY_OBJECT_FROM_OBJ
+#define SERIAL_COPY_OBJECT simple_nursery_parallel_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ simple_nursery_parallel_copy_object_from_obj
+
+#include "sgen-minor-copy-object.h"
+#include "sgen-minor-scan-object.h"
+
+static void
+fill_parallel_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
 void
-sgen_simple_nursery_init (SgenMinorCollector *collector)
+sgen_simple_nursery_init (SgenMinorCollector *collector, gboolean parallel)
 {
 	collector->is_split = FALSE;
+	collector->is_parallel = parallel;
 
 	collector->alloc_for_promotion = alloc_for_promotion;
+	collector->alloc_for_promotion_par = alloc_for_promotion_par;
 
 	collector->prepare_to_space = prepare_to_space;
 	collector->clear_fragments = clear_fragments;
@@ -92,9 +165,11 @@ sgen_simple_nursery_init (SgenMinorCollector *collector)
 	collector->build_fragments_release_exclude_head = build_fragments_release_exclude_head;
 	collector->build_fragments_finish = build_fragments_finish;
 	collector->init_nursery = init_nursery;
+	collector->get_and_reset_bytes_promoted = get_and_reset_bytes_promoted;
 
-	FILL_MINOR_COLLECTOR_COPY_OBJECT (collector);
-	FILL_MINOR_COLLECTOR_SCAN_OBJECT (collector);
+	fill_serial_ops (&collector->serial_ops);
+	if (parallel)
+		fill_parallel_ops (&collector->parallel_ops);
 }
 
 
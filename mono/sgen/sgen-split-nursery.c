@@ -33,6 +33,7 @@
 #include "mono/sgen/sgen-protocol.h"
 #include "mono/sgen/sgen-layout-stats.h"
 #include "mono/sgen/sgen-client.h"
+#include "mono/sgen/sgen-thread-pool.h"
 #include "mono/utils/mono-memory-model.h"
 
 /*
@@ -144,6 +145,15 @@ static char *region_age;
 static size_t region_age_size;
 static AgeAllocationBuffer age_alloc_buffers [MAX_AGE];
 
+/*
+ * In parallel collections each worker has its own set of age allocation buffers,
+ * `MAX_AGE` per worker.  They are refilled from the collector allocator with
+ * `par_alloc_buffer_refill_mutex` held.
+ */
+static AgeAllocationBuffer *worker_age_alloc_buffers;
+static int num_workers_with_age_alloc_buffers;
+static mono_mutex_t par_alloc_buffer_refill_mutex;
+
 /* The collector allocs from here. */
 static SgenFragmentAllocator collector_allocator;
 
@@ -238,7 +248,7 @@ fragment_list_split (SgenFragmentAllocator *allocator)
 #define AGE_ALLOC_BUFFER_DESIRED_SIZE (SGEN_TO_SPACE_GRANULE_IN_BYTES * 8)
 
 static char*
-alloc_for_promotion_slow_path (int age, size_t objsize)
+alloc_for_promotion_slow_path (AgeAllocationBuffer *buffers, int age, size_t objsize)
 {
 	char *p;
 	size_t allocated_size;
@@ -251,9 +261,9 @@ alloc_for_promotion_slow_path (int age, size_t objsize)
 		&allocated_size);
 	if (p) {
 		set_age_in_range (p, p + allocated_size, age);
-		sgen_clear_range (age_alloc_buffers [age].next, age_alloc_buffers [age].end);
-		age_alloc_buffers [age].next = p + objsize;
-		age_alloc_buffers [age].end = p + allocated_size;
+		sgen_clear_range (buffers [age].next, buffers [age].end);
+		buffers [age].next = p + objsize;
+		buffers [age].end = p + allocated_size;
 	}
 	return p;
 }
@@ -275,7 +285,7 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	if (G_LIKELY (p + objsize <= age_alloc_buffers [age].end)) {
         age_alloc_buffers [age].next += objsize;
 	} else {
-		p = alloc_for_promotion_slow_path (age, objsize);
+		p = alloc_for_promotion_slow_path (age_alloc_buffers, age, objsize);
 		if (!p)
 			return major_collector.alloc_object (vtable, objsize, has_references);
 	}
@@ -286,6 +296,56 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	return (GCObject*)p;
 }
 
+/*
+ * This is only used by the workers of parallel collections, which never evacuate major
+ * blocks, so OBJ is always in the nursery.
+ */
+static GCObject*
+minor_alloc_for_promotion_par (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references)
+{
+	AgeAllocationBuffer *buffers;
+	char *p;
+	int age, worker_index;
+
+	age = get_object_age (obj);
+	if (age >= promote_age)
+		return major_collector.alloc_object_par (vtable, objsize, has_references);
+
+	/* Promote! */
+	++age;
+
+	worker_index = sgen_thread_pool_get_current_thread_index ();
+	SGEN_ASSERT (9, worker_index >= 0 && worker_index < num_workers_with_age_alloc_buffers, "Parallel promotion must happen in a worker thread");
+	buffers = &worker_age_alloc_buffers [worker_index * MAX_AGE];
+
+	p = buffers [age].next;
+	if (G_LIKELY (p + objsize <= buffers [age].end)) {
+		buffers [age].next += objsize;
+	} else {
+		mono_mutex_lock (&par_alloc_buffer_refill_mutex);
+		p = alloc_for_promotion_slow_path (buffers, age, objsize);
+		mono_mutex_unlock (&par_alloc_buffer_refill_mutex);
+		if (!p)
+			return major_collector.alloc_object_par (vtable, objsize, has_references);
+	}
+
+	/* FIXME: assumes object layout */
+	*(GCVTable*)p = vtable;
+
+	return (GCObject*)p;
+}
+
+static void
+clear_age_alloc_buffers (AgeAllocationBuffer *buffers)
+{
+	int i;
+	for (i = 0; i < MAX_AGE; ++i) {
+		/*If we OOM'd on the last collection ->end might be null while ->next not.*/
+		if (buffers [i].end)
+			sgen_clear_range (buffers [i].next, buffers [i].end);
+	}
+}
+
 static GCObject*
 minor_alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references)
 {
@@ -302,11 +362,10 @@ static SgenFragment*
 build_fragments_get_exclude_head (void)
 {
 	int i;
-	for (i = 0; i < MAX_AGE; ++i) {
-		/*If we OOM'd on the last collection ->end might be null while ->next not.*/
-		if (age_alloc_buffers [i].end)
-			sgen_clear_range (age_alloc_buffers [i].next, age_alloc_buffers [i].end);
-	}
+
+	clear_age_alloc_buffers (age_alloc_buffers);
+	for (i = 0; i < num_workers_with_age_alloc_buffers; ++i)
+		clear_age_alloc_buffers (&worker_age_alloc_buffers [i * MAX_AGE]);
 
 	return collector_allocator.region_head;
 }
@@ -333,6 +392,14 @@ prepare_to_space (char *to_space_bitmap, size_t space_bitmap_size)
 	memset (to_space_bitmap, 0, space_bitmap_size);
 	memset (age_alloc_buffers, 0, sizeof (age_alloc_buffers));
 
+	if (sgen_collection_is_parallel ()) {
+		if (!worker_age_alloc_buffers) {
+			num_workers_with_age_alloc_buffers = sgen_thread_pool_get_num_threads ();
+			worker_age_alloc_buffers = g_new0 (AgeAllocationBuffer, num_workers_with_age_alloc_buffers * MAX_AGE);
+		}
+		memset (worker_age_alloc_buffers, 0, sizeof (AgeAllocationBuffer) * num_workers_with_age_alloc_buffers * MAX_AGE);
+	}
+
 	previous = &collector_allocator.alloc_head;
 
 	for (frag = *previous; frag; frag = *previous) {
@@ -427,18 +494,46 @@ print_gc_param_usage (void)
 
 #define SGEN_SPLIT_NURSERY
 
+#define COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION minor_alloc_for_promotion_par
+
 #define SERIAL_COPY_OBJECT split_nursery_serial_copy_object
 #define SERIAL_COPY_OBJECT_FROM_OBJ split_nursery_serial_copy_object_from_obj
 
 #include "sgen-minor-copy-object.h"
 #include "sgen-minor-scan-object.h"
 
+static void
+fill_serial_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
+#define SGEN_PARALLEL_COPY
+
+#undef SERIAL_COPY_OBJECT
+#undef SERIAL_COPY_OBJECT_FROM_OBJ
+#define SERIAL_COPY_OBJECT split_nursery_parallel_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ split_nursery_parallel_copy_object_from_obj
+
+#include "sgen-minor-copy-object.h"
+#include "sgen-minor-scan-object.h"
+
+static void
+fill_parallel_ops (SgenObjectOperations *ops)
+{
+	FILL_MINOR_COLLECTOR_COPY_OBJECT (ops);
+	FILL_MINOR_COLLECTOR_SCAN_OBJECT (ops);
+}
+
 void
-sgen_split_nursery_init (SgenMinorCollector *collector)
+sgen_split_nursery_init (SgenMinorCollector *collector, gboolean parallel)
 {
 	collector->is_split = TRUE;
+	collector->is_parallel = parallel;
 
 	collector->alloc_for_promotion = minor_alloc_for_promotion;
+	collector->alloc_for_promotion_par = minor_alloc_for_promotion_par;
 
 	collector->prepare_to_space = prepare_to_space;
 	collector->clear_fragments = clear_fragments;
@@ -449,8 +544,12 @@ sgen_split_nursery_init (SgenMinorCollector *collector)
 	collector->handle_gc_param = handle_gc_param;
 	collector->print_gc_param_usage = print_gc_param_usage;
 
-	FILL_MINOR_COLLECTOR_COPY_OBJECT (collector);
-	FILL_MINOR_COLLECTOR_SCAN_OBJECT (collector);
+	/* Parallel major collections promote with the workers, too. */
+	mono_mutex_init (&par_alloc_buffer_refill_mutex);
+
+	fill_serial_ops (&collector->serial_ops);
+	if (parallel)
+		fill_parallel_ops (&collector->parallel_ops);
 }
 
 
@@ -24,6 +24,7 @@
 #include "mono/sgen/sgen-thread-pool.h"
 #include "mono/sgen/sgen-pointer-queue.h"
 #include "mono/utils/mono-mutex.h"
+#include "mono/utils/mono-tls.h"
 #ifndef SGEN_WITHOUT_MONO
 #include "mono/utils/mono-threads.h"
 #endif
@@ -32,7 +33,12 @@ static mono_mutex_t lock;
 static mono_cond_t work_cond;
 static mono_cond_t done_cond;
 
-static MonoNativeThreadId thread;
+static int threads_num;
+static MonoNativeThreadId threads [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static void *threads_data [SGEN_THREADPOOL_MAX_NUM_THREADS];
+
+/* Holds the index of the current thread pool thread plus one, so zero means none. */
+static MonoNativeTlsKey thread_index_key;
 
 /* Only accessed with the lock held. */
 static SgenPointerQueue job_queue;
@@ -86,16 +92,21 @@ remove_job (SgenThreadPoolJob *job)
 }
 
 static gboolean
-continue_idle_job (void)
+continue_idle_job (void *thread_data)
 {
 	if (!continue_idle_job_func)
 		return FALSE;
-	return continue_idle_job_func ();
+	return continue_idle_job_func (thread_data);
 }
 
 static mono_native_thread_return_t
-thread_func (void *thread_data)
+thread_func (void *index_untyped)
 {
+	int index = GPOINTER_TO_INT (index_untyped);
+	void *thread_data = threads_data [index];
+
+	mono_native_tls_set_value (thread_index_key, GINT_TO_POINTER (index + 1));
+
 	thread_init_func (thread_data);
 
 	mono_mutex_lock (&lock);
@@ -106,7 +117,7 @@ thread_func (void *thread_data)
 		 * main thread might then set continue idle and signal us before we can take
 		 * the lock, and we'd lose the signal.
 		 */
-		gboolean do_idle = continue_idle_job ();
+		gboolean do_idle = continue_idle_job (thread_data);
 		SgenThreadPoolJob *job = get_job_and_set_in_progress ();
 
 		if (!job && !do_idle) {
@@ -139,7 +150,7 @@ thread_func (void *thread_data)
 			SGEN_ASSERT (0, idle_job_func, "Why do we have idle work when there's no idle job function?");
 			do {
 				idle_job_func (thread_data);
-				do_idle = continue_idle_job ();
+				do_idle = continue_idle_job (thread_data);
 			} while (do_idle && !job_queue.next_slot);
 
 			mono_mutex_lock (&lock);
@@ -155,7 +166,13 @@ thread_func (void *thread_data)
 void
 sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas)
 {
-	SGEN_ASSERT (0, num_threads == 1, "We only support 1 thread pool thread for now.");
+	int i;
+
+	SGEN_ASSERT (0, num_threads > 0 && num_threads <= SGEN_THREADPOOL_MAX_NUM_THREADS, "Invalid number of thread pool threads %d", num_threads);
+
+	threads_num = num_threads;
+
+	mono_native_tls_alloc (&thread_index_key, NULL);
 
 	mono_mutex_init (&lock);
 	mono_cond_init (&work_cond, 0);
@@ -165,7 +182,10 @@ sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func,
 	idle_job_func = idle_func;
 	continue_idle_job_func = continue_idle_func;
 
-	mono_native_thread_create (&thread, thread_func, thread_datas ? thread_datas [0] : NULL);
+	for (i = 0; i < threads_num; ++i)
+		threads_data [i] = thread_datas ? thread_datas [i] : NULL;
+	for (i = 0; i < threads_num; ++i)
+		mono_native_thread_create (&threads [i], thread_func, GINT_TO_POINTER (i));
 }
 
 SgenThreadPoolJob*
@@ -192,8 +212,9 @@ sgen_thread_pool_job_enqueue (SgenThreadPoolJob *job)
 
 	sgen_pointer_queue_add (&job_queue, job);
 	/*
-	 * FIXME: We could check whether there is a job in progress.  If there is, there's
-	 * no need to signal the condition, at least as long as we have only one thread.
+	 * One job only needs one thread, so there's no need to broadcast.  The other
+	 * threads will pick up any remaining jobs once they're done with their current
+	 * work.
 	 */
 	mono_cond_signal (&work_cond);
 
@@ -220,8 +241,9 @@ sgen_thread_pool_idle_signal (void)
 
 	mono_mutex_lock (&lock);
 
-	if (continue_idle_job_func ())
-		mono_cond_signal (&work_cond);
+	/* Idle work is done by all threads, so wake up every one of them. */
+	if (continue_idle_job_func (NULL))
+		mono_cond_broadcast (&work_cond);
 
 	mono_mutex_unlock (&lock);
 }
@@ -233,7 +255,7 @@ sgen_thread_pool_idle_wait (void)
 
 	mono_mutex_lock (&lock);
 
-	while (continue_idle_job_func ())
+	while (continue_idle_job_func (NULL))
 		mono_cond_wait (&done_cond, &lock);
 
 	mono_mutex_unlock (&lock);
@@ -250,10 +272,32 @@ sgen_thread_pool_wait_for_all_jobs (void)
 	mono_mutex_unlock (&lock);
 }
 
+int
+sgen_thread_pool_get_num_threads (void)
+{
+	return threads_num;
+}
+
+/*
+ * Returns the index of the calling thread in the thread pool, or -1 if it's not a thread
+ * pool thread.
+ */
+int
+sgen_thread_pool_get_current_thread_index (void)
+{
+	return GPOINTER_TO_INT (mono_native_tls_get_value (thread_index_key)) - 1;
+}
+
 gboolean
 sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId some_thread)
 {
-	return some_thread == thread;
+	int i;
+
+	for (i = 0; i < threads_num; ++i) {
+		if (some_thread == threads [i])
+			return TRUE;
+	}
+	return FALSE;
 }
 
 #endif
@@ -20,6 +20,8 @@
 #ifndef __MONO_SGEN_THREAD_POOL_H__
 #define __MONO_SGEN_THREAD_POOL_H__
 
+#define SGEN_THREADPOOL_MAX_NUM_THREADS	32
+
 typedef struct _SgenThreadPoolJob SgenThreadPoolJob;
 
 typedef void (*SgenThreadPoolJobFunc) (void *thread_data, SgenThreadPoolJob *job);
@@ -33,7 +35,11 @@ struct _SgenThreadPoolJob {
 
 typedef void (*SgenThreadPoolThreadInitFunc) (void*);
 typedef void (*SgenThreadPoolIdleJobFunc) (void*);
-typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void);
+/*
+ * Called with the data of a thread pool thread to ask whether that thread should keep
+ * doing idle work, or with NULL to ask whether any thread should.
+ */
+typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void*);
 
 void sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas);
 
@@ -50,6 +56,8 @@ void sgen_thread_pool_idle_wait (void);
 
 void sgen_thread_pool_wait_for_all_jobs (void);
 
+int sgen_thread_pool_get_num_threads (void);
+int sgen_thread_pool_get_current_thread_index (void);
 gboolean sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId thread);
 
 #endif
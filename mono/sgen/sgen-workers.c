@@ -41,15 +41,17 @@ static gboolean workers_distribute_gray_queue_inited;
  *
  * | from \ to          | NOT WORKING | WORKING | WORK ENQUEUED |
  * |--------------------+-------------+---------+---------------+
- * | NOT WORKING        | -           | -       | main          |
- * | WORKING            | worker      | -       | main          |
+ * | NOT WORKING        | -           | -       | main / worker |
+ * | WORKING            | worker      | -       | main / worker |
  * | WORK ENQUEUED      | -           | worker  | -             |
  *
- * The WORK ENQUEUED state guarantees that the worker thread will inspect the queue again at
- * least once.  Only after looking at the queue will it go back to WORKING, and then,
- * eventually, to NOT WORKING.  After enqueuing work the main thread transitions the state
- * to WORK ENQUEUED.  Signalling the worker thread to wake up is only necessary if the old
- * state was NOT WORKING.
+ * Each worker has its own state.  The WORK ENQUEUED state guarantees that the worker
+ * thread will inspect the queues again at least once.  Only after looking at the queues
+ * will it go back to WORKING, and then, eventually, to NOT WORKING.  After enqueuing work
+ * the main thread transitions all the workers to WORK ENQUEUED.  A worker that has more
+ * work than it can handle does the same, so that idle workers can steal from it.
+ * Signalling the worker threads to wake up is only necessary if the old state of one of
+ * them was NOT WORKING.
  */
 
 enum {
@@ -60,14 +62,13 @@ enum {
 
 typedef gint32 State;
 
-static volatile State workers_state;
-
 static SgenObjectOperations * volatile idle_func_object_ops;
 
 static guint64 stat_workers_num_finished;
+static guint64 stat_workers_num_steals;
 
 static gboolean
-set_state (State old_state, State new_state)
+set_state (WorkerData *data, State old_state, State new_state)
 {
 	SGEN_ASSERT (0, old_state != new_state, "Why are we transitioning to the same state?");
 	if (new_state == STATE_NOT_WORKING)
@@ -77,7 +78,7 @@ set_state (State old_state, State new_state)
 	if (new_state == STATE_NOT_WORKING || new_state == STATE_WORKING)
 		SGEN_ASSERT (6, sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Only the worker thread is allowed to transition to NOT_WORKING or WORKING");
 
-	return InterlockedCompareExchange (&workers_state, new_state, old_state) == old_state;
+	return InterlockedCompareExchange (&data->state, new_state, old_state) == old_state;
 }
 
 static gboolean
@@ -89,31 +90,40 @@ state_is_working_or_enqueued (State state)
 void
 sgen_workers_ensure_awake (void)
 {
-	State old_state;
-	gboolean did_set_state;
+	gboolean need_signal = FALSE;
+	int i;
 
-	do {
-		old_state = workers_state;
+	for (i = 0; i < workers_num; ++i) {
+		WorkerData *data = &workers_data [i];
+		State old_state;
+		gboolean did_set_state;
 
-		if (old_state == STATE_WORK_ENQUEUED)
-			break;
+		do {
+			old_state = data->state;
+
+			if (old_state == STATE_WORK_ENQUEUED)
+				break;
 
-		did_set_state = set_state (old_state, STATE_WORK_ENQUEUED);
-	} while (!did_set_state);
+			did_set_state = set_state (data, old_state, STATE_WORK_ENQUEUED);
+		} while (!did_set_state);
+
+		if (!state_is_working_or_enqueued (old_state))
+			need_signal = TRUE;
+	}
 
-	if (!state_is_working_or_enqueued (old_state))
+	if (need_signal)
 		sgen_thread_pool_idle_signal ();
 }
 
 static void
-worker_try_finish (void)
+worker_try_finish (WorkerData *data)
 {
 	State old_state;
 
 	++stat_workers_num_finished;
 
 	do {
-		old_state = workers_state;
+		old_state = data->state;
 
 		SGEN_ASSERT (0, old_state != STATE_NOT_WORKING, "How did we get from doing idle work to NOT WORKING without setting it ourselves?");
 		if (old_state == STATE_WORK_ENQUEUED)
@@ -121,13 +131,13 @@ worker_try_finish (void)
 		SGEN_ASSERT (0, old_state == STATE_WORKING, "What other possibility is there?");
 
 		/* We are the last thread to go to sleep. */
-	} while (!set_state (old_state, STATE_NOT_WORKING));
+	} while (!set_state (data, old_state, STATE_NOT_WORKING));
 }
 
 static gboolean
 collection_needs_workers (void)
 {
-	return sgen_collection_is_concurrent ();
+	return sgen_collection_is_concurrent () || sgen_collection_is_parallel ();
 }
 
 void
@@ -157,60 +167,112 @@ sgen_workers_wait_for_jobs_finished (void)
 }
 
 static gboolean
-workers_get_work (WorkerData *data)
+workers_steal_work (WorkerData *data)
 {
-	SgenMajorCollector *major;
-
-	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
+	int self = data - workers_data;
+	int i;
 
-	/* If we're concurrent, steal from the workers distribute gray queue. */
-	major = sgen_get_major_collector ();
-	if (major->is_concurrent) {
-		GrayQueueSection *section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queue);
+	for (i = 1; i < workers_num; ++i) {
+		WorkerData *victim = &workers_data [(self + i) % workers_num];
+		GrayQueueSection *section = sgen_gray_object_steal_section (&victim->private_gray_queue);
 		if (section) {
 			sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
+			++stat_workers_num_steals;
 			return TRUE;
 		}
 	}
 
+	return FALSE;
+}
+
+static gboolean
+workers_get_work (WorkerData *data)
+{
+	GrayQueueSection *section;
+
+	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
+
+	/* Work that was handed out by the main thread has priority. */
+	section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queue);
+	if (section) {
+		sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
+		return TRUE;
+	}
+
+	/* Otherwise, try to steal from the other workers. */
+	if (workers_steal_work (data))
+		return TRUE;
+
 	/* Nobody to steal from */
 	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
 	return FALSE;
 }
 
+/*
+ * If we have more work than we can handle on our own and some of the other workers are
+ * idle, wake them up so that they can steal from us.
+ */
 static void
-concurrent_enqueue_check (GCObject *obj)
+workers_share_work (WorkerData *data)
 {
+	int i;
+
+	if (workers_num <= 1 || data->private_gray_queue.num_sections <= 1)
+		return;
+
+	for (i = 0; i < workers_num; ++i) {
+		if (workers_data [i].state == STATE_NOT_WORKING) {
+			sgen_workers_ensure_awake ();
+			return;
+		}
+	}
+}
+
+static void
+workers_enqueue_check (GCObject *obj)
+{
+	g_assert (SGEN_LOAD_VTABLE (obj));
+	if (sgen_collection_is_parallel ())
+		return;
 	g_assert (sgen_concurrent_collection_in_progress ());
 	g_assert (!sgen_ptr_in_nursery (obj));
-	g_assert (SGEN_LOAD_VTABLE (obj));
 }
 
 static void
 init_private_gray_queue (WorkerData *data)
 {
-	sgen_gray_object_queue_init (&data->private_gray_queue,
-			sgen_get_major_collector ()->is_concurrent ? concurrent_enqueue_check : NULL);
+	sgen_gray_object_queue_init (&data->private_gray_queue, workers_enqueue_check);
+	sgen_gray_object_queue_init_parallel (&data->private_gray_queue);
 }
 
 static void
 thread_pool_init_func (void *data_untyped)
 {
 	WorkerData *data = data_untyped;
-	SgenMajorCollector *major = sgen_get_major_collector ();
 
 	sgen_client_thread_register_worker ();
 
-	if (!major->is_concurrent)
+	if (!data)
 		return;
 
 	init_private_gray_queue (data);
 }
 
 static gboolean
-continue_idle_func (void)
+continue_idle_func (void *data_untyped)
 {
-	return state_is_working_or_enqueued (workers_state);
+	int i;
+
+	if (data_untyped) {
+		WorkerData *data = data_untyped;
+		return state_is_working_or_enqueued (data->state);
+	}
+
+	for (i = 0; i < workers_num; ++i) {
+		if (state_is_working_or_enqueued (workers_data [i].state))
+			return TRUE;
+	}
+	return FALSE;
 }
 
 static void
@@ -218,12 +280,12 @@ marker_idle_func (void *data_untyped)
 {
 	WorkerData *data = data_untyped;
 
-	SGEN_ASSERT (0, continue_idle_func (), "Why are we called when we're not supposed to work?");
-	SGEN_ASSERT (0, sgen_concurrent_collection_in_progress (), "The worker should only mark in concurrent collections.");
+	SGEN_ASSERT (0, continue_idle_func (data), "Why are we called when we're not supposed to work?");
+	SGEN_ASSERT (0, sgen_concurrent_collection_in_progress () || sgen_collection_is_parallel (), "The worker should only mark in concurrent or parallel collections.");
 
-	if (workers_state == STATE_WORK_ENQUEUED) {
-		set_state (STATE_WORK_ENQUEUED, STATE_WORKING);
-		SGEN_ASSERT (0, workers_state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
+	if (data->state == STATE_WORK_ENQUEUED) {
+		set_state (data, STATE_WORK_ENQUEUED, STATE_WORKING);
+		SGEN_ASSERT (0, data->state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
 	}
 
 	if (!sgen_gray_object_queue_is_empty (&data->private_gray_queue) || workers_get_work (data)) {
@@ -232,8 +294,10 @@ marker_idle_func (void *data_untyped)
 		SGEN_ASSERT (0, !sgen_gray_object_queue_is_empty (&data->private_gray_queue), "How is our gray queue empty if we just got work?");
 
 		sgen_drain_gray_stack (32, ctx);
+
+		workers_share_work (data);
 	} else {
-		worker_try_finish ();
+		worker_try_finish (data);
 	}
 }
 
@@ -246,26 +310,35 @@ init_distribute_gray_queue (void)
 		return;
 	}
 
-	sgen_section_gray_queue_init (&workers_distribute_gray_queue, TRUE,
-			sgen_get_major_collector ()->is_concurrent ? concurrent_enqueue_check : NULL);
+	sgen_section_gray_queue_init (&workers_distribute_gray_queue, TRUE, workers_enqueue_check);
 	workers_distribute_gray_queue_inited = TRUE;
 }
 
 void
 sgen_workers_init_distribute_gray_queue (void)
 {
-	SGEN_ASSERT (0, sgen_get_major_collector ()->is_concurrent && collection_needs_workers (),
-			"Why should we init the distribute gray queue if we don't need it?");
+	SGEN_ASSERT (0, collection_needs_workers (), "Why should we init the distribute gray queue if we don't need it?");
 	init_distribute_gray_queue ();
 }
 
+/*
+ * The marking workers are only needed if the major collector is concurrent or if the
+ * nursery is collected in parallel.  Otherwise the thread pool only runs jobs, like
+ * sweeping.
+ */
+static gboolean
+workers_are_markers (void)
+{
+	return sgen_get_major_collector ()->is_concurrent || sgen_minor_collector.is_parallel;
+}
+
 void
 sgen_workers_init (int num_workers)
 {
 	int i;
 	void **workers_data_ptrs = alloca(num_workers * sizeof(void *));
 
-	if (!sgen_get_major_collector ()->is_concurrent) {
+	if (!workers_are_markers ()) {
 		sgen_thread_pool_init (num_workers, thread_pool_init_func, NULL, NULL, NULL);
 		return;
 	}
@@ -285,6 +358,7 @@ sgen_workers_init (int num_workers)
 	sgen_thread_pool_init (num_workers, thread_pool_init_func, marker_idle_func, continue_idle_func, workers_data_ptrs);
 
 	mono_counters_register ("# workers finished", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_finished);
+	mono_counters_register ("# workers gray queue steals", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_steals);
 }
 
 void
@@ -309,7 +383,7 @@ sgen_workers_join (void)
 
 	sgen_thread_pool_wait_for_all_jobs ();
 	sgen_thread_pool_idle_wait ();
-	SGEN_ASSERT (0, workers_state == STATE_NOT_WORKING, "Can only signal enqueue work when in no work state");
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Can only signal enqueue work when in no work state");
 
 	/* At this point all the workers have stopped. */
 
@@ -321,14 +395,20 @@ sgen_workers_join (void)
 gboolean
 sgen_workers_all_done (void)
 {
-	return workers_state == STATE_NOT_WORKING;
+	int i;
+
+	for (i = 0; i < workers_num; ++i) {
+		if (workers_data [i].state != STATE_NOT_WORKING)
+			return FALSE;
+	}
+	return TRUE;
 }
 
 /* Must only be used for debugging */
 gboolean
 sgen_workers_are_working (void)
 {
-	return state_is_working_or_enqueued (workers_state);
+	return continue_idle_func (NULL);
 }
 
 void
@@ -25,7 +25,9 @@
 
 typedef struct _WorkerData WorkerData;
 struct _WorkerData {
-	SgenGrayQueue private_gray_queue; /* only read/written by worker thread */
+	volatile gint32 state;
+	/* Only read/written by the worker thread, except for sections being stolen. */
+	SgenGrayQueue private_gray_queue;
 };
 
 void sgen_workers_init (int num_workers);